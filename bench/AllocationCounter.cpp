@@ -0,0 +1,53 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+using namespace std;
+using namespace BeeeOn;
+
+static atomic<size_t> g_allocations(0);
+static atomic<size_t> g_allocatedBytes(0);
+
+static void *countedAlloc(size_t size)
+{
+	g_allocations.fetch_add(1, memory_order_relaxed);
+	g_allocatedBytes.fetch_add(size, memory_order_relaxed);
+
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == nullptr)
+		throw bad_alloc();
+
+	return p;
+}
+
+void *operator new(size_t size)
+{
+	return countedAlloc(size);
+}
+
+void *operator new[](size_t size)
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+size_t AllocationCounter::allocations()
+{
+	return g_allocations.load(memory_order_relaxed);
+}
+
+size_t AllocationCounter::allocatedBytes()
+{
+	return g_allocatedBytes.load(memory_order_relaxed);
+}
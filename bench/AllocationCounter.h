@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+namespace BeeeOn {
+
+/**
+ * @brief AllocationCounter provides statistics of heap allocations
+ * performed via the global operator new. The statistics are available
+ * only in binaries that link AllocationCounter.cpp directly as it
+ * replaces the global operators new and delete.
+ */
+class AllocationCounter {
+public:
+	/**
+	 * @returns number of allocations performed so far
+	 */
+	static size_t allocations();
+
+	/**
+	 * @returns amount of bytes allocated so far
+	 */
+	static size_t allocatedBytes();
+};
+
+}
@@ -0,0 +1,153 @@
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+#include <Poco/DirectoryIterator.h>
+#include <Poco/NumberParser.h>
+#include <Poco/String.h>
+
+#include "Benchmark.h"
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+Benchmark::Benchmark(const string &name):
+	m_name(name),
+	m_elapsed(0),
+	m_ops(0),
+	m_bytes(0)
+{
+}
+
+void Benchmark::start()
+{
+	m_started.update();
+}
+
+void Benchmark::stop()
+{
+	m_elapsed += m_started.elapsed();
+}
+
+void Benchmark::addOps(size_t ops)
+{
+	m_ops += ops;
+}
+
+void Benchmark::addBytes(size_t bytes)
+{
+	m_bytes += bytes;
+}
+
+void Benchmark::set(const string &key, const string &value)
+{
+	m_custom.emplace_back(key, value);
+}
+
+size_t Benchmark::ops() const
+{
+	return m_ops;
+}
+
+size_t Benchmark::bytes() const
+{
+	return m_bytes;
+}
+
+Timespan Benchmark::elapsed() const
+{
+	return m_elapsed;
+}
+
+void Benchmark::report(ostream &out) const
+{
+	const double seconds = m_elapsed / 1000000.0;
+
+	out << m_name
+	    << " ops=" << m_ops
+	    << " time_ms=" << fixed << setprecision(3) << (m_elapsed / 1000.0);
+
+	if (m_ops > 0) {
+		out << " ops_per_s=" << setprecision(1) << (seconds > 0 ? m_ops / seconds : 0)
+		    << " ns_per_op=" << setprecision(1) << (m_elapsed * 1000.0 / m_ops);
+	}
+
+	out << " bytes=" << m_bytes;
+
+	if (m_ops > 0)
+		out << " bytes_per_op=" << setprecision(1) << (m_bytes / (double) m_ops);
+
+	for (const auto &pair : m_custom)
+		out << " " << pair.first << "=" << pair.second;
+
+	out << endl;
+}
+
+size_t Benchmark::writtenBytes()
+{
+	ifstream in("/proc/self/io");
+	string line;
+
+	while (getline(in, line)) {
+		if (line.find("wchar:") != 0)
+			continue;
+
+		UInt64 value = 0;
+		if (NumberParser::tryParseUnsigned64(trim(line.substr(6)), value))
+			return value;
+	}
+
+	return 0;
+}
+
+size_t Benchmark::residentBytes()
+{
+	ifstream in("/proc/self/status");
+	string line;
+
+	while (getline(in, line)) {
+		if (line.find("VmRSS:") != 0)
+			continue;
+
+		string value = trim(line.substr(6));
+		const size_t unit = value.find(' ');
+		if (unit != string::npos)
+			value = value.substr(0, unit);
+
+		UInt64 kbytes = 0;
+		if (NumberParser::tryParseUnsigned64(value, kbytes))
+			return kbytes * 1024;
+	}
+
+	return 0;
+}
+
+vector<SensorData> Benchmark::generate(size_t entries, size_t round)
+{
+	vector<SensorData> data;
+
+	for (size_t i = 0; i < entries; ++i) {
+		data.push_back({
+			DeviceID(0xa300000000000000 | (round * entries + i)),
+			Timestamp(),
+			{{0, 20.5 + i}, {1, 45.0}, {2, (double) round}}
+		});
+	}
+
+	return data;
+}
+
+size_t Benchmark::directorySize(const File &dir, size_t &files)
+{
+	size_t bytes = 0;
+	DirectoryIterator it(dir);
+	const DirectoryIterator end;
+
+	for (; it != end; ++it) {
+		bytes += it->getSize();
+		files += 1;
+	}
+
+	return bytes;
+}
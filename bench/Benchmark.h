@@ -0,0 +1,95 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Poco/Clock.h>
+#include <Poco/File.h>
+#include <Poco/Timespan.h>
+
+#include "model/SensorData.h"
+
+namespace BeeeOn {
+
+/**
+ * @brief Benchmark measures a single benchmarked operation repeated
+ * multiple times. It collects the elapsed time, number of operations
+ * and amount of processed bytes and reports them in a uniform way
+ * as a single line of key=value pairs.
+ */
+class Benchmark {
+public:
+	Benchmark(const std::string &name);
+
+	/**
+	 * @brief Start (or restart) the time measurement.
+	 */
+	void start();
+
+	/**
+	 * @brief Stop the time measurement. The time between start()
+	 * and stop() is added to the total elapsed time.
+	 */
+	void stop();
+
+	/**
+	 * @brief Count the given number of performed operations.
+	 */
+	void addOps(size_t ops);
+
+	/**
+	 * @brief Count the given amount of processed bytes.
+	 */
+	void addBytes(size_t bytes);
+
+	/**
+	 * @brief Append a custom key=value pair to the report.
+	 */
+	void set(const std::string &key, const std::string &value);
+
+	size_t ops() const;
+	size_t bytes() const;
+	Poco::Timespan elapsed() const;
+
+	/**
+	 * @brief Print results as a single line into the given stream.
+	 */
+	void report(std::ostream &out) const;
+
+	/**
+	 * @returns amount of bytes written by the current process
+	 * via the write-like system calls (from /proc/self/io).
+	 * If not available, it returns 0.
+	 */
+	static size_t writtenBytes();
+
+	/**
+	 * @returns resident set size of the current process in bytes
+	 * (VmRSS from /proc/self/status). If not available, it returns 0.
+	 */
+	static size_t residentBytes();
+
+	/**
+	 * @returns the given count of SensorData of distinct devices with
+	 * 3 values each. The round makes the data of each call unique.
+	 */
+	static std::vector<SensorData> generate(size_t entries, size_t round);
+
+	/**
+	 * @returns total size of regular files in the given directory
+	 * (not recursive), their count is added to the files.
+	 */
+	static size_t directorySize(const Poco::File &dir, size_t &files);
+
+private:
+	std::string m_name;
+	Poco::Clock m_started;
+	Poco::Clock::ClockDiff m_elapsed;
+	size_t m_ops;
+	size_t m_bytes;
+	std::vector<std::pair<std::string, std::string>> m_custom;
+};
+
+}
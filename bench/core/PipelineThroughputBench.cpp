@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <Poco/Clock.h>
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+#include <Poco/NumberFormatter.h>
+#include <Poco/NumberParser.h>
+#include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
+
+#include "Benchmark.h"
+#include "core/DeviceManager.h"
+#include "core/QueuingDistributor.h"
+#include "exporters/JournalQueuingStrategy.h"
+#include "gwmessage/GWSensorDataExport.h"
+#include "model/DevicePrefix.h"
+#include "model/ModuleType.h"
+#include "server/GWSConnector.h"
+#include "server/GWSQueuingExporter.h"
+#include "util/SequentialAsyncExecutor.h"
+#include "vdev/VirtualDevice.h"
+#include "vdev/VirtualModule.h"
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+/**
+ * End-to-end benchmark of the data pipeline. Synthetic virtual devices
+ * (devices x modules, each module with the random generator) are shipped
+ * via DeviceManager::ship() at the given rate per device into
+ * the QueuingDistributor. It passes them via ExporterQueue into
+ * the GWSQueuingExporter backed by the JournalQueuingStrategy.
+ * The exporter talks to an in-process connector that confirms each
+ * export immediately and measures the ship-to-export latency.
+ *
+ * The rate 0 means to ship as fast as possible (saturation).
+ *
+ * Usage: bench-pipeline-throughput [devices] [modules] [rate] [duration-s]
+ */
+
+/**
+ * Device manager generating data of its virtual devices periodically.
+ * Each SensorData is timestamped just before being shipped.
+ */
+class SyntheticDeviceManager : public DeviceManager {
+public:
+	SyntheticDeviceManager(size_t devices, size_t modules, size_t rate):
+		DeviceManager(DevicePrefix::PREFIX_VIRTUAL_DEVICE),
+		m_period(rate == 0 ? 0 : Timespan::SECONDS / rate),
+		m_shipped(0)
+	{
+		for (size_t i = 0; i < devices; ++i) {
+			VirtualDevice::Ptr device = new VirtualDevice;
+			device->setID(DeviceID(DevicePrefix::PREFIX_VIRTUAL_DEVICE, i + 1));
+
+			for (size_t j = 0; j < modules; ++j) {
+				VirtualModule::Ptr module = new VirtualModule(
+					ModuleType(ModuleType::Type::TYPE_TEMPERATURE));
+
+				module->setModuleID(j);
+				module->setMin(-20);
+				module->setMax(40);
+				module->setGenerator("random");
+
+				device->addModule(module);
+			}
+
+			m_devices.emplace_back(device);
+		}
+	}
+
+	void run() override
+	{
+		StopControl::Run run(m_stopControl);
+		Clock next;
+
+		while (run) {
+			for (auto &device : m_devices) {
+				SensorData data = device->generate();
+				data.setTimestamp(Timestamp());
+
+				ship(data);
+			}
+
+			m_shipped.fetch_add(m_devices.size());
+
+			if (m_period == 0)
+				continue;
+
+			next += m_period.totalMicroseconds();
+
+			if (next.elapsed() < 0)
+				run.waitStoppable(-next.elapsed());
+		}
+	}
+
+	size_t shipped() const
+	{
+		return m_shipped.load();
+	}
+
+private:
+	vector<VirtualDevice::Ptr> m_devices;
+	Timespan m_period;
+	atomic<size_t> m_shipped;
+};
+
+/**
+ * Connector confirming each GWSensorDataExport immediately. It records
+ * latency of each exported SensorData since its timestamp.
+ */
+class LoopbackGWSConnector : public GWSConnector {
+public:
+	typedef SharedPtr<LoopbackGWSConnector> Ptr;
+
+	void send(const GWMessage::Ptr message) override
+	{
+		fireEvent(message, &GWSListener::onTrySend);
+
+		GWSensorDataExport::Ptr request = message.cast<GWSensorDataExport>();
+		if (!request.isNull()) {
+			const Timestamp now;
+			FastMutex::ScopedLock guard(m_lock);
+
+			for (const auto &data : request->data())
+				m_latencies.emplace_back(now - data.timestamp().value());
+		}
+
+		fireEvent(message, &GWSListener::onSent);
+
+		if (!request.isNull())
+			fireReceived(request->confirm());
+	}
+
+	size_t exported() const
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		return m_latencies.size();
+	}
+
+	/**
+	 * @returns latency of the given percentile (0..100) of all exports
+	 */
+	Timespan percentile(unsigned int p) const
+	{
+		FastMutex::ScopedLock guard(m_lock);
+
+		if (m_latencies.empty())
+			return 0;
+
+		vector<Timestamp::TimeDiff> sorted(m_latencies);
+		const size_t i = (sorted.size() - 1) * p / 100;
+
+		nth_element(sorted.begin(), sorted.begin() + i, sorted.end());
+		return sorted[i];
+	}
+
+private:
+	vector<Timestamp::TimeDiff> m_latencies;
+	mutable FastMutex m_lock;
+};
+
+static string formatMillis(const Timespan &t)
+{
+	return NumberFormatter::format(t.totalMicroseconds() / 1000.0, 3);
+}
+
+static void runPipeline(
+	size_t devices,
+	size_t modules,
+	size_t rate,
+	const Timespan &duration)
+{
+	File rootDir(TemporaryFile::tempName());
+	rootDir.createDirectories();
+
+	Benchmark bench("pipeline");
+
+	{
+		SharedPtr<JournalQueuingStrategy> strategy = new JournalQueuingStrategy;
+		strategy->setRootDir(rootDir.path());
+		strategy->setup();
+
+		SharedPtr<SequentialAsyncExecutor> executor = new SequentialAsyncExecutor;
+		LoopbackGWSConnector::Ptr connector = new LoopbackGWSConnector;
+		GWSQueuingExporter::Ptr exporter = new GWSQueuingExporter;
+
+		exporter->setStrategy(strategy);
+		exporter->setConnector(connector);
+
+		connector->setEventsExecutor(executor);
+		connector->addListener(exporter);
+
+		SharedPtr<QueuingDistributor> distributor = new QueuingDistributor;
+		distributor->registerExporter(exporter.cast<Exporter>());
+
+		SharedPtr<SyntheticDeviceManager> manager =
+			new SyntheticDeviceManager(devices, modules, rate);
+		manager->setDistributor(distributor.cast<Distributor>());
+
+		Thread executorThread;
+		Thread exporterThread;
+		Thread distributorThread;
+		Thread managerThread;
+
+		executorThread.start(*executor);
+		exporterThread.start(*exporter);
+		distributorThread.start(*distributor);
+
+		const size_t writtenBefore = Benchmark::writtenBytes();
+		bench.start();
+
+		managerThread.start(*manager);
+		Thread::sleep(duration.totalMilliseconds());
+		manager->stop();
+		managerThread.join();
+
+		const Clock drainStarted;
+		while (connector->exported() < manager->shipped()) {
+			if (drainStarted.isElapsed(10 * Timespan::SECONDS))
+				break;
+
+			Thread::sleep(10);
+		}
+
+		bench.stop();
+		bench.addOps(connector->exported());
+		bench.addBytes(Benchmark::writtenBytes() - writtenBefore);
+
+		bench.set("devices", to_string(devices));
+		bench.set("modules", to_string(modules));
+		bench.set("offered_per_s", to_string(devices * rate));
+		bench.set("shipped", to_string(manager->shipped()));
+		bench.set("lost", to_string(manager->shipped() - connector->exported()));
+		bench.set("p50_ms", formatMillis(connector->percentile(50)));
+		bench.set("p99_ms", formatMillis(connector->percentile(99)));
+		bench.set("rss_kb", to_string(Benchmark::residentBytes() / 1024));
+
+		distributor->stop();
+		distributorThread.join();
+		exporter->stop();
+		exporterThread.join();
+		executor->stop();
+		executorThread.join();
+
+		connector->clearListeners();
+	}
+
+	bench.report(cout);
+	rootDir.remove(true);
+}
+
+int main(int argc, char **argv)
+{
+	Logger::root().setLevel("warning");
+
+	size_t devices = 10;
+	size_t modules = 5;
+	size_t rate = 10;
+	size_t durationSecs = 10;
+
+	try {
+		if (argc > 1)
+			devices = NumberParser::parseUnsigned(argv[1]);
+		if (argc > 2)
+			modules = NumberParser::parseUnsigned(argv[2]);
+		if (argc > 3)
+			rate = NumberParser::parseUnsigned(argv[3]);
+		if (argc > 4)
+			durationSecs = NumberParser::parseUnsigned(argv[4]);
+
+		runPipeline(devices, modules, rate, durationSecs * Timespan::SECONDS);
+	}
+	catch (const Exception &e) {
+		cerr << e.displayText() << endl;
+		return 1;
+	}
+
+	return 0;
+}
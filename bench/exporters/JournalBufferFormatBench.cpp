@@ -0,0 +1,143 @@
+#include <iostream>
+#include <vector>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/TemporaryFile.h>
+
+#include "Benchmark.h"
+#include "exporters/JournalQueuingStrategy.h"
+#include "model/SensorData.h"
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+/**
+ * Benchmark of JournalQueuingStrategy buffer formats and readers. For each
+ * format, it measures push() and bytes occupied on disk. Then, for each
+ * reader (mmap and stream), it measures the startup prescan (setup() of
+ * the filled repository) and the steady-state peek() (only the peek()
+ * calls are measured, not the following pop()). Each reader works on its
+ * own copy of the same repository.
+ *
+ * Usage: bench-journal-buffer-format [buffers] [entries] [peek-batch]
+ *
+ * A text backlog of about 50 MB (to compare the prescan during setup()
+ * and the steady-state peek() cost) is created by:
+ *
+ *   bench-journal-buffer-format 40000 10 32
+ */
+
+static void runReader(
+	const string &format,
+	const string &reader,
+	const File &backlog,
+	size_t buffers,
+	size_t batch)
+{
+	File rootDir(TemporaryFile::tempName());
+	backlog.copyTo(rootDir.path());
+
+	size_t files = 0;
+	const size_t onDisk = Benchmark::directorySize(rootDir, files);
+
+	Benchmark prescan(format + "-" + reader + "-prescan");
+	Benchmark peek(format + "-" + reader + "-peek");
+
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(rootDir.path());
+	strategy.setBufferFormat(format);
+	strategy.setBufferReader(reader);
+
+	prescan.start();
+	strategy.setup();
+	prescan.stop();
+	prescan.addOps(buffers);
+	prescan.addBytes(onDisk);
+	prescan.report(cout);
+
+	vector<SensorData> data;
+
+	while (!strategy.empty()) {
+		data.clear();
+
+		peek.start();
+		const size_t count = strategy.peek(data, batch);
+		peek.stop();
+
+		strategy.pop(count);
+		peek.addOps(count);
+	}
+
+	peek.report(cout);
+
+	rootDir.remove(true);
+}
+
+static void runFormat(
+	const string &format,
+	size_t buffers,
+	size_t entries,
+	size_t batch)
+{
+	File rootDir(TemporaryFile::tempName());
+	rootDir.createDirectories();
+
+	Benchmark push(format + "-push");
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(rootDir.path());
+		strategy.setBufferFormat(format);
+		strategy.setup();
+
+		push.start();
+
+		for (size_t i = 0; i < buffers; ++i)
+			strategy.push(Benchmark::generate(entries, i));
+
+		push.stop();
+		push.addOps(buffers * entries);
+	}
+
+	size_t files = 0;
+	const size_t onDisk = Benchmark::directorySize(rootDir, files);
+	push.addBytes(onDisk);
+	push.set("bytes_on_disk", to_string(onDisk));
+	push.report(cout);
+
+	runReader(format, "mmap", rootDir, buffers, batch);
+	runReader(format, "stream", rootDir, buffers, batch);
+
+	rootDir.remove(true);
+}
+
+int main(int argc, char **argv)
+{
+	Logger::root().setLevel("warning");
+
+	size_t buffers = 1000;
+	size_t entries = 10;
+	size_t batch = 32;
+
+	try {
+		if (argc > 1)
+			buffers = NumberParser::parseUnsigned(argv[1]);
+		if (argc > 2)
+			entries = NumberParser::parseUnsigned(argv[2]);
+		if (argc > 3)
+			batch = NumberParser::parseUnsigned(argv[3]);
+
+		runFormat("text", buffers, entries, batch);
+		runFormat("binary", buffers, entries, batch);
+	}
+	catch (const Exception &e) {
+		cerr << e.displayText() << endl;
+		return 1;
+	}
+
+	return 0;
+}
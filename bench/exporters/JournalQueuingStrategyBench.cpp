@@ -0,0 +1,120 @@
+#include <iostream>
+#include <vector>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/SharedPtr.h>
+#include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
+
+#include "Benchmark.h"
+#include "core/QueuingExporter.h"
+#include "exporters/JournalQueuingStrategy.h"
+#include "model/SensorData.h"
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+/**
+ * Benchmark of pushing data into JournalQueuingStrategy the way
+ * the QueuingExporter does while the server is unreachable (the
+ * saveTimeout has elapsed): a single thread ships data one by one
+ * and each ship() saves the queue. It compares saving on each ship()
+ * with saving once per the saveGroupWindow. Only the time spent in
+ * ship() (and in the final save) is measured, not the period between
+ * the ships.
+ *
+ * Usage: bench-journal-queuing-strategy [ships] [period-ms] [window-ms] [save-threshold]
+ */
+
+static void runShips(
+	const string &name,
+	const Timespan &window,
+	size_t threshold,
+	size_t ships,
+	const Timespan &period)
+{
+	File rootDir(TemporaryFile::tempName());
+	rootDir.createDirectories();
+
+	Benchmark bench(name);
+
+	{
+		SharedPtr<JournalQueuingStrategy> strategy = new JournalQueuingStrategy;
+		strategy->setRootDir(rootDir.path());
+		strategy->setup();
+
+		const size_t writtenBefore = Benchmark::writtenBytes();
+
+		{
+			QueuingExporter exporter;
+			exporter.setStrategy(strategy);
+			exporter.setSaveThreshold(threshold);
+			exporter.setSaveTimeout(0);
+			exporter.setSaveGroupWindow(window);
+
+			for (size_t i = 0; i < ships; ++i) {
+				const SensorData data = Benchmark::generate(1, i).front();
+
+				bench.start();
+				exporter.ship(data);
+				bench.stop();
+
+				if (period > 0)
+					Thread::sleep(period.totalMilliseconds());
+			}
+
+			// the exporter saves the rest of its queue when destroyed
+			bench.start();
+		}
+
+		bench.stop();
+		bench.addOps(ships);
+		bench.addBytes(Benchmark::writtenBytes() - writtenBefore);
+	}
+
+	size_t files = 0;
+	const size_t onDisk = Benchmark::directorySize(rootDir, files);
+
+	bench.set("files", to_string(files));
+	bench.set("bytes_on_disk", to_string(onDisk));
+	bench.report(cout);
+
+	rootDir.remove(true);
+}
+
+int main(int argc, char **argv)
+{
+	Logger::root().setLevel("warning");
+
+	size_t ships = 1000;
+	int periodMs = 1;
+	int windowMs = 100;
+	int threshold = 1024;
+
+	try {
+		if (argc > 1)
+			ships = NumberParser::parseUnsigned(argv[1]);
+		if (argc > 2)
+			periodMs = NumberParser::parse(argv[2]);
+		if (argc > 3)
+			windowMs = NumberParser::parse(argv[3]);
+		if (argc > 4)
+			threshold = NumberParser::parse(argv[4]);
+
+		runShips("save-each-ship", 0, threshold,
+			ships, periodMs * Timespan::MILLISECONDS);
+		runShips("save-group-window",
+			windowMs * Timespan::MILLISECONDS, threshold,
+			ships, periodMs * Timespan::MILLISECONDS);
+	}
+	catch (const Exception &e) {
+		cerr << e.displayText() << endl;
+		return 1;
+	}
+
+	return 0;
+}
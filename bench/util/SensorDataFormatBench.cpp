@@ -0,0 +1,170 @@
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Poco/Exception.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Timestamp.h>
+
+#include "AllocationCounter.h"
+#include "Benchmark.h"
+#include "model/SensorData.h"
+#include "util/CSVSensorDataFormatter.h"
+#include "util/ChecksumSensorDataFormatter.h"
+#include "util/ChecksumSensorDataParser.h"
+#include "util/JSONSensorDataFormatter.h"
+#include "util/JSONSensorDataParser.h"
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+/**
+ * Microbenchmarks of SensorData formatters and parsers used on the export
+ * and journal paths. Each one is measured for data of 1, 5 and 30 modules
+ * with long device IDs and some NaN values. Besides time, number of heap
+ * allocations and allocated bytes per operation are reported.
+ *
+ * Usage: bench-sensor-data-format [iterations]
+ */
+
+static const size_t SAMPLES = 64;
+static const size_t MODULES[] = {1, 5, 30};
+
+static vector<SensorData> generate(size_t modules)
+{
+	vector<SensorData> samples;
+
+	for (size_t i = 0; i < SAMPLES; ++i) {
+		SensorData data;
+		data.setDeviceID(DeviceID(0xa3fffffffff00000 | i));
+		data.setTimestamp(Timestamp());
+
+		for (size_t j = 0; j < modules; ++j) {
+			// every 7th value is invalid
+			const double value = (i + j) % 7 == 0 ? NAN : 1000.0 / (i + j + 3);
+			data.insertValue(SensorValue(ModuleID(j), value));
+		}
+
+		samples.emplace_back(data);
+	}
+
+	return samples;
+}
+
+static string formatDouble(double value)
+{
+	ostringstream out;
+	out << fixed << setprecision(1) << value;
+	return out.str();
+}
+
+/**
+ * Perform the given operation iterations times over the samples
+ * and report the results. The operation returns number of processed
+ * bytes.
+ */
+template <typename T, typename Op>
+static void measure(
+	const string &name,
+	size_t iterations,
+	const vector<T> &samples,
+	Op op)
+{
+	Benchmark bench(name);
+	volatile size_t sink = 0;
+
+	const size_t allocationsBefore = AllocationCounter::allocations();
+	const size_t allocatedBefore = AllocationCounter::allocatedBytes();
+	bench.start();
+
+	for (size_t i = 0; i < iterations; ++i) {
+		const size_t bytes = op(samples[i % samples.size()]);
+
+		sink = sink + bytes;
+		bench.addBytes(bytes);
+	}
+
+	bench.stop();
+	bench.addOps(iterations);
+
+	const size_t allocations = AllocationCounter::allocations() - allocationsBefore;
+	const size_t allocated = AllocationCounter::allocatedBytes() - allocatedBefore;
+
+	bench.set("allocs_per_op", formatDouble(allocations / (double) iterations));
+	bench.set("alloc_bytes_per_op", formatDouble(allocated / (double) iterations));
+	bench.report(cout);
+}
+
+static void runShape(size_t modules, size_t iterations)
+{
+	const string suffix = "-m" + to_string(modules);
+	const vector<SensorData> samples = generate(modules);
+
+	JSONSensorDataFormatter json;
+	CSVSensorDataFormatter csv;
+	ChecksumSensorDataFormatter checksum(new JSONSensorDataFormatter);
+
+	measure("format-json" + suffix, iterations, samples,
+		[&](const SensorData &data) {
+			return json.format(data).size();
+		});
+
+	measure("format-csv" + suffix, iterations, samples,
+		[&](const SensorData &data) {
+			return csv.format(data).size();
+		});
+
+	measure("format-checksum-json" + suffix, iterations, samples,
+		[&](const SensorData &data) {
+			return checksum.format(data).size();
+		});
+
+	vector<string> jsonInput;
+	vector<string> checksumInput;
+
+	for (const auto &data : samples) {
+		jsonInput.emplace_back(json.format(data));
+		checksumInput.emplace_back(checksum.format(data));
+	}
+
+	JSONSensorDataParser jsonParser;
+	ChecksumSensorDataParser checksumParser(new JSONSensorDataParser);
+
+	measure("parse-json" + suffix, iterations, jsonInput,
+		[&](const string &input) {
+			jsonParser.parse(input);
+			return input.size();
+		});
+
+	measure("parse-checksum-json" + suffix, iterations, checksumInput,
+		[&](const string &input) {
+			checksumParser.parse(input);
+			return input.size();
+		});
+}
+
+int main(int argc, char **argv)
+{
+	Logger::root().setLevel("warning");
+
+	size_t iterations = 100000;
+
+	try {
+		if (argc > 1)
+			iterations = NumberParser::parseUnsigned(argv[1]);
+
+		for (const auto modules : MODULES)
+			runShape(modules, iterations);
+	}
+	catch (const Exception &e) {
+		cerr << e.displayText() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -26,6 +26,7 @@ BEEEON_OBJECT_PROPERTY("distributor", &BelkinWemoDeviceManager::setDistributor)
 BEEEON_OBJECT_PROPERTY("commandDispatcher", &BelkinWemoDeviceManager::setCommandDispatcher)
 BEEEON_OBJECT_PROPERTY("upnpTimeout", &BelkinWemoDeviceManager::setUPnPTimeout)
 BEEEON_OBJECT_PROPERTY("httpTimeout", &BelkinWemoDeviceManager::setHTTPTimeout)
+BEEEON_OBJECT_PROPERTY("connectionPool", &BelkinWemoDeviceManager::setConnectionPool)
 BEEEON_OBJECT_PROPERTY("refresh", &BelkinWemoDeviceManager::setRefresh)
 BEEEON_OBJECT_END(BeeeOn, BelkinWemoDeviceManager)
 
@@ -43,6 +44,7 @@ BelkinWemoDeviceManager::BelkinWemoDeviceManager():
 	}),
 	m_refresh(RefreshTime::fromSeconds(5)),
 	m_httpTimeout(3 * Timespan::SECONDS),
+	m_connectionPool(new HTTPConnectionPool),
 	m_upnpTimeout(5 * Timespan::SECONDS)
 {
 }
@@ -106,6 +108,11 @@ void BelkinWemoDeviceManager::setHTTPTimeout(const Timespan &timeout)
 	m_httpTimeout = timeout;
 }
 
+void BelkinWemoDeviceManager::setConnectionPool(HTTPConnectionPool::Ptr pool)
+{
+	m_connectionPool = pool;
+}
+
 void BelkinWemoDeviceManager::searchPairedDevices()
 {
 	set<DeviceID> pairedDevices;
@@ -246,7 +253,7 @@ vector<BelkinWemoSwitch::Ptr> BelkinWemoDeviceManager::seekSwitches(const StopCo
 
 		BelkinWemoSwitch::Ptr newDevice;
 		try {
-			newDevice = new BelkinWemoSwitch(address, m_httpTimeout, m_refresh);
+			newDevice = new BelkinWemoSwitch(address, m_httpTimeout, m_refresh, m_connectionPool);
 		}
 		catch (const TimeoutException& e) {
 			logger().debug("found device has disconnected", __FILE__, __LINE__);
@@ -274,7 +281,7 @@ vector<BelkinWemoBulb::Ptr> BelkinWemoDeviceManager::seekBulbs(const StopControl
 
 		BelkinWemoLink::Ptr link;
 		try {
-			link = new BelkinWemoLink(address, m_httpTimeout);
+			link = new BelkinWemoLink(address, m_httpTimeout, m_connectionPool);
 		}
 		catch (const TimeoutException& e) {
 			logger().debug("found device has disconnected", __FILE__, __LINE__);
@@ -333,7 +340,7 @@ vector<BelkinWemoDimmer::Ptr> BelkinWemoDeviceManager::seekDimmers(const StopCon
 
 		BelkinWemoDimmer::Ptr newDevice;
 		try {
-			newDevice = new BelkinWemoDimmer(address, m_httpTimeout, m_refresh);
+			newDevice = new BelkinWemoDimmer(address, m_httpTimeout, m_refresh, m_connectionPool);
 		}
 		catch (const TimeoutException& e) {
 			logger().debug("found device has disconnected", __FILE__, __LINE__);
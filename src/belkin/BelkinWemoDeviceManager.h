@@ -17,6 +17,7 @@
 #include "loop/StopControl.h"
 #include "model/DeviceID.h"
 #include "model/RefreshTime.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/MACAddress.h"
 #include "util/AsyncWork.h"
 
@@ -50,6 +51,7 @@ public:
 
 	void setUPnPTimeout(const Poco::Timespan &timeout);
 	void setHTTPTimeout(const Poco::Timespan &timeout);
+	void setConnectionPool(HTTPConnectionPool::Ptr pool);
 	void setRefresh(const Poco::Timespan &refresh);
 
 protected:
@@ -87,6 +89,7 @@ private:
 	RefreshTime m_refresh;
 	PollingKeeper m_pollingKeeper;
 	Poco::Timespan m_httpTimeout;
+	HTTPConnectionPool::Ptr m_connectionPool;
 	Poco::Timespan m_upnpTimeout;
 };
 
@@ -29,11 +29,13 @@ static list<ModuleType> DIMMER_MODULE_TYPES = {
 BelkinWemoDimmer::BelkinWemoDimmer(
 		const SocketAddress& address,
 		const Timespan &httpTimeout,
-		const RefreshTime &refresh):
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool):
 	BelkinWemoStandaloneDevice(
 		URI("http://" + address.toString() + "/upnp/control/basicevent1"),
 		httpTimeout,
-		refresh)
+		refresh,
+		connectionPool)
 {
 }
 
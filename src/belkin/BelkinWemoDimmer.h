@@ -27,11 +27,13 @@ public:
 	 * specified timeout, Poco::TimeoutException is thrown.
 	 * @param &address IP address and port where the device is listening.
 	 * @param &timeout HTTP timeout.
+	 * @param connectionPool pool of HTTP sessions to use.
 	 */
 	BelkinWemoDimmer(
 		const Poco::Net::SocketAddress& address,
 		const Poco::Timespan &httpTimeout,
-		const RefreshTime &refresh);
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool);
 
 private:
 	/**
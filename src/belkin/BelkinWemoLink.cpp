@@ -12,7 +12,6 @@
 #include "belkin/BelkinWemoDevice.h"
 #include "belkin/BelkinWemoLink.h"
 #include "net/HTTPEntireResponse.h"
-#include "net/HTTPUtil.h"
 #include "net/SOAPMessage.h"
 #include "util/SecureXmlParser.h"
 
@@ -24,10 +23,12 @@ using namespace std;
 
 BelkinWemoLink::BelkinWemoLink(
 		const Poco::Net::SocketAddress& address,
-		const Poco::Timespan &httpTimeout):
+		const Poco::Timespan &httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool):
 	m_address(address),
 	m_countOfBulbs(0),
-	m_httpTimeout(httpTimeout)
+	m_httpTimeout(httpTimeout),
+	m_connectionPool(connectionPool)
 {
 	requestDeviceInfo();
 }
@@ -62,7 +63,7 @@ void BelkinWemoLink::requestDeviceInfo()
 	msg.prepare(request);
 
 	URI uri("http://" + m_address.toString() + "/upnp/control/basicevent1");
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = m_connectionPool->makeRequest(
 		request, uri, msg.toString(), m_httpTimeout);
 
 	SecureXmlParser parser;
@@ -126,7 +127,7 @@ std::list<BelkinWemoLink::BulbID> BelkinWemoLink::requestDeviceList()
 	msg.prepare(request);
 
 	URI uri("http://" + m_address.toString() + "/upnp/control/bridge1");
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = m_connectionPool->makeRequest(
 		request, uri, msg.toString(), m_httpTimeout);
 
 	SecureXmlParser parser;
@@ -193,7 +194,7 @@ bool BelkinWemoLink::requestModifyState(const BelkinWemoLink::BulbID bulbID,
 	msg.prepare(request);
 
 	URI uri("http://" + m_address.toString() + "/upnp/control/bridge1");
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = m_connectionPool->makeRequest(
 		request, uri, msg.toString(), m_httpTimeout);
 
 	SecureXmlParser parser;
@@ -247,7 +248,7 @@ string BelkinWemoLink::requestDeviceState(const BelkinWemoLink::BulbID bulbID)
 	msg.prepare(request);
 
 	URI uri("http://" + m_address.toString() + "/upnp/control/bridge1");
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = m_connectionPool->makeRequest(
 		request, uri, msg.toString(), m_httpTimeout);
 
 	return response.getBody();
@@ -10,6 +10,7 @@
 #include <Poco/Net/SocketAddress.h>
 
 #include "model/SensorData.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/MACAddress.h"
 
 namespace BeeeOn {
@@ -31,10 +32,12 @@ public:
 	 * specified timeout, Poco::TimeoutException is thrown.
 	 * @param &address IP address and port where the device is listening.
 	 * @param &timeout HTTP timeout.
+	 * @param connectionPool pool of HTTP sessions to use.
 	 */
 	BelkinWemoLink(
 		const Poco::Net::SocketAddress& address,
-		const Poco::Timespan &httpTimeout);
+		const Poco::Timespan &httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	/**
 	 * @brief Prepares SOAP message containing request device list
@@ -97,6 +100,7 @@ private:
 
 	Poco::FastMutex m_lock;
 	Poco::Timespan m_httpTimeout;
+	HTTPConnectionPool::Ptr m_connectionPool;
 };
 
 }
@@ -10,7 +10,6 @@
 
 #include "belkin/BelkinWemoStandaloneDevice.h"
 #include "model/DevicePrefix.h"
-#include "net/HTTPUtil.h"
 #include "net/SOAPMessage.h"
 #include "util/SecureXmlParser.h"
 
@@ -23,16 +22,19 @@ using namespace std;
 BelkinWemoStandaloneDevice::BelkinWemoStandaloneDevice(
 		const URI& uri,
 		const Timespan &httpTimeout,
-		const RefreshTime &refresh):
-	BelkinWemoDevice(buildDeviceID(uri, httpTimeout), refresh),
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool):
+	BelkinWemoDevice(buildDeviceID(uri, httpTimeout, connectionPool), refresh),
 	m_uri(uri),
-	m_httpTimeout(httpTimeout)
+	m_httpTimeout(httpTimeout),
+	m_connectionPool(connectionPool)
 {
 }
 
 MACAddress BelkinWemoStandaloneDevice::requestMacAddr(
 		const URI &uri,
-		const Timespan &httpTimeout)
+		const Timespan &httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool)
 {
 	HTTPRequest request;
 
@@ -61,7 +63,7 @@ MACAddress BelkinWemoStandaloneDevice::requestMacAddr(
 
 	msg.prepare(request);
 
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = connectionPool->makeRequest(
 		request, uri, msg.toString(), httpTimeout);
 
 	SecureXmlParser parser;
@@ -111,7 +113,7 @@ HTTPEntireResponse BelkinWemoStandaloneDevice::requestBinaryState() const
 
 	msg.prepare(request);
 
-	return HTTPUtil::makeRequest(
+	return m_connectionPool->makeRequest(
 		request, m_uri, msg.toString(), m_httpTimeout);
 }
 
@@ -156,7 +158,7 @@ bool BelkinWemoStandaloneDevice::requestModifyBinaryState(
 
 	msg.prepare(request);
 
-	HTTPEntireResponse response = HTTPUtil::makeRequest(
+	HTTPEntireResponse response = m_connectionPool->makeRequest(
 		request, m_uri, msg.toString(), m_httpTimeout);
 
 	SecureXmlParser parser;
@@ -181,7 +183,8 @@ void BelkinWemoStandaloneDevice::setAddress(const SocketAddress& address)
 
 DeviceID BelkinWemoStandaloneDevice::buildDeviceID(
 		const URI& uri,
-		const Timespan& httpTimeout)
+		const Timespan& httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool)
 {
-	return {DevicePrefix::PREFIX_BELKIN_WEMO, requestMacAddr(uri, httpTimeout)};
+	return {DevicePrefix::PREFIX_BELKIN_WEMO, requestMacAddr(uri, httpTimeout, connectionPool)};
 }
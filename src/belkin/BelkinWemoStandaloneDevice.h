@@ -8,6 +8,7 @@
 #include <Poco/Net/SocketAddress.h>
 
 #include "belkin/BelkinWemoDevice.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/HTTPEntireResponse.h"
 #include "net/MACAddress.h"
 
@@ -24,7 +25,8 @@ public:
 	BelkinWemoStandaloneDevice(
 		const Poco::URI& uri,
 		const Poco::Timespan &httpTimeout,
-		const RefreshTime &refresh);
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	/**
 	 * @brief Prepares SOAP message containing GetBinaryState request
@@ -56,7 +58,8 @@ private:
 	 */
 	static MACAddress requestMacAddr(
 		const Poco::URI &uri,
-		const Poco::Timespan &httpTimeout);
+		const Poco::Timespan &httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	/**
 	 * @brief Called internally when constructing the instance.
@@ -64,11 +67,13 @@ private:
 	 */
 	static DeviceID buildDeviceID(
 		const Poco::URI& uri,
-		const Poco::Timespan& httpTimeout);
+		const Poco::Timespan& httpTimeout,
+		HTTPConnectionPool::Ptr connectionPool);
 
 protected:
 	Poco::URI m_uri;
 	const Poco::Timespan m_httpTimeout;
+	mutable HTTPConnectionPool::Ptr m_connectionPool;
 };
 
 }
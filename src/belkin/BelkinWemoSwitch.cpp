@@ -23,11 +23,13 @@ using namespace std;
 BelkinWemoSwitch::BelkinWemoSwitch(
 		const SocketAddress& address,
 		const Timespan &httpTimeout,
-		const RefreshTime &refresh):
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool):
 	BelkinWemoStandaloneDevice(
 		URI("http://" + address.toString() + "/upnp/control/basicevent1"),
 		httpTimeout,
-		refresh)
+		refresh,
+		connectionPool)
 {
 }
 
@@ -26,11 +26,13 @@ public:
 	 * throws Poco::TimeoutException also in this case it is blocking.
 	 * @param &address IP address and port where the device is listening.
 	 * @param &timeout HTTP timeout.
+	 * @param connectionPool pool of HTTP sessions to use.
 	 */ 
 	BelkinWemoSwitch(
 		const Poco::Net::SocketAddress& address,
 		const Poco::Timespan &httpTimeout,
-		const RefreshTime &refresh);
+		const RefreshTime &refresh,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	~BelkinWemoSwitch();
 
@@ -9,6 +9,7 @@ BEEEON_OBJECT_PROPERTY("handlers", &AsyncCommandDispatcher::registerHandler)
 BEEEON_OBJECT_PROPERTY("listeners", &AsyncCommandDispatcher::registerListener)
 BEEEON_OBJECT_PROPERTY("commandsExecutor", &AsyncCommandDispatcher::setCommandsExecutor)
 BEEEON_OBJECT_PROPERTY("eventsExecutor", &AsyncCommandDispatcher::setEventsExecutor)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &AsyncCommandDispatcher::setMetricsRegistry)
 BEEEON_OBJECT_END(BeeeOn, AsyncCommandDispatcher)
 
 using namespace std;
@@ -40,6 +41,9 @@ void AsyncCommandDispatcher::dispatchImpl(
 
 	answer->setHandlersCount(handlers.size());
 
+	if (handlers.empty())
+		m_unhandledCount->add();
+
 	Answer::ScopedLock guard(*answer);
 	if (!answer->isPending()) {
 		answer->notifyUpdated();
@@ -5,6 +5,12 @@
 using namespace BeeeOn;
 using namespace Poco;
 
+CommandDispatcher::CommandDispatcher():
+	m_dispatchedCount(MetricsRegistry::createCounter()),
+	m_unhandledCount(MetricsRegistry::createCounter())
+{
+}
+
 CommandDispatcher::~CommandDispatcher()
 {
 }
@@ -30,6 +36,7 @@ void CommandDispatcher::dispatch(Command::Ptr cmd, Answer::Ptr answer)
 
 	logger().debug(cmd->toString(), __FILE__, __LINE__);
 
+	m_dispatchedCount->add();
 	dispatchImpl(cmd, answer);
 }
 
@@ -37,3 +44,13 @@ void CommandDispatcher::setEventsExecutor(AsyncExecutor::Ptr executor)
 {
 	m_eventSource.setAsyncExecutor(executor);
 }
+
+void CommandDispatcher::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_dispatchedCount = registry->counter(
+		"beeeon_dispatcher_commands_total",
+		"Commands dispatched");
+	m_unhandledCount = registry->counter(
+		"beeeon_dispatcher_unhandled_total",
+		"Commands not accepted by any handler");
+}
@@ -4,6 +4,7 @@
 
 #include "core/CommandDispatcherListener.h"
 #include "core/CommandHandler.h"
+#include "core/MetricsRegistry.h"
 #include "util/EventSource.h"
 #include "util/Loggable.h"
 
@@ -11,6 +12,7 @@ namespace BeeeOn {
 
 class CommandDispatcher : protected Loggable {
 public:
+	CommandDispatcher();
 	virtual ~CommandDispatcher();
 
 	/*
@@ -29,11 +31,19 @@ public:
 	void registerListener(CommandDispatcherListener::Ptr listener);
 	void setEventsExecutor(AsyncExecutor::Ptr executor);
 
+	/**
+	 * @brief Publish count of dispatched commands and commands
+	 * without any accepting handler in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
 protected:
 	virtual void dispatchImpl(Command::Ptr cmd, Answer::Ptr answer) = 0;
 
 protected:
 	std::list<Poco::SharedPtr<CommandHandler>> m_commandHandlers;
+	MetricsRegistry::Counter::Ptr m_dispatchedCount;
+	MetricsRegistry::Counter::Ptr m_unhandledCount;
 
 private:
 	EventSource<CommandDispatcherListener> m_eventSource;
@@ -0,0 +1,332 @@
+#include <cmath>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/StringTokenizer.h>
+
+#include "commands/NewDeviceCommand.h"
+#include "core/DeadbandSensorDataFilter.h"
+#include "di/Injectable.h"
+#include "model/DevicePrefix.h"
+#include "model/ModuleType.h"
+#include "model/SensorData.h"
+
+BEEEON_OBJECT_BEGIN(BeeeOn, DeadbandSensorDataFilter)
+BEEEON_OBJECT_CASTABLE(SensorDataFilter)
+BEEEON_OBJECT_CASTABLE(CommandDispatcherListener)
+BEEEON_OBJECT_PROPERTY("rules", &DeadbandSensorDataFilter::setRules)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &DeadbandSensorDataFilter::setMetricsRegistry)
+BEEEON_OBJECT_PROPERTY("typesFile", &DeadbandSensorDataFilter::setTypesFile)
+BEEEON_OBJECT_HOOK("done", &DeadbandSensorDataFilter::setup)
+BEEEON_OBJECT_END(BeeeOn, DeadbandSensorDataFilter)
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+static const string ANY = "*";
+
+bool DeadbandSensorDataFilter::Rule::changed(double last, double value) const
+{
+	const double diff = fabs(value - last);
+
+	if (absolute == 0 && relative == 0)
+		return value != last;
+
+	if (absolute > 0 && diff > absolute)
+		return true;
+
+	if (relative > 0 && diff > relative * fabs(last))
+		return true;
+
+	return false;
+}
+
+DeadbandSensorDataFilter::Rule DeadbandSensorDataFilter::Rule::parse(
+		const string &input)
+{
+	StringTokenizer items(input, ",",
+		StringTokenizer::TOK_TRIM | StringTokenizer::TOK_IGNORE_EMPTY);
+	Rule rule;
+
+	for (const auto &item : items) {
+		StringTokenizer pair(item, "=", StringTokenizer::TOK_TRIM);
+		if (pair.count() != 2)
+			throw SyntaxException("expected <name>=<value>, got: " + item);
+
+		const double value = NumberParser::parseFloat(pair[1]);
+		if (value < 0)
+			throw InvalidArgumentException(pair[0] + " must not be negative");
+
+		if (pair[0] == "absolute")
+			rule.absolute = value;
+		else if (pair[0] == "relative")
+			rule.relative = value;
+		else if (pair[0] == "maxSilence")
+			rule.maxSilence = Timespan::TimeDiff(value * Timespan::SECONDS);
+		else
+			throw InvalidArgumentException("unknown deadband item: " + pair[0]);
+	}
+
+	return rule;
+}
+
+DeadbandSensorDataFilter::DeadbandSensorDataFilter():
+	m_forwarded(MetricsRegistry::createCounter()),
+	m_suppressed(MetricsRegistry::createCounter())
+{
+}
+
+void DeadbandSensorDataFilter::setRules(const map<string, string> &rules)
+{
+	map<RuleKey, Rule> parsed;
+
+	for (const auto &pair : rules) {
+		StringTokenizer key(pair.first, ":", StringTokenizer::TOK_TRIM);
+		if (key.count() != 2)
+			throw SyntaxException("expected <prefix>:<type>, got: " + pair.first);
+
+		const string prefix = key[0] == ANY ? ANY : DevicePrefix::parse(key[0]).toString();
+		const string type = key[1] == ANY ? ANY : ModuleType::Type::parse(key[1]).toString();
+
+		parsed[{prefix, type}] = Rule::parse(pair.second);
+	}
+
+	FastMutex::ScopedLock guard(m_lock);
+	m_rules = parsed;
+}
+
+void DeadbandSensorDataFilter::setTypesFile(const string &path)
+{
+	m_typesFile = path;
+}
+
+void DeadbandSensorDataFilter::setup()
+{
+	if (m_typesFile.empty())
+		return;
+
+	const Path path(m_typesFile);
+	File(path.parent()).createDirectories();
+
+	Journal::Ptr journal = new Journal(path);
+
+	if (!journal->createEmpty()) {
+		journal->checkExisting(true, true);
+		journal->load(true);
+	}
+
+	map<DeviceID, vector<string>> types;
+
+	for (const auto &record : journal->records()) {
+		try {
+			const DeviceID id = DeviceID::parse(record.key);
+			StringTokenizer tokens(record.value, ",", StringTokenizer::TOK_TRIM);
+
+			types[id] = {tokens.begin(), tokens.end()};
+		}
+		catch (const Exception &e) {
+			logger().warning(
+				"skipping types of " + record.key + ": " + e.displayText(),
+				__FILE__, __LINE__);
+		}
+	}
+
+	logger().information(
+		"loaded module types of " + to_string(types.size())
+		+ " devices from " + m_typesFile,
+		__FILE__, __LINE__);
+
+	FastMutex::ScopedLock guard(m_lock);
+	m_typesJournal = journal;
+
+	for (const auto &pair : types)
+		m_types.emplace(pair.first, pair.second);
+}
+
+void DeadbandSensorDataFilter::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_forwarded = registry->counter(
+		"beeeon_filter_forwarded_total",
+		"Values forwarded by the deadband filter");
+	m_suppressed = registry->counter(
+		"beeeon_filter_suppressed_total",
+		"Values suppressed by the deadband filter");
+}
+
+bool DeadbandSensorDataFilter::hasTypedRules(const string &prefix) const
+{
+	for (const auto &pair : m_rules) {
+		const RuleKey &key = pair.first;
+
+		if (key.second != ANY && (key.first == ANY || key.first == prefix))
+			return true;
+	}
+
+	return false;
+}
+
+const DeadbandSensorDataFilter::Rule *DeadbandSensorDataFilter::lookup(
+		const DeviceID &id,
+		const ModuleID &module)
+{
+	const string prefix = id.prefix().toString();
+	string type = ANY;
+
+	auto types = m_types.find(id);
+	if (types != m_types.end()) {
+		if (module.value() < types->second.size())
+			type = types->second[module.value()];
+	}
+	else if (m_untyped.emplace(id).second && hasTypedRules(prefix)) {
+		logger().warning(
+			"module types of " + id.toString() + " are unknown, "
+			"applying rules for any type",
+			__FILE__, __LINE__);
+	}
+
+	const RuleKey candidates[] = {
+		{prefix, type},
+		{prefix, ANY},
+		{ANY, type},
+		{ANY, ANY},
+	};
+
+	for (const auto &key : candidates) {
+		auto it = m_rules.find(key);
+		if (it != m_rules.end())
+			return &it->second;
+	}
+
+	return nullptr;
+}
+
+bool DeadbandSensorDataFilter::pass(
+		const DeviceID &id,
+		const ModuleID &module,
+		double value,
+		bool valid,
+		const Timestamp &now)
+{
+	const Rule *rule = lookup(id, module);
+	if (rule == nullptr)
+		return true;
+
+	auto result = m_last.emplace(make_pair(id, module), Last{value, valid, now});
+	if (result.second)
+		return true; // first value
+
+	Last &last = result.first->second;
+	bool forward = false;
+
+	if (last.valid != valid)
+		forward = true;
+	else if (valid && rule->changed(last.value, value))
+		forward = true;
+	else if (rule->maxSilence > 0 && now - last.at >= rule->maxSilence.totalMicroseconds())
+		forward = true;
+
+	if (forward)
+		last = {value, valid, now};
+
+	return forward;
+}
+
+bool DeadbandSensorDataFilter::filter(SensorData &data)
+{
+	if (data.isEmpty())
+		return true;
+
+	const Timestamp now;
+	SensorData result;
+	size_t forwarded = 0;
+	size_t suppressed = 0;
+
+	result.setDeviceID(data.deviceID());
+	result.setTimestamp(data.timestamp());
+
+	{
+		FastMutex::ScopedLock guard(m_lock);
+
+		for (const auto &item : data) {
+			const bool valid = item.isValid();
+			const double value = valid ? item.value() : NAN;
+
+			if (pass(data.deviceID(), item.moduleID(), value, valid, now)) {
+				result.insertValue(item);
+				forwarded += 1;
+			}
+			else {
+				suppressed += 1;
+			}
+		}
+	}
+
+	m_forwarded->add(forwarded);
+	m_suppressed->add(suppressed);
+
+	if (suppressed == 0)
+		return true;
+
+	if (logger().trace()) {
+		logger().trace(
+			"suppressed " + to_string(suppressed)
+			+ " values of " + data.deviceID().toString(),
+			__FILE__, __LINE__);
+	}
+
+	if (forwarded == 0)
+		return false;
+
+	data = result;
+	return true;
+}
+
+void DeadbandSensorDataFilter::onDispatch(const Command::Ptr cmd)
+{
+	if (!cmd->is<NewDeviceCommand>())
+		return;
+
+	NewDeviceCommand::Ptr command = cmd.cast<NewDeviceCommand>();
+	vector<string> types;
+
+	for (const auto &type : command->dataTypes())
+		types.emplace_back(type.type().toString());
+
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto &known = m_types[command->deviceID()];
+	if (known == types)
+		return;
+
+	known = types;
+	m_untyped.erase(command->deviceID());
+
+	if (m_typesJournal.isNull())
+		return;
+
+	string value;
+	for (const auto &type : types) {
+		if (!value.empty())
+			value += ",";
+
+		value += type;
+	}
+
+	try {
+		m_typesJournal->append(command->deviceID().toString(), value);
+	}
+	BEEEON_CATCH_CHAIN(logger())
+}
+
+uint64_t DeadbandSensorDataFilter::forwarded() const
+{
+	return m_forwarded->value();
+}
+
+uint64_t DeadbandSensorDataFilter::suppressed() const
+{
+	return m_suppressed->value();
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Poco/Mutex.h>
+#include <Poco/SharedPtr.h>
+#include <Poco/Timespan.h>
+#include <Poco/Timestamp.h>
+
+#include "core/CommandDispatcherListener.h"
+#include "core/MetricsRegistry.h"
+#include "core/SensorDataFilter.h"
+#include "model/DeviceID.h"
+#include "model/ModuleID.h"
+#include "util/Journal.h"
+#include "util/Loggable.h"
+
+namespace BeeeOn {
+
+/**
+ * @brief DeadbandSensorDataFilter suppresses values that have not changed
+ * significantly since they were forwarded last time. A value is forwarded
+ * when:
+ *
+ * - it is the first value of the module seen,
+ * - it differs by more than the absolute deadband,
+ * - it differs by more than the relative deadband (fraction of the last
+ *   forwarded value),
+ * - it differs at all when no deadband is configured (change-only),
+ * - it becomes valid or invalid,
+ * - the maxSilence (heartbeat) has elapsed since the last forwarded value.
+ *
+ * Rules are keyed by device prefix and module type. Module types of devices
+ * are learned from NewDeviceCommands passing the CommandDispatcher, thus
+ * the filter should be registered as its listener. The most specific rule
+ * is applied: prefix and type, prefix and any type, any prefix and type
+ * and finally any prefix and any type. Values without any matching rule
+ * are always forwarded.
+ *
+ * Devices paired before the gateway has started are not announced by
+ * NewDeviceCommands again. Thus, the learned module types can be persisted
+ * in a journal file (property typesFile) and loaded on setup(). If the types
+ * of a device are still unknown, rules for any type are applied and it is
+ * logged once per device when typed rules would be skipped this way.
+ *
+ * The maxSilence is measured since the last forwarded value was seen
+ * by the filter.
+ */
+class DeadbandSensorDataFilter :
+	public SensorDataFilter,
+	public CommandDispatcherListener,
+	protected Loggable {
+public:
+	typedef Poco::SharedPtr<DeadbandSensorDataFilter> Ptr;
+
+	/**
+	 * @brief Deadband of values, zero means unused.
+	 */
+	struct Rule {
+		double absolute = 0;
+		double relative = 0;
+		Poco::Timespan maxSilence = 0;
+
+		/**
+		 * @returns true if the value differs from the last one
+		 * enough to be forwarded
+		 */
+		bool changed(double last, double value) const;
+
+		/**
+		 * @brief Parse rule of form: "absolute=0.5,relative=0.01,maxSilence=900"
+		 * where each item is optional and maxSilence is given in seconds.
+		 */
+		static Rule parse(const std::string &input);
+	};
+
+	DeadbandSensorDataFilter();
+
+	/**
+	 * @brief Set rules keyed by "<prefix>:<module-type>", any of them
+	 * can be "*" to match all prefixes or types. Values are parsed by
+	 * Rule::parse().
+	 */
+	void setRules(const std::map<std::string, std::string> &rules);
+
+	/**
+	 * @brief Set journal file to persist the learned module types in.
+	 * Empty (default) disables the persistence.
+	 */
+	void setTypesFile(const std::string &path);
+
+	/**
+	 * @brief Load module types persisted in the typesFile (if any).
+	 */
+	void setup();
+
+	/**
+	 * @brief Publish counts of forwarded and suppressed values
+	 * in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	bool filter(SensorData &data) override;
+
+	/**
+	 * @brief Learn module types of devices from NewDeviceCommands.
+	 */
+	void onDispatch(const Command::Ptr cmd) override;
+
+	/**
+	 * @returns count of values forwarded so far
+	 */
+	uint64_t forwarded() const;
+
+	/**
+	 * @returns count of values suppressed so far
+	 */
+	uint64_t suppressed() const;
+
+protected:
+	typedef std::pair<std::string, std::string> RuleKey;
+
+	/**
+	 * @brief Last forwarded value of a module.
+	 */
+	struct Last {
+		double value;
+		bool valid;
+		Poco::Timestamp at;
+	};
+
+	/**
+	 * @returns the most specific rule for the given module or nullptr
+	 */
+	const Rule *lookup(const DeviceID &id, const ModuleID &module);
+
+	/**
+	 * @returns true if there is a rule for a specific module type
+	 * applicable to the given prefix
+	 */
+	bool hasTypedRules(const std::string &prefix) const;
+
+	/**
+	 * @returns true if the given value should be forwarded,
+	 * the last forwarded value is updated in such case
+	 */
+	bool pass(
+		const DeviceID &id,
+		const ModuleID &module,
+		double value,
+		bool valid,
+		const Poco::Timestamp &now);
+
+private:
+	std::map<RuleKey, Rule> m_rules;
+	std::map<DeviceID, std::vector<std::string>> m_types;
+	std::set<DeviceID> m_untyped;
+	std::string m_typesFile;
+	Journal::Ptr m_typesJournal;
+	std::map<std::pair<DeviceID, ModuleID>, Last> m_last;
+	MetricsRegistry::Counter::Ptr m_forwarded;
+	MetricsRegistry::Counter::Ptr m_suppressed;
+	mutable Poco::FastMutex m_lock;
+};
+
+}
@@ -10,14 +10,25 @@ BEEEON_OBJECT_CASTABLE(StoppableRunnable)
 BEEEON_OBJECT_PROPERTY("distributor", &DevicePoller::setDistributor)
 BEEEON_OBJECT_PROPERTY("pollExecutor", &DevicePoller::setPollExecutor)
 BEEEON_OBJECT_PROPERTY("warnThreshold", &DevicePoller::setWarnThreshold)
+BEEEON_OBJECT_PROPERTY("maxActive", &DevicePoller::setMaxActive)
+BEEEON_OBJECT_PROPERTY("maxActivePerPrefix", &DevicePoller::setMaxActivePerPrefix)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &DevicePoller::setMetricsRegistry)
 BEEEON_OBJECT_HOOK("cleanup", &DevicePoller::cleanup)
 BEEEON_OBJECT_END(BeeeOn, DevicePoller)
 
+using namespace std;
 using namespace Poco;
 using namespace BeeeOn;
 
 DevicePoller::DevicePoller():
-	m_warnThreshold(1 * Timespan::SECONDS)
+	m_warnThreshold(1 * Timespan::SECONDS),
+	m_maxActive(0),
+	m_maxActivePerPrefix(1),
+	m_pollingCount(0),
+	m_pollsCount(MetricsRegistry::createCounter()),
+	m_slowPollsCount(MetricsRegistry::createCounter()),
+	m_pollDuration(MetricsRegistry::createHistogram()),
+	m_pollLateness(MetricsRegistry::createHistogram())
 {
 }
 
@@ -36,6 +47,49 @@ void DevicePoller::setWarnThreshold(const Poco::Timespan &threshold)
 	m_warnThreshold = threshold;
 }
 
+void DevicePoller::setMaxActive(int count)
+{
+	if (count < 0)
+		throw InvalidArgumentException("maxActive must not be negative");
+
+	m_maxActive = count;
+}
+
+void DevicePoller::setMaxActivePerPrefix(int count)
+{
+	if (count < 0)
+		throw InvalidArgumentException("maxActivePerPrefix must not be negative");
+
+	m_maxActivePerPrefix = count;
+}
+
+void DevicePoller::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_pollsCount = registry->counter(
+		"beeeon_poller_polls_total",
+		"Polls of devices performed");
+	m_slowPollsCount = registry->counter(
+		"beeeon_poller_slow_polls_total",
+		"Polls taking longer than refresh time and warnThreshold");
+	m_pollDuration = registry->histogram(
+		"beeeon_poller_poll_seconds",
+		"Duration of polls of devices");
+	m_pollLateness = registry->histogram(
+		"beeeon_poller_lateness_seconds",
+		"Delay between scheduled and actual start of polls");
+}
+
+DevicePoller::PollStats DevicePoller::stats(const DeviceID &id) const
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto it = m_stats.find(id);
+	if (it == end(m_stats))
+		return {};
+
+	return it->second;
+}
+
 Timespan DevicePoller::grabRefresh(const PollableDevice::Ptr device)
 {
 	const auto refresh = device->refresh();
@@ -93,6 +147,7 @@ void DevicePoller::cancel(const DeviceID &id)
 	FastMutex::ScopedLock guard(m_lock);
 
 	m_active.erase(id); // avoid rescheduling
+	m_stats.erase(id);
 
 	auto it = m_devices.find(id);
 	if (it == end(m_devices))
@@ -166,7 +221,19 @@ void DevicePoller::run()
 		}
 
 		const auto &sleep = pollNextIfOnSchedule();
-		if (sleep > 0) {
+		if (sleep < 0) {
+			guard.unlock();
+
+			if (logger().debug()) {
+				logger().debug(
+					"all devices on schedule are blocked by polls in progress, sleeping",
+					__FILE__, __LINE__);
+			}
+
+			m_stopControl.waitStoppable(-1);
+			continue;
+		}
+		else if (sleep > 0) {
 			guard.unlock();
 
 			if (logger().debug()) {
@@ -186,30 +253,77 @@ void DevicePoller::run()
 
 Timespan DevicePoller::pollNextIfOnSchedule(const Clock &now)
 {
-	auto it = begin(m_schedule);
-	poco_assert(it != end(m_schedule));
+	auto first = begin(m_schedule);
+	poco_assert(first != end(m_schedule));
+
+	if (first->first > now)
+		return first->first - now;
 
-	if (it->first > now)
-		return it->first - now;
+	auto it = selectNext(now);
+	if (it == end(m_schedule)) {
+		auto next = m_schedule.upper_bound(now);
+		if (next == end(m_schedule))
+			return -1;
+
+		return next->first - now;
+	}
 
 	PollableDevice::Ptr device = it->second;
+	const Clock scheduled = it->first;
 
 	m_devices.erase(device->id());
 	m_active.emplace(device->id());
 	m_schedule.erase(it);
 
-	doPoll(device);
+	m_polling[device->id().prefix()] += 1;
+	m_pollingCount += 1;
+
+	doPoll(device, scheduled);
 	return 0;
 }
 
-void DevicePoller::doPoll(PollableDevice::Ptr device)
+DevicePoller::Schedule::iterator DevicePoller::selectNext(const Clock &now)
+{
+	if (m_maxActive > 0 && m_pollingCount >= m_maxActive)
+		return end(m_schedule);
+
+	auto best = end(m_schedule);
+	size_t bestPolling = 0;
+
+	for (auto it = begin(m_schedule); it != end(m_schedule); ++it) {
+		if (it->first > now)
+			break;
+
+		auto polling = m_polling.find(it->second->id().prefix());
+		const size_t count = polling == end(m_polling) ? 0 : polling->second;
+
+		if (m_maxActivePerPrefix > 0 && count >= m_maxActivePerPrefix)
+			continue;
+
+		if (best == end(m_schedule) || count < bestPolling) {
+			best = it;
+			bestPolling = count;
+		}
+
+		if (count == 0)
+			break; // the oldest device of an idle prefix
+	}
+
+	return best;
+}
+
+void DevicePoller::doPoll(
+		PollableDevice::Ptr device,
+		const Clock &scheduled)
 {
-	m_pollExecutor->invoke([&, device]() mutable {
+	m_pollExecutor->invoke([&, device, scheduled]() mutable {
 		const Clock started;
+		const Timespan lateness = max<Clock::ClockDiff>(started - scheduled, 0);
 
 		if (logger().debug()) {
 			logger().debug(
-				"polling device " + device->id().toString(),
+				"polling device " + device->id().toString()
+				+ " (late " + DateTimeFormatter::format(lateness, "%h:%M:%S.%i") + ")",
 				__FILE__, __LINE__);
 		}
 
@@ -221,7 +335,13 @@ void DevicePoller::doPoll(PollableDevice::Ptr device)
 		const Timespan elapsed = started.elapsed();
 		const auto diff = elapsed - device->refresh();
 
+		m_pollsCount->add();
+		m_pollDuration->observe(elapsed);
+		m_pollLateness->observe(lateness);
+
 		if (diff > m_warnThreshold) {
+			m_slowPollsCount->add();
+
 			logger().warning(
 				"polling of " + device->id().toString()
 				+ " took too long ("
@@ -232,10 +352,43 @@ void DevicePoller::doPoll(PollableDevice::Ptr device)
 				__FILE__, __LINE__);
 		}
 
+		if (lateness > m_warnThreshold && lateness > 0) {
+			logger().warning(
+				"polling of " + device->id().toString()
+				+ " started late ("
+				+ DateTimeFormatter::format(lateness, "%h:%M:%S.%i")
+				+ ")",
+				__FILE__, __LINE__);
+		}
+
+		pollFinished(device, lateness);
 		reschedule(device);
 	});
 }
 
+void DevicePoller::pollFinished(
+		PollableDevice::Ptr device,
+		const Timespan &lateness)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto polling = m_polling.find(device->id().prefix());
+	if (polling != end(m_polling) && polling->second > 0) {
+		polling->second -= 1;
+		m_pollingCount -= 1;
+	}
+
+	if (m_active.find(device->id()) != end(m_active)) {
+		auto &stats = m_stats[device->id()];
+		stats.polls += 1;
+		stats.lastLateness = lateness;
+		stats.maxLateness = max(stats.maxLateness, lateness);
+		stats.totalLateness += lateness;
+	}
+
+	m_stopControl.requestWakeup();
+}
+
 void DevicePoller::stop()
 {
 	m_stopControl.requestStop();
@@ -248,5 +401,8 @@ void DevicePoller::cleanup()
 	m_active.clear();
 	m_devices.clear();
 	m_schedule.clear();
+	m_polling.clear();
+	m_pollingCount = 0;
+	m_stats.clear();
 	m_pollExecutor = nullptr;
 }
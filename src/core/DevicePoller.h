@@ -1,13 +1,18 @@
 #pragma once
 
+#include <map>
+#include <set>
+
 #include <Poco/Clock.h>
 #include <Poco/Mutex.h>
 
 #include "core/DeviceCache.h"
 #include "core/Distributor.h"
+#include "core/MetricsRegistry.h"
 #include "core/PollableDevice.h"
 #include "loop/StoppableRunnable.h"
 #include "loop/StopControl.h"
+#include "model/DevicePrefix.h"
 #include "util/AsyncExecutor.h"
 #include "util/Loggable.h"
 
@@ -18,11 +23,32 @@ namespace BeeeOn {
  * Any number of devices can be scheduled for regular polling of
  * their state. Each device can be scheduled according to its
  * refresh time and later cancelled from being polled.
+ *
+ * Polls are dispatched via the configured pollExecutor. When the
+ * executor runs polls in parallel, the DevicePoller bounds the number
+ * of polls in progress (maxActive) and the number of polls in progress
+ * per DevicePrefix (maxActivePerPrefix) to avoid overloading a single
+ * bridge or dongle. When multiple devices are on schedule, the device
+ * of the prefix with the least polls in progress is preferred, thus
+ * a prefix with many devices does not starve other prefixes.
+ *
+ * For each device, the lateness (delay between its scheduled time
+ * and the actual start of its poll) is measured and reported.
  */
 class DevicePoller : public StoppableRunnable, Loggable {
 public:
 	typedef Poco::SharedPtr<DevicePoller> Ptr;
 
+	/**
+	 * @brief Statistics of lateness of a single device.
+	 */
+	struct PollStats {
+		size_t polls = 0;
+		Poco::Timespan lastLateness = 0;
+		Poco::Timespan maxLateness = 0;
+		Poco::Timespan totalLateness = 0;
+	};
+
 	DevicePoller();
 
 	void setDistributor(Distributor::Ptr distributor);
@@ -38,6 +64,31 @@ public:
 	 */
 	void setWarnThreshold(const Poco::Timespan &threshold);
 
+	/**
+	 * @brief Configure maximal number of polls in progress at once.
+	 * It should correspond to the capacity of the pollExecutor.
+	 * Zero means no limit.
+	 */
+	void setMaxActive(int count);
+
+	/**
+	 * @brief Configure maximal number of polls in progress at once
+	 * for devices of the same DevicePrefix. Zero means no limit.
+	 */
+	void setMaxActivePerPrefix(int count);
+
+	/**
+	 * @brief Publish count of polls, polls exceeding the warnThreshold,
+	 * durations and lateness of polls in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	/**
+	 * @returns lateness statistics of the given device. Statistics
+	 * of a device are dropped when the device is cancelled.
+	 */
+	PollStats stats(const DeviceID &id) const;
+
 	/**
 	 * @brief Schedule the given device relatively to the given
 	 * time reference (usually meaning now). An already scheduled
@@ -70,6 +121,8 @@ public:
 	void cleanup();
 
 protected:
+	typedef std::multimap<Poco::Clock, PollableDevice::Ptr> Schedule;
+
 	/**
 	 * @brief Get refresh time of the device and check whether it
 	 * is usable for regular polling. If it is not, throw an exception.
@@ -98,27 +151,56 @@ protected:
 	/**
 	 * @brief Check the next device to be polled. If the next device
 	 * is scheduled into the future, return the time difference.
-	 * Otherwise return 0 as the device is currently polled.
+	 * Otherwise return 0 as the device is currently polled. If all
+	 * devices on schedule are blocked by the limits of polls in progress
+	 * and there is no device scheduled into the future, return -1.
 	 */
 	Poco::Timespan pollNextIfOnSchedule(const Poco::Clock &now = {});
 
+	/**
+	 * @brief Find the device on schedule that should be polled next
+	 * with respect to the limits of polls in progress.
+	 * @returns end of m_schedule if there is no such device
+	 */
+	Schedule::iterator selectNext(const Poco::Clock &now);
+
 	/**
 	 * @brief Invoke the PollableDevice::poll() method via the configured
 	 * m_pollExecutor. Thus, the poll() is usually called asynchronously
-	 * and it can be parallelized with other devices.
+	 * and it can be parallelized with other devices. The scheduled time
+	 * is used to compute lateness of the poll.
 	 */
-	void doPoll(PollableDevice::Ptr device);
+	void doPoll(
+		PollableDevice::Ptr device,
+		const Poco::Clock &scheduled = {});
+
+	/**
+	 * @brief Account the given lateness of the device and release
+	 * its slot of polls in progress.
+	 */
+	void pollFinished(
+		PollableDevice::Ptr device,
+		const Poco::Timespan &lateness);
 
 private:
 	Distributor::Ptr m_distributor;
 	AsyncExecutor::Ptr m_pollExecutor;
 	Poco::Timespan m_warnThreshold;
+	size_t m_maxActive;
+	size_t m_maxActivePerPrefix;
 
-	typedef std::multimap<Poco::Clock, PollableDevice::Ptr> Schedule;
 	Schedule m_schedule;
 	std::map<DeviceID, Schedule::const_iterator> m_devices;
 	std::set<DeviceID> m_active;
-	Poco::FastMutex m_lock;
+	std::map<DevicePrefix, size_t> m_polling;
+	size_t m_pollingCount;
+	std::map<DeviceID, PollStats> m_stats;
+	mutable Poco::FastMutex m_lock;
+
+	MetricsRegistry::Counter::Ptr m_pollsCount;
+	MetricsRegistry::Counter::Ptr m_slowPollsCount;
+	MetricsRegistry::Histogram::Ptr m_pollDuration;
+	MetricsRegistry::Histogram::Ptr m_pollLateness;
 
 	StopControl m_stopControl;
 };
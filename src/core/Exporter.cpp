@@ -1,5 +1,7 @@
 #include "core/Exporter.h"
+#include "model/SensorData.h"
 
+using namespace std;
 using namespace BeeeOn;
 
 Exporter::Exporter()
@@ -9,3 +11,25 @@ Exporter::Exporter()
 Exporter::~Exporter()
 {
 }
+
+size_t Exporter::shipBatch(const vector<SensorData> &data)
+{
+	size_t shipped = 0;
+
+	for (const auto &one : data) {
+		try {
+			if (!ship(one))
+				break;
+		}
+		catch (...) {
+			if (shipped == 0)
+				throw;
+
+			break;
+		}
+
+		shipped += 1;
+	}
+
+	return shipped;
+}
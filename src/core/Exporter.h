@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 namespace BeeeOn {
 
 class SensorData;
@@ -21,6 +24,25 @@ public:
 	 */
 	virtual bool ship(const SensorData &data) = 0;
 
+	/**
+	 * Ensures export of the given data (in the given order) in best effort
+	 * to target destination. The default implementation calls ship() for
+	 * each item.
+	 *
+	 * The batch might be shipped only partially. In such case, the shipped
+	 * data always form a prefix of the batch and the caller must retry
+	 * the rest later.
+	 *
+	 * @return count of successfully shipped data from the beginning of the
+	 * batch. A value less than data.size() has the same meaning as ship()
+	 * returning false for the first unshipped item.
+	 * @throws Poco::IOException when a serious issue caused the Exporter to
+	 * deny its service before shipping any data. If such an issue occurs
+	 * after shipping some data, their count is returned instead and the
+	 * issue is expected to be reported by the next call.
+	 */
+	virtual size_t shipBatch(const std::vector<SensorData> &data);
+
 };
 
 }
@@ -1,5 +1,7 @@
 #include <exception>
+#include <limits>
 
+#include <Poco/Clock.h>
 #include <Poco/Exception.h>
 
 #include "core/ExporterQueue.h"
@@ -14,11 +16,15 @@ ExporterQueue::ExporterQueue(
 		int capacity,
 		int treshold):
 	m_exporter(exporter),
-	m_dropped(0),
-	m_sent(0),
+	m_dropped(MetricsRegistry::createCounter()),
+	m_sent(MetricsRegistry::createCounter()),
+	m_shipDuration(MetricsRegistry::createHistogram()),
+	m_size(MetricsRegistry::createGauge()),
 	m_failDetector(treshold),
-	m_capacity(capacity),
-	m_batchSize(batchSize)
+	m_capacity(capacity > 0 ? capacity : UNLIMITED_CAPACITY),
+	m_batchSize(batchSize > 0 ? batchSize : UNLIMITED_BATCH_SIZE),
+	m_ring(capacity > 0 ? capacity : UNLIMITED_RING_SIZE),
+	m_overflowing(false)
 {
 }
 
@@ -26,56 +32,126 @@ ExporterQueue::~ExporterQueue()
 {
 }
 
+void ExporterQueue::registerMetrics(
+		MetricsRegistry &registry,
+		const MetricsRegistry::Labels &labels)
+{
+	auto dropped = registry.counter(
+		"beeeon_exporter_dropped_total",
+		"Data dropped due to a full exporter queue",
+		labels);
+	auto sent = registry.counter(
+		"beeeon_exporter_sent_total",
+		"Data shipped by exporter",
+		labels);
+
+	dropped->add(m_dropped->value());
+	sent->add(m_sent->value());
+
+	m_dropped = dropped;
+	m_sent = sent;
+	m_shipDuration = registry.histogram(
+		"beeeon_exporter_ship_seconds",
+		"Duration of shipping a batch of data",
+		labels);
+	m_size = registry.gauge(
+		"beeeon_exporter_queue_size",
+		"Data buffered in exporter queue",
+		labels);
+}
+
 void ExporterQueue::enqueue(const SensorData &sensorData)
 {
-	FastMutex::ScopedLock lock(m_queueMutex);
+	if (m_overflowing) {
+		FastMutex::ScopedLock guard(m_overflowLock);
+
+		if (m_overflowing) {
+			m_overflow.emplace_back(sensorData);
+			return;
+		}
+	}
+
+	while (!m_ring.push(sensorData)) {
+		if (m_capacity == UNLIMITED_CAPACITY) {
+			FastMutex::ScopedLock guard(m_overflowLock);
+
+			m_overflow.emplace_back(sensorData);
+			m_overflowing = true;
+			return;
+		}
+
+		SensorData oldest;
+		if (m_ring.pop(oldest))
+			m_dropped->add();
+	}
+}
+
+void ExporterQueue::fetchBatch(size_t count)
+{
+	if (m_batch.size() >= count)
+		return;
+
+	m_ring.drain(m_batch, count - m_batch.size());
+
+	if (m_batch.size() >= count || !m_overflowing)
+		return;
 
-	if (m_queue.size() >= m_capacity && m_capacity > 0) {
-		m_queue.pop();
-		++m_dropped;
+	FastMutex::ScopedLock guard(m_overflowLock);
+
+	if (!m_ring.empty())
+		return; // overflowed data must follow the ring contents
+
+	while (m_batch.size() < count && !m_overflow.empty()) {
+		m_batch.emplace_back(std::move(m_overflow.front()));
+		m_overflow.pop_front();
 	}
 
-	m_queue.push(sensorData);
+	if (m_overflow.empty())
+		m_overflowing = false;
 }
 
 unsigned int ExporterQueue::exportBatch()
 {
-	if (isEmpty())
+	const size_t count = m_batchSize != UNLIMITED_BATCH_SIZE ?
+		m_batchSize : numeric_limits<size_t>::max();
+
+	fetchBatch(count);
+	m_size->set(m_batch.size() + m_ring.size());
+
+	if (m_batch.empty())
 		return 0;
 
-	unsigned int i = 0;
+	size_t shipped = 0;
+	const Clock started;
 
 	try {
-		for (i = 0; (i < m_batchSize || m_batchSize <= 0) && !isEmpty(); ++i) {
-			if (m_exporter->ship(front())) {
-				++m_sent;
-				pop();
-			}
-			else {
-				break;
-			}
-		}
+		shipped = m_exporter->shipBatch(m_batch);
+		m_shipDuration->observe(started.elapsed());
 	}
 	catch (const Exception &e) {
 		m_failDetector.fail();
 		logger().log(e, __FILE__, __LINE__);
-		return i;
+		return 0;
 	}
 	catch (exception &e) {
 		m_failDetector.fail();
 		poco_critical(logger(), e.what());
-		return i;
+		return 0;
 	}
 	catch (...) {
 		m_failDetector.fail();
 		poco_critical(logger(), "unknown error occured while shipping data");
-		return i;
+		return 0;
 	}
 
-	if (i > 0)
+	shipped = min(shipped, m_batch.size());
+	m_batch.erase(m_batch.begin(), m_batch.begin() + shipped);
+	m_sent->add(shipped);
+
+	if (shipped > 0)
 		m_failDetector.success();
 
-	return i;
+	return shipped;
 }
 
 
@@ -99,28 +175,15 @@ bool ExporterQueue::deadTooLong(const Timespan deadTimeout) const
 
 bool ExporterQueue::isEmpty() const
 {
-	FastMutex::ScopedLock lock(m_queueMutex);
-	return m_queue.empty();
+	return m_batch.empty() && m_ring.empty() && !m_overflowing;
 }
 
 unsigned int ExporterQueue::dropped() const
 {
-	return m_dropped;
+	return m_dropped->value();
 }
 
 unsigned int ExporterQueue::sent() const
 {
-	return m_sent;
-}
-
-SensorData &ExporterQueue::front()
-{
-	FastMutex::ScopedLock lock(m_queueMutex);
-	return m_queue.front();
-}
-
-void ExporterQueue::pop()
-{
-	FastMutex::ScopedLock lock(m_queueMutex);
-	m_queue.pop();
+	return m_sent->value();
 }
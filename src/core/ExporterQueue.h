@@ -1,18 +1,37 @@
 #pragma once
 
-#include <queue>
+#include <atomic>
+#include <deque>
+#include <vector>
 
-#include <Poco/AtomicCounter.h>
 #include <Poco/Mutex.h>
 #include <Poco/SharedPtr.h>
 
 #include "core/Exporter.h"
+#include "core/MetricsRegistry.h"
 #include "model/SensorData.h"
+#include "util/BoundedRing.h"
 #include "util/Loggable.h"
 #include "util/FailDetector.h"
 
 namespace BeeeOn {
 
+/**
+ * @brief ExporterQueue buffers data for a single Exporter. Data are
+ * enqueued into a lock-free ring (any number of producers) and exported
+ * by a single consumer thread calling exportBatch(). The consumer drains
+ * a whole batch from the ring at once and keeps it until it is shipped
+ * via Exporter::shipBatch().
+ *
+ * When the capacity is reached, the oldest data in the ring are dropped.
+ * Data already taken for export (up to batchSize) are not dropped. If the
+ * capacity is unlimited, data not fitting into the ring are appended into
+ * an overflow list guarded by a mutex until the consumer catches up.
+ *
+ * Counts of sent and dropped data, duration of Exporter::shipBatch()
+ * and the number of buffered data are maintained as metrics that can
+ * be published via registerMetrics().
+ */
 class ExporterQueue : protected Loggable {
 public:
 	typedef Poco::SharedPtr<ExporterQueue> Ptr;
@@ -21,6 +40,11 @@ public:
 	const static int UNLIMITED_CAPACITY = 0;
 	const static int UNLIMITED_THRESHOLD = FailDetector::TRESHOLD_UNLIMITED;
 
+	/**
+	 * Size of the ring used when the capacity is unlimited.
+	 */
+	const static int UNLIMITED_RING_SIZE = 1024;
+
 	/**
 	 * If batchSize <= 0 then size of batch is unlimited.
 	 * If capacity <= 0 then data count is unlimited.
@@ -34,12 +58,31 @@ public:
 
 	~ExporterQueue();
 
+	/**
+	 * @brief Enqueue the given data. It can be called from any thread
+	 * and it does not contend with exportBatch().
+	 */
 	void enqueue(const SensorData &sensorData);
+
+	/**
+	 * @brief Export up to batchSize data via the exporter. It must be
+	 * called from a single thread only.
+	 * @returns number of shipped data
+	 */
 	unsigned int exportBatch();
 
 	unsigned int sent() const;
 	unsigned int dropped() const;
 
+	/**
+	 * @brief Register metrics of the queue in the given registry
+	 * labeled by the given labels. It is not thread-safe and it
+	 * should be called before the queue is used.
+	 */
+	void registerMetrics(
+		MetricsRegistry &registry,
+		const MetricsRegistry::Labels &labels);
+
 	/**
 	 * The method canExport returns true if queue is not empty and at least one
 	 * of following conditions is met:
@@ -59,21 +102,40 @@ private:
 
 	bool isEmpty() const;
 
-	SensorData &front();
-	void pop();
+	/**
+	 * @brief Move data from the ring (and the overflow list) into
+	 * the m_batch to contain up to count data.
+	 */
+	void fetchBatch(size_t count);
 
 private:
-	mutable Poco::FastMutex m_queueMutex;
-
 	Poco::SharedPtr<Exporter> m_exporter;
 
-	Poco::AtomicCounter m_dropped;
-	Poco::AtomicCounter m_sent;
+	MetricsRegistry::Counter::Ptr m_dropped;
+	MetricsRegistry::Counter::Ptr m_sent;
+	MetricsRegistry::Histogram::Ptr m_shipDuration;
+	MetricsRegistry::Gauge::Ptr m_size;
 
 	FailDetector m_failDetector;
-	std::queue<SensorData> m_queue;
 	unsigned int m_capacity;
 	unsigned int m_batchSize;
+
+	BoundedRing<SensorData> m_ring;
+
+	/**
+	 * @brief Data taken from the ring for export, accessed only
+	 * by the consumer thread.
+	 */
+	std::vector<SensorData> m_batch;
+
+	/**
+	 * @brief Data not fitting into the ring in case of the unlimited
+	 * capacity. While overflowing, all new data are appended here
+	 * to preserve ordering.
+	 */
+	std::deque<SensorData> m_overflow;
+	std::atomic<bool> m_overflowing;
+	mutable Poco::FastMutex m_overflowLock;
 };
 
 }
@@ -0,0 +1,246 @@
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+
+#include "core/FilesystemDeviceCache.h"
+#include "core/JournalDeviceCache.h"
+#include "di/Injectable.h"
+
+BEEEON_OBJECT_BEGIN(BeeeOn, JournalDeviceCache)
+BEEEON_OBJECT_CASTABLE(DeviceCache)
+BEEEON_OBJECT_PROPERTY("file", &JournalDeviceCache::setFile)
+BEEEON_OBJECT_PROPERTY("legacyDir", &JournalDeviceCache::setLegacyDir)
+BEEEON_OBJECT_PROPERTY("ignoreErrors", &JournalDeviceCache::setIgnoreErrors)
+BEEEON_OBJECT_HOOK("done", &JournalDeviceCache::setup)
+BEEEON_OBJECT_END(BeeeOn, JournalDeviceCache)
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+static const string PAIRED = "paired";
+
+JournalDeviceCache::JournalDeviceCache():
+	m_file("/var/cache/beeeon/gateway/devices.journal"),
+	m_ignoreErrors(false)
+{
+}
+
+void JournalDeviceCache::setFile(const string &path)
+{
+	if (path.empty())
+		throw InvalidArgumentException("journal file must not be empty");
+
+	m_file = path;
+}
+
+void JournalDeviceCache::setLegacyDir(const string &path)
+{
+	m_legacyDir = path;
+}
+
+void JournalDeviceCache::setIgnoreErrors(bool ignore)
+{
+	m_ignoreErrors = ignore;
+}
+
+void JournalDeviceCache::setup()
+{
+	RWLock::ScopedWriteLock guard(m_lock);
+
+	File(m_file.parent()).createDirectories();
+
+	if (!File(m_file).exists() && !m_legacyDir.empty()
+			&& File(m_legacyDir).exists()) {
+		const size_t count = migrate(m_legacyDir);
+
+		logger().notice(
+			"migrated " + to_string(count) + " devices from "
+			+ m_legacyDir + " into " + m_file.toString(),
+			__FILE__, __LINE__);
+	}
+
+	m_journal = new Journal(m_file);
+
+	if (!m_journal->createEmpty()) {
+		logger().notice(
+			"loading devices from " + m_file.toString(),
+			__FILE__, __LINE__);
+
+		m_journal->checkExisting(true, true);
+		m_journal->load(m_ignoreErrors);
+	}
+	else {
+		logger().notice(
+			"empty devices journal created at " + m_file.toString(),
+			__FILE__, __LINE__);
+	}
+
+	reindex();
+}
+
+size_t JournalDeviceCache::migrate(const Path &legacyDir)
+{
+	Path tmp(m_file);
+	tmp.setFileName(m_file.getFileName() + ".migrating");
+
+	File tmpFile(tmp);
+	if (tmpFile.exists()) {
+		logger().warning(
+			"removing incomplete migration " + tmp.toString(),
+			__FILE__, __LINE__);
+
+		tmpFile.remove();
+	}
+
+	FilesystemDeviceCache legacy;
+	legacy.setCacheDir(legacyDir.toString());
+
+	Journal journal(tmp);
+	journal.createEmpty();
+
+	size_t count = 0;
+
+	for (const auto &prefix : DevicePrefix::all()) {
+		for (const auto &id : legacy.paired(prefix)) {
+			journal.append(id.toString(), PAIRED, false);
+			count += 1;
+		}
+	}
+
+	journal.flush();
+	tmpFile.renameTo(m_file.toString());
+
+	return count;
+}
+
+void JournalDeviceCache::reindex()
+{
+	m_paired.clear();
+
+	for (const auto &record : m_journal->records()) {
+		try {
+			const DeviceID id = DeviceID::parse(record.key);
+			m_paired[id.prefix()].emplace(id);
+		}
+		catch (const Exception &e) {
+			logger().warning(
+				"skipping record " + record.key + ": " + e.displayText(),
+				__FILE__, __LINE__);
+		}
+	}
+
+	if (logger().debug()) {
+		size_t count = 0;
+
+		for (const auto &pair : m_paired)
+			count += pair.second.size();
+
+		logger().debug(
+			"indexed " + to_string(count) + " paired devices",
+			__FILE__, __LINE__);
+	}
+}
+
+void JournalDeviceCache::markPaired(
+		const DevicePrefix &prefix,
+		const set<DeviceID> &devices)
+{
+	RWLock::ScopedWriteLock guard(m_lock);
+
+	set<DeviceID> &current = m_paired[prefix];
+	set<string> dropped;
+	size_t appended = 0;
+
+	for (const auto &id : current) {
+		if (devices.find(id) == devices.end())
+			dropped.emplace(id.toString());
+	}
+
+	for (const auto &id : devices) {
+		if (id.prefix() != prefix) {
+			logger().warning(
+				"skipping ID " + id.toString()
+				+ " of unexpected prefix " + id.prefix(),
+				__FILE__, __LINE__);
+			continue;
+		}
+
+		if (current.find(id) != current.end())
+			continue;
+
+		m_journal->append(id.toString(), PAIRED, false);
+		appended += 1;
+	}
+
+	if (!dropped.empty())
+		m_journal->drop(dropped, false);
+
+	if (appended > 0 || !dropped.empty())
+		m_journal->flush();
+
+	current.clear();
+	for (const auto &id : devices) {
+		if (id.prefix() == prefix)
+			current.emplace(id);
+	}
+
+	if (logger().debug()) {
+		logger().debug(
+			"saving " + prefix.toString() + ": "
+			+ to_string(appended) + " appended, "
+			+ to_string(dropped.size()) + " dropped",
+			__FILE__, __LINE__);
+	}
+}
+
+void JournalDeviceCache::markPaired(const DeviceID &id)
+{
+	RWLock::ScopedWriteLock guard(m_lock);
+
+	auto result = m_paired[id.prefix()].emplace(id);
+	if (!result.second)
+		return;
+
+	m_journal->append(id.toString(), PAIRED);
+
+	logger().information(
+		"device " + id.toString() + " marked as paired",
+		__FILE__, __LINE__);
+}
+
+void JournalDeviceCache::markUnpaired(const DeviceID &id)
+{
+	RWLock::ScopedWriteLock guard(m_lock);
+
+	auto it = m_paired.find(id.prefix());
+	if (it == m_paired.end())
+		return;
+
+	if (it->second.erase(id) == 0)
+		return;
+
+	m_journal->drop(id.toString());
+
+	logger().information(
+		"device " + id.toString() + " marked as unpaired",
+		__FILE__, __LINE__);
+}
+
+bool JournalDeviceCache::paired(const DeviceID &id) const
+{
+	RWLock::ScopedReadLock guard(m_lock);
+
+	return !(*m_journal)[id.toString()].isNull();
+}
+
+set<DeviceID> JournalDeviceCache::paired(const DevicePrefix &prefix) const
+{
+	RWLock::ScopedReadLock guard(m_lock);
+
+	auto it = m_paired.find(prefix);
+	if (it == m_paired.end())
+		return {};
+
+	return it->second;
+}
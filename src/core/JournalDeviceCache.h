@@ -0,0 +1,115 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <Poco/Path.h>
+#include <Poco/RWLock.h>
+
+#include "core/DeviceCache.h"
+#include "util/Journal.h"
+#include "util/Loggable.h"
+
+namespace BeeeOn {
+
+/**
+ * @brief JournalDeviceCache implements DeviceCache persisted in a single
+ * append-only Journal file. Each paired device is represented by a record
+ * keyed by its ID, unpairing drops the record. Batch updates are appended
+ * and flushed at once and the Journal rotates itself when it contains too
+ * many duplicates.
+ *
+ * The cache is loaded when the instance is set up and all queries are
+ * answered from memory. The paired(DeviceID) is served by the hash index
+ * of live keys maintained by the Journal, the paired(DevicePrefix) is served
+ * by an index of paired devices grouped by their prefix.
+ *
+ * If the journal does not exist yet and the property <code>legacyDir</code>
+ * points to an existing directory in the layout of FilesystemDeviceCache,
+ * its contents are migrated into a new journal once. The migrated journal
+ * is written aside and renamed into place when complete, thus an interrupted
+ * migration is restarted on next setup. The legacy directory is left
+ * untouched.
+ */
+class JournalDeviceCache :
+	public DeviceCache,
+	Loggable {
+public:
+	JournalDeviceCache();
+
+	/**
+	 * @brief Set path to the journal file. The parent directory
+	 * is created on demand.
+	 */
+	void setFile(const std::string &path);
+
+	/**
+	 * @brief Set cacheDir of FilesystemDeviceCache to migrate from
+	 * when the journal does not exist. Empty disables the migration.
+	 */
+	void setLegacyDir(const std::string &path);
+
+	/**
+	 * @brief Skip broken records of the journal while loading.
+	 */
+	void setIgnoreErrors(bool ignore);
+
+	/**
+	 * @brief Create or load the journal (migrating from the legacy
+	 * directory if needed) and build the in-memory index.
+	 */
+	void setup();
+
+	/**
+	 * @brief Synchronize records of the given prefix with the given set
+	 * of devices. Only differences are appended and flushed at once.
+	 */
+	void markPaired(
+		const DevicePrefix &prefix,
+		const std::set<DeviceID> &devices) override;
+
+	/**
+	 * @brief Append record of the given device (if not paired yet).
+	 */
+	void markPaired(const DeviceID &id) override;
+
+	/**
+	 * @brief Drop record of the given device (if paired).
+	 */
+	void markUnpaired(const DeviceID &id) override;
+
+	/**
+	 * @returns whether the journal contains a live record of the given id
+	 */
+	bool paired(const DeviceID &id) const override;
+
+	/**
+	 * @returns set of devices of the given prefix from the in-memory index
+	 */
+	std::set<DeviceID> paired(const DevicePrefix &prefix) const override;
+
+protected:
+	/**
+	 * @brief Write contents of the legacy directory into a new journal
+	 * at the configured path.
+	 *
+	 * @returns count of migrated devices
+	 */
+	size_t migrate(const Poco::Path &legacyDir);
+
+	/**
+	 * @brief Rebuild the per-prefix index from live records of the journal.
+	 */
+	void reindex();
+
+private:
+	Poco::Path m_file;
+	std::string m_legacyDir;
+	bool m_ignoreErrors;
+	Journal::Ptr m_journal;
+	std::map<DevicePrefix, std::set<DeviceID>> m_paired;
+	mutable Poco::RWLock m_lock;
+};
+
+}
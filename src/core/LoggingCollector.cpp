@@ -81,7 +81,13 @@ void LoggingCollector::onDriverStats(const ZWaveDriverEvent &e)
 			+ "/"
 			+ to_string(e.dropped())
 			+ "/"
-			+ to_string(e.badChecksum()));
+			+ to_string(e.badChecksum())
+			+ ", queue: "
+			+ to_string(e.eventsQueueHighWaterMark())
+			+ "/"
+			+ to_string(e.eventsQueueReplaced())
+			+ "/"
+			+ to_string(e.eventsQueueDropped()));
 }
 
 void LoggingCollector::onNodeStats(const ZWaveNodeEvent &e)
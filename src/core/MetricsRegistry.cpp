@@ -0,0 +1,284 @@
+#include <Poco/Exception.h>
+#include <Poco/NumberFormatter.h>
+
+#include "core/MetricsRegistry.h"
+#include "di/Injectable.h"
+
+BEEEON_OBJECT_BEGIN(BeeeOn, MetricsRegistry)
+BEEEON_OBJECT_END(BeeeOn, MetricsRegistry)
+
+using namespace std;
+using namespace Poco;
+using namespace BeeeOn;
+
+MetricsRegistry::Counter::Counter():
+	m_value(0)
+{
+}
+
+MetricsRegistry::Gauge::Gauge():
+	m_value(0)
+{
+}
+
+MetricsRegistry::Histogram::Histogram(const vector<Timespan> &bounds):
+	m_bounds(bounds),
+	m_buckets(bounds.size() + 1),
+	m_count(0),
+	m_sum(0)
+{
+	for (size_t i = 1; i < m_bounds.size(); ++i) {
+		if (m_bounds[i - 1] >= m_bounds[i])
+			throw InvalidArgumentException("histogram bounds must be ascending");
+	}
+
+	for (auto &bucket : m_buckets)
+		bucket.store(0, memory_order_relaxed);
+}
+
+void MetricsRegistry::Histogram::observe(const Timespan &duration)
+{
+	size_t i = 0;
+
+	while (i < m_bounds.size() && duration > m_bounds[i])
+		++i;
+
+	m_buckets[i].fetch_add(1, memory_order_relaxed);
+	m_count.fetch_add(1, memory_order_relaxed);
+	m_sum.fetch_add(duration.totalMicroseconds(), memory_order_relaxed);
+}
+
+const vector<Timespan> &MetricsRegistry::Histogram::bounds() const
+{
+	return m_bounds;
+}
+
+uint64_t MetricsRegistry::Histogram::bucket(size_t i) const
+{
+	return m_buckets.at(i).load(memory_order_relaxed);
+}
+
+uint64_t MetricsRegistry::Histogram::count() const
+{
+	return m_count.load(memory_order_relaxed);
+}
+
+Timespan MetricsRegistry::Histogram::sum() const
+{
+	return m_sum.load(memory_order_relaxed);
+}
+
+const vector<Timespan> &MetricsRegistry::defaultBounds()
+{
+	static const vector<Timespan> bounds = {
+		1 * Timespan::MILLISECONDS,
+		5 * Timespan::MILLISECONDS,
+		10 * Timespan::MILLISECONDS,
+		50 * Timespan::MILLISECONDS,
+		100 * Timespan::MILLISECONDS,
+		500 * Timespan::MILLISECONDS,
+		1 * Timespan::SECONDS,
+		5 * Timespan::SECONDS,
+		10 * Timespan::SECONDS,
+	};
+
+	return bounds;
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+}
+
+MetricsRegistry::Family &MetricsRegistry::family(
+		const string &name,
+		const string &help,
+		Type type)
+{
+	auto result = m_families.emplace(name, Family{type, help, {}, {}, {}});
+	Family &family = result.first->second;
+
+	if (family.type != type)
+		throw ExistsException("metric " + name + " already exists with another type");
+
+	return family;
+}
+
+MetricsRegistry::Counter::Ptr MetricsRegistry::counter(
+		const string &name,
+		const string &help,
+		const Labels &labels)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto &counters = family(name, help, TYPE_COUNTER).counters;
+	auto it = counters.find(labels);
+	if (it == counters.end())
+		it = counters.emplace(labels, createCounter()).first;
+
+	return it->second;
+}
+
+MetricsRegistry::Gauge::Ptr MetricsRegistry::gauge(
+		const string &name,
+		const string &help,
+		const Labels &labels)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto &gauges = family(name, help, TYPE_GAUGE).gauges;
+	auto it = gauges.find(labels);
+	if (it == gauges.end())
+		it = gauges.emplace(labels, createGauge()).first;
+
+	return it->second;
+}
+
+MetricsRegistry::Histogram::Ptr MetricsRegistry::histogram(
+		const string &name,
+		const string &help,
+		const Labels &labels,
+		const vector<Timespan> &bounds)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	auto &histograms = family(name, help, TYPE_HISTOGRAM).histograms;
+	auto it = histograms.find(labels);
+	if (it == histograms.end())
+		it = histograms.emplace(labels, createHistogram(bounds)).first;
+
+	return it->second;
+}
+
+MetricsRegistry::Counter::Ptr MetricsRegistry::createCounter()
+{
+	return new Counter;
+}
+
+MetricsRegistry::Gauge::Ptr MetricsRegistry::createGauge()
+{
+	return new Gauge;
+}
+
+MetricsRegistry::Histogram::Ptr MetricsRegistry::createHistogram(
+		const vector<Timespan> &bounds)
+{
+	return new Histogram(bounds);
+}
+
+static string escapeLabel(const string &value)
+{
+	string result;
+
+	for (const auto c : value) {
+		switch (c) {
+		case '\\':
+			result += "\\\\";
+			break;
+		case '"':
+			result += "\\\"";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		default:
+			result += c;
+			break;
+		}
+	}
+
+	return result;
+}
+
+static string formatSeconds(const Timespan &t)
+{
+	return NumberFormatter::format(t.totalMicroseconds() / 1000000.0, 6);
+}
+
+string MetricsRegistry::formatLabels(
+		const Labels &labels,
+		const string &extraName,
+		const string &extraValue)
+{
+	if (labels.empty() && extraName.empty())
+		return "";
+
+	string result = "{";
+
+	for (const auto &pair : labels) {
+		if (result.size() > 1)
+			result += ",";
+
+		result += pair.first + "=\"" + escapeLabel(pair.second) + "\"";
+	}
+
+	if (!extraName.empty()) {
+		if (result.size() > 1)
+			result += ",";
+
+		result += extraName + "=\"" + extraValue + "\"";
+	}
+
+	return result + "}";
+}
+
+void MetricsRegistry::format(ostream &out, const string &prefix) const
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	for (const auto &pair : m_families) {
+		const string &name = pair.first;
+		const Family &family = pair.second;
+
+		if (name.compare(0, prefix.size(), prefix) != 0)
+			continue;
+
+		out << "# HELP " << name << " " << family.help << "\n";
+
+		switch (family.type) {
+		case TYPE_COUNTER:
+			out << "# TYPE " << name << " counter\n";
+
+			for (const auto &counter : family.counters) {
+				out << name << formatLabels(counter.first)
+					<< " " << counter.second->value() << "\n";
+			}
+			break;
+
+		case TYPE_GAUGE:
+			out << "# TYPE " << name << " gauge\n";
+
+			for (const auto &gauge : family.gauges) {
+				out << name << formatLabels(gauge.first)
+					<< " " << gauge.second->value() << "\n";
+			}
+			break;
+
+		case TYPE_HISTOGRAM:
+			out << "# TYPE " << name << " histogram\n";
+
+			for (const auto &histogram : family.histograms) {
+				const Labels &labels = histogram.first;
+				const Histogram &h = *histogram.second;
+				uint64_t cumulative = 0;
+
+				for (size_t i = 0; i < h.bounds().size(); ++i) {
+					cumulative += h.bucket(i);
+
+					out << name << "_bucket"
+						<< formatLabels(labels, "le", formatSeconds(h.bounds()[i]))
+						<< " " << cumulative << "\n";
+				}
+
+				cumulative += h.bucket(h.bounds().size());
+
+				out << name << "_bucket" << formatLabels(labels, "le", "+Inf")
+					<< " " << cumulative << "\n";
+				out << name << "_sum" << formatLabels(labels)
+					<< " " << formatSeconds(h.sum()) << "\n";
+				out << name << "_count" << formatLabels(labels)
+					<< " " << h.count() << "\n";
+			}
+			break;
+		}
+	}
+}
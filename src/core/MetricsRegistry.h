@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <Poco/Mutex.h>
+#include <Poco/SharedPtr.h>
+#include <Poco/Timespan.h>
+
+namespace BeeeOn {
+
+/**
+ * @brief MetricsRegistry is a central place to collect runtime counters,
+ * gauges and latency histograms of the gateway. Components obtain handles
+ * of metrics once (usually while being configured) and then update them
+ * lock-free via atomic operations. The registry can render all metrics
+ * in the Prometheus text exposition format.
+ *
+ * A metric is identified by its name and labels. Asking for the same
+ * name and labels again returns the same handle. Components that might
+ * run without any registry hold standalone (unregistered) handles
+ * created via the static MetricsRegistry::create*() methods, thus the
+ * hot paths do not need to check for existence of the registry.
+ */
+class MetricsRegistry {
+public:
+	typedef Poco::SharedPtr<MetricsRegistry> Ptr;
+	typedef std::map<std::string, std::string> Labels;
+
+	/**
+	 * @brief Monotonically increasing counter.
+	 */
+	class Counter {
+	public:
+		typedef Poco::SharedPtr<Counter> Ptr;
+
+		Counter();
+
+		void add(uint64_t count = 1)
+		{
+			m_value.fetch_add(count, std::memory_order_relaxed);
+		}
+
+		uint64_t value() const
+		{
+			return m_value.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<uint64_t> m_value;
+	};
+
+	/**
+	 * @brief Gauge representing a value that can go up and down.
+	 */
+	class Gauge {
+	public:
+		typedef Poco::SharedPtr<Gauge> Ptr;
+
+		Gauge();
+
+		void set(int64_t value)
+		{
+			m_value.store(value, std::memory_order_relaxed);
+		}
+
+		void add(int64_t diff)
+		{
+			m_value.fetch_add(diff, std::memory_order_relaxed);
+		}
+
+		int64_t value() const
+		{
+			return m_value.load(std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<int64_t> m_value;
+	};
+
+	/**
+	 * @brief Histogram of durations with fixed buckets. Each bucket
+	 * counts observations less or equal to its upper bound.
+	 */
+	class Histogram {
+	public:
+		typedef Poco::SharedPtr<Histogram> Ptr;
+
+		/**
+		 * @brief Create histogram with the given upper bounds of buckets
+		 * in ascending order. An implicit bucket +Inf is always present.
+		 */
+		Histogram(const std::vector<Poco::Timespan> &bounds);
+
+		void observe(const Poco::Timespan &duration);
+
+		const std::vector<Poco::Timespan> &bounds() const;
+
+		/**
+		 * @returns count of observations of the bucket of the given
+		 * index (not cumulative), bounds().size() denotes +Inf
+		 */
+		uint64_t bucket(size_t i) const;
+
+		uint64_t count() const;
+		Poco::Timespan sum() const;
+
+	private:
+		const std::vector<Poco::Timespan> m_bounds;
+		std::vector<std::atomic<uint64_t>> m_buckets;
+		std::atomic<uint64_t> m_count;
+		std::atomic<int64_t> m_sum;
+	};
+
+	/**
+	 * Default buckets for latencies: 1 ms up to 10 s.
+	 */
+	static const std::vector<Poco::Timespan> &defaultBounds();
+
+	MetricsRegistry();
+
+	Counter::Ptr counter(
+		const std::string &name,
+		const std::string &help,
+		const Labels &labels = {});
+
+	Gauge::Ptr gauge(
+		const std::string &name,
+		const std::string &help,
+		const Labels &labels = {});
+
+	Histogram::Ptr histogram(
+		const std::string &name,
+		const std::string &help,
+		const Labels &labels = {},
+		const std::vector<Poco::Timespan> &bounds = defaultBounds());
+
+	static Counter::Ptr createCounter();
+	static Gauge::Ptr createGauge();
+	static Histogram::Ptr createHistogram(
+		const std::vector<Poco::Timespan> &bounds = defaultBounds());
+
+	/**
+	 * @brief Write all metrics in the Prometheus text format.
+	 * Only metrics whose name starts with the given prefix are
+	 * written.
+	 */
+	void format(std::ostream &out, const std::string &prefix = "") const;
+
+private:
+	enum Type {
+		TYPE_COUNTER,
+		TYPE_GAUGE,
+		TYPE_HISTOGRAM,
+	};
+
+	struct Family {
+		Type type;
+		std::string help;
+		std::map<Labels, Counter::Ptr> counters;
+		std::map<Labels, Gauge::Ptr> gauges;
+		std::map<Labels, Histogram::Ptr> histograms;
+	};
+
+	Family &family(
+		const std::string &name,
+		const std::string &help,
+		Type type);
+
+	static std::string formatLabels(
+		const Labels &labels,
+		const std::string &extraName = "",
+		const std::string &extraValue = "");
+
+	std::map<std::string, Family> m_families;
+	mutable Poco::FastMutex m_lock;
+};
+
+}
@@ -3,6 +3,7 @@
 
 #include "core/QueuingDistributor.h"
 #include "di/Injectable.h"
+#include "util/ClassInfo.h"
 
 BEEEON_OBJECT_BEGIN(BeeeOn, QueuingDistributor)
 BEEEON_OBJECT_CASTABLE(Distributor)
@@ -15,6 +16,8 @@ BEEEON_OBJECT_PROPERTY("batchSize", &QueuingDistributor::setQueueBatchSize)
 BEEEON_OBJECT_PROPERTY("treshold", &QueuingDistributor::setQueueTreshold)
 BEEEON_OBJECT_PROPERTY("eventsExecutor", &QueuingDistributor::setExecutor)
 BEEEON_OBJECT_PROPERTY("listeners", &QueuingDistributor::registerListener)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &QueuingDistributor::setMetricsRegistry)
+BEEEON_OBJECT_PROPERTY("filter", &QueuingDistributor::setFilter)
 BEEEON_OBJECT_END(BeeeOn, QueuingDistributor)
 
 using namespace BeeeOn;
@@ -28,6 +31,7 @@ const static int DEFAULT_BATCH_SIZE = 30;
 const static int DEFAULT_TRESHOLD = 10;
 
 QueuingDistributor::QueuingDistributor():
+	m_distributed(MetricsRegistry::createCounter()),
 	m_stop(false),
 	m_deadTimeout(DEFAULT_DEAD_TIMEOUT),
 	m_idleTimeout(DEFAULT_EMPTY_TIMEOUT),
@@ -81,6 +85,33 @@ void QueuingDistributor::setIdleTimeout(const Timespan &timeout)
 	m_idleTimeout = timeout;
 }
 
+void QueuingDistributor::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_metricsRegistry = registry;
+
+	auto distributed = registry->counter(
+		"beeeon_distributor_data_total",
+		"Data passed to the distributor");
+	distributed->add(m_distributed->value());
+	m_distributed = distributed;
+
+	for (size_t i = 0; i < m_queues.size(); ++i)
+		registerQueueMetrics(i, m_queuedExporters[i]);
+}
+
+void QueuingDistributor::setFilter(SensorDataFilter::Ptr filter)
+{
+	m_filter = filter;
+}
+
+void QueuingDistributor::registerQueueMetrics(size_t i, SharedPtr<Exporter> exporter)
+{
+	m_queues[i]->registerMetrics(*m_metricsRegistry, {
+		{"exporter", ClassInfo::forPointer(exporter.get()).name()},
+		{"queue", to_string(i)},
+	});
+}
+
 void QueuingDistributor::registerExporter(SharedPtr<Exporter> exporter)
 {
 	ExporterQueue::Ptr queue = new ExporterQueue(exporter,
@@ -94,6 +125,10 @@ void QueuingDistributor::registerExporter(SharedPtr<Exporter> exporter)
 		"; treshold: " + to_string(m_treshold)
 	);
 	m_queues.push_back(queue);
+	m_queuedExporters.push_back(exporter);
+
+	if (!m_metricsRegistry.isNull())
+		registerQueueMetrics(m_queues.size() - 1, exporter);
 }
 
 void QueuingDistributor::run()
@@ -136,9 +171,20 @@ void QueuingDistributor::exportData(const SensorData &sensorData)
 		return;
 
 	notifyListeners(sensorData);
+	m_distributed->add();
 
-	for (auto q : m_queues)
-		q->enqueue(sensorData);
+	if (m_filter.isNull()) {
+		for (auto q : m_queues)
+			q->enqueue(sensorData);
+	}
+	else {
+		SensorData data = sensorData;
+		if (!m_filter->filter(data))
+			return;
+
+		for (auto q : m_queues)
+			q->enqueue(data);
+	}
 
 	m_newData.set();
 }
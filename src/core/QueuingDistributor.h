@@ -9,6 +9,8 @@
 
 #include "core/AbstractDistributor.h"
 #include "core/ExporterQueue.h"
+#include "core/MetricsRegistry.h"
+#include "core/SensorDataFilter.h"
 #include "loop/StoppableRunnable.h"
 #include "model/SensorData.h"
 
@@ -38,11 +40,30 @@ public:
 	 */
 	void setIdleTimeout(const Poco::Timespan &timeout);
 
+	/**
+	 * @brief Publish count of distributed data and metrics of all
+	 * ExporterQueues (labeled by exporter) in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	/**
+	 * @brief Set filter applied to data before they are enqueued into
+	 * the ExporterQueues. Listeners are notified about unfiltered data.
+	 */
+	void setFilter(SensorDataFilter::Ptr filter);
+
 	void run() override;
 	void stop() override;
 
+protected:
+	void registerQueueMetrics(size_t i, Poco::SharedPtr<Exporter> exporter);
+
 protected:
 	std::vector<ExporterQueue::Ptr> m_queues;
+	std::vector<Poco::SharedPtr<Exporter>> m_queuedExporters;
+	MetricsRegistry::Ptr m_metricsRegistry;
+	MetricsRegistry::Counter::Ptr m_distributed;
+	SensorDataFilter::Ptr m_filter;
 	Poco::Event m_newData;
 	Poco::AtomicCounter m_stop;
 	Poco::Timespan m_deadTimeout;
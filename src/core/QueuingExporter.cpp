@@ -10,8 +10,8 @@ QueuingExporter::QueuingExporter():
 	m_backupPriority(20),
 	m_saveThreshold(1000),
 	m_saveTimeout(30 * Timespan::MINUTES),
-	m_acquiredDataCount(0),
-	m_peekedDataCount(0),
+	m_saveGroupWindow(0),
+	m_lastSave(0),
 	m_acked(false),
 	m_mixRemainder(0),
 	m_previousMixRemainder(0)
@@ -48,6 +48,14 @@ void QueuingExporter::setSaveTimeout(const Timespan &timeout)
 	m_saveTimeout = timeout;
 }
 
+void QueuingExporter::setSaveGroupWindow(const Timespan &window)
+{
+	if (window < 0)
+		throw InvalidArgumentException("save group window must not be negative");
+
+	m_saveGroupWindow = window;
+}
+
 void QueuingExporter::setStrategyPriority(int percent)
 {
 	if (percent > 100 || percent < 0)
@@ -65,8 +73,15 @@ bool QueuingExporter::empty() const
 bool QueuingExporter::shouldSave() const
 {
 	Mutex::ScopedLock lock(m_queueMutex);
-	return queueSize() >= m_saveThreshold
-		   || m_lastExport.isElapsed(m_saveTimeout.totalMicroseconds());
+
+	if (queueSize() >= m_saveThreshold)
+		return true;
+
+	if (!m_lastExport.isElapsed(m_saveTimeout.totalMicroseconds()))
+		return false;
+
+	// data shipped within the window are pushed together
+	return m_lastSave.isElapsed(m_saveGroupWindow.totalMicroseconds());
 }
 
 size_t QueuingExporter::queueSize() const
@@ -74,6 +89,39 @@ size_t QueuingExporter::queueSize() const
 	return m_queue.size();
 }
 
+size_t QueuingExporter::queueInFlight() const
+{
+	size_t count = 0;
+
+	for (const auto &batch : m_batches)
+		count += batch.acquired;
+
+	return count;
+}
+
+size_t QueuingExporter::strategyInFlight() const
+{
+	size_t count = 0;
+
+	for (const auto &batch : m_batches)
+		count += batch.peeked;
+
+	return count;
+}
+
+size_t QueuingExporter::inFlight() const
+{
+	Mutex::ScopedLock lock(m_queueMutex);
+	size_t count = 0;
+
+	for (const auto &batch : m_batches) {
+		if (!batch.acked)
+			++count;
+	}
+
+	return count;
+}
+
 void QueuingExporter::saveQueue(size_t skipFirst)
 {
 	Mutex::ScopedLock lock(m_queueMutex);
@@ -90,13 +138,15 @@ void QueuingExporter::doSaveQueue(size_t skipFirst)
 	vector<SensorData> tmp;
 
 	const deque<SensorData>::iterator startFrom = next(m_queue.begin(), skipFirst);
-	const deque<SensorData>::iterator oneBelowThreshold = next(startFrom, queueSize() - m_saveThreshold + 1);
+	const size_t keep = min<size_t>(queueSize() - skipFirst, queueSize() - m_saveThreshold + 1);
+	const deque<SensorData>::iterator oneBelowThreshold = next(startFrom, keep);
 
 	copy(startFrom, m_queue.end(), back_inserter(tmp));
 
 	try {
 		m_strategy->push(tmp);
 		m_queue.erase(startFrom, m_queue.end());
+		m_lastSave.update();
 	}
 	BEEEON_CATCH_CHAIN_ACTION(logger(),
 	    if (queueSize() > m_saveThreshold)
@@ -109,7 +159,7 @@ bool QueuingExporter::ship(const SensorData &data)
 	Mutex::ScopedLock lock(m_queueMutex);
 
 	m_queue.emplace_back(data);
-	saveQueue(m_acquiredDataCount);
+	saveQueue(queueInFlight());
 
 	if (!m_queue.empty())
 		m_notEmpty.set();
@@ -117,6 +167,19 @@ bool QueuingExporter::ship(const SensorData &data)
 	return true;
 }
 
+size_t QueuingExporter::shipBatch(const vector<SensorData> &data)
+{
+	Mutex::ScopedLock lock(m_queueMutex);
+
+	m_queue.insert(m_queue.end(), data.begin(), data.end());
+	saveQueue(queueInFlight());
+
+	if (!m_queue.empty())
+		m_notEmpty.set();
+
+	return data.size();
+}
+
 bool QueuingExporter::waitNotEmpty(const Timespan &timeout)
 {
 	return m_notEmpty.tryWait(timeout.totalMilliseconds());
@@ -137,36 +200,107 @@ void QueuingExporter::acquire(
 
 	Mutex::ScopedLock lock(m_queueMutex);
 
-	mix(data, count, m_acquiredDataCount, m_peekedDataCount);
-	saveQueue(m_acquiredDataCount);
+	// repeated acquire without ack provides the same data again
+	m_batches.clear();
+
+	size_t acquired = 0;
+	size_t peeked = 0;
+
+	mix(data, count, 0, 0, acquired, peeked, !m_acked);
+
+	if (acquired + peeked > 0)
+		m_batches.push_back({GlobalID(), acquired, peeked, false});
+
+	saveQueue(acquired);
 	m_acked = false;
 }
 
-void QueuingExporter::mix(vector<SensorData> &data, size_t count, size_t &acquired, size_t &peeked)
+bool QueuingExporter::acquire(
+		const GlobalID &id,
+		vector<SensorData> &data,
+		size_t count,
+		const Timespan &timeout)
+{
+	if (timeout < 0)
+		throw InvalidArgumentException("timeout must be positive");
+
+	if (acquireBatch(id, data, count))
+		return true;
+
+	if (!waitNotEmpty(timeout))
+		return false;
+
+	return acquireBatch(id, data, count);
+}
+
+bool QueuingExporter::acquireBatch(
+		const GlobalID &id,
+		vector<SensorData> &data,
+		size_t count)
+{
+	Mutex::ScopedLock lock(m_queueMutex);
+
+	const size_t queueOffset = queueInFlight();
+	size_t acquired = 0;
+	size_t peeked = 0;
+
+	mix(data, count, queueOffset, strategyInFlight(), acquired, peeked, false);
+
+	if (acquired + peeked == 0) {
+		// all available data are in-flight, wait for new ones
+		m_notEmpty.reset();
+		return false;
+	}
+
+	m_batches.push_back({id, acquired, peeked, false});
+	saveQueue(queueOffset + acquired);
+
+	return true;
+}
+
+void QueuingExporter::mix(
+		vector<SensorData> &data,
+		size_t count,
+		size_t queueOffset,
+		size_t strategyOffset,
+		size_t &acquired,
+		size_t &peeked,
+		bool repeat)
 {
 	Mutex::ScopedLock lock(m_queueMutex);
 
+	const size_t queueDataCount = queueSize() - queueOffset;
+
 	if (m_backupPriority > 0 && !m_strategy->empty()) {
 
 		// preserve recent remainder if not acked yet
-		if (!m_acked)
+		if (repeat)
 			m_mixRemainder = m_previousMixRemainder;
 
 		double realLoadCount = (count * m_backupPriority / 100.0) + m_mixRemainder;
-		auto backupCount = mixFromBackup(count, queueSize(), m_backupPriority, m_mixRemainder);
+		auto backupCount = mixFromBackup(count, queueDataCount, m_backupPriority, m_mixRemainder);
 
 		try {
-			peeked = m_strategy->peek(data, backupCount);
+			if (strategyOffset == 0) {
+				peeked = m_strategy->peek(data, backupCount);
+			}
+			else {
+				vector<SensorData> tmp;
+				const size_t total = m_strategy->peek(tmp, strategyOffset + backupCount);
+
+				peeked = total > strategyOffset ? total - strategyOffset : 0;
+				data.insert(data.end(), tmp.begin() + (total - peeked), tmp.begin() + total);
+			}
 
 			updateRemaindersAfterPeek(peeked, backupCount, realLoadCount - peeked);
 		}
 		BEEEON_CATCH_CHAIN(logger());
 	}
 
-	acquired = mixFromQueue(count - peeked, queueSize());
+	acquired = mixFromQueue(count - peeked, queueDataCount);
 
-	copy(m_queue.begin(),
-	     m_queue.begin() + acquired,
+	copy(m_queue.begin() + queueOffset,
+	     m_queue.begin() + queueOffset + acquired,
 	     back_inserter(data)
 	);
 }
@@ -214,22 +348,83 @@ void QueuingExporter::ack()
 {
 	Mutex::ScopedLock lock(m_queueMutex);
 
-	m_queue.erase(m_queue.begin(), m_queue.begin() + m_acquiredDataCount);
-	m_acquiredDataCount = 0;
-
-	try {
-		m_strategy->pop(m_peekedDataCount);
-		m_peekedDataCount = 0;
+	for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+		if (!it->acked)
+			ackBatch(it);
 	}
-	BEEEON_CATCH_CHAIN(logger());
+
+	releaseAcked();
 
 	m_lastExport.update();
 	m_acked = true;
 }
 
+bool QueuingExporter::ack(const GlobalID &id)
+{
+	Mutex::ScopedLock lock(m_queueMutex);
+
+	for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+		if (it->id == id && !it->acked) {
+			ackBatch(it);
+			releaseAcked();
+
+			m_lastExport.update();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void QueuingExporter::ackBatch(list<Batch>::iterator batch)
+{
+	size_t offset = 0;
+
+	for (auto it = m_batches.begin(); it != batch; ++it)
+		offset += it->acquired;
+
+	m_queue.erase(
+		m_queue.begin() + offset,
+		m_queue.begin() + offset + batch->acquired);
+
+	batch->acquired = 0;
+	batch->acked = true;
+}
+
+void QueuingExporter::releaseAcked()
+{
+	size_t toPop = 0;
+
+	while (!m_batches.empty() && m_batches.front().acked) {
+		toPop += m_batches.front().peeked;
+		m_batches.pop_front();
+	}
+
+	if (toPop == 0)
+		return;
+
+	try {
+		m_strategy->pop(toPop);
+	}
+	BEEEON_CATCH_CHAIN(logger());
+}
+
 void QueuingExporter::reset()
 {
 	Mutex::ScopedLock lock(m_queueMutex);
-	m_acquiredDataCount = 0;
-	m_peekedDataCount = 0;
+	m_batches.clear();
+}
+
+void QueuingExporter::reset(const GlobalID &id)
+{
+	Mutex::ScopedLock lock(m_queueMutex);
+
+	for (auto it = m_batches.begin(); it != m_batches.end(); ++it) {
+		if (it->id == id) {
+			m_batches.erase(it, m_batches.end());
+			break;
+		}
+	}
+
+	m_notEmpty.set();
 }
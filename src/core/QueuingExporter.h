@@ -1,6 +1,7 @@
 #pragma once
 
 #include <deque>
+#include <list>
 
 #include <Poco/Event.h>
 #include <Poco/Mutex.h>
@@ -8,6 +9,7 @@
 
 #include "core/Exporter.h"
 #include "exporters/QueuingStrategy.h"
+#include "model/GlobalID.h"
 #include "model/SensorData.h"
 #include "util/Loggable.h"
 
@@ -55,6 +57,12 @@ public:
 	 */
 	bool ship(const SensorData &data) override;
 
+	/**
+	 * @brief Enqueue all the given data at once.
+	 * @return always size of the given data
+	 */
+	size_t shipBatch(const std::vector<SensorData> &data) override;
+
 	void setStrategy(const QueuingStrategy::Ptr strategy);
 
 	/**
@@ -77,6 +85,18 @@ public:
 	 */
 	void setSaveTimeout(const Poco::Timespan &timeout);
 
+	/**
+	 * When the data are being pushed to the QueuingStrategy because
+	 * the saveTimeout has elapsed, they are pushed at most once per
+	 * the given window. Data shipped meanwhile are thus pushed together
+	 * by the first ship() or acquire() after the window elapses instead
+	 * of each of them separately. Reaching the saveThreshold pushes
+	 * the data immediately. Zero (default) pushes on each ship().
+	 *
+	 * @param window
+	 */
+	void setSaveGroupWindow(const Poco::Timespan &window);
+
 	/**
 	 * Provided SensorData are mix from the queue and the QueuingStrategy.
 	 * The strategyPriority gives the ratio of the provided data between
@@ -104,26 +124,108 @@ protected:
 		size_t count,
 		const Poco::Timespan &timeout);
 
+	/**
+	 * Acquires a new batch of data identified by the given id. The data
+	 * of batches that are already in-flight are skipped, so the new batch
+	 * contains only data not provided by any other in-flight batch.
+	 *
+	 * @param id Identification of the batch used by ack(id) and reset(id).
+	 * @param data Vector to be filled with the acquired data.
+	 * @param count The maximal count of data to be acquired.
+	 * @param timeout If there are no data available, this method waits for the
+	 *                new data income, but for a maximum of this timeout.
+	 * @return True if a new batch has been acquired, false when no data
+	 *         were available.
+	 */
+	bool acquire(
+		const GlobalID &id,
+		std::vector<SensorData> &data,
+		size_t count,
+		const Poco::Timespan &timeout);
+
 	/**
 	 * When this method is called, all the previously acquired data are
 	 * permanently deleted.
 	 */
 	void ack();
 
+	/**
+	 * Acknowledge the batch of the given id. Its data from the queue are
+	 * deleted immediately. Its data from the QueuingStrategy are popped
+	 * as soon as all the older batches are acknowledged.
+	 *
+	 * @return False if there is no such batch in-flight.
+	 */
+	bool ack(const GlobalID &id);
+
 	/**
 	 * After calling this method, no data are longer considered as acquired.
 	 */
 	void reset();
 
+	/**
+	 * Release the batch of the given id and all batches acquired after
+	 * it. Their data are no longer considered as acquired and would be
+	 * provided again by the following calls to acquire(). Data of the
+	 * released batches that has already been acknowledged might be
+	 * provided again when they come from the QueuingStrategy.
+	 */
+	void reset(const GlobalID &id);
+
+	/**
+	 * @return Count of batches acquired but not acknowledged yet.
+	 */
+	size_t inFlight() const;
+
 	/**
 	 * @return True if the queue is empty.
 	 */
 	bool empty() const;
 
 private:
+	/**
+	 * @brief Batch of data provided by a single call to acquire().
+	 * The data of all in-flight batches form continuous prefixes
+	 * of the queue and of the QueuingStrategy in the order of
+	 * the batches.
+	 */
+	struct Batch {
+		GlobalID id;
+		size_t acquired;
+		size_t peeked;
+		bool acked;
+	};
+
 	bool shouldSave() const;
 	size_t queueSize() const;
 
+	/**
+	 * @return count of data from the queue held by in-flight batches.
+	 */
+	size_t queueInFlight() const;
+
+	/**
+	 * @return count of data from the QueuingStrategy held by batches.
+	 */
+	size_t strategyInFlight() const;
+
+	bool acquireBatch(
+		const GlobalID &id,
+		std::vector<SensorData> &data,
+		size_t count);
+
+	/**
+	 * Delete the data of the given batch from the queue
+	 * and mark it as acknowledged.
+	 */
+	void ackBatch(std::list<Batch>::iterator batch);
+
+	/**
+	 * Remove acknowledged batches from the beginning of the list
+	 * and pop their data from the QueuingStrategy.
+	 */
+	void releaseAcked();
+
 	bool waitNotEmpty(const Poco::Timespan &timeout);
 
 	/**
@@ -164,18 +266,27 @@ private:
 	 * are used to fill the vector, and the appropriate amount of data from another
 	 * source is added, to provide the total required amount.
 	 *
+	 * Data that are already held by in-flight batches are skipped via
+	 * the queueOffset and strategyOffset parameters.
+	 *
 	 * @param data Vector to be filled
 	 * @param count Required amount of SensorData
+	 * @param queueOffset Count of data to skip in the buffer
+	 * @param strategyOffset Count of data to skip in the QueuingStrategy
 	 * @param acquired The count of data in the added to vector from the buffer
 	 *                 is returned via this parameter
 	 * @param peeked The count of data in the added to vector from
 	 *               the QueuingStrategy is returned via this parameter
+	 * @param repeat The call repeats the recent one that has not been acked
 	 */
 	void mix(
 		std::vector<SensorData> &data,
 		size_t count,
+		size_t queueOffset,
+		size_t strategyOffset,
 		size_t &acquired,
-		size_t &peeked);
+		size_t &peeked,
+		bool repeat);
 
 	size_t mixFromBackup(
 		size_t requiredCount,
@@ -203,10 +314,11 @@ private:
 	uint32_t m_backupPriority;
 	size_t m_saveThreshold;
 	Poco::Timespan m_saveTimeout;
+	Poco::Timespan m_saveGroupWindow;
 
-	size_t m_acquiredDataCount;
-	size_t m_peekedDataCount;
+	std::list<Batch> m_batches;
 	Poco::Timestamp m_lastExport;
+	Poco::Timestamp m_lastSave;
 	std::deque<SensorData> m_queue;
 
 	bool m_acked;
@@ -0,0 +1,7 @@
+#include "core/SensorDataFilter.h"
+
+using namespace BeeeOn;
+
+SensorDataFilter::~SensorDataFilter()
+{
+}
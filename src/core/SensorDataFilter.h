@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Poco/SharedPtr.h>
+
+namespace BeeeOn {
+
+class SensorData;
+
+/**
+ * @brief SensorDataFilter decides which values of SensorData are passed
+ * further to exporters. It can remove values from the given SensorData.
+ */
+class SensorDataFilter {
+public:
+	typedef Poco::SharedPtr<SensorDataFilter> Ptr;
+
+	virtual ~SensorDataFilter();
+
+	/**
+	 * @brief Remove values that should not be exported from the given data.
+	 * @returns false if the whole data should be dropped
+	 */
+	virtual bool filter(SensorData &data) = 0;
+};
+
+}
@@ -1,3 +1,5 @@
+#include <sstream>
+
 #include <Poco/Crypto/Cipher.h>
 #include <Poco/Crypto/CipherFactory.h>
 #include <Poco/Crypto/CipherKey.h>
@@ -35,6 +37,7 @@ BEEEON_OBJECT_PROPERTY("console", &TestingCenter::setConsole)
 BEEEON_OBJECT_PROPERTY("credentialsStorage", &TestingCenter::setCredentialsStorage)
 BEEEON_OBJECT_PROPERTY("cryptoConfig", &TestingCenter::setCryptoConfig)
 BEEEON_OBJECT_PROPERTY("pairedDevices", &TestingCenter::setPairedDevices)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &TestingCenter::setMetricsRegistry)
 BEEEON_OBJECT_END(BeeeOn, TestingCenter)
 
 using namespace std;
@@ -479,6 +482,28 @@ static void credentialsAction(TestingCenter::ActionContext &context)
 	}
 }
 
+/**
+ * Print metrics (optionally only those of the given name prefix)
+ * in the Prometheus text format.
+ */
+static void metricsAction(TestingCenter::ActionContext &context)
+{
+	ConsoleSession &console = context.console;
+
+	if (context.metricsRegistry.isNull()) {
+		console.print("no metrics registry configured");
+		return;
+	}
+
+	ostringstream buffer;
+	context.metricsRegistry->format(
+		buffer, context.args.size() > 1 ? context.args[1] : "");
+
+	StringTokenizer lines(buffer.str(), "\n", StringTokenizer::TOK_IGNORE_EMPTY);
+	for (const auto &line : lines)
+		console.print(line);
+}
+
 TestingCenter::TestingCenter():
 	m_stop(0)
 {
@@ -487,6 +512,7 @@ TestingCenter::TestingCenter():
 	registerAction("wait-queue", waitQueueAction, "wait for new command answers");
 	registerAction("device", deviceAction, "simulate device in server database");
 	registerAction("credentials", credentialsAction, "manage credentials storage");
+	registerAction("metrics", metricsAction, "print runtime metrics");
 }
 
 void TestingCenter::registerAction(
@@ -524,6 +550,11 @@ void TestingCenter::setCryptoConfig(SharedPtr<CryptoConfig> config)
 	m_cryptoConfig = config;
 }
 
+void TestingCenter::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_metricsRegistry = registry;
+}
+
 void TestingCenter::printHelp(ConsoleSession &session)
 {
 	session.print("Gateway Testing Center");
@@ -558,7 +589,8 @@ void TestingCenter::processLine(ConsoleSession &session, const string &line)
 	}
 
 	ActionContext context {session, m_devices, m_mutex,
-		*this, args, m_credentialsStorage, m_cryptoConfig, m_newDevices, m_acceptedDevices, m_seenDevices};
+		*this, args, m_credentialsStorage, m_cryptoConfig, m_newDevices, m_acceptedDevices, m_seenDevices,
+		m_metricsRegistry};
 	Action f = it->second.action;
 
 	try {
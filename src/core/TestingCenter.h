@@ -10,6 +10,7 @@
 
 #include "core/CommandHandler.h"
 #include "core/CommandSender.h"
+#include "core/MetricsRegistry.h"
 #include "credentials/FileCredentialsStorage.h"
 #include "io/Console.h"
 #include "loop/StoppableRunnable.h"
@@ -40,6 +41,7 @@ public:
 		std::list<DeviceID> &newDevices;
 		std::set<DeviceID> &acceptedDevices;
 		std::map<DeviceID, DeviceDescription> &seenDevices;
+		MetricsRegistry::Ptr metricsRegistry;
 	};
 
 	/**
@@ -65,6 +67,7 @@ public:
 	Poco::SharedPtr<Console> console() const;
 	void setCredentialsStorage(Poco::SharedPtr<FileCredentialsStorage> storage);
 	void setCryptoConfig(Poco::SharedPtr<CryptoConfig> config);
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
 
 protected:
 	void registerAction(
@@ -85,6 +88,7 @@ private:
 	Poco::SharedPtr<CryptoConfig> m_cryptoConfig;
 	std::map<DeviceID, DeviceDescription> m_seenDevices;
 	std::set<DeviceID> m_acceptedDevices;
+	MetricsRegistry::Ptr m_metricsRegistry;
 };
 
 }
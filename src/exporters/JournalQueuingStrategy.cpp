@@ -1,17 +1,26 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+#include <Poco/Ascii.h>
+#include <Poco/ByteOrder.h>
+#include <Poco/Checksum.h>
+#include <Poco/Clock.h>
 #include <Poco/DateTimeFormat.h>
 #include <Poco/DateTimeFormatter.h>
-#include <Poco/DigestStream.h>
+#include <Poco/DeflatingStream.h>
 #include <Poco/DirectoryIterator.h>
 #include <Poco/Exception.h>
 #include <Poco/FileStream.h>
+#include <Poco/InflatingStream.h>
 #include <Poco/Logger.h>
-#include <Poco/NullStream.h>
+#include <Poco/MemoryStream.h>
 #include <Poco/NumberFormatter.h>
 #include <Poco/NumberParser.h>
 #include <Poco/RegularExpression.h>
-#include <Poco/StreamCopier.h>
-#include <Poco/String.h>
 #include <Poco/SHA1Engine.h>
+#include <Poco/StreamCopier.h>
 
 #include "di/Injectable.h"
 #include "exporters/JournalQueuingStrategy.h"
@@ -28,6 +37,10 @@ BEEEON_OBJECT_PROPERTY("disableGC", &JournalQueuingStrategy::setDisableGC)
 BEEEON_OBJECT_PROPERTY("neverDropOldest", &JournalQueuingStrategy::setNeverDropOldest)
 BEEEON_OBJECT_PROPERTY("bytesLimit", &JournalQueuingStrategy::setBytesLimit)
 BEEEON_OBJECT_PROPERTY("ignoreIndexErrors", &JournalQueuingStrategy::setIgnoreIndexErrors)
+BEEEON_OBJECT_PROPERTY("bufferFormat", &JournalQueuingStrategy::setBufferFormat)
+BEEEON_OBJECT_PROPERTY("compression", &JournalQueuingStrategy::setCompression)
+BEEEON_OBJECT_PROPERTY("bufferReader", &JournalQueuingStrategy::setBufferReader)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &JournalQueuingStrategy::setMetricsRegistry)
 BEEEON_OBJECT_HOOK("done", &JournalQueuingStrategy::setup)
 BEEEON_OBJECT_END(BeeeOn, JournalQueuingStrategy)
 
@@ -36,14 +49,145 @@ using namespace Poco;
 using namespace BeeeOn;
 
 static const RegularExpression BUFFER_REGEX("^[a-fA-F0-9]{40}$");
-static const RegularExpression INDEX_REGEX("^index$");
 static const RegularExpression INDEX_LOCK_REGEX("^index.lock$");
 
+/**
+ * Binary buffer header: magic (4 B), version (1 B), flags (1 B)
+ * and reserved (2 B). The leading zero byte never starts a text
+ * buffer and thus both formats are distinguishable. Compressed
+ * buffers always start with the header, the flags denote
+ * the compression and format of the records.
+ */
+static const char BINARY_MAGIC[] = {'\0', 'J', 'Q', 'S'};
+static const char BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_SIZE = 8;
+static const char BINARY_FLAG_DEFLATE = 0x01;
+static const char BINARY_FLAG_TEXT = 0x02;
+static const char BINARY_FLAGS_KNOWN = BINARY_FLAG_DEFLATE | BINARY_FLAG_TEXT;
+
+/**
+ * Binary record layout: CRC32 and values count (prefix), device ID
+ * and timestamp (fixed part) and values count times module ID and value.
+ */
+static const size_t BINARY_RECORD_PREFIX = 6;
+static const size_t BINARY_RECORD_FIXED = 16;
+static const size_t BINARY_VALUE_SIZE = 10;
+
+template <typename T>
+static void appendNetwork(string &buffer, T value)
+{
+	value = ByteOrder::toNetwork(value);
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+static T readNetwork(const char *p)
+{
+	T value;
+	memcpy(&value, p, sizeof(value));
+	return ByteOrder::fromNetwork(value);
+}
+
+static UInt32 recordChecksum(const char *prefix, const char *record, size_t size)
+{
+	Checksum csum(Checksum::TYPE_CRC32);
+	csum.update(prefix + 4, BINARY_RECORD_PREFIX - 4);
+	csum.update(record, size);
+
+	return csum.checksum();
+}
+
+static SensorData parseBinaryRecord(const char *record, size_t values)
+{
+	const char *p = record;
+	SensorData data;
+
+	data.setDeviceID(DeviceID(readNetwork<UInt64>(p)));
+	data.setTimestamp(Timestamp(readNetwork<Int64>(p + 8)));
+	p += BINARY_RECORD_FIXED;
+
+	for (size_t i = 0; i < values; ++i, p += BINARY_VALUE_SIZE) {
+		const UInt64 bits = readNetwork<UInt64>(p + 2);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+
+		data.insertValue(SensorValue(
+			ModuleID(readNetwork<UInt16>(p)),
+			value));
+	}
+
+	return data;
+}
+
+/**
+ * @returns flags of the buffer header or 0 if there is no header.
+ */
+static char headerFlags(const char *data, size_t size)
+{
+	if (size < BINARY_HEADER_SIZE)
+		return 0;
+
+	if (memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)))
+		return 0;
+
+	return data[5];
+}
+
+/**
+ * Inflate the given zlib stream and append the result to the output.
+ * Inflating stops on the first error and data inflated so far are kept
+ * as they can still contain valid records.
+ */
+static void inflateInto(const char *data, size_t size, string &output)
+{
+	MemoryInputStream raw(data, size);
+	InflatingInputStream in(raw, InflatingStreamBuf::STREAM_ZLIB);
+	char chunk[4096];
+
+	try {
+		while (in) {
+			in.read(chunk, sizeof(chunk));
+			output.append(chunk, in.gcount());
+		}
+	}
+	catch (const Exception &) {
+		// keep the partially inflated contents
+	}
+}
+
+static void dataPeriod(
+		const vector<SensorData> &data,
+		Timestamp &oldest,
+		Timestamp &newest)
+{
+	for (const auto &one : data) {
+		const Timestamp &timestamp = one.timestamp().value();
+
+		oldest = min(oldest, timestamp);
+		newest = max(newest, timestamp);
+	}
+}
+
 JournalQueuingStrategy::JournalQueuingStrategy():
 	m_gcDisabled(false),
 	m_neverDropOldest(false),
 	m_bytesLimit(-1),
-	m_ignoreIndexErrors(true)
+	m_ignoreIndexErrors(true),
+	m_bufferFormat(FORMAT_TEXT),
+	m_compression(COMPRESSION_NONE),
+	m_bufferReader(READER_MMAP),
+	m_pushedCount(MetricsRegistry::createCounter()),
+	m_poppedCount(MetricsRegistry::createCounter()),
+	m_droppedBuffers(MetricsRegistry::createCounter()),
+	m_writeDuration(MetricsRegistry::createHistogram()),
+	m_bytesUsed(MetricsRegistry::createGauge()),
+	m_rawBytes(MetricsRegistry::createCounter()),
+	m_storedBytes(MetricsRegistry::createCounter()),
+	m_retention(MetricsRegistry::createGauge()),
+	m_retentionOldest(Timestamp::TIMEVAL_MAX),
+	m_retentionNewest(Timestamp::TIMEVAL_MIN),
+	m_retentionBytes(0),
+	m_ledgerValid(false)
 {
 }
 
@@ -86,6 +230,103 @@ void JournalQueuingStrategy::setIgnoreIndexErrors(bool ignore)
 	m_ignoreIndexErrors = ignore;
 }
 
+void JournalQueuingStrategy::setBufferFormat(const string &format)
+{
+	if (format == "text")
+		m_bufferFormat = FORMAT_TEXT;
+	else if (format == "binary")
+		m_bufferFormat = FORMAT_BINARY;
+	else
+		throw InvalidArgumentException("unsupported buffer format: " + format);
+}
+
+JournalQueuingStrategy::BufferFormat JournalQueuingStrategy::bufferFormat() const
+{
+	return m_bufferFormat;
+}
+
+void JournalQueuingStrategy::setCompression(const string &compression)
+{
+	if (compression == "none")
+		m_compression = COMPRESSION_NONE;
+	else if (compression == "deflate")
+		m_compression = COMPRESSION_DEFLATE;
+	else
+		throw InvalidArgumentException("unsupported compression: " + compression);
+}
+
+JournalQueuingStrategy::BufferCompression JournalQueuingStrategy::compression() const
+{
+	return m_compression;
+}
+
+void JournalQueuingStrategy::setBufferReader(const string &reader)
+{
+	if (reader == "mmap")
+		m_bufferReader = READER_MMAP;
+	else if (reader == "stream")
+		m_bufferReader = READER_STREAM;
+	else
+		throw InvalidArgumentException("unsupported buffer reader: " + reader);
+}
+
+JournalQueuingStrategy::BufferReader JournalQueuingStrategy::bufferReader() const
+{
+	return m_bufferReader;
+}
+
+Timespan JournalQueuingStrategy::estimatedRetention() const
+{
+	if (m_bytesLimit < 0 || m_retentionBytes == 0)
+		return 0;
+
+	if (m_retentionNewest <= m_retentionOldest)
+		return 0;
+
+	const Timespan period = m_retentionNewest - m_retentionOldest;
+	const double ratio = m_bytesLimit / (double) m_retentionBytes;
+
+	return Timespan::TimeDiff(period.totalMicroseconds() * ratio);
+}
+
+void JournalQueuingStrategy::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	const MetricsRegistry::Labels labels = {{"rootDir", m_rootDir.toString()}};
+
+	m_pushedCount = registry->counter(
+		"beeeon_journal_pushed_total",
+		"Data pushed into the journal",
+		labels);
+	m_poppedCount = registry->counter(
+		"beeeon_journal_popped_total",
+		"Data popped off the journal",
+		labels);
+	m_droppedBuffers = registry->counter(
+		"beeeon_journal_dropped_buffers_total",
+		"Buffers with valid data dropped to free space",
+		labels);
+	m_writeDuration = registry->histogram(
+		"beeeon_journal_write_seconds",
+		"Duration of writing a buffer durably",
+		labels);
+	m_bytesUsed = registry->gauge(
+		"beeeon_journal_bytes_used",
+		"Bytes consumed by the journal in the filesystem",
+		labels);
+	m_rawBytes = registry->counter(
+		"beeeon_journal_raw_bytes_total",
+		"Bytes of records written before compression",
+		labels);
+	m_storedBytes = registry->counter(
+		"beeeon_journal_stored_bytes_total",
+		"Bytes of buffers written into the filesystem",
+		labels);
+	m_retention = registry->gauge(
+		"beeeon_journal_retention_seconds",
+		"Estimated period of data fitting into the bytes limit",
+		labels);
+}
+
 void JournalQueuingStrategy::initIndex(const Path &index)
 {
 	m_index = new Journal(index);
@@ -120,7 +361,7 @@ void JournalQueuingStrategy::inspectAndRegisterBuffer(
 		m_index->drop(name, false);
 		return) // non-recoverable, just skip it
 
-	FileBuffer buffer(file.path(), offset, size);
+	FileBuffer buffer(file.path(), offset, size, m_bufferReader);
 	FileBufferStat stat;
 
 	if (logger().debug()) {
@@ -171,6 +412,19 @@ void JournalQueuingStrategy::prescanBuffers(Timestamp &newest, BrokenHandler bro
 		try {
 			inspectAndRegisterBuffer(name, offset, newest);
 		}
+		catch (const FileNotFoundException &e) {
+			logger().log(e, __FILE__, __LINE__);
+			broken(name, offset, newest);
+		}
+		catch (const IOException &e) {
+			// the contents might be valid, keep it for next setup()
+			logger().log(e, __FILE__, __LINE__);
+			logger().error(
+				"buffer " + name + " is unreadable, keeping it",
+				__FILE__, __LINE__);
+
+			m_unreadable.emplace(name);
+		}
 		BEEEON_CATCH_CHAIN_ACTION(logger(),
 			broken(name, offset, newest));
 	}
@@ -187,6 +441,7 @@ void JournalQueuingStrategy::setup()
 			whipeFile(pathTo(name));	
 		});
 
+	rescanLedger();
 	reportStats(newest);
 }
 
@@ -194,8 +449,13 @@ Timestamp JournalQueuingStrategy::initIndexAndScan(BrokenHandler broken)
 {
 	m_buffers.clear();
 	m_exhausted.clear();
+	m_unreadable.clear();
 	m_entryCache.clear();
 
+	m_retentionOldest = Timestamp::TIMEVAL_MAX;
+	m_retentionNewest = Timestamp::TIMEVAL_MIN;
+	m_retentionBytes = 0;
+
 	File rootDir(m_rootDir);
 	rootDir.createDirectories();
 
@@ -215,6 +475,15 @@ void JournalQueuingStrategy::reportStats(const Timestamp &newest) const
 		+ " B, total " + to_string(bytesUsedAll())
 		+ " B, newest timestamp: " + tsString(newest),
 		__FILE__, __LINE__);
+
+	const Timespan retention = estimatedRetention();
+	if (retention > 0) {
+		logger().information(
+			"estimated retention "
+			+ DateTimeFormatter::format(retention)
+			+ " for " + to_string(m_bytesLimit) + " B",
+			__FILE__, __LINE__);
+	}
 }
 
 bool JournalQueuingStrategy::whipeFile(File file, bool usuallyFails) const
@@ -225,9 +494,12 @@ bool JournalQueuingStrategy::whipeFile(File file, bool usuallyFails) const
 			__FILE__, __LINE__);
 	}
 
+	const string name = Path(file.path()).getFileName();
+
 	if (usuallyFails) {
 		try {
 			file.remove(true);
+			ledgerRemoved(name);
 			return true;
 		}
 		catch (...) {}
@@ -235,11 +507,15 @@ bool JournalQueuingStrategy::whipeFile(File file, bool usuallyFails) const
 	else {
 		try {
 			file.remove(true);
+			ledgerRemoved(name);
 			return true;
 		}
 		BEEEON_CATCH_CHAIN(logger())
 	}
 
+	if (m_ledger.find(name) != m_ledger.end())
+		ledgerInvalidate();
+
 	return false;
 }
 
@@ -267,12 +543,17 @@ void JournalQueuingStrategy::registerBuffer(
 		__FILE__, __LINE__);
 
 	m_buffers.emplace_back(buffer);
+	updateRetention(stat.oldest, stat.newest, buffer.size());
 }
 
 string JournalQueuingStrategy::writeData(
 		const string &data,
 		bool force) const
 {
+	// data.tmp might be left in any state on failure
+	const bool ledgerValid = m_ledgerValid;
+	ledgerInvalidate();
+
 	SafeWriter writer(pathTo("data.tmp"));
 	writer.stream(force) << data;
 
@@ -297,6 +578,11 @@ string JournalQueuingStrategy::writeData(
 
 	const auto &name = DigestEngine::digestToHex(state.first);
 	writer.commitAs(pathTo(name));
+
+	m_ledgerValid = ledgerValid;
+	ledgerRemoved("data.tmp");
+	ledgerWritten(name, data.size());
+
 	return name;
 }
 
@@ -305,14 +591,56 @@ Journal::Ptr JournalQueuingStrategy::index() const
 	return m_index;
 }
 
-void JournalQueuingStrategy::push(const vector<SensorData> &data)
+void JournalQueuingStrategy::writeBuffer(
+		const string &entries,
+		const Timestamp &oldest,
+		const Timestamp &newest)
 {
-	const string &buffer = FileBuffer::formatEntries(data);
+	const auto &buffer = FileBuffer::formatBuffer(
+		entries, m_bufferFormat, m_compression);
+	const Clock started;
+
 	if (!garbageCollect(buffer.size()))
 		dropOldestBuffers(buffer.size());
 
 	const auto &name = writeData(buffer);
 	m_index->append(name, "0");
+
+	m_writeDuration->observe(started.elapsed());
+	m_bytesUsed->set(bytesUsedAll());
+	m_rawBytes->add(entries.size());
+	m_storedBytes->add(buffer.size());
+
+	updateRetention(oldest, newest, buffer.size());
+}
+
+void JournalQueuingStrategy::updateRetention(
+		const Timestamp &oldest,
+		const Timestamp &newest,
+		size_t bytes)
+{
+	if (oldest > newest)
+		return; // no data
+
+	m_retentionOldest = min(m_retentionOldest, oldest);
+	m_retentionNewest = max(m_retentionNewest, newest);
+	m_retentionBytes += bytes;
+
+	m_retention->set(estimatedRetention().totalSeconds());
+}
+
+void JournalQueuingStrategy::push(const vector<SensorData> &data)
+{
+	m_pushedCount->add(data.size());
+
+	Timestamp oldest = Timestamp::TIMEVAL_MAX;
+	Timestamp newest = Timestamp::TIMEVAL_MIN;
+	dataPeriod(data, oldest, newest);
+
+	writeBuffer(
+		FileBuffer::formatEntries(data, m_bufferFormat),
+		oldest,
+		newest);
 }
 
 size_t JournalQueuingStrategy::readEntries(
@@ -439,6 +767,8 @@ void JournalQueuingStrategy::pop(size_t count)
 		},
 		(count - cacheCount));
 
+	m_poppedCount->add(total);
+
 	if (logger().debug()) {
 		logger().debug(
 			"pop " + to_string(total) + " entries, "
@@ -476,6 +806,8 @@ void JournalQueuingStrategy::collectReferenced(set<string> &referenced) const
 		referenced.emplace(buffer.name());
 	for (const auto &pair : m_exhausted)
 		referenced.emplace(pair.first);
+	for (const auto &name : m_unreadable)
+		referenced.emplace(name);
 }
 
 bool JournalQueuingStrategy::garbageCollect(const size_t bytes)
@@ -499,32 +831,21 @@ bool JournalQueuingStrategy::garbageCollect(const size_t bytes)
 		+ to_string(used + bytes) + " B",
 		__FILE__, __LINE__);
 
-	DirectoryIterator it(m_rootDir);
-	const DirectoryIterator end;
-
 	set<string> referenced; // collect names of buffers
 	collectReferenced(referenced);
 
 	multimap<size_t, File, greater<size_t>> dangling;
 	size_t total = 0;
 
-	for (; it != end; ++it) {
-		if (!BUFFER_REGEX.match(it.name()))
+	for (const auto &pair : m_ledger) {
+		if (!BUFFER_REGEX.match(pair.first))
 			continue;
 
-		if (referenced.find(it.name()) != referenced.end())
+		if (referenced.find(pair.first) != referenced.end())
 			continue;
 
-		size_t size = 0;
-
-		try {
-			size = it->getSize();
-		}
-		BEEEON_CATCH_CHAIN_ACTION(logger(),
-			continue)
-
-		dangling.emplace(size, *it);
-		total += size;
+		dangling.emplace(pair.second, File(pathTo(pair.first)));
+		total += pair.second;
 	}
 
 	logger().information(
@@ -622,6 +943,7 @@ void JournalQueuingStrategy::dropOldestBuffers(const size_t bytes)
 			removed += it->size();
 			dropped.emplace(it->name());
 			m_index->drop(it->name());
+			m_droppedBuffers->add();
 		}
 	}
 
@@ -665,8 +987,32 @@ size_t JournalQueuingStrategy::bytesUsed() const
 
 size_t JournalQueuingStrategy::bytesUsedAll() const
 {
+	if (!m_ledgerValid)
+		rescanLedger();
+
 	size_t bytes = 0;
 
+	for (const auto &pair : m_ledger)
+		bytes += pair.second;
+
+	// the index changes with each append, just stat it
+	File index = pathTo("index");
+
+	try {
+		bytes += index.getSize();
+	}
+	catch (const FileNotFoundException &) {
+		// no index yet
+	}
+	BEEEON_CATCH_CHAIN(logger())
+
+	return bytes;
+}
+
+void JournalQueuingStrategy::rescanLedger() const
+{
+	m_ledger.clear();
+
 	DirectoryIterator it(m_rootDir);
 	const DirectoryIterator end;
 
@@ -687,16 +1033,29 @@ size_t JournalQueuingStrategy::bytesUsedAll() const
 		}
 
 		if (BUFFER_REGEX.match(it.name()))
-			bytes += size;
+			m_ledger[it.name()] = size;
 		else if (it.name() == "data.tmp")
-			bytes += size;
-		else if (INDEX_REGEX.match(it.name()))
-			bytes += size;
+			m_ledger[it.name()] = size;
 		else if (INDEX_LOCK_REGEX.match(it.name()))
-			bytes += size;
+			m_ledger[it.name()] = size;
 	}
 
-	return bytes;
+	m_ledgerValid = true;
+}
+
+void JournalQueuingStrategy::ledgerWritten(const string &name, size_t bytes) const
+{
+	m_ledger[name] = bytes;
+}
+
+void JournalQueuingStrategy::ledgerRemoved(const string &name) const
+{
+	m_ledger.erase(name);
+}
+
+void JournalQueuingStrategy::ledgerInvalidate() const
+{
+	m_ledgerValid = false;
 }
 
 Path JournalQueuingStrategy::pathTo(const string &name) const
@@ -744,10 +1103,13 @@ void JournalQueuingStrategy::FileBufferStat::update(
 JournalQueuingStrategy::FileBuffer::FileBuffer(
 		const Path &path,
 		size_t offset,
-		size_t size):
+		size_t size,
+		BufferReader reader):
 	m_path(path),
 	m_offset(offset),
-	m_size(size)
+	m_size(size),
+	m_end(size),
+	m_reader(reader)
 {
 }
 
@@ -773,7 +1135,7 @@ size_t JournalQueuingStrategy::FileBuffer::size() const
 
 bool JournalQueuingStrategy::FileBuffer::exhausted() const
 {
-	return m_offset >= m_size;
+	return m_offset >= m_end;
 }
 
 size_t JournalQueuingStrategy::FileBuffer::readEntries(
@@ -784,10 +1146,20 @@ size_t JournalQueuingStrategy::FileBuffer::readEntries(
 	try {
 		const size_t total = scanEntries(m_offset, proc, bytes, 1024);
 		m_offset += bytes;
+
+		if (exhausted())
+			unmap();
+		else if (m_reader == READER_STREAM)
+			m_loaded.reset(); // read the file again on the next access
+
 		return total;
 	}
 	catch (...) {
 		m_offset += bytes;
+
+		if (m_reader == READER_STREAM)
+			m_loaded.reset();
+
 		throw;
 	}
 }
@@ -802,10 +1174,20 @@ size_t JournalQueuingStrategy::FileBuffer::readEntries(
 	try {
 		const size_t total = scanEntries(m_offset, proc, bytes, count);
 		m_offset += bytes;
+
+		if (exhausted())
+			unmap();
+		else if (m_reader == READER_STREAM)
+			m_loaded.reset(); // read the file again on the next access
+
 		return total;
 	}
 	catch (...) {
 		m_offset += bytes;
+
+		if (m_reader == READER_STREAM)
+			m_loaded.reset();
+
 		throw;
 	}
 }
@@ -814,32 +1196,27 @@ void JournalQueuingStrategy::FileBuffer::inspectAndVerify(
 	const DigestEngine::Digest &digest,
 	FileBufferStat &stat) const
 {
-	FileInputStream fin(m_path.toString());
-	SHA1Engine engine;
-	DigestInputStream in(engine, fin);
+	// do not hold mappings or inflated contents of the whole backlog
+	try {
+		verifyAndScan(digest, stat);
+	}
+	catch (...) {
+		release();
+		throw;
+	}
 
-	while (fin) {
-		try {
-			scanEntries(
-				in,
-				[&](const Entry &entry) {
-					stat.offset = entry.nextOffset();		
-					stat.count += 1;
-					stat.update(entry.data().timestamp());
-				},
-				stat.bytes,
-				1024);
-		}
-		catch (const Exception &e) {
-			if (!in.good())
-				e.rethrow();
+	release();
+}
 
-			stat.broken += 1;
-		}
-	}
+void JournalQueuingStrategy::FileBuffer::verifyAndScan(
+	const DigestEngine::Digest &digest,
+	FileBufferStat &stat) const
+{
+	const View raw = contents();
 
-	NullOutputStream null;
-	StreamCopier::copyStream(in, null);
+	SHA1Engine engine;
+	if (raw.size > 0)
+		engine.update(raw.data, raw.size);
 
 	const auto &computed = engine.digest();
 
@@ -849,78 +1226,372 @@ void JournalQueuingStrategy::FileBuffer::inspectAndVerify(
 			+ " != "
 			+ DigestEngine::digestToHex(computed));
 	}
+
+	const View content = view();
+	const auto format = scanHeader(content, stat.bytes);
+
+	scanEntries(
+		content,
+		stat.bytes,
+		format,
+		[&](const Entry &entry) {
+			stat.offset = entry.nextOffset();
+			stat.count += 1;
+			stat.update(entry.data().timestamp());
+		},
+		stat.bytes,
+		numeric_limits<size_t>::max(),
+		&stat.broken);
 }
 
 string JournalQueuingStrategy::FileBuffer::formatEntries(
-	const vector<SensorData> &data)
+	const vector<SensorData> &data,
+	BufferFormat format)
 {
 	static ChecksumSensorDataFormatter formatter(new JSONSensorDataFormatter);
 
 	string buffer;
 
+	if (format == FORMAT_BINARY) {
+		for (const auto &one : data) {
+			const size_t start = buffer.size();
+			buffer.append(BINARY_RECORD_PREFIX, '\0');
+
+			appendNetwork<UInt64>(buffer, one.deviceID().data());
+			appendNetwork<Int64>(buffer,
+				one.timestamp().value().epochMicroseconds());
+
+			size_t values = 0;
+			for (const auto &item : one) {
+				const double value = item.isValid() ? item.value() : NAN;
+				UInt64 bits;
+				memcpy(&bits, &value, sizeof(bits));
+
+				appendNetwork<UInt16>(buffer, item.moduleID().value());
+				appendNetwork<UInt64>(buffer, bits);
+				values += 1;
+			}
+
+			if (values > 0xffff) {
+				throw RangeException(
+					"too many values (" + to_string(values) + ") for "
+					+ one.deviceID().toString());
+			}
+
+			const UInt16 count = ByteOrder::toNetwork(UInt16(values));
+			memcpy(&buffer[start + 4], &count, sizeof(count));
+
+			const UInt32 crc = ByteOrder::toNetwork(recordChecksum(
+				buffer.data() + start,
+				buffer.data() + start + BINARY_RECORD_PREFIX,
+				buffer.size() - start - BINARY_RECORD_PREFIX));
+			memcpy(&buffer[start], &crc, sizeof(crc));
+		}
+
+		return buffer;
+	}
+
 	for (const auto &one : data) {
-		buffer += formatter.format(one);
+		formatter.formatTo(one, buffer);
 		buffer += "\n";
 	}
 
 	return buffer;
 }
 
+string JournalQueuingStrategy::FileBuffer::formatHeader(
+		BufferFormat format,
+		BufferCompression compression)
+{
+	if (format == FORMAT_TEXT && compression == COMPRESSION_NONE)
+		return "";
+
+	char flags = 0;
+
+	if (format == FORMAT_TEXT)
+		flags |= BINARY_FLAG_TEXT;
+	if (compression == COMPRESSION_DEFLATE)
+		flags |= BINARY_FLAG_DEFLATE;
+
+	string header(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	header += BINARY_VERSION;
+	header += flags;
+	header.append(BINARY_HEADER_SIZE - header.size(), '\0');
+
+	return header;
+}
+
+string JournalQueuingStrategy::FileBuffer::formatBuffer(
+		const string &entries,
+		BufferFormat format,
+		BufferCompression compression)
+{
+	string buffer = formatHeader(format, compression);
+
+	if (compression == COMPRESSION_NONE) {
+		buffer += entries;
+		return buffer;
+	}
+
+	ostringstream out;
+	DeflatingOutputStream deflate(out, DeflatingStreamBuf::STREAM_ZLIB);
+	deflate.write(entries.data(), entries.size());
+	deflate.close();
+
+	buffer += out.str();
+	return buffer;
+}
+
+void JournalQueuingStrategy::FileBuffer::unmap()
+{
+	release();
+}
+
+void JournalQueuingStrategy::FileBuffer::release() const
+{
+	m_mapping.reset();
+	m_loaded.reset();
+	m_inflated.reset();
+}
+
+const MappedFile &JournalQueuingStrategy::FileBuffer::mapping() const
+{
+	if (m_mapping.isNull())
+		m_mapping = new MappedFile(m_path);
+
+	return *m_mapping;
+}
+
+JournalQueuingStrategy::FileBuffer::View JournalQueuingStrategy::FileBuffer::contents() const
+{
+	if (m_reader == READER_MMAP) {
+		const MappedFile &raw = mapping();
+		return {raw.data(), raw.size()};
+	}
+
+	if (m_loaded.isNull()) {
+		SharedPtr<string> loaded = new string;
+		FileInputStream in(m_path.toString());
+		StreamCopier::copyToString(in, *loaded);
+
+		if (in.bad())
+			throw ReadFileException("failed to read " + m_path.toString());
+
+		m_loaded = loaded;
+	}
+
+	return {m_loaded->data(), m_loaded->size()};
+}
+
+JournalQueuingStrategy::FileBuffer::View JournalQueuingStrategy::FileBuffer::view() const
+{
+	if (!m_inflated.isNull())
+		return {m_inflated->data(), m_inflated->size()};
+
+	const View raw = contents();
+
+	if (!(headerFlags(raw.data, raw.size) & BINARY_FLAG_DEFLATE)) {
+		m_end = raw.size;
+		return raw;
+	}
+
+	SharedPtr<string> inflated = new string(raw.data, BINARY_HEADER_SIZE);
+	inflateInto(
+		raw.data + BINARY_HEADER_SIZE,
+		raw.size - BINARY_HEADER_SIZE,
+		*inflated);
+
+	// offsets refer to the inflated contents from now on
+	m_inflated = inflated;
+	m_end = m_inflated->size();
+	m_mapping.reset();
+	m_loaded.reset();
+
+	return {m_inflated->data(), m_inflated->size()};
+}
+
+JournalQueuingStrategy::BufferFormat JournalQueuingStrategy::FileBuffer::scanHeader(
+		const View &view,
+		size_t &bytes)
+{
+	if (view.size == 0 || view.data[0] != BINARY_MAGIC[0])
+		return FORMAT_TEXT;
+
+	if (view.size < BINARY_HEADER_SIZE)
+		throw IllegalStateException("buffer header is truncated");
+
+	const char *header = view.data;
+
+	if (memcmp(header, BINARY_MAGIC, sizeof(BINARY_MAGIC)))
+		throw IllegalStateException("unrecognized buffer header");
+
+	if (header[4] != BINARY_VERSION) {
+		throw IllegalStateException(
+			"unsupported buffer version " + to_string((int) header[4]));
+	}
+
+	if (header[5] & ~BINARY_FLAGS_KNOWN) {
+		throw IllegalStateException(
+			"unsupported buffer flags " + to_string((int) header[5]));
+	}
+
+	bytes += BINARY_HEADER_SIZE;
+	return header[5] & BINARY_FLAG_TEXT ? FORMAT_TEXT : FORMAT_BINARY;
+}
+
 size_t JournalQueuingStrategy::FileBuffer::scanEntries(
 		size_t offset,
 		function<void(const Entry &entry)> proc,
 		size_t &bytes,
 		const size_t count) const
 {
-	if (offset >= m_size)
+	const View content = view();
+
+	if (offset >= content.size)
 		return 0;
 
-	FileInputStream fin(m_path.toString());
-	fin.seekg(offset);
+	size_t header = 0;
+	const auto format = scanHeader(content, header);
 
-	if (fin.eof())
-		return 0;
+	if (offset < header) {
+		bytes += header - offset;
+		offset = header;
 
-	if (!fin) {
-		throw ReadFileException(
-			"failed to seek " + m_path.toString()
-			+ " to " + to_string(m_offset));
+		if (offset >= content.size)
+			return 0;
 	}
 
-	return scanEntries(fin, proc, bytes, count);
+	return scanEntries(content, offset, format, proc, bytes, count);
 }
 
 size_t JournalQueuingStrategy::FileBuffer::scanEntries(
-		istream &in,
+		const View &view,
+		size_t offset,
+		BufferFormat format,
 		function<void(const Entry &entry)> proc,
 		size_t &bytes,
-		const size_t count) const
+		const size_t count,
+		size_t *broken) const
+{
+	if (format == FORMAT_BINARY)
+		return scanBinaryEntries(view, offset, proc, bytes, count, broken);
+
+	return scanTextEntries(view, offset, proc, bytes, count, broken);
+}
+
+static bool isBlank(const char *p, size_t length)
+{
+	for (size_t i = 0; i < length; ++i) {
+		if (!Ascii::isSpace(p[i]))
+			return false;
+	}
+
+	return true;
+}
+
+size_t JournalQueuingStrategy::FileBuffer::scanTextEntries(
+		const View &view,
+		size_t offset,
+		function<void(const Entry &entry)> proc,
+		size_t &bytes,
+		const size_t count,
+		size_t *broken) const
 {
 	static ChecksumSensorDataParser parser(new JSONSensorDataParser);
 
+	const char *end = view.data + view.size;
 	string line;
 	size_t total = 0;
 
-	while (getline(in, line)) {
-		if (total >= count)
-			break;
+	while (offset < view.size && total < count) {
+		const char *begin = view.data + offset;
+		const char *eol = static_cast<const char *>(
+			memchr(begin, '\n', end - begin));
+		const size_t length = (eol == nullptr ? end : eol) - begin;
 
-		bytes += line.size() + 1;
+		// the last line might miss the trailing newline
+		offset += length + 1;
+		bytes += length + 1;
 
-		if (trim(line).empty())
+		if (isBlank(begin, length))
 			continue;
 
+		// the parser needs a string, reuse its storage
+		line.assign(begin, length);
+
 		try {
 			proc({
 				parser.parse(line),
 				name(),
-				m_offset + bytes
+				offset
 			});
 
 			total += 1;
 		}
 		catch (...) {
-			break;
+			if (broken == nullptr)
+				break;
+
+			*broken += 1;
+		}
+	}
+
+	return total;
+}
+
+size_t JournalQueuingStrategy::FileBuffer::scanBinaryEntries(
+		const View &view,
+		size_t offset,
+		function<void(const Entry &entry)> proc,
+		size_t &bytes,
+		const size_t count,
+		size_t *broken) const
+{
+	const size_t size = view.size;
+	size_t total = 0;
+
+	while (offset < size && total < count) {
+		if (size - offset < BINARY_RECORD_PREFIX) {
+			bytes += size - offset;
+			break; // truncated record
+		}
+
+		const char *prefix = view.data + offset;
+		const UInt16 values = readNetwork<UInt16>(prefix + 4);
+		const size_t length = BINARY_RECORD_FIXED + values * BINARY_VALUE_SIZE;
+
+		if (size - offset - BINARY_RECORD_PREFIX < length) {
+			bytes += size - offset;
+			break; // truncated record
+		}
+
+		const char *record = prefix + BINARY_RECORD_PREFIX;
+		offset += BINARY_RECORD_PREFIX + length;
+		bytes += BINARY_RECORD_PREFIX + length;
+
+		const UInt32 crc = recordChecksum(prefix, record, length);
+		if (readNetwork<UInt32>(prefix) != crc) {
+			if (broken == nullptr)
+				break;
+
+			*broken += 1;
+			continue;
+		}
+
+		try {
+			proc({
+				parseBinaryRecord(record, values),
+				name(),
+				offset
+			});
+
+			total += 1;
+		}
+		catch (...) {
+			if (broken == nullptr)
+				break;
+
+			*broken += 1;
 		}
 	}
 
@@ -3,16 +3,20 @@
 #include <functional>
 #include <list>
 #include <map>
+#include <set>
 
 #include <Poco/DigestEngine.h>
 #include <Poco/File.h>
 #include <Poco/Path.h>
+#include <Poco/SharedPtr.h>
 #include <Poco/Timespan.h>
 #include <Poco/Timestamp.h>
 
+#include "core/MetricsRegistry.h"
 #include "exporters/QueuingStrategy.h"
 #include "util/Journal.h"
 #include "util/Loggable.h"
+#include "util/MappedFile.h"
 
 namespace BeeeOn {
 
@@ -24,7 +28,7 @@ namespace BeeeOn {
  * The JournalQueuingStrategy maintains 3 kinds of files:
  *
  * - buffers - files named after their SHA-1 checksum (Git-like) containing serialized
- *   SensorData instances in a line-oriented way with CRC32 protection per-record
+ *   SensorData instances with CRC32 protection per-record (see bufferFormat below)
  *
  * - index - index of buffer files and byte offsets into them implemented as a journal
  *   (mostly append only file)
@@ -36,9 +40,72 @@ namespace BeeeOn {
  * reached by all persisted files (both active or dangling), the JournalQueuingStrategy
  * tries to garbage collect unused (dangling) files and if it does not succeed then
  * it drops also valid data that were not peeked yet.
+ *
+ * The consumed space is tracked incrementally in a ledger of files (buffers
+ * and locks) that is updated whenever a file is written or removed by the
+ * strategy. The whole rootDir is rescanned only during setup() or when the
+ * ledger is detected to be inconsistent (e.g. a write or remove fails).
+ *
+ * Each push() creates a separate buffer and appends it into the index
+ * immediately. Coalescing of small pushes is up to the caller (see
+ * QueuingExporter::setSaveGroupWindow()).
+ *
+ * New buffers are written either in the text format (a CRC32 prefixed
+ * JSON record per line) or in the binary format. The binary buffer starts
+ * with a header (magic, version and flags) followed by records with
+ * fixed-width fields. Buffers of both formats can be read regardless of
+ * the configured bufferFormat, thus switching the format does not lose
+ * any data.
+ *
+ * When the compression is enabled, records of each new buffer are deflated
+ * (zlib) as a whole and the buffer header marks the compression and the
+ * format of the records. The buffer is still named after the SHA-1 of its
+ * contents as stored on disk. Compressed buffers are inflated into memory
+ * when being read, the offsets in the index refer to the inflated records.
+ * Offline retention (how long period of data fits into the bytesLimit)
+ * is estimated from the data written since setup() and reported.
  */
 class JournalQueuingStrategy : public QueuingStrategy, protected Loggable {
 public:
+	enum BufferFormat {
+		/**
+		 * Line-oriented records of CRC32 prefixed JSON.
+		 */
+		FORMAT_TEXT,
+		/**
+		 * Header followed by records of form:
+		 * <pre>
+		 * CRC32 (4 B) | count (2 B) | device ID (8 B) | timestamp (8 B)
+		 *   | count * (module ID (2 B) | value (8 B))
+		 * </pre>
+		 * All fields are in the network byte order, the CRC32 covers
+		 * all the record's fields following it.
+		 */
+		FORMAT_BINARY,
+	};
+
+	enum BufferCompression {
+		COMPRESSION_NONE,
+		/**
+		 * Records of a buffer are deflated as a single zlib stream
+		 * following the buffer header.
+		 */
+		COMPRESSION_DEFLATE,
+	};
+
+	enum BufferReader {
+		/**
+		 * Buffers are memory-mapped and the mapping of the buffer
+		 * being read is kept until it is exhausted.
+		 */
+		READER_MMAP,
+		/**
+		 * Buffers are read via FileInputStream on each access and
+		 * nothing is kept in memory between the accesses.
+		 */
+		READER_STREAM,
+	};
+
 	JournalQueuingStrategy();
 
 	/**
@@ -85,10 +152,61 @@ public:
 	 */
 	void setIgnoreIndexErrors(bool ignore);
 
+	/**
+	 * @brief Set format of newly written buffers: "text" (default)
+	 * or "binary". Existing buffers are read in their own format.
+	 */
+	void setBufferFormat(const std::string &format);
+
+	/**
+	 * @returns format used for newly written buffers.
+	 */
+	BufferFormat bufferFormat() const;
+
+	/**
+	 * @brief Set compression of newly written buffers: "none" (default)
+	 * or "deflate". Existing buffers are read according to their header.
+	 */
+	void setCompression(const std::string &compression);
+
+	/**
+	 * @returns compression used for newly written buffers.
+	 */
+	BufferCompression compression() const;
+
+	/**
+	 * @brief Set how the buffers are read: "mmap" (default) or "stream".
+	 * The stream reader serves as a fallback and for comparison.
+	 */
+	void setBufferReader(const std::string &reader);
+
+	/**
+	 * @returns reader used to read the buffers.
+	 */
+	BufferReader bufferReader() const;
+
+	/**
+	 * @returns estimated period of data that would fit into the bytesLimit
+	 * based on the data written (or found during setup) since the last
+	 * setup(). Zero when unlimited or unknown yet.
+	 */
+	Poco::Timespan estimatedRetention() const;
+
+	/**
+	 * @brief Publish counts of pushed and popped data, duration of
+	 * buffer writes, count of dropped buffers, consumed space, written
+	 * raw and stored bytes and the estimated retention in the given
+	 * registry. The metrics are labeled by the rootDir, thus
+	 * it must be set before.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
 	/**
 	 * @brief Setup the storage for the JournalQueuingStrategy. It creates
 	 * new index or loads the existing one. All buffers present in the index
-	 * are checked and registered for future use.
+	 * are checked and registered for future use. Buffers that cannot be
+	 * read (an I/O error, e.g. failed mapping) are kept untouched in the
+	 * index and on disk but they are not registered until next setup().
 	 */
 	virtual void setup();
 
@@ -123,6 +241,26 @@ public:
 	void pop(size_t count) override;
 
 protected:
+	/**
+	 * @brief Write the given formatted entries as a new buffer (prepended
+	 * by the appropriate header and compressed if configured) and append
+	 * it into the index. The data period of the entries is used to update
+	 * the estimated retention.
+	 */
+	void writeBuffer(
+		const std::string &entries,
+		const Poco::Timestamp &oldest,
+		const Poco::Timestamp &newest);
+
+	/**
+	 * @brief Account the given period of data occupying the given amount
+	 * of stored bytes into the estimated retention.
+	 */
+	void updateRetention(
+		const Poco::Timestamp &oldest,
+		const Poco::Timestamp &newest,
+		size_t bytes);
+
 	typedef std::function<void(
 		const std::string &name,
 		size_t offset,
@@ -208,6 +346,28 @@ protected:
 	 */
 	size_t bytesUsedAll() const;
 
+	/**
+	 * @brief Scan the whole rootDir and reinitialize the ledger of
+	 * files counted into the bytesLimit.
+	 */
+	void rescanLedger() const;
+
+	/**
+	 * @brief Record the given file into the ledger.
+	 */
+	void ledgerWritten(const std::string &name, size_t bytes) const;
+
+	/**
+	 * @brief Remove the given file from the ledger.
+	 */
+	void ledgerRemoved(const std::string &name) const;
+
+	/**
+	 * @brief Mark the ledger as inconsistent. It would be rescanned
+	 * before its next usage.
+	 */
+	void ledgerInvalidate() const;
+
 	/**
 	 * @returns path to the given name relative to the rootDir.
 	 */
@@ -278,13 +438,22 @@ protected:
 	/**
 	 * @brief Representation of a persistent file buffer that contains
 	 * entries holding the stored SensorData.
+	 *
+	 * The buffer file is memory-mapped lazily when being read and the mapping
+	 * is kept (shared among copies) until the buffer is exhausted. Thus, only
+	 * the head buffer being read is usually mapped. Records are located
+	 * directly in the mapping. A compressed buffer is inflated into memory
+	 * instead and its raw mapping is released. With the READER_STREAM,
+	 * the buffer file is read via FileInputStream on each access instead
+	 * of being mapped.
 	 */
 	class FileBuffer {
 	public:
 		FileBuffer(
 			const Poco::Path &path,
 			size_t offset,
-			size_t size);
+			size_t size,
+			BufferReader reader = READER_MMAP);
 
 		std::string name() const;
 		Poco::Path path() const;
@@ -292,8 +461,9 @@ protected:
 		size_t size() const;
 
 		/**
-		 * @returns true if the offset is greater than size and
-		 * thus the buffer contains no more data to be scanned.
+		 * @returns true if the offset is greater than size (of the
+		 * inflated contents for compressed buffers) and thus
+		 * the buffer contains no more data to be scanned.
 		 */
 		bool exhausted() const;
 
@@ -315,7 +485,13 @@ protected:
 			const size_t count);
 
 		/**
-		 * @brief
+		 * @brief Read all entries of the buffer and collect statistics
+		 * about them. The buffer contents (as stored on disk) must match
+		 * the given digest. Broken records are skipped and counted.
+		 * The mapping is released when finished.
+		 *
+		 * @throws Poco::IOException when the buffer cannot be read
+		 * @throws Poco::IllegalStateException when the buffer is corrupted
 		 */
 		void inspectAndVerify(
 			const Poco::DigestEngine::Digest &digest,
@@ -323,17 +499,84 @@ protected:
 
 		/**
 		 * @brief Format the given data into the form as expected
-		 * by the readEntries() method.
+		 * by the readEntries() method. Results of multiple calls
+		 * can be concatenated into a single buffer.
 		 */
 		static std::string formatEntries(
-			const std::vector<SensorData> &data);
+			const std::vector<SensorData> &data,
+			BufferFormat format = FORMAT_TEXT);
+
+		/**
+		 * @returns header to be written at the beginning of a buffer
+		 * of the given format and compression (empty for uncompressed
+		 * FORMAT_TEXT).
+		 */
+		static std::string formatHeader(
+			BufferFormat format,
+			BufferCompression compression = COMPRESSION_NONE);
+
+		/**
+		 * @brief Build contents of a buffer file from the given entries
+		 * formatted by formatEntries(), i.e. prepend the header and
+		 * compress the entries if requested.
+		 */
+		static std::string formatBuffer(
+			const std::string &entries,
+			BufferFormat format,
+			BufferCompression compression = COMPRESSION_NONE);
+
+		/**
+		 * @brief Release the memory mapping or the inflated contents
+		 * of the buffer (if any). It is loaded again on the next access.
+		 */
+		void unmap();
 
 	protected:
 		/**
-		 * @brief Scan for up to count entries from the current
-		 * offset. The parameter bytes is updated continuously
-		 * while reading any bytes and it would up to date even
-		 * in case of an exception.
+		 * @brief Implementation of inspectAndVerify() that leaves
+		 * the buffer mapped.
+		 */
+		void verifyAndScan(
+			const Poco::DigestEngine::Digest &digest,
+			FileBufferStat &stat) const;
+
+		/**
+		 * @brief Drop the mapping and the inflated contents.
+		 */
+		void release() const;
+
+		/**
+		 * @brief Contents of the buffer as seen by the scanners. For
+		 * a compressed buffer, it is its inflated image including
+		 * the header.
+		 */
+		struct View {
+			const char *data;
+			size_t size;
+		};
+
+		/**
+		 * @returns mapping of the buffer file, it is created if missing
+		 */
+		const MappedFile &mapping() const;
+
+		/**
+		 * @returns raw contents of the buffer file, it is mapped
+		 * or read according to the reader if necessary.
+		 */
+		View contents() const;
+
+		/**
+		 * @returns contents of the buffer to be scanned, the buffer
+		 * is mapped or inflated if necessary. Inflating stops on
+		 * the first error and the data inflated so far are used.
+		 */
+		View view() const;
+
+		/**
+		 * @brief Scan for up to count entries from the given offset.
+		 * The parameter bytes is updated continuously while reading
+		 * any bytes and it would up to date even in case of an exception.
 		 */
 		size_t scanEntries(
 			size_t offset,
@@ -342,21 +585,52 @@ protected:
 			const size_t count) const;
 
 		/**
-		 * @brief Scan for up to count entries from the given
-		 * input stream. The parameter bytes is updated continuously
-		 * while reading any bytes and it would up to date even
-		 * in case of an exception.
+		 * @brief Scan for up to count entries of the given format
+		 * in the view starting at the given offset. The scan stops
+		 * at the first broken record unless the parameter broken is
+		 * given. In such case, broken records are skipped and counted.
 		 */
 		size_t scanEntries(
-			std::istream &in,
+			const View &view,
+			size_t offset,
+			BufferFormat format,
 			std::function<void(const Entry &entry)> proc,
 			size_t &bytes,
-			const size_t count) const;
+			const size_t count,
+			size_t *broken = nullptr) const;
+
+		size_t scanTextEntries(
+			const View &view,
+			size_t offset,
+			std::function<void(const Entry &entry)> proc,
+			size_t &bytes,
+			const size_t count,
+			size_t *broken) const;
+
+		size_t scanBinaryEntries(
+			const View &view,
+			size_t offset,
+			std::function<void(const Entry &entry)> proc,
+			size_t &bytes,
+			const size_t count,
+			size_t *broken) const;
+
+		/**
+		 * @brief Detect format of a buffer from its beginning. If
+		 * a header is present, its size is added to bytes.
+		 * @throws IllegalStateException for unsupported header
+		 */
+		static BufferFormat scanHeader(const View &view, size_t &bytes);
 
 	private:
 		Poco::Path m_path;
 		size_t m_offset;
 		size_t m_size;
+		mutable size_t m_end;
+		BufferReader m_reader;
+		mutable MappedFile::Ptr m_mapping;
+		mutable Poco::SharedPtr<std::string> m_loaded;
+		mutable Poco::SharedPtr<std::string> m_inflated;
 	};
 
 	/**
@@ -373,8 +647,35 @@ private:
 	bool m_neverDropOldest;
 	ssize_t m_bytesLimit;
 	bool m_ignoreIndexErrors;
+	BufferFormat m_bufferFormat;
+	BufferCompression m_compression;
+	BufferReader m_bufferReader;
 	Journal::Ptr m_index;
 
+	MetricsRegistry::Counter::Ptr m_pushedCount;
+	MetricsRegistry::Counter::Ptr m_poppedCount;
+	MetricsRegistry::Counter::Ptr m_droppedBuffers;
+	MetricsRegistry::Histogram::Ptr m_writeDuration;
+	MetricsRegistry::Gauge::Ptr m_bytesUsed;
+	MetricsRegistry::Counter::Ptr m_rawBytes;
+	MetricsRegistry::Counter::Ptr m_storedBytes;
+	MetricsRegistry::Gauge::Ptr m_retention;
+
+	/**
+	 * @brief Period of data and amount of stored bytes since setup()
+	 * used to estimate the retention.
+	 */
+	Poco::Timestamp m_retentionOldest;
+	Poco::Timestamp m_retentionNewest;
+	size_t m_retentionBytes;
+
+	/**
+	 * @brief Sizes of files in the rootDir counted into the bytesLimit
+	 * (except the index which is changing with each append).
+	 */
+	mutable std::map<std::string, size_t> m_ledger;
+	mutable bool m_ledgerValid;
+
 	/**
 	 * @brief Buffers known to be valid. The peek operation reads buffers
 	 * from this list (the oldest buffers first).
@@ -388,6 +689,12 @@ private:
 	 */
 	std::map<std::string, FileBuffer> m_exhausted;
 
+	/**
+	 * @brief Buffers that failed to be read during setup(). They are
+	 * neither read nor garbage-collected.
+	 */
+	std::set<std::string> m_unreadable;
+
 	/**
 	 * @brief Peeked entries waiting to be popped.
 	 */
@@ -4,6 +4,7 @@
 
 #include "di/Injectable.h"
 #include "exporters/MqttExporter.h"
+#include "model/SensorData.h"
 #include "util/NullSensorDataFormatter.h"
 #include "util/SensorDataFormatter.h"
 
@@ -13,6 +14,7 @@ BEEEON_OBJECT_PROPERTY("topic", &MqttExporter::setTopic)
 BEEEON_OBJECT_PROPERTY("qos", &MqttExporter::setQos)
 BEEEON_OBJECT_PROPERTY("formatter", &MqttExporter::setFormatter)
 BEEEON_OBJECT_PROPERTY("mqttClient", &MqttExporter::setMqttClient)
+BEEEON_OBJECT_PROPERTY("batchArray", &MqttExporter::setBatchArray)
 BEEEON_OBJECT_END(BeeeOn, MqttExporter)
 
 using namespace BeeeOn;
@@ -25,7 +27,8 @@ const static string DEFAULT_CLIENT_ID = "GatewayExporterClient";
 MqttExporter::MqttExporter():
 	m_topic(DEFAULT_TOPIC),
 	m_qos(MqttMessage::EXACTLY_ONCE),
-	m_clientID(DEFAULT_CLIENT_ID)
+	m_clientID(DEFAULT_CLIENT_ID),
+	m_batchArray(false)
 {
 }
 
@@ -48,11 +51,16 @@ void MqttExporter::setFormatter(const SharedPtr<SensorDataFormatter> formatter)
 	m_formatter = formatter;
 }
 
-bool MqttExporter::ship(const SensorData &data)
+void MqttExporter::setBatchArray(bool batchArray)
+{
+	m_batchArray = batchArray;
+}
+
+bool MqttExporter::publish(const string &message)
 {
 	MqttMessage msg = {
 		m_topic,
-		m_formatter->format(data),
+		message,
 		m_qos
 	};
 
@@ -67,6 +75,42 @@ bool MqttExporter::ship(const SensorData &data)
 	return true;
 }
 
+bool MqttExporter::ship(const SensorData &data)
+{
+	return publish(m_formatter->format(data));
+}
+
+size_t MqttExporter::shipBatch(const vector<SensorData> &data)
+{
+	if (data.empty())
+		return 0;
+
+	if (m_batchArray) {
+		string message = "[";
+
+		for (const auto &one : data) {
+			if (message.size() > 1)
+				message += ",";
+
+			m_formatter->formatTo(one, message);
+		}
+
+		message += "]";
+		return publish(message) ? data.size() : 0;
+	}
+
+	size_t shipped = 0;
+
+	for (const auto &one : data) {
+		if (!publish(m_formatter->format(one)))
+			break;
+
+		shipped += 1;
+	}
+
+	return shipped;
+}
+
 void MqttExporter::setQos(const int qos)
 {
 	switch (qos) {
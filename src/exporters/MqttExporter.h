@@ -22,6 +22,15 @@ public:
 
 	bool ship(const SensorData &data) override;
 
+	/**
+	 * @brief Publish all the given data. Messages are published without
+	 * waiting for their delivery. When batchArray is enabled, the whole
+	 * batch is published as a single message holding an array of the
+	 * formatted data. Otherwise, a message per data is published until
+	 * the first failure.
+	 */
+	size_t shipBatch(const std::vector<SensorData> &data) override;
+
 	void setTopic(const std::string &topic);
 
 	void setQos(int qos);
@@ -30,12 +39,23 @@ public:
 
 	void setFormatter(const Poco::SharedPtr<SensorDataFormatter> formatter);
 
+	/**
+	 * @brief Publish batches as a single message containing a JSON-like
+	 * array of formatted data. It is meaningful only with formatters
+	 * producing JSON.
+	 */
+	void setBatchArray(bool batchArray);
+
 private:
+	bool publish(const std::string &message);
+
+
 	std::string m_topic;
 	MqttMessage::QoS m_qos;
 	std::string m_clientID;
 	Poco::SharedPtr<SensorDataFormatter> m_formatter;
 	MqttClient::Ptr m_mqtt;
+	bool m_batchArray;
 };
 
 }
@@ -1,23 +1,31 @@
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <Poco/Exception.h>
 
 #include "di/Injectable.h"
 #include "exporters/NamedPipeExporter.h"
+#include "model/SensorData.h"
 #include "util/NullSensorDataFormatter.h"
 #include "util/SensorDataFormatter.h"
 
 #define ATTEMPTS_CREATE_PIPE 3
+#define MAX_IOV_PER_WRITE 128
 
 BEEEON_OBJECT_BEGIN(BeeeOn, NamedPipeExporter)
 BEEEON_OBJECT_CASTABLE(Exporter)
 BEEEON_OBJECT_PROPERTY("filePath", &NamedPipeExporter::setFilePath)
 BEEEON_OBJECT_PROPERTY("formatter", &NamedPipeExporter::setFormatter)
+BEEEON_OBJECT_PROPERTY("backpressure", &NamedPipeExporter::setBackpressure)
+BEEEON_OBJECT_PROPERTY("blockTimeout", &NamedPipeExporter::setBlockTimeout)
 BEEEON_OBJECT_END(BeeeOn, NamedPipeExporter)
 
 using namespace BeeeOn;
@@ -25,34 +33,65 @@ using namespace Poco;
 using namespace std;
 
 NamedPipeExporter::NamedPipeExporter() :
-	m_formatter(&NullSensorDataFormatter::instance())
+	m_formatter(&NullSensorDataFormatter::instance()),
+	m_backpressure(BACKPRESSURE_FAIL),
+	m_blockTimeout(100 * Timespan::MILLISECONDS),
+	m_fd(-1)
 {
 }
 
 NamedPipeExporter::~NamedPipeExporter()
 {
+	closePipe();
+
 	if (!m_pipePath.empty())
 		remove(m_pipePath.c_str());
 }
 
 bool NamedPipeExporter::ship(const SensorData &data)
 {
-	int fd = openPipe();
+	return shipBatch({data}) == 1;
+}
 
-	if (fd < 0 && errno == ENXIO)
-		return true;
-	if (fd < 0 && errno == EINTR)
-		return false;
+size_t NamedPipeExporter::shipBatch(const vector<SensorData> &data)
+{
+	if (data.empty())
+		return 0;
 
-	poco_assert(fd >= 0);
+	vector<string> lines;
+	lines.reserve(data.size());
 
-	try {
-		return writeAndClose(fd, m_formatter->format(data) + "\n");
+	for (const auto &one : data) {
+		lines.emplace_back();
+		m_formatter->formatTo(one, lines.back());
+		lines.back() += "\n";
 	}
-	catch (...) {
-		close(fd);
-		throw;
+
+	FastMutex::ScopedLock guard(m_lock);
+
+	if (m_fd < 0) {
+		m_fd = openPipe();
+
+		if (m_fd < 0 && errno == ENXIO) {
+			m_pending.clear();
+			return data.size();
+		}
+		if (m_fd < 0)
+			return 0;
 	}
+
+	const size_t written = writeLines(lines);
+
+	if (written < data.size() && m_backpressure == BACKPRESSURE_DROP) {
+		logger().warning(
+			"pipe " + m_pipePath + " is full, dropping "
+			+ to_string(data.size() - written) + " items",
+			__FILE__, __LINE__);
+
+		return data.size();
+	}
+
+	return written;
 }
 
 void NamedPipeExporter::setFilePath(const string &path)
@@ -65,6 +104,26 @@ void NamedPipeExporter::setFormatter(SensorDataFormatter *formatter)
 	m_formatter = formatter;
 }
 
+void NamedPipeExporter::setBackpressure(const string &policy)
+{
+	if (policy == "drop")
+		m_backpressure = BACKPRESSURE_DROP;
+	else if (policy == "block")
+		m_backpressure = BACKPRESSURE_BLOCK;
+	else if (policy == "fail")
+		m_backpressure = BACKPRESSURE_FAIL;
+	else
+		throw InvalidArgumentException("invalid backpressure policy: " + policy);
+}
+
+void NamedPipeExporter::setBlockTimeout(const Timespan &timeout)
+{
+	if (timeout < 0)
+		throw InvalidArgumentException("blockTimeout must not be negative");
+
+	m_blockTimeout = timeout;
+}
+
 int NamedPipeExporter::openPipe()
 {
 	unsigned int attempts = ATTEMPTS_CREATE_PIPE;
@@ -130,37 +189,131 @@ int NamedPipeExporter::openPipe()
 	return fd;
 }
 
-bool NamedPipeExporter::writeAndClose(int fd, const string &msg)
+void NamedPipeExporter::closePipe()
 {
-	ssize_t totalLength = msg.size();
-	ssize_t restLength = 0;
+	if (m_fd < 0)
+		return;
 
-	do { // we are blocking here
-		ssize_t writtenLength = write(fd, msg.c_str() + restLength, totalLength - restLength);
+	close(m_fd);
+	m_fd = -1;
+}
+
+bool NamedPipeExporter::waitWritable(const Clock &deadline)
+{
+	for (;;) {
+		const Clock::ClockDiff left = deadline - Clock();
+		if (left <= 0)
+			return false;
+
+		struct pollfd pfd = {m_fd, POLLOUT, 0};
+		const int ret = poll(&pfd, 1, max<int>(1, left / 1000));
+
+		if (ret > 0)
+			return true; // POLLERR is reported by the following write
+		if (ret == 0)
+			return false;
+
+		if (errno != EINTR) {
+			throw IOException(
+				"failed to poll fifo "
+				+ m_pipePath + ": "
+				+ strerror(errno));
+		}
+	}
+}
+
+size_t NamedPipeExporter::writeLines(vector<string> &lines)
+{
+	const size_t pending = m_pending.empty() ? 0 : 1;
+
+	if (pending) {
+		lines.insert(lines.begin(), m_pending);
+		m_pending.clear();
+	}
+
+	const Clock deadline = Clock() + m_blockTimeout.totalMicroseconds();
+	size_t done = 0;
+	size_t offset = 0;
+
+	while (done < lines.size()) {
+		struct iovec iov[MAX_IOV_PER_WRITE];
+		int count = 0;
+
+		for (size_t i = done; i < lines.size() && count < MAX_IOV_PER_WRITE; ++i, ++count) {
+			const size_t skip = i == done ? offset : 0;
+
+			iov[count].iov_base = const_cast<char *>(lines[i].data() + skip);
+			iov[count].iov_len = lines[i].size() - skip;
+		}
+
+		const ssize_t written = writev(m_fd, iov, count);
+
+		if (written < 0 && errno == EINTR)
+			continue;
+
+		if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (m_backpressure == BACKPRESSURE_BLOCK && waitWritable(deadline))
+				continue;
 
-		if (writtenLength < 0 && errno == EINTR) {
-			// interrupt from user
-			logger().notice("interrupt from user during write",
-				__FILE__, __LINE__);
 			break;
 		}
-		if (writtenLength < 0) {
-			close(fd);
+
+		if (written < 0 && errno == EPIPE) {
+			logger().information(
+				"reader of " + m_pipePath + " has gone, reopening",
+				__FILE__, __LINE__);
+
+			closePipe();
+
+			// never continue a line for a different reader
+			offset = 0;
+			done = max(done, pending);
+
+			m_fd = openPipe();
+			if (m_fd < 0)
+				return errno == ENXIO ? lines.size() - pending : done - pending;
+
+			continue;
+		}
+
+		if (written < 0) {
+			const int error = errno;
+			closePipe();
+
 			throw IOException(
-				"failed to write fifo: "
-				+ string(strerror(errno)));
+				"failed to write fifo "
+				+ m_pipePath + ": "
+				+ strerror(error));
 		}
 
-		restLength += writtenLength;
-	} while(restLength < totalLength);
+		size_t rest = written;
+
+		while (rest > 0) {
+			const size_t left = lines[done].size() - offset;
+
+			if (rest < left) {
+				offset += rest;
+				break;
+			}
+
+			rest -= left;
+			offset = 0;
+			done += 1;
+		}
+	}
+
+	// the rest of a partially written line must go first next time
+	if (done < lines.size() && (offset > 0 || done < pending)) {
+		m_pending = lines[done].substr(offset);
+		done += 1;
+	}
 
 	if (logger().debug()) {
 		logger().debug(
-			"written " + to_string(restLength) + "/"
-			+ to_string(totalLength) + " bytes",
+			"written " + to_string(done - pending) + "/"
+			+ to_string(lines.size() - pending) + " lines",
 			__FILE__, __LINE__);
 	}
 
-	close(fd);
-	return restLength >= totalLength;
+	return done - pending;
 }
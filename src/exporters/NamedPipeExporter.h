@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
+
+#include <Poco/Clock.h>
 #include <Poco/Logger.h>
+#include <Poco/Mutex.h>
+#include <Poco/Timespan.h>
 
 #include "core/Exporter.h"
 #include "util/Loggable.h"
@@ -10,10 +15,34 @@ namespace BeeeOn {
 
 class SensorDataFormatter;
 
+/**
+ * @brief NamedPipeExporter writes formatted SensorData into a named
+ * pipe (FIFO). The pipe is opened lazily and kept open across ships.
+ * It is reopened only when the reader disconnects (EPIPE) and closed
+ * when no reader is present (ENXIO, data are dropped).
+ *
+ * The pipe is non-blocking. When it is full, the configured
+ * backpressure policy is applied:
+ *
+ * - drop - data that do not fit into the pipe are dropped
+ * - block - wait up to blockTimeout for the reader, then fail
+ * - fail - report data that do not fit as not shipped
+ *
+ * A line is never split between readers. When a line is written
+ * only partially, its rest is written before any other data.
+ *
+ * The SIGPIPE signal is expected to be ignored by the process.
+ */
 class NamedPipeExporter :
 	public Exporter,
 	public Loggable {
 public:
+	enum Backpressure {
+		BACKPRESSURE_DROP,
+		BACKPRESSURE_BLOCK,
+		BACKPRESSURE_FAIL,
+	};
+
 	NamedPipeExporter();
 	~NamedPipeExporter();
 
@@ -22,6 +51,14 @@ public:
 	 */
 	bool ship(const SensorData &data) override;
 
+	/**
+	 * Export all data to named pipe by a single writev() (when no
+	 * reader is present, data are dropped). If the pipe is full, the
+	 * backpressure policy decides how many leading items are reported
+	 * as shipped.
+	 */
+	size_t shipBatch(const std::vector<SensorData> &data) override;
+
 	/**
 	 * Set file path of named pipe (mkfifo)
 	 */
@@ -33,6 +70,16 @@ public:
 	 */
 	void setFormatter(SensorDataFormatter * formatter);
 
+	/**
+	 * Set policy applied when the pipe is full: drop, block or fail.
+	 */
+	void setBackpressure(const std::string &policy);
+
+	/**
+	 * Set how long to wait for a full pipe with the block policy.
+	 */
+	void setBlockTimeout(const Poco::Timespan &timeout);
+
 private:
 	/**
 	 * Create pipe file (mkfifo)
@@ -41,15 +88,29 @@ private:
 	 */
 	int openPipe();
 
+	void closePipe();
+
+	/**
+	 * Wait until the pipe is writable, but not after the deadline.
+	 * @return false on timeout
+	 */
+	bool waitWritable(const Poco::Clock &deadline);
+
 	/**
-	 * Write SensorData in string format to named pipe
-	 * @return result of the write
-	 * @throw ExporterShipException, when cannot write
+	 * Write the given lines into the open pipe via writev().
+	 * The pending rest of a partially written line is written first.
+	 * @return number of lines written or committed to be written
+	 * @throw IOException, when cannot write
 	 */
-	bool writeAndClose(int fd, const std::string &msg);
+	size_t writeLines(std::vector<std::string> &lines);
 
 	std::string m_pipePath;
 	SensorDataFormatter *m_formatter;
+	Backpressure m_backpressure;
+	Poco::Timespan m_blockTimeout;
+	int m_fd;
+	std::string m_pending;
+	Poco::FastMutex m_lock;
 };
 
 }
@@ -19,6 +19,10 @@ BEEEON_OBJECT_PROPERTY("disableGC", &RecoverableJournalQueuingStrategy::setDisab
 BEEEON_OBJECT_PROPERTY("neverDropOldest", &RecoverableJournalQueuingStrategy::setNeverDropOldest)
 BEEEON_OBJECT_PROPERTY("bytesLimit", &RecoverableJournalQueuingStrategy::setBytesLimit)
 BEEEON_OBJECT_PROPERTY("ignoreIndexErrors", &RecoverableJournalQueuingStrategy::setIgnoreIndexErrors)
+BEEEON_OBJECT_PROPERTY("bufferFormat", &RecoverableJournalQueuingStrategy::setBufferFormat)
+BEEEON_OBJECT_PROPERTY("compression", &RecoverableJournalQueuingStrategy::setCompression)
+BEEEON_OBJECT_PROPERTY("bufferReader", &RecoverableJournalQueuingStrategy::setBufferReader)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &RecoverableJournalQueuingStrategy::setMetricsRegistry)
 BEEEON_OBJECT_PROPERTY("disableTmpDataRecovery", &RecoverableJournalQueuingStrategy::setDisableTmpDataRecovery)
 BEEEON_OBJECT_PROPERTY("disableBrokenRecovery", &RecoverableJournalQueuingStrategy::setDisableBrokenRecovery)
 BEEEON_OBJECT_PROPERTY("disableLostRecovery", &RecoverableJournalQueuingStrategy::setDisableLostRecovery)
@@ -84,6 +88,7 @@ void RecoverableJournalQueuingStrategy::setup()
 	collectRecoverable(recoverable);
 	recoverLost(recoverable, modified, newest);
 
+	rescanLedger();
 	reportStats(newest);
 }
 
@@ -110,7 +115,7 @@ size_t RecoverableJournalQueuingStrategy::recoverEntries(
 		File file,
 		vector<SensorData> &data) const
 {
-	FileBuffer buffer(file.path(), 0, file.getSize());
+	FileBuffer buffer(file.path(), 0, file.getSize(), bufferReader());
 	size_t lastOffset = ~((size_t) 0);
 	size_t errors = 0;
 
@@ -164,7 +169,10 @@ string RecoverableJournalQueuingStrategy::recoverBrokenBuffer(File file) const
 	}
 
 	SafeWriter writer(pathTo("recover.tmp"));
-	writer.stream(true) << FileBuffer::formatEntries(tmp);
+	writer.stream(true) << FileBuffer::formatBuffer(
+		FileBuffer::formatEntries(tmp, bufferFormat()),
+		bufferFormat(),
+		compression());
 
 	const auto &state = writer.finalize();
 	const auto &name = DigestEngine::digestToHex(state.first);
@@ -311,7 +319,7 @@ void RecoverableJournalQueuingStrategy::recoverLost(
 				continue;
 			}
 
-			FileBuffer buffer(file.path(), 0, file.getSize());
+			FileBuffer buffer(file.path(), 0, file.getSize(), bufferReader());
 			FileBufferStat stat;
 
 			buffer.inspectAndVerify(
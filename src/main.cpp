@@ -15,6 +15,7 @@ int main(int argc, char **argv)
 
 	about.version = GatewayInfo::version();
 	PosixSignal::handle("SIGUSR1", [](int) {});
+	PosixSignal::ignore("SIGPIPE");
 
 	Poco::Net::RemoteSyslogChannel::registerChannel();
 	DIDaemon::up(argc, argv, about);
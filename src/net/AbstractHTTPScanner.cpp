@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <list>
+
+#include <Poco/Clock.h>
 #include <Poco/Exception.h>
 #include <Poco/Glob.h>
 #include <Poco/Logger.h>
+#include <Poco/Mutex.h>
 #include <Poco/Net/StreamSocket.h>
 #include <Poco/SharedPtr.h>
 #include <Poco/StreamCopier.h>
+#include <Poco/Thread.h>
 #include <Poco/URI.h>
 
 #include "net/AbstractHTTPScanner.h"
@@ -14,16 +20,26 @@ using namespace Poco;
 using namespace Poco::Net;
 using namespace std;
 
+/**
+ * Upper bound of a single Socket::select() call while sweeping
+ * to recheck the StopControl regularly.
+ */
+static const Timespan MAX_SELECT_WAIT = 100 * Timespan::MILLISECONDS;
+
 AbstractHTTPScanner::AbstractHTTPScanner():
 	m_port(0),
-	m_minNetMask("255.255.255.255")
+	m_minNetMask("255.255.255.255"),
+	m_maxInFlightProbes(1),
+	m_verifyThreads(1)
 {
 }
 
 AbstractHTTPScanner::AbstractHTTPScanner(const string& path, uint16_t port, const IPAddress& minNetMask):
 	m_path(path),
 	m_port(port),
-	m_minNetMask(minNetMask)
+	m_minNetMask(minNetMask),
+	m_maxInFlightProbes(1),
+	m_verifyThreads(1)
 {
 }
 
@@ -61,6 +77,16 @@ void AbstractHTTPScanner::setBlackList(const set<string>& blackList)
 	m_blackList = blackList;
 }
 
+void AbstractHTTPScanner::setMaxInFlightProbes(size_t count)
+{
+	m_maxInFlightProbes = count;
+}
+
+void AbstractHTTPScanner::setVerifyThreads(size_t count)
+{
+	m_verifyThreads = count;
+}
+
 string AbstractHTTPScanner::path()
 {
 	return m_path;
@@ -128,6 +154,15 @@ void AbstractHTTPScanner::probeAddressRange(
 	vector<SocketAddress>& devices,
 	const Int64 maxResponseLength)
 {
+	if (m_maxInFlightProbes > 1) {
+		const auto hosts = sweepAddressRange(run, range);
+
+		if (run)
+			verifyHosts(run, hosts, devices, maxResponseLength);
+
+		return;
+	}
+
 	StreamSocket ping;
 
 	for (auto& ip : range) {
@@ -150,28 +185,160 @@ void AbstractHTTPScanner::probeAddressRange(
 		if (!run)
 			break;
 
-		HTTPEntireResponse response;
-		try {
-			response = sendRequest(socketAddress, maxResponseLength);
+		if (verifyDevice(socketAddress, maxResponseLength))
+			devices.push_back(socketAddress);
+	}
+}
+
+vector<SocketAddress> AbstractHTTPScanner::sweepAddressRange(
+	StopControl::Run &run,
+	const IPAddressRange& range)
+{
+	struct Probe {
+		StreamSocket socket;
+		SocketAddress address;
+		Clock started;
+	};
+
+	vector<SocketAddress> hosts;
+	list<Probe> pending;
+	auto next = range.begin();
+
+	while (run) {
+		while (pending.size() < m_maxInFlightProbes && next != range.end()) {
+			Probe probe;
+			probe.address = SocketAddress(*next, m_port);
+			++next;
+
+			try {
+				probe.socket.connectNB(probe.address);
+			}
+			catch (const Exception& e) {
+				if (logger().debug())
+					logger().log(e, __FILE__, __LINE__);
+				continue;
+			}
+
+			pending.emplace_back(probe);
 		}
-		catch (TimeoutException& e) {
-			logger().debug("timeout expired", __FILE__, __LINE__);
-			continue;
+
+		if (pending.empty())
+			break;
+
+		Socket::SocketList readList;
+		Socket::SocketList writeList;
+		Socket::SocketList exceptList;
+		Timespan timeout = MAX_SELECT_WAIT;
+
+		for (const auto &probe : pending) {
+			writeList.push_back(probe.socket);
+			exceptList.push_back(probe.socket);
+
+			const Timespan left = m_pingTimeout - probe.started.elapsed();
+			timeout = min(timeout, max(left, Timespan(0)));
 		}
-		catch (Exception& e) {
-			if (logger().debug())
-				logger().log(e, __FILE__, __LINE__);
-			continue;
+
+		try {
+			Socket::select(readList, writeList, exceptList, timeout);
+		}
+		catch (const Exception& e) {
+			logger().log(e, __FILE__, __LINE__);
+			break;
 		}
 
-		if (response.getStatus() != 200) {
-			logger().warning("drop response " + to_string(response.getStatus()), __FILE__, __LINE__);
-			continue;
+		for (auto it = pending.begin(); it != pending.end();) {
+			const auto &socket = it->socket;
+			const bool failed = find(exceptList.begin(), exceptList.end(), socket)
+					!= exceptList.end();
+			const bool connected = find(writeList.begin(), writeList.end(), socket)
+					!= writeList.end();
+
+			if (connected && !failed && socket.impl()->socketError() == 0) {
+				logger().debug("service detected at " + it->address.toString());
+				hosts.emplace_back(it->address);
+			}
+			else if (!connected && !failed && !it->started.isElapsed(m_pingTimeout.totalMicroseconds())) {
+				++it;
+				continue;
+			}
+
+			it->socket.close();
+			it = pending.erase(it);
 		}
+	}
 
-		if (isValidResponse(response.getBody()))
-			devices.push_back(socketAddress);
+	for (auto &probe : pending)
+		probe.socket.close();
+
+	return hosts;
+}
+
+void AbstractHTTPScanner::verifyHosts(
+	StopControl::Run &run,
+	const vector<SocketAddress>& hosts,
+	vector<SocketAddress>& devices,
+	const Int64 maxResponseLength)
+{
+	if (hosts.empty())
+		return;
+
+	const size_t numberOfThreads = max<size_t>(1, min(m_verifyThreads, hosts.size()));
+	vector<bool> valid(hosts.size(), false);
+	vector<SharedPtr<Thread>> threads;
+	FastMutex validMutex;
+
+	for (size_t t = 0; t < numberOfThreads; ++t) {
+		SharedPtr<Thread> thread = new Thread;
+		threads.push_back(thread);
+
+		thread->startFunc(
+			[&, t]() {
+				for (size_t i = t; i < hosts.size(); i += numberOfThreads) {
+					if (!run)
+						break;
+
+					const bool result = verifyDevice(hosts[i], maxResponseLength);
+
+					FastMutex::ScopedLock guard(validMutex);
+					valid[i] = result;
+				}
+			}
+		);
 	}
+
+	for (auto thread : threads)
+		thread->join();
+
+	for (size_t i = 0; i < hosts.size(); ++i) {
+		if (valid[i])
+			devices.push_back(hosts[i]);
+	}
+}
+
+bool AbstractHTTPScanner::verifyDevice(
+	const SocketAddress& socketAddress,
+	const Int64 maxResponseLength)
+{
+	HTTPEntireResponse response;
+	try {
+		response = sendRequest(socketAddress, maxResponseLength);
+	}
+	catch (TimeoutException& e) {
+		logger().debug("timeout expired", __FILE__, __LINE__);
+		return false;
+	}
+	catch (Exception& e) {
+		if (logger().debug())
+			logger().log(e, __FILE__, __LINE__);
+		return false;
+	}
+
+	if (response.getStatus() != 200) {
+		logger().warning("drop response " + to_string(response.getStatus()), __FILE__, __LINE__);
+		return false;
+	}
+
+	return isValidResponse(response.getBody());
 }
 
 HTTPEntireResponse AbstractHTTPScanner::sendRequest(const SocketAddress& socketAddress, const Int64 maxResponseLength)
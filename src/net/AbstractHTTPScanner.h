@@ -1,6 +1,7 @@
 #pragma once
 
 #include <set>
+#include <vector>
 
 #include <Poco/Net/HTTPRequest.h>
 #include <Poco/Net/IPAddress.h>
@@ -20,6 +21,12 @@ namespace BeeeOn {
  * of network. Derivated classes will have to implement
  * methods to prepare HTTP request and if the response
  * is from right device.
+ *
+ * By default, each IP address is probed by a blocking connect
+ * one after another. When maxInFlightProbes is greater than 1,
+ * the range is swept concurrently by non-blocking connects
+ * multiplexed via Socket::select() and the hosts that responded
+ * are verified via HTTP by up to verifyThreads threads.
  */
 class AbstractHTTPScanner : protected Loggable {
 public:
@@ -49,6 +56,19 @@ public:
 	void setHTTPTimeout(const Poco::Timespan& httpTimeout);
 	void setBlackList(const std::set<std::string>& set);
 
+	/**
+	 * @brief Set maximal number of concurrently pending connects
+	 * while sweeping an address range. Values less than 2 select
+	 * the sequential probing.
+	 */
+	void setMaxInFlightProbes(size_t count);
+
+	/**
+	 * @brief Set maximal number of threads verifying via HTTP
+	 * the hosts found by the concurrent sweep.
+	 */
+	void setVerifyThreads(size_t count);
+
 	std::string path();
 	Poco::UInt16 port();
 
@@ -87,6 +107,33 @@ protected:
 		std::vector<Poco::Net::SocketAddress>& devices,
 		const Poco::Int64 maxResponseLength);
 
+	/**
+	 * @brief Probe each IP address of the range by non-blocking connects,
+	 * keeping up to maxInFlightProbes connects pending at once.
+	 * @return addresses where a service is listening
+	 */
+	std::vector<Poco::Net::SocketAddress> sweepAddressRange(
+		StopControl::Run &run,
+		const IPAddressRange& range);
+
+	/**
+	 * @brief Verify the given hosts via HTTP in parallel and append
+	 * the valid ones to devices (preserving order of hosts).
+	 */
+	void verifyHosts(
+		StopControl::Run &run,
+		const std::vector<Poco::Net::SocketAddress>& hosts,
+		std::vector<Poco::Net::SocketAddress>& devices,
+		const Poco::Int64 maxResponseLength);
+
+	/**
+	 * @brief Send HTTP request to the given address and check
+	 * whether the response is valid.
+	 */
+	bool verifyDevice(
+		const Poco::Net::SocketAddress& socketAddress,
+		const Poco::Int64 maxResponseLength);
+
 	/**
 	 * @brief It sends HTTP request.
 	 * @param socketAddress Address of receiver.
@@ -111,6 +158,8 @@ private:
 	Poco::Timespan m_pingTimeout;
 	Poco::Timespan m_httpTimeout;
 	std::set<std::string> m_blackList;
+	size_t m_maxInFlightProbes;
+	size_t m_verifyThreads;
 	StopControl m_stopControl;
 };
 
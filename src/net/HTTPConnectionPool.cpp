@@ -0,0 +1,303 @@
+#include <Poco/Exception.h>
+#include <Poco/Logger.h>
+#include <Poco/Net/HTTPMessage.h>
+#include <Poco/Net/NetException.h>
+
+#include "di/Injectable.h"
+#include "net/HTTPConnectionPool.h"
+
+BEEEON_OBJECT_BEGIN(BeeeOn, HTTPConnectionPool)
+BEEEON_OBJECT_PROPERTY("idleTimeout", &HTTPConnectionPool::setIdleTimeout)
+BEEEON_OBJECT_PROPERTY("maxPerHost", &HTTPConnectionPool::setMaxPerHost)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &HTTPConnectionPool::setMetricsRegistry)
+BEEEON_OBJECT_END(BeeeOn, HTTPConnectionPool)
+
+using namespace BeeeOn;
+using namespace Poco;
+using namespace Poco::Net;
+using namespace std;
+
+HTTPConnectionPool::HTTPConnectionPool():
+	m_idleTimeout(30 * Timespan::SECONDS),
+	m_maxPerHost(2),
+	m_opened(MetricsRegistry::createCounter()),
+	m_reused(MetricsRegistry::createCounter()),
+	m_retried(MetricsRegistry::createCounter())
+{
+}
+
+HTTPConnectionPool::~HTTPConnectionPool()
+{
+}
+
+void HTTPConnectionPool::setIdleTimeout(const Timespan &timeout)
+{
+	if (timeout <= 0)
+		throw InvalidArgumentException("idle timeout must be positive");
+
+	m_idleTimeout = timeout;
+}
+
+void HTTPConnectionPool::setMaxPerHost(int count)
+{
+	if (count < 0)
+		throw InvalidArgumentException("max sessions per host must not be negative");
+
+	m_maxPerHost = count;
+}
+
+void HTTPConnectionPool::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_opened = registry->counter(
+		"beeeon_http_pool_opened_total",
+		"HTTP sessions opened by the connection pool");
+	m_reused = registry->counter(
+		"beeeon_http_pool_reused_total",
+		"HTTP requests sent via an idle pooled session");
+	m_retried = registry->counter(
+		"beeeon_http_pool_retried_total",
+		"HTTP requests repeated after a pooled session failed");
+}
+
+bool HTTPConnectionPool::isIdempotent(const HTTPRequest &request)
+{
+	const string &method = request.getMethod();
+
+	return method == HTTPRequest::HTTP_GET
+		|| method == HTTPRequest::HTTP_HEAD
+		|| method == HTTPRequest::HTTP_PUT
+		|| method == HTTPRequest::HTTP_DELETE
+		|| method == HTTPRequest::HTTP_OPTIONS;
+}
+
+bool HTTPConnectionPool::canRetry(
+		const HTTPRequest &request,
+		const Exception &e,
+		Stage stage)
+{
+	// the device might still be processing the request
+	if (dynamic_cast<const TimeoutException *>(&e))
+		return false;
+
+	switch (stage) {
+	case STAGE_SEND:
+		return true;
+
+	case STAGE_RECEIVE:
+		// closed before any response byte, probably stale session
+		if (!dynamic_cast<const NoMessageException *>(&e)
+				&& !dynamic_cast<const ConnectionResetException *>(&e))
+			return false;
+
+		return isIdempotent(request);
+
+	default:
+		return false;
+	}
+}
+
+HTTPEntireResponse HTTPConnectionPool::makeRequest(
+		HTTPRequest &request,
+		const URI &uri,
+		const string &msg,
+		const Timespan &timeout)
+{
+	request.setURI(uri.getPathEtc());
+	return makeRequest(request, uri.getHost(), uri.getPort(), msg, timeout);
+}
+
+HTTPEntireResponse HTTPConnectionPool::makeRequest(
+		HTTPRequest &request,
+		const string &host,
+		const uint16_t port,
+		const string &msg,
+		const Timespan &timeout)
+{
+	const Endpoint endpoint(host, port);
+	bool reused = false;
+
+	Session session = acquire(endpoint, timeout, true, reused);
+	Stage stage = STAGE_SEND;
+
+	try {
+		const HTTPEntireResponse response = perform(
+			*session, request, msg, timeout, stage);
+		release(endpoint, session, response.getKeepAlive());
+		return response;
+	}
+	catch (const Exception &e) {
+		release(endpoint, session, false);
+
+		if (!reused || !canRetry(request, e, stage))
+			throw;
+
+		if (logger().debug()) {
+			logger().debug(
+				"reused session to " + host + ":" + to_string(port)
+				+ " failed, retrying: " + e.displayText(),
+				__FILE__, __LINE__);
+		}
+	}
+
+	m_retried->add();
+	session = acquire(endpoint, timeout, false, reused);
+
+	try {
+		const HTTPEntireResponse response = perform(
+			*session, request, msg, timeout, stage);
+		release(endpoint, session, response.getKeepAlive());
+		return response;
+	}
+	catch (...) {
+		release(endpoint, session, false);
+		throw;
+	}
+}
+
+HTTPEntireResponse HTTPConnectionPool::perform(
+		HTTPClientSession &session,
+		HTTPRequest &request,
+		const string &msg,
+		const Timespan &timeout,
+		Stage &stage)
+{
+	request.setVersion(HTTPMessage::HTTP_1_1);
+	request.setKeepAlive(true);
+
+	if (!msg.empty() && !request.hasContentLength() && !request.getChunkedTransferEncoding())
+		request.setContentLength(msg.size());
+
+	session.setTimeout(timeout);
+
+	stage = STAGE_SEND;
+	ostream &output = session.sendRequest(request);
+	output << msg;
+	output.flush();
+
+	if (!output)
+		throw IOException("failed to send request");
+
+	stage = STAGE_RECEIVE;
+	HTTPEntireResponse response;
+	istream &input = session.receiveResponse(response);
+
+	stage = STAGE_BODY;
+	response.readBody(input);
+
+	return response;
+}
+
+HTTPConnectionPool::Session HTTPConnectionPool::acquire(
+		const Endpoint &endpoint,
+		const Timespan &timeout,
+		bool allowIdle,
+		bool &reused)
+{
+	const Clock started;
+	FastMutex::ScopedLock guard(m_lock);
+	Pool &pool = m_pools[endpoint];
+
+	for (;;) {
+		expireIdle(pool);
+
+		if (allowIdle && !pool.idle.empty()) {
+			Session session = pool.idle.front().session;
+			pool.idle.pop_front();
+			pool.active += 1;
+
+			m_reused->add();
+			reused = true;
+			return session;
+		}
+
+		if (m_maxPerHost == 0 || pool.active + pool.idle.size() < m_maxPerHost)
+			break;
+
+		if (!pool.idle.empty()) {
+			// make room for a new session
+			pool.idle.pop_back();
+			continue;
+		}
+
+		const Timespan left = timeout - started.elapsed();
+		if (left <= 0 || !m_released.tryWait(m_lock, left.totalMilliseconds())) {
+			throw TimeoutException(
+				"no session available for "
+				+ endpoint.first + ":" + to_string(endpoint.second));
+		}
+	}
+
+	Session session = new HTTPClientSession(endpoint.first, endpoint.second);
+	session->setKeepAlive(true);
+	session->setKeepAliveTimeout(m_idleTimeout);
+	pool.active += 1;
+
+	m_opened->add();
+	reused = false;
+	return session;
+}
+
+void HTTPConnectionPool::release(
+		const Endpoint &endpoint,
+		Session session,
+		bool keep)
+{
+	FastMutex::ScopedLock guard(m_lock);
+	Pool &pool = m_pools[endpoint];
+
+	poco_assert(pool.active > 0);
+	pool.active -= 1;
+
+	if (keep && session->connected())
+		pool.idle.push_front({session, Clock()});
+	else
+		session->reset();
+
+	m_released.broadcast();
+}
+
+void HTTPConnectionPool::expireIdle(Pool &pool)
+{
+	while (!pool.idle.empty()) {
+		if (!pool.idle.back().since.isElapsed(m_idleTimeout.totalMicroseconds()))
+			break;
+
+		pool.idle.pop_back();
+	}
+}
+
+size_t HTTPConnectionPool::opened() const
+{
+	return m_opened->value();
+}
+
+size_t HTTPConnectionPool::reused() const
+{
+	return m_reused->value();
+}
+
+size_t HTTPConnectionPool::retried() const
+{
+	return m_retried->value();
+}
+
+size_t HTTPConnectionPool::idle() const
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	size_t count = 0;
+	for (const auto &pair : m_pools)
+		count += pair.second.idle.size();
+
+	return count;
+}
+
+void HTTPConnectionPool::closeIdle()
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	for (auto &pair : m_pools)
+		pair.second.idle.clear();
+
+	m_released.broadcast();
+}
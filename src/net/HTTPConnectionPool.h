@@ -0,0 +1,188 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <Poco/Clock.h>
+#include <Poco/Condition.h>
+#include <Poco/Exception.h>
+#include <Poco/Mutex.h>
+#include <Poco/SharedPtr.h>
+#include <Poco/Timespan.h>
+#include <Poco/URI.h>
+#include <Poco/Net/HTTPClientSession.h>
+#include <Poco/Net/HTTPRequest.h>
+
+#include "core/MetricsRegistry.h"
+#include "net/HTTPEntireResponse.h"
+#include "util/Loggable.h"
+
+namespace BeeeOn {
+
+/**
+ * @brief HTTPConnectionPool keeps persistent HTTP/1.1 sessions
+ * per endpoint (host and port) to avoid a TCP handshake for each
+ * request. It is a drop-in replacement of HTTPUtil::makeRequest()
+ * intended to be shared among device managers.
+ *
+ * Idle sessions are closed after idleTimeout. At most maxPerHost
+ * sessions (idle or active) exist per endpoint, a request that would
+ * exceed the limit waits until a session is released or its timeout
+ * expires. When a reused session fails (e.g. the device has closed
+ * it meanwhile), the request is repeated once via a new session. To avoid
+ * executing a request twice, it is repeated only if the failure happened
+ * while sending the request or if the session was closed or reset before
+ * any response byte has arrived and the request is idempotent. Timeouts
+ * are never retried.
+ */
+class HTTPConnectionPool : protected Loggable {
+public:
+	typedef Poco::SharedPtr<HTTPConnectionPool> Ptr;
+
+	HTTPConnectionPool();
+	~HTTPConnectionPool();
+
+	/**
+	 * @brief Set how long a session can stay idle in the pool.
+	 */
+	void setIdleTimeout(const Poco::Timespan &timeout);
+
+	/**
+	 * @brief Set maximal number of sessions per endpoint,
+	 * 0 means unlimited.
+	 */
+	void setMaxPerHost(int count);
+
+	/**
+	 * @brief Publish counts of opened, reused and retried sessions
+	 * in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	/**
+	 * @brief Send the request with the given body to the host
+	 * and read the whole response.
+	 */
+	HTTPEntireResponse makeRequest(
+		Poco::Net::HTTPRequest &request,
+		const std::string &host,
+		const uint16_t port,
+		const std::string &msg,
+		const Poco::Timespan &timeout);
+
+	/**
+	 * @brief Send the request with the given body to the host and
+	 * path given by the URI and read the whole response.
+	 */
+	HTTPEntireResponse makeRequest(
+		Poco::Net::HTTPRequest &request,
+		const Poco::URI &uri,
+		const std::string &msg,
+		const Poco::Timespan &timeout);
+
+	/**
+	 * @returns number of sessions opened so far
+	 */
+	size_t opened() const;
+
+	/**
+	 * @returns number of requests that reused an idle session
+	 */
+	size_t reused() const;
+
+	/**
+	 * @returns number of requests repeated via a new session
+	 */
+	size_t retried() const;
+
+	/**
+	 * @returns number of idle sessions in the pool
+	 */
+	size_t idle() const;
+
+	/**
+	 * @brief Close all idle sessions.
+	 */
+	void closeIdle();
+
+protected:
+	/**
+	 * @brief Stage of a request where a failure has occurred.
+	 */
+	enum Stage {
+		STAGE_SEND,
+		STAGE_RECEIVE,
+		STAGE_BODY,
+	};
+
+	/**
+	 * @returns true if the request method is idempotent
+	 */
+	static bool isIdempotent(const Poco::Net::HTTPRequest &request);
+
+	/**
+	 * @returns true if the request failed by the given exception
+	 * in the given stage can be safely repeated
+	 */
+	static bool canRetry(
+		const Poco::Net::HTTPRequest &request,
+		const Poco::Exception &e,
+		Stage stage);
+
+private:
+	typedef std::pair<std::string, uint16_t> Endpoint;
+	typedef Poco::SharedPtr<Poco::Net::HTTPClientSession> Session;
+
+	struct IdleSession {
+		Session session;
+		Poco::Clock since;
+	};
+
+	struct Pool {
+		/**
+		 * Most recently used session first.
+		 */
+		std::list<IdleSession> idle;
+		size_t active = 0;
+	};
+
+	/**
+	 * @brief Obtain an idle session for the endpoint (if allowed)
+	 * or create a new one, waiting up to timeout for the maxPerHost
+	 * limit.
+	 * @throw TimeoutException when the limit does not allow a new session
+	 */
+	Session acquire(
+		const Endpoint &endpoint,
+		const Poco::Timespan &timeout,
+		bool allowIdle,
+		bool &reused);
+
+	/**
+	 * @brief Return the session back to the pool. The session is
+	 * closed if not marked to be kept.
+	 */
+	void release(const Endpoint &endpoint, Session session, bool keep);
+
+	void expireIdle(Pool &pool);
+
+	HTTPEntireResponse perform(
+		Poco::Net::HTTPClientSession &session,
+		Poco::Net::HTTPRequest &request,
+		const std::string &msg,
+		const Poco::Timespan &timeout,
+		Stage &stage);
+
+	Poco::Timespan m_idleTimeout;
+	size_t m_maxPerHost;
+	std::map<Endpoint, Pool> m_pools;
+	MetricsRegistry::Counter::Ptr m_opened;
+	MetricsRegistry::Counter::Ptr m_reused;
+	MetricsRegistry::Counter::Ptr m_retried;
+	mutable Poco::FastMutex m_lock;
+	Poco::Condition m_released;
+};
+
+}
@@ -0,0 +1,126 @@
+#include <Poco/File.h>
+#include <Poco/Logger.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+
+#include "di/Injectable.h"
+#include "net/MetricsServer.h"
+
+BEEEON_OBJECT_BEGIN(BeeeOn, MetricsServer)
+BEEEON_OBJECT_CASTABLE(StoppableRunnable)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &MetricsServer::setMetricsRegistry)
+BEEEON_OBJECT_PROPERTY("address", &MetricsServer::setAddress)
+BEEEON_OBJECT_END(BeeeOn, MetricsServer)
+
+using namespace std;
+using namespace Poco;
+using namespace Poco::Net;
+using namespace BeeeOn;
+
+namespace BeeeOn {
+
+class MetricsRequestHandler : public HTTPRequestHandler {
+public:
+	MetricsRequestHandler(MetricsRegistry::Ptr registry):
+		m_registry(registry)
+	{
+	}
+
+	void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override
+	{
+		if (request.getMethod() != HTTPRequest::HTTP_GET) {
+			response.setStatusAndReason(HTTPResponse::HTTP_METHOD_NOT_ALLOWED);
+			response.send();
+			return;
+		}
+
+		response.setContentType("text/plain; version=0.0.4");
+		response.setChunkedTransferEncoding(true);
+		m_registry->format(response.send());
+	}
+
+private:
+	MetricsRegistry::Ptr m_registry;
+};
+
+class MetricsRequestHandlerFactory : public HTTPRequestHandlerFactory {
+public:
+	MetricsRequestHandlerFactory(MetricsRegistry::Ptr registry):
+		m_registry(registry)
+	{
+	}
+
+	HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override
+	{
+		return new MetricsRequestHandler(m_registry);
+	}
+
+private:
+	MetricsRegistry::Ptr m_registry;
+};
+
+}
+
+MetricsServer::MetricsServer():
+	m_address("127.0.0.1:9779")
+{
+}
+
+void MetricsServer::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_registry = registry;
+}
+
+void MetricsServer::setAddress(const string &address)
+{
+	m_address = address;
+}
+
+SocketAddress MetricsServer::parseAddress() const
+{
+	if (!m_address.empty() && m_address[0] == '/')
+		return SocketAddress(SocketAddress::UNIX_LOCAL, m_address);
+
+	return SocketAddress(m_address);
+}
+
+void MetricsServer::run()
+{
+	StopControl::Run run(m_stopControl);
+
+	const SocketAddress address = parseAddress();
+
+	if (address.family() == SocketAddress::UNIX_LOCAL) {
+		File socket(m_address);
+		if (socket.exists())
+			socket.remove();
+	}
+
+	HTTPServerParams::Ptr params = new HTTPServerParams;
+	params->setMaxThreads(1);
+	params->setKeepAlive(false);
+
+	HTTPServer server(
+		new MetricsRequestHandlerFactory(m_registry),
+		ServerSocket(address),
+		params);
+
+	server.start();
+	logger().information("serving metrics at " + m_address, __FILE__, __LINE__);
+
+	while (run)
+		m_stopControl.waitStoppable(-1);
+
+	server.stop();
+	logger().information("metrics server has stopped", __FILE__, __LINE__);
+}
+
+void MetricsServer::stop()
+{
+	m_stopControl.requestStop();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include <Poco/SharedPtr.h>
+#include <Poco/Net/SocketAddress.h>
+
+#include "core/MetricsRegistry.h"
+#include "loop/StoppableRunnable.h"
+#include "loop/StopControl.h"
+#include "util/Loggable.h"
+
+namespace BeeeOn {
+
+/**
+ * @brief MetricsServer exposes contents of a MetricsRegistry in the
+ * Prometheus text format via HTTP. It is intended for local scraping
+ * only, thus it listens either on a loopback TCP address or on a UNIX
+ * domain socket. Any GET request is answered by all metrics.
+ */
+class MetricsServer :
+	public StoppableRunnable,
+	protected Loggable {
+public:
+	MetricsServer();
+
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	/**
+	 * @brief Set address to listen on. It is either host:port or
+	 * an absolute path of a UNIX domain socket.
+	 */
+	void setAddress(const std::string &address);
+
+	void run() override;
+	void stop() override;
+
+protected:
+	Poco::Net::SocketAddress parseAddress() const;
+
+private:
+	MetricsRegistry::Ptr m_registry;
+	std::string m_address;
+	StopControl m_stopControl;
+};
+
+}
@@ -13,7 +13,6 @@
 #include <Poco/JSON/Object.h>
 #include <Poco/JSON/Parser.h>
 
-#include "net/HTTPUtil.h"
 #include "philips/PhilipsHueBridge.h"
 #include "util/JsonUtil.h"
 
@@ -30,10 +29,12 @@ const Timespan PhilipsHueBridge::SLEEP_BETWEEN_ATTEMPTS = 5 * Timespan::SECONDS;
 
 PhilipsHueBridge::PhilipsHueBridge(
 		const SocketAddress& address,
-		const Timespan& timeout):
+		const Timespan& timeout,
+		HTTPConnectionPool::Ptr connectionPool):
 	m_address(address),
 	m_countOfBulbs(0),
-	m_httpTimeout(timeout)
+	m_httpTimeout(timeout),
+	m_connectionPool(connectionPool)
 {
 	requestDeviceInfo();
 }
@@ -397,6 +398,6 @@ HTTPEntireResponse PhilipsHueBridge::sendRequest(
 	logger().debug("sending HTTP request to " + address.toString() +
 		request.getURI(), __FILE__, __LINE__);
 
-	return HTTPUtil::makeRequest(
+	return m_connectionPool->makeRequest(
 		request, address.host().toString(), address.port(), message, timeout);
 }
@@ -11,6 +11,7 @@
 #include <Poco/Net/SocketAddress.h>
 
 #include "credentials/PasswordCredentials.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/HTTPEntireResponse.h"
 #include "net/MACAddress.h"
 #include "philips/PhilipsHueBridgeInfo.h"
@@ -38,10 +39,12 @@ public:
 	 * specified timeout, Poco::TimeoutException is thrown.
 	 * @param &address IP address and port where the device is listening.
 	 * @param &timeout HTTP timeout.
+	 * @param connectionPool pool of HTTP sessions to use.
 	 */
 	PhilipsHueBridge(
 		const Poco::Net::SocketAddress& address,
-		const Poco::Timespan& timeout);
+		const Poco::Timespan& timeout,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	/**
 	 * @brief Authorization of the gateway to Philips Hue Bridge. It starts
@@ -135,6 +138,7 @@ private:
 
 	Poco::FastMutex m_lock;
 	Poco::Timespan m_httpTimeout;
+	HTTPConnectionPool::Ptr m_connectionPool;
 };
 
 }
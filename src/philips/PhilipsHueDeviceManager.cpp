@@ -33,6 +33,7 @@ BEEEON_OBJECT_PROPERTY("distributor", &PhilipsHueDeviceManager::setDistributor)
 BEEEON_OBJECT_PROPERTY("commandDispatcher", &PhilipsHueDeviceManager::setCommandDispatcher)
 BEEEON_OBJECT_PROPERTY("upnpTimeout", &PhilipsHueDeviceManager::setUPnPTimeout)
 BEEEON_OBJECT_PROPERTY("httpTimeout", &PhilipsHueDeviceManager::setHTTPTimeout)
+BEEEON_OBJECT_PROPERTY("connectionPool", &PhilipsHueDeviceManager::setConnectionPool)
 BEEEON_OBJECT_PROPERTY("refresh", &PhilipsHueDeviceManager::setRefresh)
 BEEEON_OBJECT_PROPERTY("credentialsStorage", &PhilipsHueDeviceManager::setCredentialsStorage)
 BEEEON_OBJECT_PROPERTY("cryptoConfig", &PhilipsHueDeviceManager::setCryptoConfig)
@@ -57,6 +58,7 @@ PhilipsHueDeviceManager::PhilipsHueDeviceManager():
 	}),
 	m_refresh(RefreshTime::fromSeconds(5)),
 	m_httpTimeout(3 * Timespan::SECONDS),
+	m_connectionPool(new HTTPConnectionPool),
 	m_upnpTimeout(5 * Timespan::SECONDS)
 {
 }
@@ -120,6 +122,11 @@ void PhilipsHueDeviceManager::setHTTPTimeout(const Timespan &timeout)
 	m_httpTimeout = timeout;
 }
 
+void PhilipsHueDeviceManager::setConnectionPool(HTTPConnectionPool::Ptr pool)
+{
+	m_connectionPool = pool;
+}
+
 void PhilipsHueDeviceManager::setCredentialsStorage(
 	SharedPtr<FileCredentialsStorage> storage)
 {
@@ -290,7 +297,7 @@ vector<PhilipsHueBulb::Ptr> PhilipsHueDeviceManager::seekBulbs(const StopControl
 
 		PhilipsHueBridge::Ptr bridge;
 		try {
-			bridge = new PhilipsHueBridge(address, m_httpTimeout);
+			bridge = new PhilipsHueBridge(address, m_httpTimeout, m_connectionPool);
 		}
 		catch (const TimeoutException& e) {
 			logger().debug("found device has disconnected", __FILE__, __LINE__);
@@ -13,6 +13,7 @@
 #include "loop/StopControl.h"
 #include "model/DeviceID.h"
 #include "model/RefreshTime.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/MACAddress.h"
 #include "philips/PhilipsHueBridge.h"
 #include "philips/PhilipsHueBulb.h"
@@ -57,6 +58,7 @@ public:
 	void setDevicePoller(DevicePoller::Ptr poller);
 	void setUPnPTimeout(const Poco::Timespan &timeout);
 	void setHTTPTimeout(const Poco::Timespan &timeout);
+	void setConnectionPool(HTTPConnectionPool::Ptr pool);
 	void setRefresh(const Poco::Timespan &refresh);
 	void setCredentialsStorage(Poco::SharedPtr<FileCredentialsStorage> storage);
 	void setCryptoConfig(Poco::SharedPtr<CryptoConfig> config);
@@ -101,6 +103,7 @@ private:
 	PollingKeeper m_pollingKeeper;
 	RefreshTime m_refresh;
 	Poco::Timespan m_httpTimeout;
+	HTTPConnectionPool::Ptr m_connectionPool;
 	Poco::Timespan m_upnpTimeout;
 
 	Poco::SharedPtr<FileCredentialsStorage> m_credentialsStorage;
@@ -1,5 +1,7 @@
 #include <Poco/Exception.h>
 #include <Poco/Logger.h>
+#include <Poco/NumberParser.h>
+#include <Poco/Timespan.h>
 
 #include "server/AbstractGWSConnector.h"
 #include "util/Occasionally.h"
@@ -8,6 +10,12 @@ using namespace std;
 using namespace Poco;
 using namespace BeeeOn;
 
+/**
+ * Default weight of the lowest-priority queue. Each higher-priority queue
+ * gets one more such quantum.
+ */
+static const int64_t DEFAULT_QUANTUM = 1024;
+
 AbstractGWSConnector::AbstractGWSConnector():
 	m_outputsCount(2)
 {
@@ -21,11 +29,39 @@ void AbstractGWSConnector::setOutputsCount(int count)
 	m_outputsCount = count;
 }
 
+void AbstractGWSConnector::setOutputsWeights(const list<string> &weights)
+{
+	vector<int64_t> parsed;
+
+	for (const auto &weight : weights) {
+		const unsigned int value = NumberParser::parseUnsigned(weight);
+		if (value == 0)
+			throw InvalidArgumentException("outputsWeights must be positive");
+
+		parsed.emplace_back(value);
+	}
+
+	m_outputsWeights = parsed;
+}
+
 void AbstractGWSConnector::setPriorityAssigner(GWSPriorityAssigner::Ptr assigner)
 {
 	m_priorityAssigner = assigner;
 }
 
+void AbstractGWSConnector::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_metricsRegistry = registry;
+}
+
+int64_t AbstractGWSConnector::weightOf(size_t i) const
+{
+	if (i < m_outputsWeights.size())
+		return m_outputsWeights[i];
+
+	return DEFAULT_QUANTUM * (m_outputsCount - i);
+}
+
 void AbstractGWSConnector::setupQueues()
 {
 	Mutex::ScopedLock guard(m_outputLock);
@@ -37,55 +73,96 @@ void AbstractGWSConnector::setupQueues()
 	}
 
 	m_outputs.clear();
+	m_active.clear();
+
 	for (unsigned int i = 0; i < m_outputsCount; ++i) {
-		m_outputs.emplace_back(queue<GWMessage::Ptr>());
-		m_outputsStatus.emplace_back(0);
-	}
+		Output output;
+		output.weight = weightOf(i);
+		output.deficit = output.weight;
+		output.active = false;
+
+		if (m_metricsRegistry.isNull()) {
+			output.size = MetricsRegistry::createGauge();
+			output.sent = MetricsRegistry::createCounter();
+			output.bytes = MetricsRegistry::createCounter();
+			output.wait = MetricsRegistry::createHistogram();
+			m_outputs.emplace_back(output);
+			continue;
+		}
 
-	poco_assert(m_outputs.size() == m_outputsStatus.size());
+		const MetricsRegistry::Labels labels = {{"output", to_string(i)}};
+
+		output.size = m_metricsRegistry->gauge(
+			"beeeon_gws_output_queue_size",
+			"Messages waiting in the output queue",
+			labels);
+		output.sent = m_metricsRegistry->counter(
+			"beeeon_gws_output_sent_total",
+			"Messages sent from the output queue",
+			labels);
+		output.bytes = m_metricsRegistry->counter(
+			"beeeon_gws_output_sent_bytes_total",
+			"Bytes sent from the output queue",
+			labels);
+		output.wait = m_metricsRegistry->histogram(
+			"beeeon_gws_output_wait_seconds",
+			"Time spent by messages in the output queue",
+			labels);
+
+		m_outputs.emplace_back(output);
+	}
 }
 
-size_t AbstractGWSConnector::selectOutput() const
+void AbstractGWSConnector::activate(size_t i)
 {
-	static Occasionally occasionally;
+	Output &output = m_outputs[i];
+	if (output.active)
+		return;
 
-	Mutex::ScopedLock guard(m_outputLock);
+	output.active = true;
 
-	vector<bool> go;
-	for (size_t i = 0; i < m_outputsStatus.size(); ++i) {
-		go.push_back(false);
+	if (output.deficit > 0 && !m_active.empty() && i < m_active.front())
+		m_active.emplace_front(i);
+	else
+		m_active.emplace_back(i);
+}
 
-		size_t others = 0;
-		size_t count = 0;
+void AbstractGWSConnector::deactivate(size_t i)
+{
+	Output &output = m_outputs[i];
+	if (!output.active)
+		return;
 
-		for (size_t j = i + 1; j < m_outputsStatus.size(); ++j) {
-			if (m_outputs[j].empty())
-				continue;
+	output.active = false;
 
-			others += m_outputsStatus[j];
-			count += 1;
-		}
+	if (m_active.front() == i)
+		m_active.pop_front();
+	else
+		m_active.remove(i);
+}
 
-		if (m_outputsStatus[i] <= others || count == 0)
-			go[i] = true;
-	}
+size_t AbstractGWSConnector::selectOutput()
+{
+	static Occasionally occasionally;
 
-	poco_assert(!go.empty());
+	Mutex::ScopedLock guard(m_outputLock);
 
-	go[go.size() - 1] = true;
+	occasionally.execute([&]() {
+		string queues;
 
-	poco_assert(go.size() == m_outputsStatus.size());
-	poco_assert(go.size() == m_outputs.size());
+		for (size_t i = 0; i < m_outputs.size(); ++i) {
+			const Output &output = m_outputs[i];
+			const uint64_t count = output.wait->count();
+			const Timespan wait = count == 0 ? 0 : output.wait->sum().totalMicroseconds() / count;
 
-	occasionally.execute([&]() {
-		string queues = to_string(m_outputs.front().size())
-			+ " [" + (go.front()? "*" : "")
-			+ to_string(m_outputsStatus.front()) + "]";
-
-		for (size_t i = 1; i < m_outputs.size(); ++i) {
-			queues += ", " + to_string(m_outputs[i].size())
-				+ " [" + (go[i]? "*" : "")
-				+ to_string(m_outputsStatus[i]) + "]";
+			if (!queues.empty())
+				queues += ", ";
+
+			queues += to_string(output.messages.size())
+				+ " [" + (output.active? "*" : "")
+				+ to_string(output.deficit) + "/"
+				+ to_string(output.weight) + " "
+				+ to_string(wait.totalMilliseconds()) + " ms]";
 		}
 
 		logger().information(
@@ -93,36 +170,37 @@ size_t AbstractGWSConnector::selectOutput() const
 			__FILE__, __LINE__);
 	});
 
-	for (size_t i = 0; i < go.size(); ++i) {
-		if (!go[i])
-			continue;
+	while (!m_active.empty()) {
+		const size_t i = m_active.front();
+		Output &output = m_outputs[i];
 
-		auto &queue = m_outputs[i];
-		if (queue.empty())
+		if (output.messages.empty()) {
+			deactivate(i);
 			continue;
+		}
+
+		if (output.deficit > 0)
+			return i;
 
-		return i;
+		// the turn is over, refill and let the others go
+		output.deficit += output.weight;
+		m_active.splice(m_active.end(), m_active, m_active.begin());
 	}
 
-	return go.size();
+	return m_outputs.size();
 }
 
-void AbstractGWSConnector::updateOutputs(size_t i)
+void AbstractGWSConnector::updateOutputs(size_t i, size_t size)
 {
 	Mutex::ScopedLock guard(m_outputLock);
 
-	m_outputsStatus[i] += 1;
+	Output &output = m_outputs[i];
 
-	size_t highest = 0;
-
-	for (const auto &status : m_outputsStatus)
-		highest = status > highest? status : highest;
-
-	if (highest < 16)
-		return;
+	output.deficit -= size;
+	output.bytes->add(size);
 
-	for (auto &status : m_outputsStatus)
-		status /= 16;
+	if (output.messages.empty())
+		deactivate(i);
 }
 
 bool AbstractGWSConnector::outputValid(size_t i) const
@@ -136,16 +214,37 @@ GWMessage::Ptr AbstractGWSConnector::peekOutput(size_t i) const
 {
 	Mutex::ScopedLock guard(m_outputLock);
 
-	poco_assert(!m_outputs[i].empty());
-	return m_outputs[i].front();
+	poco_assert(!m_outputs[i].messages.empty());
+	return m_outputs[i].messages.front().message;
+}
+
+GWMessage::Ptr AbstractGWSConnector::peekOutput(size_t i, size_t n) const
+{
+	Mutex::ScopedLock guard(m_outputLock);
+
+	poco_assert(n < m_outputs[i].messages.size());
+	return m_outputs[i].messages[n].message;
+}
+
+size_t AbstractGWSConnector::outputSize(size_t i) const
+{
+	Mutex::ScopedLock guard(m_outputLock);
+
+	return m_outputs[i].messages.size();
 }
 
 void AbstractGWSConnector::popOutput(size_t i)
 {
 	Mutex::ScopedLock guard(m_outputLock);
 
-	poco_assert(!m_outputs[i].empty());
-	m_outputs[i].pop();
+	Output &output = m_outputs[i];
+
+	poco_assert(!output.messages.empty());
+	output.wait->observe(output.messages.front().since.elapsed());
+	output.messages.pop_front();
+
+	output.size->add(-1);
+	output.sent->add();
 }
 
 void AbstractGWSConnector::send(const GWMessage::Ptr message)
@@ -161,10 +260,11 @@ void AbstractGWSConnector::send(const GWMessage::Ptr message)
 			__FILE__, __LINE__);
 	}
 
-	if (priority > m_outputs.size())
-		m_outputs.back().emplace(message);
-	else
-		m_outputs[priority].emplace(message);
+	const size_t i = min<size_t>(priority, m_outputs.size() - 1);
+
+	m_outputs[i].messages.emplace_back(Waiting{message, {}});
+	m_outputs[i].size->add(1);
+	activate(i);
 
 	m_outputsUpdated.set();
 }
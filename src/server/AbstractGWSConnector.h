@@ -1,10 +1,15 @@
 #pragma once
 
-#include <queue>
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
 
+#include <Poco/Clock.h>
 #include <Poco/Event.h>
 #include <Poco/Mutex.h>
 
+#include "core/MetricsRegistry.h"
 #include "gwmessage/GWMessage.h"
 #include "server/GWSConnector.h"
 #include "server/GWSPriorityAssigner.h"
@@ -21,19 +26,27 @@ namespace BeeeOn {
  * Each message is appended to a queue based on its priority. The queue
  * number 0 is the most urgent queue.
  *
- * Each queue contains a statistic of count of messages sent from
- * the queue. A message for output is selected based on the following
- * algorithm:
+ * Messages are selected for output by deficit round-robin (DRR) over
+ * the non-empty (active) queues. Each queue has a weight (quantum) in bytes
+ * that it is allowed to send during its turn. Whenever a message is sent,
+ * its size is charged from the deficit of its queue. When the deficit is
+ * exhausted, the queue is refilled by its weight and moved behind the other
+ * active queues. Thus, each queue gets a share of the bandwidth proportional
+ * to its weight and no queue can be starved. The selection is O(1) with
+ * respect to the number of messages.
  *
- * 1. take queue[i] (initially i := 0) with status[i]
- * 2. sum all status[j] for j > i
- * 3. if the status[i] <= sum(status[all j]), use queue i
- * 4. i := i + 1, try again
+ * When a queue becomes active while having some deficit left, it is served
+ * before the current active queue of a lower priority (higher index). This
+ * keeps latency of urgent messages (e.g. responses) low, while the deficit
+ * accounting limits how much such queue can send before it must wait for
+ * its turn again.
  *
- * Empty or unused queues are skipped. Summarization... The first queue must
- * always send more messages then all the other queues. If the first queue
- * sends more messages then available in other queues (the first queue has been
- * satisfied), the following queue is used with the same algorithm.
+ * Unless configured, weights decrease linearly with the queue index, i.e.
+ * the queue 0 has the highest weight.
+ *
+ * Size of each queue, count of messages and bytes sent from it and time
+ * spent by messages waiting in it are published as metrics when
+ * a MetricsRegistry is set.
  */
 class AbstractGWSConnector :
 	public GWSConnector,
@@ -42,7 +55,15 @@ public:
 	AbstractGWSConnector();
 
 	void setOutputsCount(int count);
+
+	/**
+	 * @brief Set weight (in bytes per turn) of each queue starting
+	 * from the queue 0. Queues without a weight use the default one.
+	 */
+	void setOutputsWeights(const std::list<std::string> &weights);
+
 	void setPriorityAssigner(GWSPriorityAssigner::Ptr assigner);
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
 
 	/**
 	 * @brief Setup queues based on configuration. This must
@@ -58,15 +79,16 @@ public:
 
 protected:
 	/**
-	 * @returns index of output queue to send from.
+	 * @returns index of output queue to send from or an invalid
+	 * index when all queues are empty.
 	 */
-	size_t selectOutput() const;
+	size_t selectOutput();
 
 	/**
-	 * @breif Update status of output queues. The given index
-	 * denotes queue that has been used to send a message.
+	 * @brief Charge the given count of bytes sent from the queue of
+	 * the given index. The queue becomes inactive when it is empty.
 	 */
-	void updateOutputs(size_t i);
+	void updateOutputs(size_t i, size_t size);
 
 	/**
 	 * @returns true if the queue of the given index is valid
@@ -79,6 +101,16 @@ protected:
 	 */
 	GWMessage::Ptr peekOutput(size_t i) const;
 
+	/**
+	 * @returns n-th message in the queue of the given index
+	 */
+	GWMessage::Ptr peekOutput(size_t i, size_t n) const;
+
+	/**
+	 * @returns count of messages in the queue of the given index
+	 */
+	size_t outputSize(size_t i) const;
+
 	/**
 	 * @brief Pop the first (oldest) message in the queue of the
 	 * given index.
@@ -90,10 +122,44 @@ protected:
 	mutable Poco::Mutex m_outputLock;
 
 private:
+	struct Waiting {
+		GWMessage::Ptr message;
+		Poco::Clock since;
+	};
+
+	struct Output {
+		std::deque<Waiting> messages;
+		int64_t weight;
+		int64_t deficit;
+		bool active;
+		MetricsRegistry::Gauge::Ptr size;
+		MetricsRegistry::Counter::Ptr sent;
+		MetricsRegistry::Counter::Ptr bytes;
+		MetricsRegistry::Histogram::Ptr wait;
+	};
+
+	/**
+	 * @brief Append the queue of the given index to the active
+	 * queues unless it is already there.
+	 */
+	void activate(size_t i);
+
+	/**
+	 * @brief Remove the queue of the given index from the active queues.
+	 */
+	void deactivate(size_t i);
+
+	/**
+	 * @returns weight of the queue of the given index
+	 */
+	int64_t weightOf(size_t i) const;
+
 	unsigned int m_outputsCount;
-	std::vector<std::queue<GWMessage::Ptr>> m_outputs;
-	std::vector<size_t> m_outputsStatus;
+	std::vector<int64_t> m_outputsWeights;
+	std::vector<Output> m_outputs;
+	std::list<size_t> m_active;
 	GWSPriorityAssigner::Ptr m_priorityAssigner;
+	MetricsRegistry::Ptr m_metricsRegistry;
 };
 
 }
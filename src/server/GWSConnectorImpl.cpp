@@ -1,5 +1,8 @@
+#include <sstream>
+
 #include <Poco/Buffer.h>
 #include <Poco/DateTimeFormatter.h>
+#include <Poco/DeflatingStream.h>
 #include <Poco/Exception.h>
 #include <Poco/Logger.h>
 #include <Poco/Message.h>
@@ -35,7 +38,10 @@ BEEEON_OBJECT_PROPERTY("keepAliveTimeout", &GWSConnectorImpl::setKeepAliveTimeou
 BEEEON_OBJECT_PROPERTY("outputsCount", &GWSConnectorImpl::setOutputsCount)
 BEEEON_OBJECT_PROPERTY("maxFailedReceives", &GWSConnectorImpl::setMaxFailedReceives)
 BEEEON_OBJECT_PROPERTY("gatewayInfo", &GWSConnectorImpl::setGatewayInfo)
+BEEEON_OBJECT_PROPERTY("compression", &GWSConnectorImpl::setCompression)
+BEEEON_OBJECT_PROPERTY("maxRecords", &GWSConnectorImpl::setMaxRecords)
 BEEEON_OBJECT_PROPERTY("priorityAssigner", &GWSConnectorImpl::setPriorityAssigner)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &GWSConnectorImpl::setMetricsRegistry)
 BEEEON_OBJECT_PROPERTY("listeners", &GWSConnectorImpl::addListener)
 BEEEON_OBJECT_PROPERTY("eventsExecutor", &GWSConnectorImpl::setEventsExecutor)
 BEEEON_OBJECT_HOOK("done", &GWSConnectorImpl::setupQueues)
@@ -47,6 +53,17 @@ using namespace Poco;
 using namespace Poco::Net;
 using namespace BeeeOn;
 
+/**
+ * WebSocket subprotocol denoting support of the application-level
+ * envelope (coalesced and deflated frames).
+ */
+static const string ENVELOPE_PROTOCOL = "beeeon-gws-envelope";
+
+/**
+ * Frames smaller than this are never compressed.
+ */
+static const size_t MIN_DEFLATE_SIZE = 128;
+
 GWSConnectorImpl::GWSConnectorImpl():
 	m_host("127.0.0.1"),
 	m_port(8850),
@@ -55,6 +72,13 @@ GWSConnectorImpl::GWSConnectorImpl():
 	m_sendTimeout(1 * Timespan::SECONDS),
 	m_reconnectDelay(5 * Timespan::SECONDS),
 	m_keepAliveTimeout(30 * Timespan::SECONDS),
+	m_deflate(false),
+	m_maxRecords(1),
+	m_envelope(false),
+	m_frames(MetricsRegistry::createCounter()),
+	m_records(MetricsRegistry::createCounter()),
+	m_payloadBytes(MetricsRegistry::createCounter()),
+	m_wireBytes(MetricsRegistry::createCounter()),
 	m_receiveFailed(0)
 {
 }
@@ -123,6 +147,42 @@ void GWSConnectorImpl::setGatewayInfo(GatewayInfo::Ptr info)
 	m_gatewayInfo = info;
 }
 
+void GWSConnectorImpl::setCompression(const string &compression)
+{
+	if (compression == "none")
+		m_deflate = false;
+	else if (compression == "deflate")
+		m_deflate = true;
+	else
+		throw InvalidArgumentException("unsupported compression: " + compression);
+}
+
+void GWSConnectorImpl::setMaxRecords(int count)
+{
+	if (count < 1)
+		throw InvalidArgumentException("maxRecords must be at least 1");
+
+	m_maxRecords = count;
+}
+
+void GWSConnectorImpl::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	AbstractGWSConnector::setMetricsRegistry(registry);
+
+	m_frames = registry->counter(
+		"beeeon_gws_frames_sent_total",
+		"Frames sent to the remote server");
+	m_records = registry->counter(
+		"beeeon_gws_records_sent_total",
+		"Messages sent to the remote server via frames");
+	m_payloadBytes = registry->counter(
+		"beeeon_gws_payload_bytes_total",
+		"Bytes of frames sent to the remote server before compression");
+	m_wireBytes = registry->counter(
+		"beeeon_gws_wire_bytes_total",
+		"Bytes of frames sent to the remote server after compression");
+}
+
 void GWSConnectorImpl::run()
 {
 	StopControl::Run run(m_stopControl);
@@ -154,6 +214,7 @@ void GWSConnectorImpl::run()
 			waitBeforeReconnect();
 			continue)
 
+		m_connection = traffic();
 		fireEvent(address, &GWSListener::onConnected);
 
 		SocketReactor reactor;
@@ -179,6 +240,7 @@ void GWSConnectorImpl::run()
 		reactorThread.join();
 
 		fireEvent(address, &GWSListener::onDisconnected);
+		reportTraffic();
 
 		if (run)
 			waitBeforeReconnect();
@@ -289,12 +351,18 @@ void GWSConnectorImpl::checkPingTimeout() const
 
 SharedPtr<WebSocket> GWSConnectorImpl::connect(
 		const string &host,
-		const int port) const
+		const int port)
 {
 	HTTPRequest request(HTTPRequest::HTTP_1_1);
 	HTTPResponse response;
 
 	SharedPtr<WebSocket> socket;
+	const bool offer = m_deflate || m_maxRecords > 1;
+
+	if (offer)
+		request.set("Sec-WebSocket-Protocol", ENVELOPE_PROTOCOL);
+
+	m_envelope = false;
 
 	logger().notice("connecting...", __FILE__, __LINE__);
 
@@ -319,6 +387,17 @@ SharedPtr<WebSocket> GWSConnectorImpl::connect(
 			__FILE__, __LINE__);
 	}
 
+	if (offer) {
+		m_envelope = response.get("Sec-WebSocket-Protocol", "") == ENVELOPE_PROTOCOL;
+
+		if (!m_envelope) {
+			logger().notice(
+				"server does not support " + ENVELOPE_PROTOCOL
+				+ ", sending plain messages",
+				__FILE__, __LINE__);
+		}
+	}
+
 	return socket;
 }
 
@@ -353,22 +432,62 @@ bool GWSConnectorImpl::performOutput(WebSocket &socket)
 	if (!outputValid(i))
 		return false; // nothing to output
 
-	const GWMessage::Ptr message = peekOutput(i);
+	const size_t limit = m_envelope ? min(m_maxRecords, outputSize(i)) : 1;
+	vector<GWMessage::Ptr> messages;
+	vector<string> records;
+	size_t length = 0;
+
+	try {
+		// coalesce the oldest messages of the queue while they fit
+		for (size_t n = 0; n < limit; ++n) {
+			const GWMessage::Ptr message = peekOutput(i, n);
+			const string raw = message->toString();
+
+			if (n > 0 && length + raw.size() + n + 2 > m_maxMessageSize)
+				break;
+
+			length += raw.size();
+			messages.emplace_back(message);
+			records.emplace_back(raw);
+		}
+	}
+	BEEEON_CATCH_CHAIN(logger())
+
+	if (messages.empty()) {
+		// the message is broken, drop it
+		popOutput(i);
+		updateOutputs(i, 0);
+		return true;
+	}
+
+	size_t size = 0;
 
 	try {
-		fireEvent(message, &GWSListener::onTrySend);
+		for (const auto &message : messages)
+			fireEvent(message, &GWSListener::onTrySend);
 
-		sendMessage(socket, *message);
+		if (logger().debug()) {
+			for (const auto &message : messages) {
+				logger().debug(
+					"sending message " + message->toBriefString(),
+					__FILE__, __LINE__);
+			}
+		}
 
-		fireEvent(message, &GWSListener::onSent);
+		size = sendRecords(socket, records);
+
+		for (const auto &message : messages)
+			fireEvent(message, &GWSListener::onSent);
 	}
 	catch (const NetException &e) {
 		e.rethrow();
 	}
 	BEEEON_CATCH_CHAIN(logger())
 
-	popOutput(i);
-	updateOutputs(i);
+	for (size_t n = 0; n < messages.size(); ++n)
+		popOutput(i);
+
+	updateOutputs(i, size);
 
 	return true;
 }
@@ -421,7 +540,7 @@ void GWSConnectorImpl::onReadable(const AutoPtr<ReadableNotification> &n)
 	fireReceived(message);
 }
 
-void GWSConnectorImpl::sendMessage(
+size_t GWSConnectorImpl::sendMessage(
 		WebSocket &socket,
 		const GWMessage &message) const
 {
@@ -434,6 +553,96 @@ void GWSConnectorImpl::sendMessage(
 	}
 
 	sendFrame(socket, raw, WebSocket::FRAME_TEXT);
+	return raw.size();
+}
+
+/**
+ * Compress the given payload into the zlib format.
+ */
+static string deflate(const string &payload)
+{
+	ostringstream out;
+
+	DeflatingOutputStream deflate(out, DeflatingStreamBuf::STREAM_ZLIB);
+	deflate.write(payload.data(), payload.size());
+	deflate.close();
+
+	return out.str();
+}
+
+size_t GWSConnectorImpl::sendRecords(
+		WebSocket &socket,
+		const vector<string> &records)
+{
+	poco_assert(!records.empty());
+
+	string payload;
+
+	if (records.size() == 1) {
+		payload = records.front();
+	}
+	else {
+		payload = "[";
+
+		for (size_t n = 0; n < records.size(); ++n) {
+			if (n > 0)
+				payload += ",";
+
+			payload += records[n];
+		}
+
+		payload += "]";
+	}
+
+	string compressed;
+
+	if (m_envelope && m_deflate && payload.size() >= MIN_DEFLATE_SIZE)
+		compressed = deflate(payload);
+
+	const bool binary = !compressed.empty() && compressed.size() < payload.size();
+	const string &wire = binary ? compressed : payload;
+
+	sendFrame(socket, wire, binary ? WebSocket::FRAME_BINARY : WebSocket::FRAME_TEXT);
+
+	m_frames->add();
+	m_records->add(records.size());
+	m_payloadBytes->add(payload.size());
+	m_wireBytes->add(wire.size());
+
+	return wire.size();
+}
+
+GWSConnectorImpl::Traffic GWSConnectorImpl::traffic() const
+{
+	return {
+		Clock{},
+		m_frames->value(),
+		m_records->value(),
+		m_payloadBytes->value(),
+		m_wireBytes->value(),
+	};
+}
+
+void GWSConnectorImpl::reportTraffic() const
+{
+	const Traffic now = traffic();
+	const uint64_t frames = now.frames - m_connection.frames;
+	const uint64_t payload = now.payloadBytes - m_connection.payloadBytes;
+	const uint64_t wire = now.wireBytes - m_connection.wireBytes;
+	const Timespan duration = now.since - m_connection.since;
+
+	if (frames == 0)
+		return;
+
+	const double seconds = max<double>(duration.totalMilliseconds() / 1000.0, 0.001);
+
+	logger().information(
+		"sent " + to_string(now.records - m_connection.records) + " messages"
+		+ " in " + to_string(frames) + " frames"
+		+ " (" + NumberFormatter::format(frames / seconds, 2) + " frames/s)"
+		+ ", compression ratio "
+		+ NumberFormatter::format(payload == 0 ? 1.0 : double(wire) / payload, 2),
+		__FILE__, __LINE__);
 }
 
 void GWSConnectorImpl::sendFrame(
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <Poco/AutoPtr.h>
 #include <Poco/Buffer.h>
@@ -27,6 +28,26 @@ namespace BeeeOn {
  * - sending messages,
  * - receiving messages,
  * - keep alive ping-pong.
+ *
+ * The connector can offer the application-level envelope to the server
+ * by the WebSocket subprotocol "beeeon-gws-envelope". It is offered only
+ * when compression or coalescing is configured. If the server accepts it,
+ * the following applies to the outgoing frames:
+ *
+ * - a text frame contains either a single message or a JSON array of
+ *   multiple messages taken from the same output queue (when the queue
+ *   is deep, at most maxRecords messages are coalesced),
+ * - a binary frame contains such text deflated (zlib format), it is used
+ *   only when the compression is enabled and it saves some bytes.
+ *
+ * Messages are coalesced only while the text of the frame fits into
+ * the maxMessageSize. A single message is always sent as its own frame
+ * regardless of its size (just like without the envelope), thus only
+ * frames of multiple messages are guaranteed to fit. If the server does
+ * not accept the envelope, each message is sent as its own text frame
+ * as usual. Count of frames, records and bytes before and after
+ * compression are published as metrics and summarized in the log for
+ * each connection.
  */
 class GWSConnectorImpl :
 	public AbstractGWSConnector,
@@ -45,15 +66,31 @@ public:
 	void setMaxFailedReceives(int count);
 	void setGatewayInfo(GatewayInfo::Ptr info);
 
+	/**
+	 * @brief Set compression of outgoing frames: none or deflate.
+	 */
+	void setCompression(const std::string &compression);
+
+	/**
+	 * @brief Set maximal count of messages coalesced into a single frame.
+	 */
+	void setMaxRecords(int count);
+
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
 	void run();
 	void stop();
 
 protected:
 	void waitBeforeReconnect();
 
+	/**
+	 * @brief Connect to the server and negotiate the envelope
+	 * if it is to be offered.
+	 */
 	Poco::SharedPtr<Poco::Net::WebSocket> connect(
 		const std::string &host,
-		int port) const;
+		int port);
 	void performRegister(Poco::Net::WebSocket &socket) const;
 	bool performOutput(Poco::Net::WebSocket &socket);
 	void performPing(Poco::Net::WebSocket &socket);
@@ -77,9 +114,28 @@ protected:
 
 	void onReadable(const Poco::AutoPtr<Poco::Net::ReadableNotification> &n);
 
-	void sendMessage(
+	/**
+	 * @brief Serialize and send the given message.
+	 * @returns count of bytes of the sent message
+	 */
+	size_t sendMessage(
 		Poco::Net::WebSocket &socket,
 		const GWMessage &message) const;
+
+	/**
+	 * @brief Send the given serialized messages in a single frame
+	 * while respecting the negotiated envelope.
+	 * @returns count of bytes sent
+	 */
+	size_t sendRecords(
+		Poco::Net::WebSocket &socket,
+		const std::vector<std::string> &records);
+
+	/**
+	 * @brief Log traffic statistics of the current connection.
+	 */
+	void reportTraffic() const;
+
 	void sendFrame(
 		Poco::Net::WebSocket &socket,
 		const std::string &payload,
@@ -92,6 +148,22 @@ protected:
 		int &flags) const;
 
 private:
+	/**
+	 * @brief Snapshot of the traffic counters.
+	 */
+	struct Traffic {
+		Poco::Clock since;
+		uint64_t frames;
+		uint64_t records;
+		uint64_t payloadBytes;
+		uint64_t wireBytes;
+	};
+
+	/**
+	 * @returns current values of the traffic counters
+	 */
+	Traffic traffic() const;
+
 	std::string m_host;
 	int m_port;
 	size_t m_maxMessageSize;
@@ -102,6 +174,9 @@ private:
 	Poco::Timespan m_keepAliveTimeout;
 	int m_maxFailedReceives;
 	GatewayInfo::Ptr m_gatewayInfo;
+	bool m_deflate;
+	size_t m_maxRecords;
+	bool m_envelope;
 
 	mutable Poco::FastMutex m_sendLock;
 	mutable Poco::FastMutex m_receiveLock;
@@ -110,6 +185,11 @@ private:
 	mutable Poco::Clock m_lastActivity;
 	mutable Poco::FastMutex m_lock;
 
+	MetricsRegistry::Counter::Ptr m_frames;
+	MetricsRegistry::Counter::Ptr m_records;
+	MetricsRegistry::Counter::Ptr m_payloadBytes;
+	MetricsRegistry::Counter::Ptr m_wireBytes;
+	Traffic m_connection;
 	Poco::Clock m_lastPing;
 	Poco::AtomicCounter m_receiveFailed;
 };
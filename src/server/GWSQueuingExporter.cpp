@@ -1,3 +1,4 @@
+#include <Poco/DateTimeFormatter.h>
 #include <Poco/Exception.h>
 
 #include "di/Injectable.h"
@@ -10,12 +11,18 @@ BEEEON_OBJECT_CASTABLE(StoppableRunnable)
 BEEEON_OBJECT_CASTABLE(GWSListener)
 BEEEON_OBJECT_CASTABLE(Exporter)
 BEEEON_OBJECT_PROPERTY("activeCount", &GWSQueuingExporter::setActiveCount)
+BEEEON_OBJECT_PROPERTY("batchMode", &GWSQueuingExporter::setBatchMode)
+BEEEON_OBJECT_PROPERTY("maxActiveCount", &GWSQueuingExporter::setMaxActiveCount)
+BEEEON_OBJECT_PROPERTY("maxMessageSize", &GWSQueuingExporter::setMaxMessageSize)
+BEEEON_OBJECT_PROPERTY("latencyTarget", &GWSQueuingExporter::setLatencyTarget)
+BEEEON_OBJECT_PROPERTY("windowSize", &GWSQueuingExporter::setWindowSize)
 BEEEON_OBJECT_PROPERTY("acquireTimeout", &GWSQueuingExporter::setAcquireTimeout)
 BEEEON_OBJECT_PROPERTY("sendFailedDelay", &GWSQueuingExporter::setSendFailedDelay)
 BEEEON_OBJECT_PROPERTY("connector", &GWSQueuingExporter::setConnector)
 BEEEON_OBJECT_PROPERTY("queuingStrategy", &GWSQueuingExporter::setStrategy)
 BEEEON_OBJECT_PROPERTY("saveThreshold", &GWSQueuingExporter::setSaveThreshold)
 BEEEON_OBJECT_PROPERTY("saveTimeout", &GWSQueuingExporter::setSaveTimeout)
+BEEEON_OBJECT_PROPERTY("saveGroupWindow", &GWSQueuingExporter::setSaveGroupWindow)
 BEEEON_OBJECT_PROPERTY("strategyPriority", &GWSQueuingExporter::setStrategyPriority)
 BEEEON_OBJECT_END(BeeeOn, GWSQueuingExporter)
 
@@ -23,8 +30,23 @@ using namespace std;
 using namespace Poco;
 using namespace BeeeOn;
 
+/**
+ * Batches not confirmed within this multiple of the latencyTarget
+ * are not tracked anymore.
+ */
+static const int MAX_UNCONFIRMED_LATENCY = 8;
+
 GWSQueuingExporter::GWSQueuingExporter():
 	m_activeCount(10),
+	m_batchMode(BATCH_FIXED),
+	m_maxActiveCount(256),
+	m_maxMessageSize(4096),
+	m_latencyTarget(2 * Timespan::SECONDS),
+	m_batchSize(10),
+	m_bytesPerData(0),
+	m_exported(0),
+	m_decreaseBarrier(0),
+	m_windowSize(1),
 	m_acquireTimeout(5 * Timespan::SECONDS),
 	m_sendFailedDelay(5 * Timespan::SECONDS)
 {
@@ -36,6 +58,98 @@ void GWSQueuingExporter::setActiveCount(int count)
 		throw InvalidArgumentException("activeCount must be positive");
 
 	m_activeCount = count;
+	m_batchSize = count;
+}
+
+void GWSQueuingExporter::setBatchMode(const string &mode)
+{
+	if (mode == "fixed")
+		m_batchMode = BATCH_FIXED;
+	else if (mode == "adaptive")
+		m_batchMode = BATCH_ADAPTIVE;
+	else
+		throw InvalidArgumentException("unsupported batch mode: " + mode);
+}
+
+void GWSQueuingExporter::setMaxActiveCount(int count)
+{
+	if (count <= 0)
+		throw InvalidArgumentException("maxActiveCount must be positive");
+
+	m_maxActiveCount = count;
+}
+
+void GWSQueuingExporter::setMaxMessageSize(int size)
+{
+	if (size <= 0)
+		throw InvalidArgumentException("maxMessageSize must be positive");
+
+	m_maxMessageSize = size;
+}
+
+void GWSQueuingExporter::setLatencyTarget(const Timespan &target)
+{
+	if (target <= 0)
+		throw InvalidArgumentException("latencyTarget must be positive");
+
+	m_latencyTarget = target;
+}
+
+size_t GWSQueuingExporter::batchSize() const
+{
+	if (m_batchMode == BATCH_FIXED)
+		return m_activeCount;
+
+	size_t count = min(m_batchSize, m_maxActiveCount);
+
+	if (m_bytesPerData > 0)
+		count = min(count, m_maxMessageSize / m_bytesPerData);
+
+	return max<size_t>(count, 1);
+}
+
+void GWSQueuingExporter::adaptBatchSize(
+		size_t count,
+		size_t requested,
+		const Timespan &latency,
+		uint64_t sequence)
+{
+	const size_t previous = m_batchSize;
+
+	if (latency > m_latencyTarget) {
+		// batches exported before the last decrease are of the same
+		// window, they must not decrease the batch size again
+		if (sequence > m_decreaseBarrier) {
+			m_batchSize = max<size_t>(m_batchSize / 2, 1);
+			m_decreaseBarrier = m_exported;
+		}
+	}
+	else if (count >= requested)
+		m_batchSize = min(m_batchSize + 1, m_maxActiveCount);
+
+	if (m_batchSize != previous && logger().debug()) {
+		logger().debug(
+			"batch size " + to_string(previous)
+			+ " -> " + to_string(m_batchSize)
+			+ " (latency " + DateTimeFormatter::format(latency) + ")",
+			__FILE__, __LINE__);
+	}
+}
+
+void GWSQueuingExporter::updateBytesPerData(size_t bytes, size_t count)
+{
+	if (count == 0)
+		return;
+
+	m_bytesPerData = (bytes + count - 1) / count;
+}
+
+void GWSQueuingExporter::setWindowSize(int size)
+{
+	if (size <= 0)
+		throw InvalidArgumentException("windowSize must be positive");
+
+	m_windowSize = size;
 }
 
 void GWSQueuingExporter::setAcquireTimeout(const Timespan &timeout)
@@ -66,63 +180,174 @@ void GWSQueuingExporter::run()
 	logger().information("starting GWS queuing exporter");
 
 	while (run) {
-		vector<SensorData> active;
+		ackConfirmed();
 
-		acquire(active, m_activeCount, m_acquireTimeout);
-		if (active.empty())
+		if (inFlight() >= m_windowSize) {
+			m_event.wait();
 			continue;
+		}
 
-		if (logger().trace()) {
-			string details;
+		exportBatch();
+	}
 
-			for (const auto &data : active) {
-				if (!details.empty())
-					details += ", ";
+	ackConfirmed();
+
+	logger().information("GWS queuing exporter has stopped");
+}
 
-				details += data.deviceID().toString();
-				details += " (" + to_string(data.size()) + ")";
+bool GWSQueuingExporter::exportBatch()
+{
+	vector<SensorData> active;
+	GlobalID id = GlobalID::random();
+	size_t requested = batchSize();
+
+	if (!acquire(id, active, requested, m_acquireTimeout))
+		return false;
+
+	GWSensorDataExport::Ptr request = new GWSensorDataExport;
+	request->setID(id);
+	request->setData(active);
+
+	if (m_batchMode == BATCH_ADAPTIVE) {
+		size_t size = request->toString().size();
+		updateBytesPerData(size, active.size());
+
+		// too big, release the batch and acquire a smaller one
+		while (size > m_maxMessageSize && active.size() > 1) {
+			reset(id);
+
+			requested = min(batchSize(), active.size() - 1);
+			m_batchSize = requested;
+
+			if (logger().debug()) {
+				logger().debug(
+					"batch of " + to_string(active.size())
+					+ " is too big (" + to_string(size) + " B), "
+					+ "shrinking to " + to_string(requested),
+					__FILE__, __LINE__);
 			}
 
-			logger().trace(
-				"exporting values: " + details,
-				__FILE__, __LINE__);
+			active.clear();
+			id = GlobalID::random();
+
+			if (!acquire(id, active, requested, 0))
+				return false;
+
+			request->setID(id);
+			request->setData(active);
+
+			size = request->toString().size();
+			updateBytesPerData(size, active.size());
 		}
+	}
 
-		const auto id = GlobalID::random();
+	if (logger().trace()) {
+		string details;
 
-		GWSensorDataExport::Ptr request = new GWSensorDataExport;
-		request->setID(id);
-		request->setData(active);
+		for (const auto &data : active) {
+			if (!details.empty())
+				details += ", ";
 
-		try {
-			m_connector->send(request);
+			details += data.deviceID().toString();
+			details += " (" + to_string(data.size()) + ")";
 		}
-		BEEEON_CATCH_CHAIN_ACTION(logger(),
-			m_stopControl.waitStoppable(m_sendFailedDelay);
-			continue)
-			
 
-		bool acked = false;
+		logger().trace(
+			"exporting values: " + details,
+			__FILE__, __LINE__);
+	}
 
-		while (!acked && run) {
-			m_event.wait();
+	{
+		FastMutex::ScopedLock guard(m_sentLock);
+		m_sent[id] = {Clock{}, Clock{}, ++m_exported, active.size(), requested};
+	}
 
-			FastMutex::ScopedLock guard(m_ackedLock);
-			acked = m_acked.find(id) != m_acked.end();
-			m_acked.clear();
+	try {
+		m_connector->send(request);
+	}
+	BEEEON_CATCH_CHAIN_ACTION(logger(),
+		{
+			FastMutex::ScopedLock guard(m_sentLock);
+			m_sent.erase(id);
 		}
+		reset(id);
+		m_stopControl.waitStoppable(m_sendFailedDelay);
+		return false)
 
-		if (acked)
-			ack();
+	return true;
+}
+
+void GWSQueuingExporter::ackConfirmed()
+{
+	map<GlobalID, Clock> confirmed;
+
+	{
+		FastMutex::ScopedLock guard(m_ackedLock);
+		confirmed.swap(m_acked);
+	}
+
+	{
+		FastMutex::ScopedLock guard(m_sentLock);
+
+		for (const auto &pair : confirmed) {
+			auto sent = m_sent.find(pair.first);
+			if (sent == m_sent.end())
+				continue;
+
+			if (m_batchMode == BATCH_ADAPTIVE) {
+				adaptBatchSize(
+					sent->second.count,
+					sent->second.requested,
+					pair.second - sent->second.transmitted,
+					sent->second.sequence);
+			}
+
+			m_sent.erase(sent);
+		}
+
+		pruneSent();
+	}
+
+	for (const auto &pair : confirmed) {
+		const GlobalID &id = pair.first;
+
+		if (!ack(id))
+			continue;
 
 		if (logger().debug()) {
 			logger().debug(
-				"recent request " + id.toString() + " has been acked",
+				"request " + id.toString() + " has been acked",
 				__FILE__, __LINE__);
 		}
 	}
+}
 
-	logger().information("GWS queuing exporter has stopped");
+void GWSQueuingExporter::pruneSent()
+{
+	const Timespan maxAge = m_latencyTarget.totalMicroseconds() * MAX_UNCONFIRMED_LATENCY;
+
+	for (auto it = m_sent.begin(); it != m_sent.end();) {
+		if (!it->second.at.isElapsed(maxAge.totalMicroseconds())) {
+			++it;
+			continue;
+		}
+
+		logger().warning(
+			"request " + it->first.toString()
+			+ " has not been confirmed for "
+			+ DateTimeFormatter::format(maxAge),
+			__FILE__, __LINE__);
+
+		if (m_batchMode == BATCH_ADAPTIVE) {
+			adaptBatchSize(
+				it->second.count,
+				it->second.requested,
+				it->second.transmitted.elapsed(),
+				it->second.sequence);
+		}
+
+		it = m_sent.erase(it);
+	}
 }
 
 void GWSQueuingExporter::stop()
@@ -136,12 +361,24 @@ void GWSQueuingExporter::onConnected(const Address &)
 	m_stopControl.requestWakeup();
 }
 
+void GWSQueuingExporter::onSent(const GWMessage::Ptr message)
+{
+	if (message.cast<GWSensorDataExport>().isNull())
+		return;
+
+	FastMutex::ScopedLock guard(m_sentLock);
+
+	auto it = m_sent.find(message->id());
+	if (it != m_sent.end())
+		it->second.transmitted.update();
+}
+
 void GWSQueuingExporter::onOther(const GWMessage::Ptr message)
 {
 	if (message.cast<GWSensorDataConfirm>().isNull())
 		return;
 
 	FastMutex::ScopedLock guard(m_ackedLock);
-	m_acked.emplace(message->id());
+	m_acked.emplace(message->id(), Clock{});
 	m_event.set();
 }
@@ -1,7 +1,9 @@
 #pragma once
 
-#include <set>
+#include <map>
+#include <string>
 
+#include <Poco/Clock.h>
 #include <Poco/Event.h>
 #include <Poco/Mutex.h>
 #include <Poco/Timespan.h>
@@ -15,17 +17,34 @@
 namespace BeeeOn {
 
 /**
- * @brief GWSQueuingExporter implements stop-and-go exporting logic based
+ * @brief GWSQueuingExporter implements sliding-window exporting logic based
  * on the QueuingExporter. The GWSQueuingExporter is to be explicitly
  * registered as a GWSListener to a selected GWSConnector instance.
  * The same GWSConnector instance should then be used for sending
  * of messages.
  *
  * GWSQueuingExporter exports data in batches (of size activeCount).
- * Each batch must be first confirmed from the Gateway Server before
- * another one is sent. This provides better reliablity and allows
- * to prevent data losses related to connection or power issues
- * (when the right QueuingStrategy is used).
+ * At most windowSize batches can be sent without being confirmed
+ * from the Gateway Server. The batches can be confirmed in any order,
+ * a confirmation releases only data of the confirmed batch. This provides
+ * better reliablity and allows to prevent data losses related to connection
+ * or power issues (when the right QueuingStrategy is used). Setting
+ * windowSize to 1 leads to the stop-and-wait behaviour.
+ *
+ * In the adaptive batch mode, the activeCount is just the initial batch
+ * size. The batch size is then adapted in the AIMD manner based on latency
+ * of confirmations: it is incremented by one after each confirmed full batch
+ * and halved whenever a confirmation takes longer than the latencyTarget.
+ * The latency is measured since the batch has been actually sent by the
+ * connector (its last attempt), so time spent in the connector queues
+ * is not counted. Batches exported before the last decrease belong to
+ * the same window, their late confirmations do not decrease the batch size
+ * again. A batch not confirmed within 8 times the latencyTarget is
+ * considered as confirmed too late and it is not tracked anymore.
+ * Moreover, the batch size is limited by the maxMessageSize: a batch whose
+ * serialized form would exceed it is released and acquired again smaller.
+ * The serialized size per SensorData observed last is used to avoid such
+ * oversized batches in advance.
  */
 class GWSQueuingExporter :
 	public QueuingExporter,
@@ -34,6 +53,11 @@ class GWSQueuingExporter :
 public:
 	typedef Poco::SharedPtr<GWSQueuingExporter> Ptr;
 
+	enum BatchMode {
+		BATCH_FIXED,
+		BATCH_ADAPTIVE,
+	};
+
 	GWSQueuingExporter();
 
 	/**
@@ -43,6 +67,40 @@ public:
 	 */
 	void setActiveCount(int count);
 
+	/**
+	 * @brief Configure batch mode: fixed (activeCount is always used)
+	 * or adaptive.
+	 */
+	void setBatchMode(const std::string &mode);
+
+	/**
+	 * @brief Configure upper bound of the batch size in the adaptive mode.
+	 */
+	void setMaxActiveCount(int count);
+
+	/**
+	 * @brief Configure maximal size of a serialized GWSensorDataExport
+	 * in the adaptive mode. It should be the same as of the connector.
+	 */
+	void setMaxMessageSize(int size);
+
+	/**
+	 * @brief Configure latency of confirmations that leads to
+	 * decreasing of the batch size in the adaptive mode.
+	 */
+	void setLatencyTarget(const Poco::Timespan &target);
+
+	/**
+	 * @returns count of SensorData to be acquired for the next batch
+	 */
+	size_t batchSize() const;
+
+	/**
+	 * @brief Configure how many GWSensorDataExport messages can be
+	 * sent without waiting for their confirmation.
+	 */
+	void setWindowSize(int size);
+
 	/**
 	 * @brief Configure how long to wait until the QueuingExporter::acquire()
 	 * operation returns a result. Tweaking the timeout an the activeCount
@@ -67,6 +125,12 @@ public:
 	 */
 	void onConnected(const Address &address) override;
 
+	/**
+	 * @brief Record time of sending of an exported batch to measure
+	 * latency of its confirmation.
+	 */
+	void onSent(const GWMessage::Ptr message) override;
+
 	/**
 	 * @brief Receive GWSensorDataConfirm messages via this method.
 	 */
@@ -74,15 +138,76 @@ public:
 
 	void run() override;
 	void stop() override;
-	
+
+protected:
+	/**
+	 * @brief Acknowledge all batches that has been confirmed
+	 * since the last call.
+	 */
+	void ackConfirmed();
+
+	/**
+	 * @brief Acquire a new batch and send it via the connector.
+	 * @returns false if there was nothing to send
+	 */
+	bool exportBatch();
+
+	/**
+	 * @brief Adapt the batch size after a batch of the given count
+	 * of SensorData (acquired for the given requested count) has been
+	 * confirmed after the given latency. The sequence denotes order
+	 * of the batch among exported batches, batches exported before
+	 * the last decrease never decrease the batch size.
+	 */
+	void adaptBatchSize(
+		size_t count,
+		size_t requested,
+		const Poco::Timespan &latency,
+		uint64_t sequence);
+
+	/**
+	 * @brief Stop tracking of batches that have not been confirmed
+	 * for too long and consider them as confirmed too late.
+	 * Must be called with m_sentLock held.
+	 */
+	void pruneSent();
+
+	/**
+	 * @brief Record serialized size of a batch of the given count
+	 * of SensorData.
+	 */
+	void updateBytesPerData(size_t bytes, size_t count);
+
 private:
+	/**
+	 * @brief Batch sent but not confirmed yet.
+	 */
+	struct Sent {
+		Poco::Clock at;
+		Poco::Clock transmitted;
+		uint64_t sequence;
+		size_t count;
+		size_t requested;
+	};
+
 	size_t m_activeCount;
+	BatchMode m_batchMode;
+	size_t m_maxActiveCount;
+	size_t m_maxMessageSize;
+	Poco::Timespan m_latencyTarget;
+	size_t m_batchSize;
+	size_t m_bytesPerData;
+	uint64_t m_exported;
+	uint64_t m_decreaseBarrier;
+	std::map<GlobalID, Sent> m_sent;
+	Poco::FastMutex m_sentLock;
+	size_t m_windowSize;
 	Poco::Timespan m_acquireTimeout;
 	Poco::Timespan m_sendFailedDelay;
 	GWSConnector::Ptr m_connector;
 	StopControl m_stopControl;
 	Poco::Event m_event;
-	std::set<GlobalID> m_acked;
+	std::map<GlobalID, Poco::Clock> m_acked;
 	Poco::FastMutex m_ackedLock;
 };
 
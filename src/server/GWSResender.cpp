@@ -12,14 +12,54 @@ BEEEON_OBJECT_CASTABLE(StoppableRunnable)
 BEEEON_OBJECT_CASTABLE(GWSListener)
 BEEEON_OBJECT_PROPERTY("connector", &GWSResender::setConnector)
 BEEEON_OBJECT_PROPERTY("resendTimeout", &GWSResender::setResendTimeout)
+BEEEON_OBJECT_PROPERTY("adaptive", &GWSResender::setAdaptive)
+BEEEON_OBJECT_PROPERTY("minResendTimeout", &GWSResender::setMinResendTimeout)
+BEEEON_OBJECT_PROPERTY("maxResendTimeout", &GWSResender::setMaxResendTimeout)
+BEEEON_OBJECT_PROPERTY("flushInterval", &GWSResender::setFlushInterval)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &GWSResender::setMetricsRegistry)
 BEEEON_OBJECT_END(BeeeOn, GWSResender)
 
 using namespace std;
 using namespace Poco;
 using namespace BeeeOn;
 
+/**
+ * Lower bound of the RTT variance part of the RTO to deal with
+ * granularity of the measurement.
+ */
+static const Timespan RTO_GRANULARITY = 10 * Timespan::MILLISECONDS;
+
+void GWSResender::RTTEstimator::update(const Timespan &rtt)
+{
+	if (!valid) {
+		srtt = rtt;
+		rttvar = rtt.totalMicroseconds() / 2;
+		valid = true;
+		return;
+	}
+
+	const Timespan::TimeDiff diff = srtt > rtt
+		? (srtt - rtt).totalMicroseconds()
+		: (rtt - srtt).totalMicroseconds();
+
+	rttvar = (3 * rttvar.totalMicroseconds() + diff) / 4;
+	srtt = (7 * srtt.totalMicroseconds() + rtt.totalMicroseconds()) / 8;
+}
+
+Timespan GWSResender::RTTEstimator::rto() const
+{
+	return srtt + max(RTO_GRANULARITY, Timespan(4 * rttvar.totalMicroseconds()));
+}
+
 GWSResender::GWSResender():
-	m_resendTimeout(10 * Timespan::SECONDS)
+	m_resendTimeout(10 * Timespan::SECONDS),
+	m_adaptive(false),
+	m_minResendTimeout(1 * Timespan::SECONDS),
+	m_maxResendTimeout(5 * Timespan::MINUTES),
+	m_flushInterval(100 * Timespan::MILLISECONDS),
+	m_connected(true),
+	m_pacing(false),
+	m_resent(MetricsRegistry::createCounter())
 {
 }
 
@@ -36,6 +76,116 @@ void GWSResender::setResendTimeout(const Timespan &timeout)
 	m_resendTimeout = timeout;
 }
 
+void GWSResender::setAdaptive(bool adaptive)
+{
+	m_adaptive = adaptive;
+}
+
+void GWSResender::setMinResendTimeout(const Timespan &timeout)
+{
+	if (timeout <= 0)
+		throw InvalidArgumentException("minResendTimeout must be positive");
+
+	m_minResendTimeout = timeout;
+}
+
+void GWSResender::setMaxResendTimeout(const Timespan &timeout)
+{
+	if (timeout <= 0)
+		throw InvalidArgumentException("maxResendTimeout must be positive");
+
+	m_maxResendTimeout = timeout;
+}
+
+void GWSResender::setFlushInterval(const Timespan &interval)
+{
+	if (interval < 0)
+		throw InvalidArgumentException("flushInterval must not be negative");
+
+	m_flushInterval = interval;
+}
+
+void GWSResender::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	m_metricsRegistry = registry;
+	m_rtt.clear();
+
+	m_resent = registry->counter(
+		"beeeon_gws_resent_total",
+		"Messages resent to the remote server");
+}
+
+Timespan GWSResender::resendTimeoutOf(const string &type) const
+{
+	FastMutex::ScopedLock guard(m_lock);
+	return timeoutFor(type, 0);
+}
+
+Timespan GWSResender::timeoutFor(
+		const string &type,
+		unsigned int resends) const
+{
+	if (!m_adaptive)
+		return m_resendTimeout;
+
+	Timespan timeout = m_resendTimeout;
+
+	auto it = m_estimators.find(type);
+	if (it != m_estimators.end() && it->second.valid)
+		timeout = it->second.rto();
+
+	timeout = max(timeout, m_minResendTimeout);
+	timeout = min(timeout, m_maxResendTimeout);
+
+	for (unsigned int i = 0; i < resends && timeout < m_maxResendTimeout; ++i)
+		timeout = min(Timespan(2 * timeout.totalMicroseconds()), m_maxResendTimeout);
+
+	return timeout;
+}
+
+MetricsRegistry::Histogram::Ptr GWSResender::rttHistogram(const string &type)
+{
+	auto it = m_rtt.find(type);
+	if (it != m_rtt.end())
+		return it->second;
+
+	MetricsRegistry::Histogram::Ptr histogram;
+
+	if (m_metricsRegistry.isNull()) {
+		histogram = MetricsRegistry::createHistogram();
+	}
+	else {
+		histogram = m_metricsRegistry->histogram(
+			"beeeon_gws_rtt_seconds",
+			"Round-trip time of messages until response, ack or confirmation",
+			{{"type", type}});
+	}
+
+	m_rtt.emplace(type, histogram);
+	return histogram;
+}
+
+void GWSResender::delivered(const GlobalID &id)
+{
+	auto it = m_attempts.find(id);
+	if (it == m_attempts.end())
+		return;
+
+	const Attempt &attempt = it->second;
+
+	// RTT of a resent message is ambiguous (Karn's algorithm)
+	if (attempt.resends == 0) {
+		const Timespan rtt = attempt.since.elapsed();
+
+		rttHistogram(attempt.type)->observe(rtt);
+		m_estimators[attempt.type].update(rtt);
+	}
+
+	m_attempts.erase(it);
+}
+
 void GWSResender::run()
 {
 	StopControl::Run run(m_stopControl);
@@ -45,7 +195,7 @@ void GWSResender::run()
 	while (run) {
 		ScopedLockWithUnlock<FastMutex> guard(m_lock);
 
-		if (m_waiting.empty()) {
+		if (m_waiting.empty() || !m_connected) {
 			guard.unlock();
 			m_event.wait();
 			continue;
@@ -55,7 +205,7 @@ void GWSResender::run()
 		const auto current = resendOrGet(now);
 
 		if (current != m_waiting.end()) {
-			Timespan delay = current->first - now;
+			Timespan delay = pacedAt(current->first) - now;
 			if (delay < 1 * Timespan::MILLISECONDS)
 				delay = 1 * Timespan::MILLISECONDS;
 
@@ -84,7 +234,13 @@ GWSResender::WaitingList::const_iterator GWSResender::resendOrGet(const Clock &n
 {
 	const auto it = m_waiting.begin();
 
-	if (it == m_waiting.end() || it->first > now)
+	if (it == m_waiting.end())
+		return it;
+
+	if (m_pacing && it->first > now)
+		m_pacing = false; // nothing is overdue, the flush is over
+
+	if (pacedAt(it->first) > now)
 		return it;
 
 	GWMessage::Ptr message = it->second;
@@ -98,6 +254,17 @@ GWSResender::WaitingList::const_iterator GWSResender::resendOrGet(const Clock &n
 	m_refs.erase(it->second->id());
 	m_waiting.erase(it);
 
+	auto attempt = m_attempts.find(message->id());
+	if (attempt != m_attempts.end())
+		attempt->second.resends += 1;
+
+	m_resent->add();
+
+	if (m_pacing) {
+		m_nextResend = now;
+		m_nextResend += m_flushInterval.totalMicroseconds();
+	}
+
 	try {
 		m_connector->send(message);
 	}
@@ -111,10 +278,50 @@ GWSResender::WaitingList &GWSResender::waiting()
 	return m_waiting;
 }
 
+Clock GWSResender::pacedAt(const Clock &at) const
+{
+	if (!m_pacing)
+		return at;
+
+	return max(at, m_nextResend);
+}
+
+void GWSResender::onDisconnected(const Address &)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	if (m_connected)
+		logger().information("pausing resends while disconnected", __FILE__, __LINE__);
+
+	m_connected = false;
+}
+
+void GWSResender::onConnected(const Address &)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	if (!m_connected) {
+		m_connected = true;
+		m_pacing = m_flushInterval > 0;
+		m_nextResend.update();
+
+		if (logger().debug()) {
+			logger().debug(
+				"resuming " + to_string(m_waiting.size()) + " resends",
+				__FILE__, __LINE__);
+		}
+	}
+
+	m_event.set();
+}
+
 void GWSResender::onTrySend(const GWMessage::Ptr message)
 {
 	FastMutex::ScopedLock guard(m_lock);
 	m_pending.emplace(message->id());
+
+	if (resendable(message) && m_attempts.find(message->id()) == m_attempts.end())
+		m_attempts.emplace(message->id(), Attempt{message->type().toString(), {}, 0});
 }
 
 void GWSResender::onSent(const GWMessage::Ptr message)
@@ -169,15 +376,20 @@ void GWSResender::onSent(const GWMessage::Ptr message)
 		return;
 	}
 
+	const auto attempt = m_attempts.find(message->id());
+	const Timespan timeout = attempt == m_attempts.end()
+		? timeoutFor(message->type().toString(), 0)
+		: timeoutFor(attempt->second.type, attempt->second.resends);
+
 	if (logger().debug()) {
 		logger().debug(
 			"schedule resend of " + message->toBriefString()
-			+ " in " + DateTimeFormatter::format(m_resendTimeout),
+			+ " in " + DateTimeFormatter::format(timeout),
 			__FILE__, __LINE__);
 	}
 
 	Clock at;
-	at += m_resendTimeout.totalMicroseconds();
+	at += timeout.totalMicroseconds();
 
 	auto result = m_waiting.emplace(at, message);
 	m_refs.emplace(message->id(), result);
@@ -205,8 +417,10 @@ void GWSResender::onAck(const GWAck::Ptr ack)
 	m_pending.erase(ack->id());
 
 	auto it = m_refs.find(ack->id());
-	if (it == m_refs.end())
+	if (it == m_refs.end()) {
+		delivered(ack->id());
 		return;
+	}
 
 	GWResponse::Ptr response = it->second->second.cast<GWResponse>();
 	if (response.isNull()) {
@@ -237,6 +451,7 @@ void GWSResender::onAck(const GWAck::Ptr ack)
 			__FILE__, __LINE__);
 	}
 
+	delivered(ack->id());
 	m_waiting.erase(it->second);
 	m_refs.erase(it);
 }
@@ -268,6 +483,7 @@ void GWSResender::findAndDrop(const GWMessage::Ptr message)
 	FastMutex::ScopedLock guard(m_lock);
 
 	m_pending.erase(message->id());
+	delivered(message->id());
 
 	auto it = m_refs.find(message->id());
 	if (it == m_refs.end())
@@ -2,12 +2,14 @@
 
 #include <map>
 #include <set>
+#include <string>
 
 #include <Poco/Clock.h>
 #include <Poco/Event.h>
 #include <Poco/Mutex.h>
 #include <Poco/Timespan.h>
 
+#include "core/MetricsRegistry.h"
 #include "loop/StoppableRunnable.h"
 #include "loop/StopControl.h"
 #include "server/GWSConnector.h"
@@ -26,6 +28,18 @@ namespace BeeeOn {
  * If a message of an existing ID is to be resent, it replaces the previous
  * message of the same ID scheduled for resent. Thus, only the most recent
  * message of the same ID is always scheduled.
+ *
+ * The round-trip time (RTT) of each message (from sending until its
+ * response, ack or confirmation) is measured per message type. When
+ * the adaptive mode is enabled, the resend timeout (RTO) of each type
+ * is computed from the smoothed RTT and its variance (as TCP does, see
+ * RFC 6298) and it is doubled for each resend of the same message up
+ * to the maxResendTimeout. Samples of resent messages are ambiguous and
+ * thus not used for the RTO (Karn's algorithm).
+ *
+ * No messages are resent while the connection is down. After reconnecting,
+ * messages that became due meanwhile are resent one by one with at least
+ * the flushInterval between them to avoid bursts.
  */
 class GWSResender :
 	public StoppableRunnable,
@@ -41,12 +55,58 @@ public:
 	 */
 	void setResendTimeout(const Poco::Timespan &timeout);
 
+	/**
+	 * @brief Enable the adaptive mode, i.e. computing of resend timeouts
+	 * from the measured RTT and exponential backoff of repeated resends.
+	 * Otherwise, the resendTimeout is always used.
+	 */
+	void setAdaptive(bool adaptive);
+
+	/**
+	 * @brief Configure lower bound of the computed resend timeout.
+	 */
+	void setMinResendTimeout(const Poco::Timespan &timeout);
+
+	/**
+	 * @brief Configure upper bound of the computed resend timeout
+	 * including the backoff.
+	 */
+	void setMaxResendTimeout(const Poco::Timespan &timeout);
+
+	/**
+	 * @brief Configure minimal delay between resends of messages that
+	 * became due while being disconnected.
+	 */
+	void setFlushInterval(const Poco::Timespan &interval);
+
+	/**
+	 * @brief Publish RTT histograms (labeled by message type) and count
+	 * of resent messages in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	/**
+	 * @returns resend timeout of the first send of a message of the given
+	 * type, i.e. the current RTO in the adaptive mode.
+	 */
+	Poco::Timespan resendTimeoutOf(const std::string &type) const;
+
 	/**
 	 * @brief Implement scheduler of the waiting messages.
 	 */
 	void run() override;
 	void stop() override;
 
+	/**
+	 * @brief Pause resending while being disconnected.
+	 */
+	void onDisconnected(const Address &address) override;
+
+	/**
+	 * @brief Resume resending paced by the flushInterval.
+	 */
+	void onConnected(const Address &address) override;
+
 	void onTrySend(const GWMessage::Ptr message) override;
 
 	/**
@@ -70,6 +130,28 @@ public:
 protected:
 	typedef std::multimap<Poco::Clock, GWMessage::Ptr> WaitingList;
 
+	/**
+	 * @brief Estimator of the resend timeout based on smoothed
+	 * RTT and its variance.
+	 */
+	struct RTTEstimator {
+		Poco::Timespan srtt = 0;
+		Poco::Timespan rttvar = 0;
+		bool valid = false;
+
+		void update(const Poco::Timespan &rtt);
+		Poco::Timespan rto() const;
+	};
+
+	/**
+	 * @brief State of a message being delivered.
+	 */
+	struct Attempt {
+		std::string type;
+		Poco::Clock since;
+		unsigned int resends = 0;
+	};
+
 	/**
 	 * @brief Resend the oldest message waiting for resend
 	 * if its timeout has expired.
@@ -82,6 +164,31 @@ protected:
 	 */
 	WaitingList &waiting();
 
+	/**
+	 * @returns when the message scheduled at the given time can be resent
+	 * with respect to pacing of the flush after reconnect
+	 */
+	Poco::Clock pacedAt(const Poco::Clock &at) const;
+
+	/**
+	 * @returns timeout after which the given message is to be resent
+	 * if it has already been resent the given number of times
+	 */
+	Poco::Timespan timeoutFor(
+		const std::string &type,
+		unsigned int resends) const;
+
+	/**
+	 * @brief Record the message of the given ID as delivered and
+	 * account its RTT unless it has been resent.
+	 */
+	void delivered(const GlobalID &id);
+
+	/**
+	 * @returns histogram of RTT for the given message type
+	 */
+	MetricsRegistry::Histogram::Ptr rttHistogram(const std::string &type);
+
 	/**
 	 * @brief Certain messages should be resended when there
 	 * is no response/ack during the resendTimeout period.
@@ -102,12 +209,24 @@ protected:
 private:
 	GWSConnector::Ptr m_connector;
 	Poco::Timespan m_resendTimeout;
+	bool m_adaptive;
+	Poco::Timespan m_minResendTimeout;
+	Poco::Timespan m_maxResendTimeout;
+	Poco::Timespan m_flushInterval;
 	WaitingList m_waiting;
 	std::map<GlobalID, WaitingList::iterator> m_refs;
 	std::set<GlobalID> m_pending;
+	std::map<GlobalID, Attempt> m_attempts;
+	std::map<std::string, RTTEstimator> m_estimators;
+	bool m_connected;
+	bool m_pacing;
+	Poco::Clock m_nextResend;
+	MetricsRegistry::Ptr m_metricsRegistry;
+	std::map<std::string, MetricsRegistry::Histogram::Ptr> m_rtt;
+	MetricsRegistry::Counter::Ptr m_resent;
 	StopControl m_stopControl;
 	Poco::Event m_event;
-	Poco::FastMutex m_lock;
+	mutable Poco::FastMutex m_lock;
 };
 
 }
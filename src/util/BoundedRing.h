@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include <Poco/Exception.h>
+
+namespace BeeeOn {
+
+/**
+ * @brief BoundedRing is a lock-free bounded queue based on a ring
+ * of cells where each cell carries a sequence number telling whether
+ * it is ready for writing or for reading (Vyukov's bounded queue).
+ *
+ * Any number of threads can push() and pop() concurrently. The
+ * drain() operation takes a whole batch of items at once by a single
+ * update of the head. Producers can thus implement drop-oldest
+ * semantics by calling pop() while a single consumer drains batches.
+ */
+template <typename T>
+class BoundedRing {
+public:
+	BoundedRing(size_t capacity):
+		m_capacity(capacity),
+		m_cells(new Cell[capacity]),
+		m_head(0),
+		m_tail(0)
+	{
+		if (capacity == 0)
+			throw Poco::InvalidArgumentException("ring capacity must be positive");
+
+		for (size_t i = 0; i < capacity; ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	BoundedRing(const BoundedRing &) = delete;
+	BoundedRing &operator =(const BoundedRing &) = delete;
+
+	size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+	/**
+	 * @returns approximate count of items in the ring.
+	 */
+	size_t size() const
+	{
+		const size_t head = m_head.load(std::memory_order_acquire);
+		const size_t tail = m_tail.load(std::memory_order_acquire);
+
+		return tail > head ? tail - head : 0;
+	}
+
+	/**
+	 * @returns true if there is no item ready for reading.
+	 */
+	bool empty() const
+	{
+		const size_t pos = m_head.load(std::memory_order_acquire);
+		const Cell &cell = m_cells[pos % m_capacity];
+
+		return cell.sequence.load(std::memory_order_acquire) != pos + 1;
+	}
+
+	/**
+	 * @brief Append the given item at the end of the ring.
+	 * @returns false if the ring is full
+	 */
+	bool push(const T &item)
+	{
+		size_t pos = m_tail.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &m_cells[pos % m_capacity];
+
+			const size_t seq = cell->sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+
+			if (diff == 0) {
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->item = item;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Remove the oldest item from the ring.
+	 * @returns false if the ring is empty
+	 */
+	bool pop(T &item)
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		Cell *cell;
+
+		for (;;) {
+			cell = &m_cells[pos % m_capacity];
+
+			const size_t seq = cell->sequence.load(std::memory_order_acquire);
+			const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+
+			if (diff == 0) {
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = m_head.load(std::memory_order_relaxed);
+			}
+		}
+
+		item = std::move(cell->item);
+		cell->sequence.store(pos + m_capacity, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Remove up to count oldest items from the ring at once
+	 * and append them to the given container (via emplace_back()).
+	 * @returns number of removed items
+	 */
+	template <typename Container>
+	size_t drain(Container &items, size_t count)
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+
+		for (;;) {
+			size_t ready = 0;
+
+			while (ready < count && ready < m_capacity) {
+				const Cell &cell = m_cells[(pos + ready) % m_capacity];
+
+				if (cell.sequence.load(std::memory_order_acquire) != pos + ready + 1)
+					break;
+
+				ready += 1;
+			}
+
+			if (ready == 0)
+				return 0;
+
+			if (m_head.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+				for (size_t i = 0; i < ready; ++i) {
+					Cell &cell = m_cells[(pos + i) % m_capacity];
+
+					items.emplace_back(std::move(cell.item));
+					cell.sequence.store(pos + i + m_capacity, std::memory_order_release);
+				}
+
+				return ready;
+			}
+		}
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	/**
+	 * Head and tail are updated by different threads, keep them
+	 * in separate cache lines.
+	 */
+	static const size_t CACHE_LINE = 64;
+
+	const size_t m_capacity;
+	std::unique_ptr<Cell[]> m_cells;
+	char m_pad0[CACHE_LINE];
+	std::atomic<size_t> m_head;
+	char m_pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> m_tail;
+	char m_pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
+
+}
@@ -26,17 +26,32 @@ CSVSensorDataFormatter::CSVSensorDataFormatter() :
 
 string CSVSensorDataFormatter::format(const SensorData &data)
 {
-	string output = "";
-	string device = data.deviceID().toString();
-	string timestamp = to_string(data.timestamp().value().epochTime());
-
-	for (auto item : data) {
-		if (!output.empty())
-			output += '\n';
-		output += "sensor" + separator() + timestamp + separator() + device + separator();
-		output += item.moduleID().toString() + separator();
-		output += NumberFormatter::format(item.value(), PRECISION_OF_VALUE) + separator();
-	}
-
+	string output;
+	formatTo(data, output);
 	return output;
 }
+
+void CSVSensorDataFormatter::formatTo(const SensorData &data, string &buffer)
+{
+	const string device = data.deviceID().toString();
+	const time_t timestamp = data.timestamp().value().epochTime();
+	bool first = true;
+
+	for (const auto &item : data) {
+		if (!first)
+			buffer += '\n';
+
+		first = false;
+
+		buffer += "sensor";
+		buffer += m_separator;
+		NumberFormatter::append(buffer, Int64(timestamp));
+		buffer += m_separator;
+		buffer += device;
+		buffer += m_separator;
+		NumberFormatter::append(buffer, item.moduleID().value());
+		buffer += m_separator;
+		NumberFormatter::append(buffer, item.value(), PRECISION_OF_VALUE);
+		buffer += m_separator;
+	}
+}
@@ -20,6 +20,7 @@ public:
 	 * <pre>sensor;1488879656;0x499602d2;5;4.200000;</pre>
 	 */
 	std::string format(const SensorData &data) override;
+	void formatTo(const SensorData &data, std::string &buffer) override;
 
 	/**
 	 * Optional custom separator
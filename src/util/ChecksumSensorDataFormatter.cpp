@@ -37,11 +37,26 @@ void ChecksumSensorDataFormatter::setFormatter(SensorDataFormatter::Ptr formatte
 
 string ChecksumSensorDataFormatter::format(const SensorData &data)
 {
-	Checksum csum(Checksum::TYPE_CRC32);
+	string output;
+	formatTo(data, output);
+	return output;
+}
+
+void ChecksumSensorDataFormatter::formatTo(const SensorData &data, string &buffer)
+{
+	const size_t start = buffer.size();
 
-	const auto &content = m_formatter->format(data);
-	csum.update(content);
+	buffer.append(8, '0');
+	buffer += m_delimiter;
+
+	const size_t content = buffer.size();
+	m_formatter->formatTo(data, buffer);
+
+	Checksum csum(Checksum::TYPE_CRC32);
+	csum.update(buffer.data() + content, buffer.size() - content);
 
-	return NumberFormatter::formatHex(csum.checksum(), 8)
-		+ m_delimiter + content;
+	// fits into the small string buffer, no allocation
+	string hex;
+	NumberFormatter::appendHex(hex, csum.checksum(), 8);
+	buffer.replace(start, 8, hex);
 }
@@ -33,6 +33,14 @@ public:
 	 */
 	std::string format(const SensorData &data) override;
 
+	/**
+	 * @brief Append the checksum, delimiter and data formatted by
+	 * the wrapped formatter to the buffer. The wrapped formatter
+	 * appends directly into the buffer and the checksum is filled
+	 * in afterwards.
+	 */
+	void formatTo(const SensorData &data, std::string &buffer) override;
+
 private:
 	std::string m_delimiter;
 	SensorDataFormatter::Ptr m_formatter;
@@ -1,10 +1,8 @@
-#include <iomanip>
-#include <sstream>
+#include <cmath>
+#include <cstdio>
 #include <string>
 
-#include <Poco/JSON/PrintHandler.h>
-#include <Poco/NumberFormatter.h>
-#include <Poco/Timestamp.h>
+#include <Poco/Types.h>
 
 #include "di/Injectable.h"
 #include "model/SensorData.h"
@@ -15,48 +13,100 @@ BEEEON_OBJECT_CASTABLE(SensorDataFormatter)
 BEEEON_OBJECT_END(BeeeOn, JSONSensorDataFormatter)
 
 using namespace BeeeOn;
-using namespace Poco::JSON;
 using namespace Poco;
 using namespace std;
 
+static void appendUnsigned(string &buffer, UInt64 value)
+{
+	char digits[20];
+	size_t count = 0;
+
+	do {
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	while (count > 0)
+		buffer += digits[--count];
+}
+
+/**
+ * Append the given ID in the same form as DeviceID::toString(),
+ * i.e. lowercase hexadecimal with the 0x prefix and without
+ * leading zeros.
+ */
+static void appendHex(string &buffer, UInt64 value)
+{
+	static const char HEX[] = "0123456789abcdef";
+	char digits[16];
+	size_t count = 0;
+
+	do {
+		digits[count++] = HEX[value & 0xf];
+		value >>= 4;
+	} while (value > 0);
+
+	buffer += "0x";
+
+	while (count > 0)
+		buffer += digits[--count];
+}
+
+/**
+ * Append the value with precision of 3 decimal digits in the fixed
+ * notation as printed by a std::ostream with std::ios::fixed.
+ */
+static void appendFixed(string &buffer, double value)
+{
+	// enough for the longest fixed representation of a double
+	char digits[320];
+
+	const int length = snprintf(digits, sizeof(digits), "%.3f", value);
+	if (length > 0)
+		buffer.append(digits, length);
+}
+
 JSONSensorDataFormatter::JSONSensorDataFormatter()
 {
 }
 
 string JSONSensorDataFormatter::format(const SensorData &data)
 {
-	stringstream output;
-	output.setf(ios::fixed);
-	output.precision(3);
-	PrintHandler json(output);
+	string output;
+	formatTo(data, output);
+	return output;
+}
+
+void JSONSensorDataFormatter::formatTo(const SensorData &data, string &buffer)
+{
+	buffer += "{\"device_id\":\"";
+	appendHex(buffer, data.deviceID().data());
+	buffer += "\",\"timestamp\":";
+	appendUnsigned(buffer, (UInt64) data.timestamp().value().epochMicroseconds());
+	buffer += ",\"data\":[";
 
-	json.startObject();
+	bool first = true;
 
-	json.key("device_id");
-	json.value(data.deviceID().toString());
-	json.key("timestamp");
-	json.value((UInt64)data.timestamp().value().epochMicroseconds());
+	for (const auto &item : data) {
+		if (!first)
+			buffer += ',';
 
-	json.key("data");
-	json.startArray();
+		first = false;
 
-	for (auto item : data) {
-		json.startObject();
-		json.key("module_id");
-		json.value(item.moduleID());
+		buffer += "{\"module_id\":";
+		appendUnsigned(buffer, item.moduleID().value());
 
 		if (item.isValid()) {
-			json.key("value");
+			buffer += ",\"value\":";
+
 			if (std::isinf(item.value()) || std::isnan(item.value()))
-				json.null();
+				buffer += "null";
 			else
-				json.value(item.value());
+				appendFixed(buffer, item.value());
 		}
 
-		json.endObject();
+		buffer += '}';
 	}
 
-	json.endArray();
-	json.endObject();
-	return output.str();
+	buffer += "]}";
 }
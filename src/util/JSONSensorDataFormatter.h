@@ -16,6 +16,13 @@ public:
 	 * Convert data from struct SensorData to JSON format
 	 */
 	std::string format(const SensorData &data) override;
+
+	/**
+	 * Append JSON representation of the given data to the buffer.
+	 * Numbers and IDs are serialized directly into the buffer,
+	 * the output is the same as of format().
+	 */
+	void formatTo(const SensorData &data, std::string &buffer) override;
 };
 
 }
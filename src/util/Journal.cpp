@@ -1,6 +1,6 @@
 #include <cerrno>
 #include <functional>
-#include <map>
+#include <unordered_map>
 
 #include <Poco/Checksum.h>
 #include <Poco/Error.h>
@@ -27,7 +27,9 @@ Journal::Journal(
 	m_file(file),
 	m_duplicatesFactor(duplicatesFactor),
 	m_minimalRewriteSize(minimalRewritesSize),
-	m_dirty(false)
+	m_dirty(false),
+	m_committedBytes(0),
+	m_dirtyBytes(0)
 {
 	if (m_duplicatesFactor < 1.0)
 		throw InvalidArgumentException("duplicatesFactor must be at least 1");
@@ -120,6 +122,7 @@ void Journal::load(istream &in, bool recover)
 	m_records.clear();
 	m_records.insert(m_records.end(), records.begin(), records.end());
 	m_dirty.clear();
+	reindex();
 }
 
 void Journal::checkConsistent() const
@@ -181,6 +184,8 @@ void Journal::append(
 	Mutex::ScopedLock guard(m_lock);
 
 	m_dirty.emplace_back(record);
+	m_dirtyBytes += bytes(record);
+	applyLive(record);
 
 	if (flush)
 		this->flush();
@@ -191,6 +196,8 @@ void Journal::appendDrop(const string &key, bool flush)
 	Mutex::ScopedLock guard(m_lock);
 
 	m_dirty.emplace_back(Record{key, OP_DROP});
+	m_dirtyBytes += bytes(m_dirty.back());
+	applyLive(m_dirty.back());
 
 	if (flush)
 		this->flush();
@@ -200,8 +207,6 @@ void Journal::drop(const set<string> &keys, bool flush)
 {
 	Mutex::ScopedLock guard(m_lock);
 
-	list<Record> records = this->records();
-
 	for (auto it = keys.begin(); it != keys.end();) {
 		const auto &key = *it;
 		++it;
@@ -213,7 +218,7 @@ void Journal::flush()
 {
 	Mutex::ScopedLock guard(m_lock);
 
-	const auto factor = duplicatesFactor(m_records);
+	const auto factor = duplicatesFactor();
 
 	if (factor > m_duplicatesFactor && overMinimalSize())
 		interpretAndFlush();
@@ -225,31 +230,26 @@ double Journal::currentDuplicatesFactor() const
 {
 	Mutex::ScopedLock guard(m_lock);
 
-	return duplicatesFactor(m_records);
+	return duplicatesFactor();
 }
 
-double Journal::duplicatesFactor(const list<Record> &records) const
+double Journal::duplicatesFactor() const
 {
-	set<string> unique;
-
-	for (const auto &r : records)
-		unique.emplace(r.key);
-
-	if (unique.size() == 0)
+	if (m_committedKeys.empty())
 		return 1.0;
 
-	return static_cast<double>(records.size())
-		/ static_cast<double>(unique.size());
+	return static_cast<double>(m_records.size())
+		/ static_cast<double>(m_committedKeys.size());
 }
 
 bool Journal::overMinimalSize() const
 {
-	return bytes(m_records) + bytes(m_dirty) > m_minimalRewriteSize;
+	return m_committedBytes + m_dirtyBytes > m_minimalRewriteSize;
 }
 
 void Journal::interpret(list<Record> &records) const
 {
-	map<string, list<Record>::iterator> cache;
+	unordered_map<string, list<Record>::iterator> cache;
 
 	for (auto it = records.begin(); it != records.end();) {
 		if (it->value == OP_DROP) {
@@ -278,8 +278,8 @@ void Journal::interpret(list<Record> &records) const
 void Journal::interpretAndFlush()
 {
 	try {
-		list<Record> records = recordsRaw();
-		interpret(records);
+		// copy as the rewrite replaces the committed records
+		const list<Record> records = m_live;
 		rewriteAndFlush(records);
 	}
 	catch (const WriteFileException &e) {
@@ -308,6 +308,7 @@ void Journal::rewriteAndFlush(const list<Record> &records)
 	m_records.clear();
 	m_records.insert(m_records.end(), records.begin(), records.end());
 	m_dirty.clear();
+	reindex();
 }
 
 void Journal::appendFlush()
@@ -325,39 +326,75 @@ void Journal::appendFlush()
 		handleFailure(fout);
 
 		m_records.emplace_back(*it);
+		countCommitted(*it);
+		m_dirtyBytes -= bytes(*it);
 		it = m_dirty.erase(it);
 	}
 }
 
 list<Journal::Record> Journal::records() const
 {
-	list<Journal::Record> records = recordsRaw();
-	interpret(records);
-
-	return records;
+	Mutex::ScopedLock guard(m_lock);
+	return m_live;
 }
 
 Nullable<string> Journal::operator [](const string &key) const
 {
-	for (const auto &record : records()) {
-		if (record.key == key)
-			return record.value;
-	}
+	Mutex::ScopedLock guard(m_lock);
+
+	auto it = m_liveIndex.find(key);
+	if (it != m_liveIndex.end())
+		return it->second->value;
 
 	Nullable<string> null;
 	return null;
 }
 
-list<Journal::Record> Journal::recordsRaw() const
+void Journal::applyLive(const Record &record)
 {
-	Mutex::ScopedLock guard(m_lock);
+	auto it = m_liveIndex.find(record.key);
+
+	if (record.value == OP_DROP) {
+		if (it != m_liveIndex.end()) {
+			m_live.erase(it->second);
+			m_liveIndex.erase(it);
+		}
+
+		return;
+	}
+
+	if (it != m_liveIndex.end()) {
+		*it->second = record;
+		return;
+	}
+
+	m_live.emplace_back(record);
+	m_liveIndex.emplace(record.key, --m_live.end());
+}
+
+void Journal::countCommitted(const Record &record)
+{
+	m_committedKeys[record.key] += 1;
+	m_committedBytes += bytes(record);
+}
+
+void Journal::reindex()
+{
+	m_live.clear();
+	m_liveIndex.clear();
+	m_committedKeys.clear();
+	m_committedBytes = 0;
+	m_dirtyBytes = 0;
 
-	if (m_dirty.empty())
-		return m_records;
+	for (const auto &record : m_records) {
+		countCommitted(record);
+		applyLive(record);
+	}
 
-	list<Record> records = m_records;
-	records.insert(records.end(), m_dirty.begin(), m_dirty.end());
-	return records;
+	for (const auto &record : m_dirty) {
+		m_dirtyBytes += bytes(record);
+		applyLive(record);
+	}
 }
 
 list<Journal::Record> &Journal::committed()
@@ -467,10 +504,14 @@ size_t Journal::bytes(const list<Record> &records) const
 {
 	size_t bytes = 0;
 
-	for (const auto &one : records) {
-		bytes += format(one, true).size();
-		bytes += 1;
-	}
+	for (const auto &one : records)
+		bytes += Journal::bytes(one);
 
 	return bytes;
 }
+
+size_t Journal::bytes(const Record &record)
+{
+	// zero checksum (8 B), 2x <TAB>, <LF>
+	return 8 + 1 + record.key.size() + 1 + record.value.size() + 1;
+}
@@ -3,6 +3,7 @@
 #include <list>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #include <Poco/File.h>
 #include <Poco/Mutex.h>
@@ -56,6 +57,11 @@ namespace BeeeOn {
  * deduplicates itself (during the flush operation) and writes its shrinked
  * version safely into the storage. The rewrite utilizes the SafeWriter to stay
  * as safe as possible and prevent any or most data loss possibilities.
+ *
+ * The current state of records (the most recent value per key) is maintained
+ * incrementally together with a hash index of live keys. Counters of all and
+ * unique keys and of bytes of the journal are maintained as well. Thus, lookups,
+ * flush decisions and rotations do not need to scan the whole journal.
  */
 class Journal : protected virtual Loggable {
 public:
@@ -194,7 +200,7 @@ public:
 	Poco::Nullable<std::string> operator [](const std::string &key) const;
 
 	/**
-	 * @breif Computes the current duplicates factor of the journal main records
+	 * @breif Returns the current duplicates factor of the journal main records
 	 * (waiting records are not counted).
 	 */
 	double currentDuplicatesFactor() const;
@@ -205,9 +211,8 @@ protected:
 	void appendDrop(const std::string &key, bool flush);
 	void dropInPlace(std::list<Record> &records, const std::string &key) const;
 
-	double duplicatesFactor(const std::list<Record> &records) const;
+	double duplicatesFactor() const;
 	bool overMinimalSize() const;
-	std::list<Record> recordsRaw() const;
 	void interpret(std::list<Record> &records) const;
 	void interpretAndFlush();
 	void appendFlush();
@@ -222,6 +227,24 @@ protected:
 	std::string format(const Record &record, bool zeroSum = false) const;
 	Record parse(const std::string &line, size_t lineno) const;
 	size_t bytes(const std::list<Record> &records) const;
+	static size_t bytes(const Record &record);
+
+	/**
+	 * @brief Apply the record to the current state of records
+	 * as the interpret() would do.
+	 */
+	void applyLive(const Record &record);
+
+	/**
+	 * @brief Count the record as a committed one.
+	 */
+	void countCommitted(const Record &record);
+
+	/**
+	 * @brief Rebuild the current state of records and all counters
+	 * from the committed and dirty records.
+	 */
+	void reindex();
 
 private:
 	mutable Poco::Mutex m_lock;
@@ -230,6 +253,12 @@ private:
 	size_t m_minimalRewriteSize;
 	std::list<Record> m_records;
 	std::list<Record> m_dirty;
+
+	std::list<Record> m_live;
+	std::unordered_map<std::string, std::list<Record>::iterator> m_liveIndex;
+	std::unordered_map<std::string, size_t> m_committedKeys;
+	size_t m_committedBytes;
+	size_t m_dirtyBytes;
 };
 
 }
@@ -0,0 +1,84 @@
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Poco/Error.h>
+#include <Poco/Exception.h>
+
+#include "util/MappedFile.h"
+
+using namespace Poco;
+using namespace BeeeOn;
+
+static void throwFileError(const Path &path, int err)
+{
+	const std::string message = path.toString() + ": " + Error::getMessage(err);
+
+	switch (err) {
+	case ENOENT:
+		throw FileNotFoundException(message, err);
+	case EACCES:
+	case EPERM:
+		throw FileAccessDeniedException(message, err);
+	default:
+		throw ReadFileException(message, err);
+	}
+}
+
+MappedFile::MappedFile(const Path &path):
+	m_data(nullptr),
+	m_size(0)
+{
+	const int fd = ::open(path.toString().c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		throwFileError(path, errno);
+
+	struct stat st;
+	if (::fstat(fd, &st) < 0) {
+		const int err = errno;
+		::close(fd);
+		throwFileError(path, err);
+	}
+
+	if (!S_ISREG(st.st_mode)) {
+		::close(fd);
+		throw ReadFileException(path.toString() + ": not a regular file");
+	}
+
+	if (st.st_size > 0) {
+		void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			const int err = errno;
+			::close(fd);
+			throwFileError(path, err);
+		}
+
+		// records are usually scanned from beginning to end
+		::madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+		m_data = static_cast<const char *>(p);
+		m_size = st.st_size;
+	}
+
+	// the mapping stays valid after closing the file
+	::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data != nullptr)
+		::munmap(const_cast<char *>(m_data), m_size);
+}
+
+const char *MappedFile::data() const
+{
+	return m_data;
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+#include <Poco/Path.h>
+#include <Poco/SharedPtr.h>
+
+namespace BeeeOn {
+
+/**
+ * @brief MappedFile maps contents of a file read-only into memory.
+ * The whole file (as large as it is when opened) is mapped and
+ * the mapping is released when the instance is destroyed.
+ *
+ * The file is expected to be immutable while mapped. Truncating
+ * the file leads to SIGBUS when accessing the truncated part.
+ */
+class MappedFile {
+public:
+	typedef Poco::SharedPtr<MappedFile> Ptr;
+
+	/**
+	 * @throws Poco::FileNotFoundException if the file does not exist
+	 * @throws Poco::FileAccessDeniedException if the file is not readable
+	 * @throws Poco::ReadFileException if the file is not a regular file
+	 * or it cannot be mapped
+	 */
+	MappedFile(const Poco::Path &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator =(const MappedFile &) = delete;
+
+	/**
+	 * @returns pointer to the mapped contents, nullptr for an empty file
+	 */
+	const char *data() const;
+
+	size_t size() const;
+
+private:
+	const char *m_data;
+	size_t m_size;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "util/NullSensorDataFormatter.h"
 #include "util/SensorDataFormatter.h"
 
+using namespace std;
 using namespace BeeeOn;
 
 SensorDataFormatter::SensorDataFormatter()
@@ -10,3 +11,8 @@ SensorDataFormatter::SensorDataFormatter()
 SensorDataFormatter::~SensorDataFormatter()
 {
 }
+
+void SensorDataFormatter::formatTo(const SensorData &data, string &buffer)
+{
+	buffer += format(data);
+}
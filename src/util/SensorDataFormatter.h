@@ -19,6 +19,14 @@ public:
 	 * Convert data from struct SensorData to some formatted text
 	 */
 	virtual std::string format(const SensorData &data) = 0;
+
+	/**
+	 * @brief Append formatted data to the given buffer. It allows to
+	 * reuse a single buffer for many SensorData instances and to chain
+	 * formatters without intermediate copies. The default implementation
+	 * appends result of format().
+	 */
+	virtual void formatTo(const SensorData &data, std::string &buffer);
 };
 
 }
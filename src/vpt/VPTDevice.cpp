@@ -13,7 +13,6 @@
 #include <Poco/String.h>
 
 #include "model/DevicePrefix.h"
-#include "net/HTTPUtil.h"
 #include "util/JsonUtil.h"
 #include "vpt/VPTBoilerModuleType.h"
 #include "vpt/VPTDevice.h"
@@ -114,13 +113,15 @@ VPTDevice::VPTDevice(
 		const Poco::Timespan& pingTimeout,
 		const GatewayID& id,
 		const RefreshTime& refresh,
-		const DeviceCache::Ptr deviceCache):
+		const DeviceCache::Ptr deviceCache,
+		HTTPConnectionPool::Ptr connectionPool):
 	m_address(address),
 	m_refresh(refresh),
 	m_pingTimeout(pingTimeout),
 	m_httpTimeout(httpTimeout),
 	m_gatewayID(id),
-	m_deviceCache(deviceCache)
+	m_deviceCache(deviceCache),
+	m_connectionPool(connectionPool)
 {
 	buildDeviceID();
 }
@@ -564,7 +565,7 @@ HTTPEntireResponse VPTDevice::sendRequest(HTTPRequest& request, const Timespan&
 
 	logger().information("request: " + m_address.toString() + request.getURI(), __FILE__, __LINE__);
 
-	response = HTTPUtil::makeRequest(
+	response = m_connectionPool->makeRequest(
 		request, m_address.host().toString(), m_address.port(), "", timeout);
 
 	const int status = response.getStatus();
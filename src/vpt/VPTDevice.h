@@ -21,6 +21,7 @@
 #include "model/ModuleType.h"
 #include "model/RefreshTime.h"
 #include "model/SensorData.h"
+#include "net/HTTPConnectionPool.h"
 #include "net/HTTPEntireResponse.h"
 #include "util/Loggable.h"
 
@@ -63,6 +64,7 @@ public:
 	 * @param pingTimeout ping timeout used to obtain the IP address of gateway's interface
 	 * from which the VPT is available.
 	 * @param id Gateway id used in generating of stamp.
+	 * @param connectionPool pool of HTTP sessions to use.
 	 */
 	VPTDevice(
 		const Poco::Net::SocketAddress& address,
@@ -70,7 +72,8 @@ public:
 		const Poco::Timespan& pingTimeout,
 		const GatewayID& id,
 		const RefreshTime& refresh,
-		const DeviceCache::Ptr deviceCache);
+		const DeviceCache::Ptr deviceCache,
+		HTTPConnectionPool::Ptr connectionPool);
 
 	DeviceID id() const override;
 	RefreshTime refresh() const override;
@@ -181,6 +184,7 @@ private:
 	Poco::FastMutex m_lock;
 
 	DeviceCache::Ptr m_deviceCache;
+	mutable HTTPConnectionPool::Ptr m_connectionPool;
 };
 
 }
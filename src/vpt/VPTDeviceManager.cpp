@@ -26,6 +26,9 @@ BEEEON_OBJECT_PROPERTY("refresh", &VPTDeviceManager::setRefresh)
 BEEEON_OBJECT_PROPERTY("interfaceBlackList", &VPTDeviceManager::setBlackList)
 BEEEON_OBJECT_PROPERTY("pingTimeout", &VPTDeviceManager::setPingTimeout)
 BEEEON_OBJECT_PROPERTY("httpTimeout", &VPTDeviceManager::setHTTPTimeout)
+BEEEON_OBJECT_PROPERTY("connectionPool", &VPTDeviceManager::setConnectionPool)
+BEEEON_OBJECT_PROPERTY("maxInFlightProbes", &VPTDeviceManager::setMaxInFlightProbes)
+BEEEON_OBJECT_PROPERTY("verifyThreads", &VPTDeviceManager::setVerifyThreads)
 BEEEON_OBJECT_PROPERTY("maxMsgSize", &VPTDeviceManager::setMaxMsgSize)
 BEEEON_OBJECT_PROPERTY("path", &VPTDeviceManager::setPath)
 BEEEON_OBJECT_PROPERTY("port", &VPTDeviceManager::setPort)
@@ -51,6 +54,7 @@ VPTDeviceManager::VPTDeviceManager():
 	m_maxMsgSize(10000),
 	m_refresh(RefreshTime::fromSeconds(5)),
 	m_httpTimeout(3 * Timespan::SECONDS),
+	m_connectionPool(new HTTPConnectionPool),
 	m_pingTimeout(20 * Timespan::MILLISECONDS)
 {
 }
@@ -115,6 +119,27 @@ void VPTDeviceManager::setHTTPTimeout(const Timespan &timeout)
 	m_scanner.setHTTPTimeout(timeout);
 }
 
+void VPTDeviceManager::setConnectionPool(HTTPConnectionPool::Ptr pool)
+{
+	m_connectionPool = pool;
+}
+
+void VPTDeviceManager::setMaxInFlightProbes(int count)
+{
+	if (count <= 0)
+		throw InvalidArgumentException("max in-flight probes must be a positive number");
+
+	m_scanner.setMaxInFlightProbes(count);
+}
+
+void VPTDeviceManager::setVerifyThreads(int count)
+{
+	if (count <= 0)
+		throw InvalidArgumentException("number of verify threads must be a positive number");
+
+	m_scanner.setVerifyThreads(count);
+}
+
 void VPTDeviceManager::setMaxMsgSize(int size)
 {
 	if (size <= 0)
@@ -337,7 +362,8 @@ vector<VPTDevice::Ptr> VPTDeviceManager::seekDevices(const StopControl& stop)
 				m_pingTimeout,
 				m_gatewayInfo->gatewayID(),
 				m_refresh,
-				deviceCache());
+				deviceCache(),
+				m_connectionPool);
 		}
 		catch (Exception& e) {
 			logger().warning("found device has disconnected", __FILE__, __LINE__);
@@ -20,6 +20,7 @@
 #include "loop/StopControl.h"
 #include "model/DeviceID.h"
 #include "model/RefreshTime.h"
+#include "net/HTTPConnectionPool.h"
 #include "util/AsyncWork.h"
 #include "util/CryptoConfig.h"
 #include "vpt/VPTDevice.h"
@@ -59,6 +60,9 @@ public:
 	void setRefresh(const Poco::Timespan &refresh);
 	void setPingTimeout(const Poco::Timespan &timeout);
 	void setHTTPTimeout(const Poco::Timespan &timeout);
+	void setConnectionPool(HTTPConnectionPool::Ptr pool);
+	void setMaxInFlightProbes(int count);
+	void setVerifyThreads(int count);
 	void setMaxMsgSize(int size);
 	void setBlackList(const std::list<std::string>& list);
 	void setPath(const std::string& path);
@@ -128,6 +132,7 @@ private:
 	PollingKeeper m_pollingKeeper;
 	RefreshTime m_refresh;
 	Poco::Timespan m_httpTimeout;
+	HTTPConnectionPool::Ptr m_connectionPool;
 	Poco::Timespan m_pingTimeout;
 
 	/**
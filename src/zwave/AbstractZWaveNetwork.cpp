@@ -9,10 +9,29 @@ using namespace std;
 using namespace Poco;
 using namespace BeeeOn;
 
-AbstractZWaveNetwork::AbstractZWaveNetwork()
+AbstractZWaveNetwork::AbstractZWaveNetwork():
+	m_eventsQueueCapacity(0)
 {
 }
 
+void AbstractZWaveNetwork::setEventsQueueCapacity(int capacity)
+{
+	if (capacity < 0)
+		throw InvalidArgumentException("events queue capacity must not be negative");
+
+	FastMutex::ScopedLock guard(m_lock);
+	m_eventsQueueCapacity = capacity;
+}
+
+AbstractZWaveNetwork::EventsQueueStats AbstractZWaveNetwork::eventsQueueStats() const
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	EventsQueueStats stats = m_eventsQueueStats;
+	stats.depth = m_eventsQueue.size();
+	return stats;
+}
+
 ZWaveNetwork::PollEvent AbstractZWaveNetwork::pollEvent(
 		const Timespan &timeout)
 {
@@ -83,11 +102,59 @@ ZWaveNetwork::PollEvent AbstractZWaveNetwork::pollEvent(
 	return event;
 }
 
+static bool sameValueSource(const ZWaveNode::Value &a, const ZWaveNode::Value &b)
+{
+	return a.node() == b.node()
+		&& a.commandClass().id() == b.commandClass().id()
+		&& a.commandClass().index() == b.commandClass().index()
+		&& a.commandClass().instance() == b.commandClass().instance();
+}
+
+bool AbstractZWaveNetwork::makeRoomForValue(const PollEvent &event)
+{
+	for (auto &queued : m_eventsQueue) {
+		if (queued.type() != PollEvent::EVENT_VALUE)
+			continue;
+
+		if (sameValueSource(queued.value(), event.value())) {
+			queued = event;
+			m_eventsQueueStats.replaced += 1;
+			return false;
+		}
+	}
+
+	m_eventsQueueStats.dropped += 1;
+
+	for (auto it = m_eventsQueue.begin(); it != m_eventsQueue.end(); ++it) {
+		if (it->type() == PollEvent::EVENT_VALUE) {
+			m_eventsQueue.erase(it);
+			return true;
+		}
+	}
+
+	// there are only life-cycle events, drop the given one
+	return false;
+}
+
 void AbstractZWaveNetwork::notifyEvent(const PollEvent &event)
 {
 	FastMutex::ScopedLock guard(m_lock);
 
+	const bool full = m_eventsQueueCapacity > 0
+		&& m_eventsQueue.size() >= m_eventsQueueCapacity;
+
+	if (full && event.type() == PollEvent::EVENT_VALUE) {
+		if (!makeRoomForValue(event)) {
+			m_event.set();
+			return;
+		}
+	}
+
 	m_eventsQueue.emplace_back(event);
+
+	if (m_eventsQueue.size() > m_eventsQueueStats.highWaterMark)
+		m_eventsQueueStats.highWaterMark = m_eventsQueue.size();
+
 	m_event.set();
 }
 
@@ -15,13 +15,57 @@ namespace BeeeOn {
  * a pre-implemented polling mechanism. It is assumed that exactly one
  * thread calls the method pollEvent() periodically to read the events
  * (using multiple threads might be an issue because we use Poco::Event).
+ *
+ * The queue of events can be bounded by setEventsQueueCapacity(). When
+ * it is full, the events are handled by their type:
+ *
+ * - events related to life-cycle of nodes (new, update, remove), inclusion,
+ *   node removal and readiness of the network are never dropped; they are
+ *   always enqueued even beyond the capacity
+ * - a value event replaces a queued value event of the same node and
+ *   command class (only the latest value is kept), otherwise the oldest
+ *   queued value event is dropped to make room for it
  */
 class AbstractZWaveNetwork :
 	public ZWaveNetwork,
 	protected virtual Loggable {
 public:
+	/**
+	 * @brief Counters describing behaviour of the queue of events.
+	 */
+	struct EventsQueueStats {
+		/**
+		 * Number of currently queued events.
+		 */
+		size_t depth = 0;
+
+		/**
+		 * Maximal number of queued events seen so far.
+		 */
+		size_t highWaterMark = 0;
+
+		/**
+		 * Number of value events overwritten by a newer value
+		 * of the same node and command class.
+		 */
+		size_t replaced = 0;
+
+		/**
+		 * Number of value events dropped due to a full queue.
+		 */
+		size_t dropped = 0;
+	};
+
 	AbstractZWaveNetwork();
 
+	/**
+	 * @brief Set maximal number of queued events, 0 means unlimited.
+	 * Life-cycle events can exceed the capacity.
+	 */
+	void setEventsQueueCapacity(int capacity);
+
+	EventsQueueStats eventsQueueStats() const;
+
 	/**
 	 * Implements the pollEvent() operation generically. It just
 	 * waits on the m_event and reads events from the m_eventsQueue.
@@ -43,7 +87,16 @@ protected:
 	void notifyEvent(const PollEvent &event);
 
 private:
+	/**
+	 * Make room for the given value event in the full m_eventsQueue.
+	 * @returns false if the value event has been already handled
+	 * (replaced or dropped) and thus must not be enqueued
+	 */
+	bool makeRoomForValue(const PollEvent &event);
+
 	std::deque<PollEvent> m_eventsQueue;
+	size_t m_eventsQueueCapacity;
+	EventsQueueStats m_eventsQueueStats;
 	Poco::Event m_event;
 	mutable Poco::FastMutex m_lock;
 };
@@ -38,6 +38,7 @@ BEEEON_OBJECT_PROPERTY("intervalBetweenPolls", &OZWNetwork::setIntervalBetweenPo
 BEEEON_OBJECT_PROPERTY("retryTimeout", &OZWNetwork::setRetryTimeout)
 BEEEON_OBJECT_PROPERTY("statisticsInterval", &OZWNetwork::setStatisticsInterval)
 BEEEON_OBJECT_PROPERTY("networkKey", &OZWNetwork::setNetworkKey)
+BEEEON_OBJECT_PROPERTY("eventsQueueCapacity", &OZWNetwork::setEventsQueueCapacity)
 BEEEON_OBJECT_PROPERTY("controllersToReset", &OZWNetwork::setControllersToReset)
 BEEEON_OBJECT_PROPERTY("executor", &OZWNetwork::setExecutor)
 BEEEON_OBJECT_PROPERTY("listeners", &OZWNetwork::registerListener)
@@ -991,6 +992,8 @@ void OZWNetwork::interrupt()
 
 void OZWNetwork::fireStatistics()
 {
+	const EventsQueueStats queueStats = eventsQueueStats();
+
 	FastMutex::ScopedLock guard(m_managerLock);
 
 	for (const auto &home : m_homes) {
@@ -1019,6 +1022,9 @@ void OZWNetwork::fireStatistics()
 			{"routedbusy", data.m_routedbusy},
 			{"broadcastReadCnt", data.m_broadcastReadCnt},
 			{"broadcastWriteCnt", data.m_broadcastWriteCnt},
+			{"eventsQueueHighWaterMark", (uint32_t) queueStats.highWaterMark},
+			{"eventsQueueReplaced", (uint32_t) queueStats.replaced},
+			{"eventsQueueDropped", (uint32_t) queueStats.dropped},
 		};
 
 		ZWaveDriverEvent e(stats);
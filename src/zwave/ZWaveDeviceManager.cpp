@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include <Poco/Clock.h>
@@ -26,6 +27,9 @@ BEEEON_OBJECT_PROPERTY("network", &ZWaveDeviceManager::setNetwork)
 BEEEON_OBJECT_PROPERTY("registry", &ZWaveDeviceManager::setRegistry)
 BEEEON_OBJECT_PROPERTY("dispatchDuration", &ZWaveDeviceManager::setDispatchDuration)
 BEEEON_OBJECT_PROPERTY("pollTimeout", &ZWaveDeviceManager::setPollTimeout)
+BEEEON_OBJECT_PROPERTY("coalesceWindow", &ZWaveDeviceManager::setCoalesceWindow)
+BEEEON_OBJECT_PROPERTY("coalesceMaxDelay", &ZWaveDeviceManager::setCoalesceMaxDelay)
+BEEEON_OBJECT_PROPERTY("metricsRegistry", &ZWaveDeviceManager::setMetricsRegistry)
 BEEEON_OBJECT_PROPERTY("distributor", &ZWaveDeviceManager::setDistributor)
 BEEEON_OBJECT_PROPERTY("commandDispatcher", &ZWaveDeviceManager::setCommandDispatcher)
 BEEEON_OBJECT_END(BeeeOn, ZWaveDeviceManager)
@@ -113,6 +117,14 @@ string ZWaveDeviceManager::Device::toString() const
 	return id().toString() + " " + m_node.toString();
 }
 
+double ZWaveDeviceManager::CoalescingStats::mergeRatio() const
+{
+	if (shipped == 0)
+		return 0;
+
+	return static_cast<double>(values) / shipped;
+}
+
 ZWaveDeviceManager::ZWaveDeviceManager():
 	DeviceManager(DevicePrefix::PREFIX_ZWAVE, {
 		typeid(GatewayListenCommand),
@@ -121,7 +133,11 @@ ZWaveDeviceManager::ZWaveDeviceManager():
 		typeid(DeviceSetValueCommand),
 	}),
 	m_dispatchDuration(60 * Timespan::SECONDS),
-	m_pollTimeout(30 * Timespan::SECONDS)
+	m_pollTimeout(30 * Timespan::SECONDS),
+	m_coalesceWindow(0),
+	m_coalesceMaxDelay(1 * Timespan::SECONDS),
+	m_coalescedValues(MetricsRegistry::createCounter()),
+	m_coalescedShipped(MetricsRegistry::createCounter())
 {
 }
 
@@ -151,6 +167,37 @@ void ZWaveDeviceManager::setPollTimeout(const Timespan &timeout)
 	m_pollTimeout = timeout;
 }
 
+void ZWaveDeviceManager::setCoalesceWindow(const Timespan &window)
+{
+	if (window < 0)
+		throw InvalidArgumentException("coalesceWindow must not be negative");
+
+	m_coalesceWindow = window;
+}
+
+void ZWaveDeviceManager::setCoalesceMaxDelay(const Timespan &delay)
+{
+	if (delay < 1 * Timespan::MILLISECONDS)
+		throw InvalidArgumentException("coalesceMaxDelay must be at least 1 ms");
+
+	m_coalesceMaxDelay = delay;
+}
+
+void ZWaveDeviceManager::setMetricsRegistry(MetricsRegistry::Ptr registry)
+{
+	m_coalescedValues = registry->counter(
+		"beeeon_zwave_values_total",
+		"Values received from paired Z-Wave devices");
+	m_coalescedShipped = registry->counter(
+		"beeeon_zwave_shipped_total",
+		"SensorData shipped by Z-Wave device manager");
+}
+
+ZWaveDeviceManager::CoalescingStats ZWaveDeviceManager::coalescingStats() const
+{
+	return {m_coalescedValues->value(), m_coalescedShipped->value()};
+}
+
 void ZWaveDeviceManager::run()
 {
 	logger().information("Z-Wave device manager is starting");
@@ -159,7 +206,7 @@ void ZWaveDeviceManager::run()
 	StopControl::Run run(m_stopControl);
 
 	while (run) {
-		const auto event = m_network->pollEvent(m_pollTimeout);
+		const auto event = m_network->pollEvent(flushCoalesced());
 
 		if (logger().trace())
 			logger().trace(event.toString(), __FILE__, __LINE__);
@@ -207,6 +254,15 @@ void ZWaveDeviceManager::run()
 			logger().trace("event handled", __FILE__, __LINE__);
 	}
 
+	flushCoalesced(true);
+
+	const auto stats = coalescingStats();
+	logger().information(
+		"shipped " + to_string(stats.shipped) + " data of "
+		+ to_string(stats.values) + " values (merge ratio "
+		+ to_string(stats.mergeRatio()) + ")",
+		__FILE__, __LINE__);
+
 	logger().information("Z-Wave device manager has stopped");
 }
 
@@ -266,13 +322,95 @@ void ZWaveDeviceManager::processValue(const ZWaveNode::Value &value)
 		return;
 	}
 
+	if (m_coalesceWindow == 0) {
+		m_coalescedValues->add();
+
+		try {
+			const Timestamp now;
+			shipCoalesced({device.id(), now, {device.convert(value)}});
+		}
+		BEEEON_CATCH_CHAIN(logger())
+
+		return;
+	}
+
 	try {
-		const Timestamp now;
-		ship({device.id(), now, {device.convert(value)}});
+		coalesce(device.id(), device.convert(value));
 	}
 	BEEEON_CATCH_CHAIN(logger())
 }
 
+void ZWaveDeviceManager::coalesce(const DeviceID &id, const SensorValue &value)
+{
+	m_coalescedValues->add();
+
+	auto it = m_coalesced.find(id);
+
+	if (it != m_coalesced.end()) {
+		const auto &data = it->second.data;
+		const bool duplicate = any_of(data.begin(), data.end(),
+			[&](const SensorValue &pending) {
+				return pending.moduleID() == value.moduleID();
+			});
+
+		if (!duplicate) {
+			it->second.data.insertValue(value);
+			it->second.last.update();
+			return;
+		}
+	}
+
+	Coalesced entry;
+	entry.data.setDeviceID(id);
+	entry.data.setTimestamp(Timestamp());
+	entry.data.insertValue(value);
+
+	if (it == m_coalesced.end()) {
+		m_coalesced.emplace(id, entry);
+		return;
+	}
+
+	// the module already has a pending value, ship it first
+	const SensorData pending = it->second.data;
+	it->second = entry;
+	shipCoalesced(pending);
+}
+
+Timespan ZWaveDeviceManager::flushCoalesced(bool all)
+{
+	FastMutex::ScopedLock guard(m_lock);
+
+	Timespan timeout = m_pollTimeout;
+
+	for (auto it = m_coalesced.begin(); it != m_coalesced.end();) {
+		const Coalesced &entry = it->second;
+		const Timespan quiet = m_coalesceWindow - entry.last.elapsed();
+		const Timespan delay = m_coalesceMaxDelay - entry.first.elapsed();
+		const Timespan left = min(quiet, delay);
+
+		if (all || left <= 0) {
+			try {
+				shipCoalesced(entry.data);
+			}
+			BEEEON_CATCH_CHAIN(logger())
+
+			it = m_coalesced.erase(it);
+			continue;
+		}
+
+		timeout = min(timeout, left);
+		++it;
+	}
+
+	return max(timeout, Timespan(1 * Timespan::MILLISECONDS));
+}
+
+void ZWaveDeviceManager::shipCoalesced(const SensorData &data)
+{
+	m_coalescedShipped->add();
+	ship(data);
+}
+
 void ZWaveDeviceManager::newNode(const ZWaveNode &node, bool dispatch)
 {
 	FastMutex::ScopedLock guard(m_lock);
@@ -9,7 +9,9 @@
 #include <Poco/Timespan.h>
 
 #include "core/DeviceManager.h"
+#include "core/MetricsRegistry.h"
 #include "model/RefreshTime.h"
+#include "model/SensorData.h"
 #include "model/SensorValue.h"
 #include "util/DelayedAsyncWork.h"
 #include "zwave/ZWaveMapperRegistry.h"
@@ -40,6 +42,17 @@ namespace BeeeOn {
  * A Z-Wave node is considered as working when a Mapper is resolved for it.
  * If no Mapper is resolved such Z-Wave node is dropped until an update of
  * its details comes from the underlying ZWaveNetwork.
+ *
+ * Z-Wave reports each value separately. If a coalescing window is set,
+ * values of a device arriving within the window are merged into a single
+ * SensorData. Each merged value restarts the window, however, the data are
+ * shipped at latest coalesceMaxDelay after their first value. A value of
+ * a module that is already pending causes the pending data to be shipped
+ * first. Pending data are shipped when the manager stops.
+ *
+ * The counts of received values and shipped SensorData can be exported
+ * via MetricsRegistry, their ratio describes how much the coalescing
+ * saves.
  */
 class ZWaveDeviceManager : public DeviceManager {
 public:
@@ -101,6 +114,26 @@ public:
 	typedef std::map<DeviceID, Device> DeviceMap;
 	typedef std::map<ZWaveNode::Identity, DeviceMap::iterator> ZWaveNodeMap;
 
+	/**
+	 * @brief Statistics of values coalescing.
+	 */
+	struct CoalescingStats {
+		/**
+		 * Count of values received for paired devices.
+		 */
+		uint64_t values;
+
+		/**
+		 * Count of SensorData shipped.
+		 */
+		uint64_t shipped;
+
+		/**
+		 * @returns average count of values per shipped SensorData
+		 */
+		double mergeRatio() const;
+	};
+
 	ZWaveDeviceManager();
 
 	/**
@@ -130,6 +163,26 @@ public:
 	 */
 	void setPollTimeout(const Poco::Timespan &timeout);
 
+	/**
+	 * @brief Set window in which values of a single device are merged
+	 * into a single SensorData. Zero disables coalescing.
+	 */
+	void setCoalesceWindow(const Poco::Timespan &window);
+
+	/**
+	 * @brief Set maximal delay of shipping coalesced data since
+	 * receiving their first value.
+	 */
+	void setCoalesceMaxDelay(const Poco::Timespan &delay);
+
+	/**
+	 * @brief Register counters of received values and shipped
+	 * SensorData in the given registry.
+	 */
+	void setMetricsRegistry(MetricsRegistry::Ptr registry);
+
+	CoalescingStats coalescingStats() const;
+
 	/**
 	 * @brief Run the loop that receives events from the configured
 	 * ZWaveNetwork instance. The loop receives information about
@@ -197,6 +250,25 @@ protected:
 	 */
 	void processValue(const ZWaveNode::Value &value);
 
+	/**
+	 * @brief Merge the given value into data pending for the device.
+	 * Must be called with m_lock held.
+	 */
+	void coalesce(const DeviceID &id, const SensorValue &value);
+
+	/**
+	 * @brief Ship pending coalesced data whose window or max delay
+	 * has expired (or all of them).
+	 * @returns time to wait for the next event
+	 */
+	Poco::Timespan flushCoalesced(bool all = false);
+
+	/**
+	 * @brief Ship the given data and update statistics.
+	 * Must be called with m_lock held.
+	 */
+	void shipCoalesced(const SensorData &data);
+
 	/**
 	 * @brief If the given node is fully resolvable (we can determine
 	 * its Mapper instance), it is registered as a new Device and dispatched
@@ -251,6 +323,21 @@ private:
 	ZWaveMapperRegistry::Ptr m_registry;
 	Poco::Timespan m_dispatchDuration;
 	Poco::Timespan m_pollTimeout;
+	Poco::Timespan m_coalesceWindow;
+	Poco::Timespan m_coalesceMaxDelay;
+
+	struct Coalesced {
+		SensorData data;
+		Poco::Clock first;
+		Poco::Clock last;
+	};
+
+	/**
+	 * Data being coalesced for each device.
+	 */
+	std::map<DeviceID, Coalesced> m_coalesced;
+	MetricsRegistry::Counter::Ptr m_coalescedValues;
+	MetricsRegistry::Counter::Ptr m_coalescedShipped;
 
 	/**
 	 * Cache of devices discovered by Z-Wave with a resolved Mapper instance.
@@ -271,7 +358,8 @@ private:
 	std::set<DeviceID> m_recentlyUnpaired;
 
 	/**
-	 * Protect access to m_devices, m_zwaveNodes, m_recentlyUnpaired.
+	 * Protect access to m_devices, m_zwaveNodes, m_recentlyUnpaired
+	 * and m_coalesced.
 	 */
 	Poco::FastMutex m_lock;
 
@@ -123,3 +123,18 @@ uint32_t ZWaveDriverEvent::broadcastWriteCount() const
 {
 	return lookup("broadcastWriteCnt");
 }
+
+uint32_t ZWaveDriverEvent::eventsQueueHighWaterMark() const
+{
+	return lookup("eventsQueueHighWaterMark");
+}
+
+uint32_t ZWaveDriverEvent::eventsQueueReplaced() const
+{
+	return lookup("eventsQueueReplaced");
+}
+
+uint32_t ZWaveDriverEvent::eventsQueueDropped() const
+{
+	return lookup("eventsQueueDropped");
+}
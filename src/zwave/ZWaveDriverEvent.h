@@ -46,6 +46,23 @@ public:
 	uint32_t broadcastReadCount() const;
 	uint32_t broadcastWriteCount() const;
 
+	/**
+	 * @returns maximal number of events queued in the gateway
+	 * for processing seen so far
+	 */
+	uint32_t eventsQueueHighWaterMark() const;
+
+	/**
+	 * @returns number of value events replaced by a newer value
+	 * of the same node and command class while queued
+	 */
+	uint32_t eventsQueueReplaced() const;
+
+	/**
+	 * @returns number of value events dropped due to a full queue
+	 */
+	uint32_t eventsQueueDropped() const;
+
 protected:
 	uint32_t lookup(const std::string &key) const;
 
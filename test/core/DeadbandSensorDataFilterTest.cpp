@@ -0,0 +1,222 @@
+#include <cmath>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/TemporaryFile.h>
+#include <Poco/Thread.h>
+
+#include "cppunit/BetterAssert.h"
+
+#include "commands/NewDeviceCommand.h"
+#include "core/DeadbandSensorDataFilter.h"
+#include "model/DeviceDescription.h"
+#include "model/DevicePrefix.h"
+#include "model/ModuleType.h"
+#include "model/SensorData.h"
+
+using namespace std;
+using namespace Poco;
+
+namespace BeeeOn {
+
+class DeadbandSensorDataFilterTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(DeadbandSensorDataFilterTest);
+	CPPUNIT_TEST(testChangeOnly);
+	CPPUNIT_TEST(testDeadbandByModuleType);
+	CPPUNIT_TEST(testMaxSilence);
+	CPPUNIT_TEST(testUnknownTypesFallback);
+	CPPUNIT_TEST(testPersistedTypes);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void testChangeOnly();
+	void testDeadbandByModuleType();
+	void testMaxSilence();
+	void testUnknownTypesFallback();
+	void testPersistedTypes();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DeadbandSensorDataFilterTest);
+
+static const DeviceID DEVICE(DevicePrefix::PREFIX_VIRTUAL_DEVICE, 1);
+
+static SensorData makeData(double value0, double value1)
+{
+	SensorData data;
+	data.setDeviceID(DEVICE);
+	data.insertValue(SensorValue(ModuleID(0), value0));
+	data.insertValue(SensorValue(ModuleID(1), value1));
+
+	return data;
+}
+
+static size_t countValues(const SensorData &data)
+{
+	size_t count = 0;
+
+	for (auto it = data.begin(); it != data.end(); ++it)
+		count += 1;
+
+	return count;
+}
+
+/**
+ * @brief Test that without any deadband only changed values (including
+ * change of validity) are forwarded and data with no forwarded values
+ * are dropped entirely.
+ */
+void DeadbandSensorDataFilterTest::testChangeOnly()
+{
+	DeadbandSensorDataFilter filter;
+	filter.setRules({{"*:*", ""}});
+
+	SensorData data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(2, countValues(data));
+
+	data = makeData(20, 50);
+	CPPUNIT_ASSERT(!filter.filter(data));
+
+	data = makeData(20, 51);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(1, countValues(data));
+	CPPUNIT_ASSERT_EQUAL(1, data.begin()->moduleID().value());
+
+	data = makeData(NAN, 51);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(1, countValues(data));
+	CPPUNIT_ASSERT(!data.begin()->isValid());
+
+	CPPUNIT_ASSERT_EQUAL(4, filter.forwarded());
+	CPPUNIT_ASSERT_EQUAL(4, filter.suppressed());
+}
+
+static NewDeviceCommand::Ptr announceDevice()
+{
+	const list<ModuleType> types = {
+		{ModuleType::Type::TYPE_TEMPERATURE},
+		{ModuleType::Type::TYPE_HUMIDITY},
+	};
+
+	return new NewDeviceCommand(
+		DeviceDescription::Builder()
+			.id(DEVICE)
+			.type("BeeeOn", "Testing")
+			.modules(types)
+			.build());
+}
+
+static map<string, string> typedRules()
+{
+	const string prefix = DevicePrefix(DevicePrefix::PREFIX_VIRTUAL_DEVICE).toString();
+	const string temperature =
+		ModuleType::Type(ModuleType::Type::TYPE_TEMPERATURE).toString();
+
+	return {
+		{"*:*", "relative=0.1"},
+		{prefix + ":" + temperature, "absolute=0.5"},
+	};
+}
+
+/**
+ * @brief Test that the deadband of the rule matching the module type
+ * learned from NewDeviceCommand is preferred over the generic rule.
+ * Differences are computed against the last forwarded value.
+ */
+void DeadbandSensorDataFilterTest::testDeadbandByModuleType()
+{
+	DeadbandSensorDataFilter filter;
+	filter.setRules(typedRules());
+	filter.onDispatch(announceDevice());
+
+	SensorData data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(2, countValues(data));
+
+	data = makeData(20.3, 54);
+	CPPUNIT_ASSERT(!filter.filter(data));
+
+	data = makeData(20.6, 56);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(2, countValues(data));
+
+	data = makeData(20.9, 60);
+	CPPUNIT_ASSERT(!filter.filter(data));
+}
+
+/**
+ * @brief Test that an unchanged value is forwarded again when
+ * the maxSilence elapses.
+ */
+void DeadbandSensorDataFilterTest::testMaxSilence()
+{
+	DeadbandSensorDataFilter filter;
+	filter.setRules({{"*:*", "absolute=1, maxSilence=0.05"}});
+
+	SensorData data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+
+	data = makeData(20, 50);
+	CPPUNIT_ASSERT(!filter.filter(data));
+
+	Thread::sleep(100);
+
+	data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(2, countValues(data));
+}
+
+/**
+ * @brief Test that a device whose NewDeviceCommand has never been seen
+ * (e.g. paired before restart) is filtered by the rules for any type.
+ */
+void DeadbandSensorDataFilterTest::testUnknownTypesFallback()
+{
+	DeadbandSensorDataFilter filter;
+	filter.setRules(typedRules());
+
+	SensorData data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(2, countValues(data));
+
+	// relative=0.1 applies to the temperature as well
+	data = makeData(20.6, 54);
+	CPPUNIT_ASSERT(!filter.filter(data));
+
+	data = makeData(22.5, 53);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(1, countValues(data));
+	CPPUNIT_ASSERT_EQUAL(0, data.begin()->moduleID().value());
+}
+
+/**
+ * @brief Test that module types learned from NewDeviceCommand are persisted
+ * in the typesFile and a new filter instance (after restart) applies typed
+ * rules without seeing the NewDeviceCommand again.
+ */
+void DeadbandSensorDataFilterTest::testPersistedTypes()
+{
+	TemporaryFile typesFile;
+
+	{
+		DeadbandSensorDataFilter filter;
+		filter.setTypesFile(typesFile.path());
+		filter.setup();
+		filter.onDispatch(announceDevice());
+	}
+
+	DeadbandSensorDataFilter filter;
+	filter.setRules(typedRules());
+	filter.setTypesFile(typesFile.path());
+	filter.setup();
+
+	SensorData data = makeData(20, 50);
+	CPPUNIT_ASSERT(filter.filter(data));
+
+	// absolute=0.5 applies to the temperature
+	data = makeData(20.6, 54);
+	CPPUNIT_ASSERT(filter.filter(data));
+	CPPUNIT_ASSERT_EQUAL(1, countValues(data));
+	CPPUNIT_ASSERT_EQUAL(0, data.begin()->moduleID().value());
+}
+
+}
@@ -1,3 +1,5 @@
+#include <list>
+
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <Poco/Exception.h>
@@ -20,6 +22,8 @@ class DevicePollerTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testDontRescheduleInactive);
 	CPPUNIT_TEST(testRescheduleAfterPoll);
 	CPPUNIT_TEST(testCancel);
+	CPPUNIT_TEST(testLimitsAndFairness);
+	CPPUNIT_TEST(testLateness);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -30,6 +34,8 @@ public:
 	void testDontRescheduleInactive();
 	void testRescheduleAfterPoll();
 	void testCancel();
+	void testLimitsAndFairness();
+	void testLateness();
 
 private:
 	NonAsyncExecutor::Ptr m_executor;
@@ -46,6 +52,35 @@ public:
 	using DevicePoller::doPoll;
 };
 
+/**
+ * @brief Executor that only collects the invoked jobs. The jobs
+ * are executed explicitly by calling runNext().
+ */
+class QueuedExecutor : public AsyncExecutor {
+public:
+	typedef Poco::SharedPtr<QueuedExecutor> Ptr;
+
+	void invoke(std::function<void()> f) override
+	{
+		m_jobs.emplace_back(f);
+	}
+
+	size_t pending() const
+	{
+		return m_jobs.size();
+	}
+
+	void runNext()
+	{
+		auto f = m_jobs.front();
+		m_jobs.pop_front();
+		f();
+	}
+
+private:
+	list<std::function<void()>> m_jobs;
+};
+
 class TestingPollableDevice : public PollableDevice {
 public:
 	typedef Poco::SharedPtr<TestingPollableDevice> Ptr;
@@ -289,4 +324,102 @@ void DevicePollerTest::testCancel()
 		AssertionViolationException);
 }
 
+/**
+ * @brief Check that the count of polls in progress is limited globally and
+ * per DevicePrefix. When multiple devices are on schedule, the device of
+ * an idle prefix is preferred over the older devices of a busy prefix.
+ */
+void DevicePollerTest::testLimitsAndFairness()
+{
+	QueuedExecutor::Ptr executor = new QueuedExecutor;
+
+	TestableDevicePoller poller;
+	poller.setPollExecutor(executor);
+	poller.setMaxActive(2);
+	poller.setMaxActivePerPrefix(1);
+
+	TestingPollableDevice::Ptr hue0 = new TestingPollableDevice(
+		DeviceID(DevicePrefix::PREFIX_PHILIPS_HUE, 1), RefreshTime::fromSeconds(5));
+	TestingPollableDevice::Ptr hue1 = new TestingPollableDevice(
+		DeviceID(DevicePrefix::PREFIX_PHILIPS_HUE, 2), RefreshTime::fromSeconds(5));
+	TestingPollableDevice::Ptr vdev0 = new TestingPollableDevice(
+		DeviceID(DevicePrefix::PREFIX_VIRTUAL_DEVICE, 1), RefreshTime::fromSeconds(7));
+	TestingPollableDevice::Ptr vdev1 = new TestingPollableDevice(
+		DeviceID(DevicePrefix::PREFIX_VIRTUAL_DEVICE, 2), RefreshTime::fromSeconds(8));
+
+	poller.doSchedule(hue0, 0);
+	poller.doSchedule(hue1, 0);
+	poller.doSchedule(vdev0, 0);
+	poller.doSchedule(vdev1, 0);
+
+	const Clock at(10 * Timespan::SECONDS);
+
+	// hue0 is the oldest one
+	CPPUNIT_ASSERT_EQUAL(0, poller.pollNextIfOnSchedule(at).totalMicroseconds());
+	CPPUNIT_ASSERT_EQUAL(1, executor->pending());
+
+	// hue1 is older than vdev0 but the Philips Hue prefix is busy
+	CPPUNIT_ASSERT_EQUAL(0, poller.pollNextIfOnSchedule(at).totalMicroseconds());
+	CPPUNIT_ASSERT_EQUAL(2, executor->pending());
+
+	// maxActive reached, nothing is scheduled into the future
+	CPPUNIT_ASSERT_EQUAL(-1, poller.pollNextIfOnSchedule(at).totalMicroseconds());
+	CPPUNIT_ASSERT_EQUAL(2, executor->pending());
+
+	executor->runNext();
+	CPPUNIT_ASSERT_EQUAL(1, hue0->polled());
+
+	// Philips Hue prefix is idle again, hue1 is polled and hue0 has
+	// been rescheduled into the future (real clock)
+	CPPUNIT_ASSERT_EQUAL(0, poller.pollNextIfOnSchedule(at).totalMicroseconds());
+	CPPUNIT_ASSERT_EQUAL(2, executor->pending());
+	CPPUNIT_ASSERT(poller.pollNextIfOnSchedule(at) > 0);
+
+	executor->runNext();
+	CPPUNIT_ASSERT_EQUAL(1, vdev0->polled());
+
+	// vdev1 is not blocked anymore
+	CPPUNIT_ASSERT_EQUAL(0, poller.pollNextIfOnSchedule(at).totalMicroseconds());
+
+	executor->runNext();
+	executor->runNext();
+	CPPUNIT_ASSERT_EQUAL(1, hue1->polled());
+	CPPUNIT_ASSERT_EQUAL(1, vdev1->polled());
+}
+
+/**
+ * @brief Check that lateness of polls is measured per device and that
+ * the statistics are dropped on cancel.
+ */
+void DevicePollerTest::testLateness()
+{
+	QueuedExecutor::Ptr executor = new QueuedExecutor;
+
+	TestableDevicePoller poller;
+	poller.setPollExecutor(executor);
+
+	TestingPollableDevice::Ptr device = new TestingPollableDevice(
+			DeviceID::random(), RefreshTime::fromSeconds(5));
+
+	poller.doSchedule(device, 0);
+
+	CPPUNIT_ASSERT_EQUAL(0, poller.stats(device->id()).polls);
+
+	CPPUNIT_ASSERT_EQUAL(
+		0,
+		poller.pollNextIfOnSchedule(5 * Timespan::SECONDS)
+			.totalMicroseconds());
+
+	executor->runNext();
+
+	const auto stats = poller.stats(device->id());
+	CPPUNIT_ASSERT_EQUAL(1, stats.polls);
+	CPPUNIT_ASSERT(stats.lastLateness > 0);
+	CPPUNIT_ASSERT(stats.maxLateness == stats.lastLateness);
+	CPPUNIT_ASSERT(stats.totalLateness == stats.lastLateness);
+
+	poller.cancel(device->id());
+	CPPUNIT_ASSERT_EQUAL(0, poller.stats(device->id()).polls);
+}
+
 }
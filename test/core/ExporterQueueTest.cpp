@@ -67,6 +67,11 @@ public:
 		m_ship = &QueueTestingExporter::shipBroken;
 	}
 
+	void setShip(function<bool ()> function)
+	{
+		m_ship = function;
+	}
+
 	AtomicCounter m_shipped;
 	SensorData m_lastShipped;
 
@@ -74,12 +79,41 @@ private:
 	function<bool ()> m_ship;
 };
 
+/**
+ * Exporter shipping at most the given count of data per shipBatch() call.
+ */
+class PartialBatchExporter : public QueueTestingExporter {
+public:
+	PartialBatchExporter(size_t limit):
+		m_limit(limit),
+		m_batches(0)
+	{
+	}
+
+	size_t shipBatch(const vector<SensorData> &data) override
+	{
+		++m_batches;
+
+		const size_t count = min(m_limit, data.size());
+		for (size_t i = 0; i < count; ++i)
+			ship(data[i]);
+
+		return count;
+	}
+
+	size_t m_limit;
+	AtomicCounter m_batches;
+};
+
 class ExporterQueueTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(ExporterQueueTest);
 	CPPUNIT_TEST(testExportOk);
 	CPPUNIT_TEST(testQueueOverloaded);
 	CPPUNIT_TEST(testExporterBroken);
 	CPPUNIT_TEST(testExporterFull);
+	CPPUNIT_TEST(testUnlimitedCapacity);
+	CPPUNIT_TEST(testPartialShipBatch);
+	CPPUNIT_TEST(testShipBatchFailsLater);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -87,6 +121,9 @@ public:
 	void testQueueOverloaded();
 	void testExporterBroken();
 	void testExporterFull();
+	void testUnlimitedCapacity();
+	void testPartialShipBatch();
+	void testShipBatchFailsLater();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ExporterQueueTest);
@@ -284,4 +321,95 @@ void ExporterQueueTest::testExporterFull()
 	);
 }
 
+/**
+ * The test vertifies that when the capacity is unlimited, data not fitting
+ * into the internal ring are not dropped and they are exported in order.
+ */
+void ExporterQueueTest::testUnlimitedCapacity()
+{
+	SharedPtr<Exporter> exporter = new QueueTestingExporter;
+
+	ExporterQueue queue(exporter,
+		ExporterQueue::UNLIMITED_BATCH_SIZE,
+		ExporterQueue::UNLIMITED_CAPACITY,
+		1);
+
+	const int count = 3 * ExporterQueue::UNLIMITED_RING_SIZE;
+
+	for (int i = 0; i < count; ++i) {
+		SensorData data;
+		data.setDeviceID(DeviceID(0x1111222200000000UL + i));
+		queue.enqueue(data);
+	}
+
+	unsigned int exported = 0;
+	while (queue.canExport(0))
+		exported += queue.exportBatch();
+
+	CPPUNIT_ASSERT_EQUAL(count, exported);
+	CPPUNIT_ASSERT_EQUAL(0, queue.dropped());
+	CPPUNIT_ASSERT_EQUAL(count, exporter.cast<QueueTestingExporter>()->m_shipped);
+	CPPUNIT_ASSERT_EQUAL(
+		DeviceID(0x1111222200000000UL + count - 1),
+		exporter.cast<QueueTestingExporter>()->m_lastShipped.deviceID()
+	);
+}
+
+/**
+ * The test vertifies that when the exporter ships only a part of a batch,
+ * the rest is kept and shipped by the next exportBatch() call in order.
+ */
+void ExporterQueueTest::testPartialShipBatch()
+{
+	SharedPtr<PartialBatchExporter> exporter = new PartialBatchExporter(3);
+
+	ExporterQueue queue(exporter, 10, 20, 1);
+
+	for (int i = 0; i < 8; ++i) {
+		SensorData data;
+		data.setDeviceID(DeviceID(0x1111222233330000UL + i));
+		queue.enqueue(data);
+	}
+
+	CPPUNIT_ASSERT_EQUAL(3, queue.exportBatch());
+	CPPUNIT_ASSERT_EQUAL(
+		DeviceID(0x1111222233330002UL),
+		exporter->m_lastShipped.deviceID());
+
+	CPPUNIT_ASSERT_EQUAL(3, queue.exportBatch());
+	CPPUNIT_ASSERT_EQUAL(2, queue.exportBatch());
+	CPPUNIT_ASSERT_EQUAL(0, queue.exportBatch());
+
+	CPPUNIT_ASSERT_EQUAL(3, exporter->m_batches);
+	CPPUNIT_ASSERT_EQUAL(8, queue.sent());
+	CPPUNIT_ASSERT_EQUAL(
+		DeviceID(0x1111222233330007UL),
+		exporter->m_lastShipped.deviceID());
+	CPPUNIT_ASSERT(queue.working());
+}
+
+/**
+ * The test vertifies the default Exporter::shipBatch() when the exporter
+ * fails after shipping some data. The shipped count is reported and the
+ * failure is reported (thrown) by the next call.
+ */
+void ExporterQueueTest::testShipBatchFailsLater()
+{
+	SharedPtr<QueueTestingExporter> exporter = new QueueTestingExporter;
+	int calls = 0;
+
+	exporter->setShip([&]() {
+		if (++calls > 2)
+			throw IOException("no connection");
+
+		return true;
+	});
+
+	vector<SensorData> data(4);
+
+	CPPUNIT_ASSERT_EQUAL(2, exporter->shipBatch(data));
+	CPPUNIT_ASSERT_THROW(exporter->shipBatch(data), IOException);
+	CPPUNIT_ASSERT_EQUAL(2, exporter->m_shipped);
+}
+
 }
@@ -0,0 +1,163 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/File.h>
+
+#include "cppunit/BetterAssert.h"
+#include "cppunit/FileTestFixture.h"
+
+#include "core/JournalDeviceCache.h"
+#include "model/DevicePrefix.h"
+
+using namespace Poco;
+
+namespace BeeeOn {
+
+class JournalDeviceCacheTest : public FileTestFixture {
+	CPPUNIT_TEST_SUITE(JournalDeviceCacheTest);
+	CPPUNIT_TEST(testPairUnpair);
+	CPPUNIT_TEST(testBatchPair);
+	CPPUNIT_TEST(testMigrateOnce);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testPairUnpair();
+	void testBatchPair();
+	void testMigrateOnce();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JournalDeviceCacheTest);
+
+void JournalDeviceCacheTest::setUp()
+{
+	setUpAsDirectory();
+}
+
+void JournalDeviceCacheTest::tearDown()
+{
+	// remove all named mutexes created by migration
+	for (const auto &prefix : DevicePrefix::all()) {
+		File mutex("/tmp/" + prefix.toString() + ".mutex");
+
+		try {
+			mutex.remove();
+		}
+		catch (...) {}
+	}
+}
+
+/**
+ * @brief Test we can pair and unpair a device and the pairing status
+ * is persisted in the journal file and visible after reloading.
+ */
+void JournalDeviceCacheTest::testPairUnpair()
+{
+	const DevicePrefix &VDEV = DevicePrefix::PREFIX_VIRTUAL_DEVICE;
+	const Path journal(testingPath(), "devices.journal");
+
+	JournalDeviceCache cache;
+	cache.setFile(journal.toString());
+	cache.setup();
+
+	CPPUNIT_ASSERT_FILE_EXISTS(journal);
+	CPPUNIT_ASSERT(cache.paired(VDEV).empty());
+	CPPUNIT_ASSERT(!cache.paired({0xa300000001020304}));
+
+	cache.markPaired({0xa300000001020304});
+	cache.markPaired({0xa3000000aaaaaaaa});
+	cache.markUnpaired({0xa3000000aaaaaaaa});
+
+	CPPUNIT_ASSERT_EQUAL(1, cache.paired(VDEV).size());
+	CPPUNIT_ASSERT(cache.paired({0xa300000001020304}));
+	CPPUNIT_ASSERT(!cache.paired({0xa3000000aaaaaaaa}));
+
+	JournalDeviceCache reloaded;
+	reloaded.setFile(journal.toString());
+	reloaded.setup();
+
+	CPPUNIT_ASSERT_EQUAL(1, reloaded.paired(VDEV).size());
+	CPPUNIT_ASSERT(reloaded.paired({0xa300000001020304}));
+	CPPUNIT_ASSERT(!reloaded.paired({0xa3000000aaaaaaaa}));
+}
+
+/**
+ * @brief Test pairing as a batch process. All already paired devices
+ * should be removed and only the given set is to be paired.
+ */
+void JournalDeviceCacheTest::testBatchPair()
+{
+	const DevicePrefix &VDEV = DevicePrefix::PREFIX_VIRTUAL_DEVICE;
+	const Path journal(testingPath(), "devices.journal");
+
+	JournalDeviceCache cache;
+	cache.setFile(journal.toString());
+	cache.setup();
+
+	cache.markPaired(VDEV, {{0xa3000000aaaaaaaa}, {0xa3000000bbbbbbbb}});
+
+	CPPUNIT_ASSERT_EQUAL(2, cache.paired(VDEV).size());
+	CPPUNIT_ASSERT(cache.paired({0xa3000000aaaaaaaa}));
+	CPPUNIT_ASSERT(cache.paired({0xa3000000bbbbbbbb}));
+
+	cache.markPaired(VDEV, {{0xa3000000bbbbbbbb}, {0xa300000001020304}});
+
+	CPPUNIT_ASSERT_EQUAL(2, cache.paired(VDEV).size());
+	CPPUNIT_ASSERT(!cache.paired({0xa3000000aaaaaaaa}));
+	CPPUNIT_ASSERT(cache.paired({0xa3000000bbbbbbbb}));
+	CPPUNIT_ASSERT(cache.paired({0xa300000001020304}));
+
+	JournalDeviceCache reloaded;
+	reloaded.setFile(journal.toString());
+	reloaded.setup();
+
+	CPPUNIT_ASSERT_EQUAL(2, reloaded.paired(VDEV).size());
+	CPPUNIT_ASSERT(!reloaded.paired({0xa3000000aaaaaaaa}));
+
+	reloaded.markPaired(VDEV, {});
+	CPPUNIT_ASSERT(reloaded.paired(VDEV).empty());
+	CPPUNIT_ASSERT(!reloaded.paired({0xa300000001020304}));
+}
+
+/**
+ * @brief Test devices stored in the layout of FilesystemDeviceCache are
+ * migrated into a new journal. Once the journal exists, the legacy
+ * directory is not consulted anymore.
+ */
+void JournalDeviceCacheTest::testMigrateOnce()
+{
+	const DevicePrefix &VDEV = DevicePrefix::PREFIX_VIRTUAL_DEVICE;
+	const Path journal(testingPath(), "devices.journal");
+	const Path legacy(testingPath(), "devices");
+
+	CPPUNIT_ASSERT_NO_THROW(File(Path(legacy, "vdev")).createDirectories());
+	CPPUNIT_ASSERT_NO_THROW(
+		File(Path(legacy, "vdev/0xa3000000aaaaaaaa")).createFile());
+	CPPUNIT_ASSERT_NO_THROW(
+		File(Path(legacy, "vdev/0xa3000000bbbbbbbb")).createFile());
+
+	JournalDeviceCache cache;
+	cache.setFile(journal.toString());
+	cache.setLegacyDir(legacy.toString());
+	cache.setup();
+
+	CPPUNIT_ASSERT_FILE_EXISTS(journal);
+	CPPUNIT_ASSERT_EQUAL(2, cache.paired(VDEV).size());
+	CPPUNIT_ASSERT(cache.paired({0xa3000000aaaaaaaa}));
+	CPPUNIT_ASSERT(cache.paired({0xa3000000bbbbbbbb}));
+
+	cache.markUnpaired({0xa3000000aaaaaaaa});
+	CPPUNIT_ASSERT_FILE_EXISTS(Path(legacy, "vdev/0xa3000000aaaaaaaa"));
+
+	JournalDeviceCache reloaded;
+	reloaded.setFile(journal.toString());
+	reloaded.setLegacyDir(legacy.toString());
+	reloaded.setup();
+
+	CPPUNIT_ASSERT_EQUAL(1, reloaded.paired(VDEV).size());
+	CPPUNIT_ASSERT(!reloaded.paired({0xa3000000aaaaaaaa}));
+	CPPUNIT_ASSERT(reloaded.paired({0xa3000000bbbbbbbb}));
+}
+
+}
@@ -0,0 +1,140 @@
+#include <sstream>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Exception.h>
+#include <Poco/Timespan.h>
+
+#include "cppunit/BetterAssert.h"
+#include "core/MetricsRegistry.h"
+
+using namespace std;
+using namespace Poco;
+
+namespace BeeeOn {
+
+class MetricsRegistryTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(MetricsRegistryTest);
+	CPPUNIT_TEST(testSameHandle);
+	CPPUNIT_TEST(testTypeConflict);
+	CPPUNIT_TEST(testHistogram);
+	CPPUNIT_TEST(testFormat);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void testSameHandle();
+	void testTypeConflict();
+	void testHistogram();
+	void testFormat();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MetricsRegistryTest);
+
+/**
+ * @brief Test that the same name and labels lead to the same metric
+ * while different labels lead to different metrics.
+ */
+void MetricsRegistryTest::testSameHandle()
+{
+	MetricsRegistry registry;
+
+	auto a = registry.counter("test_total", "help", {{"x", "1"}});
+	auto b = registry.counter("test_total", "help", {{"x", "1"}});
+	auto c = registry.counter("test_total", "help", {{"x", "2"}});
+
+	a->add();
+	b->add(2);
+	c->add();
+
+	CPPUNIT_ASSERT(a == b);
+	CPPUNIT_ASSERT_EQUAL(3, a->value());
+	CPPUNIT_ASSERT_EQUAL(1, c->value());
+
+	auto gauge = registry.gauge("test_size", "help");
+	gauge->set(10);
+	gauge->add(-3);
+	CPPUNIT_ASSERT_EQUAL(7, registry.gauge("test_size", "help")->value());
+}
+
+/**
+ * @brief Test that a name cannot be reused for a metric of another type.
+ */
+void MetricsRegistryTest::testTypeConflict()
+{
+	MetricsRegistry registry;
+
+	registry.counter("test", "help");
+	CPPUNIT_ASSERT_THROW(registry.gauge("test", "help"), ExistsException);
+	CPPUNIT_ASSERT_THROW(registry.histogram("test", "help"), ExistsException);
+}
+
+/**
+ * @brief Test that observations are counted into the right buckets,
+ * the bound itself belongs to the bucket.
+ */
+void MetricsRegistryTest::testHistogram()
+{
+	CPPUNIT_ASSERT_THROW(
+		MetricsRegistry::createHistogram({2 * Timespan::SECONDS, 1 * Timespan::SECONDS}),
+		InvalidArgumentException);
+
+	auto h = MetricsRegistry::createHistogram({
+		10 * Timespan::MILLISECONDS,
+		100 * Timespan::MILLISECONDS,
+	});
+
+	h->observe(5 * Timespan::MILLISECONDS);
+	h->observe(10 * Timespan::MILLISECONDS);
+	h->observe(50 * Timespan::MILLISECONDS);
+	h->observe(1 * Timespan::SECONDS);
+
+	CPPUNIT_ASSERT_EQUAL(2, h->bucket(0));
+	CPPUNIT_ASSERT_EQUAL(1, h->bucket(1));
+	CPPUNIT_ASSERT_EQUAL(1, h->bucket(2));
+	CPPUNIT_ASSERT_EQUAL(4, h->count());
+	CPPUNIT_ASSERT_EQUAL(1065 * Timespan::MILLISECONDS, h->sum().totalMicroseconds());
+}
+
+/**
+ * @brief Test rendering in the Prometheus text format including
+ * filtering by a prefix.
+ */
+void MetricsRegistryTest::testFormat()
+{
+	MetricsRegistry registry;
+
+	registry.counter("a_total", "Counter A", {{"q", "x\"y"}})->add(5);
+	registry.gauge("b_size", "Gauge B")->set(-2);
+	registry.histogram("c_seconds", "Histogram C", {{"q", "0"}},
+		{1 * Timespan::MILLISECONDS, 1 * Timespan::SECONDS})
+			->observe(500 * Timespan::MILLISECONDS);
+
+	ostringstream all;
+	registry.format(all);
+
+	CPPUNIT_ASSERT_EQUAL(
+		"# HELP a_total Counter A\n"
+		"# TYPE a_total counter\n"
+		"a_total{q=\"x\\\"y\"} 5\n"
+		"# HELP b_size Gauge B\n"
+		"# TYPE b_size gauge\n"
+		"b_size -2\n"
+		"# HELP c_seconds Histogram C\n"
+		"# TYPE c_seconds histogram\n"
+		"c_seconds_bucket{q=\"0\",le=\"0.001000\"} 0\n"
+		"c_seconds_bucket{q=\"0\",le=\"1.000000\"} 1\n"
+		"c_seconds_bucket{q=\"0\",le=\"+Inf\"} 1\n"
+		"c_seconds_sum{q=\"0\"} 0.500000\n"
+		"c_seconds_count{q=\"0\"} 1\n",
+		all.str());
+
+	ostringstream filtered;
+	registry.format(filtered, "b_");
+
+	CPPUNIT_ASSERT_EQUAL(
+		"# HELP b_size Gauge B\n"
+		"# TYPE b_size gauge\n"
+		"b_size -2\n",
+		filtered.str());
+}
+
+}
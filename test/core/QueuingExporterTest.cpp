@@ -1,5 +1,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <Poco/Thread.h>
+
 #include "cppunit/BetterAssert.h"
 
 #include "core/QueuingExporter.h"
@@ -16,6 +18,7 @@ public:
 	using QueuingExporter::acquire;
 	using QueuingExporter::ack;
 	using QueuingExporter::reset;
+	using QueuingExporter::inFlight;
 };
 
 class TestingQueuingStrategyEmpty : public QueuingStrategy {
@@ -100,6 +103,28 @@ public:
 	}
 };
 
+class TestingQueuingStrategyCounting : public InMemoryQueuingStrategy {
+public:
+	TestingQueuingStrategyCounting():
+		m_pushes(0)
+	{
+	}
+
+	void push(const vector<SensorData> &data) override
+	{
+		m_pushes += 1;
+		InMemoryQueuingStrategy::push(data);
+	}
+
+	size_t pushes() const
+	{
+		return m_pushes;
+	}
+
+private:
+	size_t m_pushes;
+};
+
 class QueuingExporterTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(QueuingExporterTest);
 	CPPUNIT_TEST(testAcquireAck);
@@ -112,6 +137,10 @@ class QueuingExporterTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testStrategyPriorityEmptyStrategy);
 	CPPUNIT_TEST(testStrategyPriorityEmptyExporter);
 	CPPUNIT_TEST(testFailingStrategy);
+	CPPUNIT_TEST(testBatchesAckOutOfOrder);
+	CPPUNIT_TEST(testBatchesWithStrategy);
+	CPPUNIT_TEST(testBatchReset);
+	CPPUNIT_TEST(testSaveGroupWindow);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -125,6 +154,10 @@ public:
 	void testStrategyPriorityEmptyStrategy();
 	void testStrategyPriorityEmptyExporter();
 	void testFailingStrategy();
+	void testBatchesAckOutOfOrder();
+	void testBatchesWithStrategy();
+	void testBatchReset();
+	void testSaveGroupWindow();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(QueuingExporterTest);
@@ -482,4 +515,195 @@ void QueuingExporterTest::testFailingStrategy()
 	CPPUNIT_ASSERT_NO_THROW(exporter.ack());
 }
 
+/**
+ * The test verifies that multiple batches can be in-flight at once, each of
+ * them contains different data and acknowledging a batch releases only its
+ * own data regardless the order of acknowledging.
+ */
+void QueuingExporterTest::testBatchesAckOutOfOrder()
+{
+	TestableQueuingExporter exporter;
+	QueuingStrategy::Ptr strategy = new InMemoryQueuingStrategy;
+	exporter.setStrategy(strategy);
+	exporter.setSaveThreshold(50);
+
+	for (int i = 0; i < 6; ++i) {
+		exporter.ship({
+			DeviceID(0x8888999988880000 + i),
+			Timestamp(),
+			{{4, 79}}
+		});
+	}
+
+	const GlobalID id0 = GlobalID::random();
+	const GlobalID id1 = GlobalID::random();
+	const GlobalID id2 = GlobalID::random();
+	vector<SensorData> batch0;
+	vector<SensorData> batch1;
+	vector<SensorData> batch2;
+
+	CPPUNIT_ASSERT(exporter.acquire(id0, batch0, 2, 0));
+	CPPUNIT_ASSERT(exporter.acquire(id1, batch1, 2, 0));
+	CPPUNIT_ASSERT_EQUAL(2, exporter.inFlight());
+
+	CPPUNIT_ASSERT_EQUAL(2, batch0.size());
+	CPPUNIT_ASSERT_EQUAL(2, batch1.size());
+	CPPUNIT_ASSERT(batch0[0].deviceID() == DeviceID(0x8888999988880000));
+	CPPUNIT_ASSERT(batch0[1].deviceID() == DeviceID(0x8888999988880001));
+	CPPUNIT_ASSERT(batch1[0].deviceID() == DeviceID(0x8888999988880002));
+	CPPUNIT_ASSERT(batch1[1].deviceID() == DeviceID(0x8888999988880003));
+
+	// ack the newer batch first
+	CPPUNIT_ASSERT(exporter.ack(id1));
+	CPPUNIT_ASSERT(!exporter.ack(id1));
+	CPPUNIT_ASSERT_EQUAL(1, exporter.inFlight());
+
+	CPPUNIT_ASSERT(exporter.acquire(id2, batch2, 10, 0));
+	CPPUNIT_ASSERT_EQUAL(2, batch2.size());
+	CPPUNIT_ASSERT(batch2[0].deviceID() == DeviceID(0x8888999988880004));
+	CPPUNIT_ASSERT(batch2[1].deviceID() == DeviceID(0x8888999988880005));
+
+	// everything is in-flight
+	vector<SensorData> none;
+	CPPUNIT_ASSERT(!exporter.acquire(GlobalID::random(), none, 10, 0));
+	CPPUNIT_ASSERT(none.empty());
+
+	CPPUNIT_ASSERT(exporter.ack(id0));
+	CPPUNIT_ASSERT(exporter.ack(id2));
+	CPPUNIT_ASSERT_EQUAL(0, exporter.inFlight());
+	CPPUNIT_ASSERT(exporter.empty());
+}
+
+/**
+ * The test verifies that data peeked from the QueuingStrategy by multiple
+ * batches are not duplicated and that they are popped only after all
+ * the older batches are acknowledged.
+ */
+void QueuingExporterTest::testBatchesWithStrategy()
+{
+	InMemoryQueuingStrategy::Ptr strategy = new InMemoryQueuingStrategy;
+	vector<SensorData> data;
+
+	for (int i = 0; i < 6; ++i) {
+		data.push_back({
+			DeviceID(0x8888999988880000 + i),
+			Timestamp(),
+			{{4, 79}}
+		});
+	}
+
+	strategy->push(data);
+
+	TestableQueuingExporter exporter;
+	exporter.setStrategy(strategy);
+
+	const GlobalID id0 = GlobalID::random();
+	const GlobalID id1 = GlobalID::random();
+	vector<SensorData> batch0;
+	vector<SensorData> batch1;
+
+	CPPUNIT_ASSERT(exporter.acquire(id0, batch0, 3, 0));
+	CPPUNIT_ASSERT(exporter.acquire(id1, batch1, 3, 0));
+
+	CPPUNIT_ASSERT_EQUAL(3, batch0.size());
+	CPPUNIT_ASSERT_EQUAL(3, batch1.size());
+	CPPUNIT_ASSERT(batch0[0].deviceID() == DeviceID(0x8888999988880000));
+	CPPUNIT_ASSERT(batch1[0].deviceID() == DeviceID(0x8888999988880003));
+
+	// the older batch is not acked yet, nothing can be popped
+	CPPUNIT_ASSERT(exporter.ack(id1));
+	CPPUNIT_ASSERT_EQUAL(6, strategy->size());
+
+	CPPUNIT_ASSERT(exporter.ack(id0));
+	CPPUNIT_ASSERT_EQUAL(0, strategy->size());
+}
+
+/**
+ * The test verifies that resetting a batch releases its data and data
+ * of the newer batches so they are acquired again.
+ */
+void QueuingExporterTest::testBatchReset()
+{
+	TestableQueuingExporter exporter;
+	QueuingStrategy::Ptr strategy = new InMemoryQueuingStrategy;
+	exporter.setStrategy(strategy);
+	exporter.setSaveThreshold(50);
+
+	for (int i = 0; i < 4; ++i) {
+		exporter.ship({
+			DeviceID(0x8888999988880000 + i),
+			Timestamp(),
+			{{4, 79}}
+		});
+	}
+
+	const GlobalID id0 = GlobalID::random();
+	const GlobalID id1 = GlobalID::random();
+	vector<SensorData> batch0;
+	vector<SensorData> batch1;
+
+	CPPUNIT_ASSERT(exporter.acquire(id0, batch0, 2, 0));
+	CPPUNIT_ASSERT(exporter.acquire(id1, batch1, 2, 0));
+
+	exporter.reset(id1);
+	CPPUNIT_ASSERT_EQUAL(1, exporter.inFlight());
+
+	vector<SensorData> again;
+	CPPUNIT_ASSERT(exporter.acquire(GlobalID::random(), again, 2, 0));
+	CPPUNIT_ASSERT_EQUAL(2, again.size());
+	CPPUNIT_ASSERT(again[0] == batch1[0]);
+	CPPUNIT_ASSERT(again[1] == batch1[1]);
+
+	exporter.reset();
+	CPPUNIT_ASSERT_EQUAL(0, exporter.inFlight());
+	CPPUNIT_ASSERT(!exporter.empty());
+}
+
+/**
+ * The test verifies that when the saveTimeout has elapsed, the data shipped
+ * within the saveGroupWindow are pushed to the QueuingStrategy together and
+ * that reaching the saveThreshold pushes them immediately.
+ */
+void QueuingExporterTest::testSaveGroupWindow()
+{
+	TestableQueuingExporter exporter;
+	SharedPtr<TestingQueuingStrategyCounting> strategy =
+		new TestingQueuingStrategyCounting;
+	exporter.setStrategy(strategy);
+	exporter.setSaveThreshold(10);
+	exporter.setSaveTimeout(0);
+	exporter.setSaveGroupWindow(200 * Timespan::MILLISECONDS);
+
+	const SensorData testData = {
+		0x8888999988889999,
+		Timestamp(),
+		{{44, 789}}
+	};
+
+	// nothing has been saved yet, the first data are pushed immediately
+	exporter.ship(testData);
+	CPPUNIT_ASSERT_EQUAL(1, strategy->pushes());
+	CPPUNIT_ASSERT_EQUAL(1, strategy->size());
+
+	exporter.ship(testData);
+	exporter.ship(testData);
+	CPPUNIT_ASSERT_EQUAL(1, strategy->pushes());
+	CPPUNIT_ASSERT_EQUAL(1, strategy->size());
+
+	Thread::sleep(250);
+
+	exporter.ship(testData);
+	CPPUNIT_ASSERT_EQUAL(2, strategy->pushes());
+	CPPUNIT_ASSERT_EQUAL(4, strategy->size());
+
+	for (int i = 0; i < 9; ++i)
+		exporter.ship(testData);
+
+	CPPUNIT_ASSERT_EQUAL(2, strategy->pushes());
+
+	exporter.ship(testData);
+	CPPUNIT_ASSERT_EQUAL(3, strategy->pushes());
+	CPPUNIT_ASSERT_EQUAL(14, strategy->size());
+}
+
 }
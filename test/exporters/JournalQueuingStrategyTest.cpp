@@ -2,8 +2,11 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <Poco/DirectoryIterator.h>
 #include <Poco/Error.h>
 #include <Poco/Exception.h>
+#include <Poco/FileStream.h>
+#include <Poco/SHA1Engine.h>
 
 #include "cppunit/BetterAssert.h"
 #include "cppunit/FileTestFixture.h"
@@ -87,6 +90,13 @@ static const vector<SensorData> data_dbf5f6c = {
 	}
 };
 
+class TestableJournalQueuingStrategy : public JournalQueuingStrategy {
+public:
+	using JournalQueuingStrategy::bytesUsedAll;
+	using JournalQueuingStrategy::FileBuffer;
+	using JournalQueuingStrategy::FileBufferStat;
+};
+
 class JournalQueuingStrategyTest : public FileTestFixture {
 	CPPUNIT_TEST_SUITE(JournalQueuingStrategyTest);
 	CPPUNIT_TEST(testTestingData);
@@ -94,6 +104,8 @@ class JournalQueuingStrategyTest : public FileTestFixture {
 	CPPUNIT_TEST(testSetupExistingEmpty);
 	CPPUNIT_TEST(testSetupExisting);
 	CPPUNIT_TEST(testSetupWithBroken);
+	CPPUNIT_TEST(testSetupKeepsUnreadable);
+	CPPUNIT_TEST(testInspectSkipsBrokenRecords);
 	CPPUNIT_TEST(testPushSuccessful);
 	CPPUNIT_TEST(testPushNotWritable);
 	CPPUNIT_TEST(testPushDiskFullOnIndexAppend);
@@ -101,6 +113,11 @@ class JournalQueuingStrategyTest : public FileTestFixture {
 	CPPUNIT_TEST(testPushOverSizeWithGC);
 	CPPUNIT_TEST(testPushOverSizeNoGC);
 	CPPUNIT_TEST(testPushOverRLimit);
+	CPPUNIT_TEST(testBytesUsedAllTracked);
+	CPPUNIT_TEST(testPushBinary);
+	CPPUNIT_TEST(testReadMixedFormats);
+	CPPUNIT_TEST(testPushCompressed);
+	CPPUNIT_TEST(testStreamReader);
 	CPPUNIT_TEST(testRepeatedPeekStable);
 	CPPUNIT_TEST(testPopFromEmpty);
 	CPPUNIT_TEST(testPopZero);
@@ -114,6 +131,8 @@ public:
 	void testSetupExistingEmpty();
 	void testSetupExisting();
 	void testSetupWithBroken();
+	void testSetupKeepsUnreadable();
+	void testInspectSkipsBrokenRecords();
 	void testPushSuccessful();
 	void testPushNotWritable();
 	void testPushDiskFullOnIndexAppend();
@@ -121,6 +140,11 @@ public:
 	void testPushOverSizeWithGC();
 	void testPushOverSizeNoGC();
 	void testPushOverRLimit();
+	void testBytesUsedAllTracked();
+	void testPushBinary();
+	void testReadMixedFormats();
+	void testPushCompressed();
+	void testStreamReader();
 	void testRepeatedPeekStable();
 	void testPopFromEmpty();
 	void testPopZero();
@@ -285,6 +309,74 @@ void JournalQueuingStrategyTest::testSetupWithBroken()
 	CPPUNIT_ASSERT_FILE_EXISTS(data1);
 }
 
+/**
+ * @brief Test setup of JournalQueuingStrategy on repository with a buffer
+ * that cannot be mapped (I/O error). Such buffer might still contain valid
+ * data thus it must be neither dropped from the index nor removed.
+ */
+void JournalQueuingStrategyTest::testSetupKeepsUnreadable()
+{
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+
+	File data0(Path(testingPath(), "b2d37030ae3d28d6fde6db21b43362ae54a35299"));
+	data0.createDirectories(); // mapping fails
+
+	File index(Path(testingPath(), "index"));
+	writeFile(index,
+		"D29C989A\tb2d37030ae3d28d6fde6db21b43362ae54a35299\t0\n");
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+	CPPUNIT_ASSERT(strategy.empty());
+
+	CPPUNIT_ASSERT_FILE_TEXTUAL_EQUALS(
+		"D29C989A\tb2d37030ae3d28d6fde6db21b43362ae54a35299\t0\n",
+		index);
+	CPPUNIT_ASSERT_FILE_EXISTS(data0);
+}
+
+/**
+ * @brief Test that inspection of a buffer with a valid digest skips broken
+ * records (of both formats) and counts them. Valid records following the
+ * broken one are still counted.
+ */
+void JournalQueuingStrategyTest::testInspectSkipsBrokenRecords()
+{
+	typedef TestableJournalQueuingStrategy::FileBuffer FileBuffer;
+	typedef TestableJournalQueuingStrategy::FileBufferStat FileBufferStat;
+
+	string text = raw_b2d3703;
+	const size_t value = text.find("\"value\":1.000");
+	CPPUNIT_ASSERT(value != string::npos);
+	text[value + 8] = '2'; // CRC does not match anymore
+
+	string binary = FileBuffer::formatBuffer(
+		FileBuffer::formatEntries(data_b2d3703, JournalQueuingStrategy::FORMAT_BINARY),
+		JournalQueuingStrategy::FORMAT_BINARY);
+	// header (8 B) and the first record with 3 values (52 B)
+	binary[8 + 52 + 10] ^= 0xff; // device ID of the second record
+
+	for (const auto &contents : {text, binary}) {
+		SHA1Engine engine;
+		engine.update(contents);
+		const auto &digest = engine.digest();
+
+		File file(Path(testingPath(), DigestEngine::digestToHex(digest)));
+		writeFile(file, contents);
+
+		FileBuffer buffer(file.path(), 0, contents.size());
+		FileBufferStat stat;
+
+		CPPUNIT_ASSERT_NO_THROW(buffer.inspectAndVerify(digest, stat));
+		CPPUNIT_ASSERT_EQUAL(2, stat.count);
+		CPPUNIT_ASSERT_EQUAL(1, stat.broken);
+		CPPUNIT_ASSERT_EQUAL(contents.size(), stat.offset);
+		CPPUNIT_ASSERT_EQUAL(contents.size(), stat.bytes);
+		CPPUNIT_ASSERT(stat.oldest == data_b2d3703[0].timestamp().value());
+		CPPUNIT_ASSERT(stat.newest == data_b2d3703[2].timestamp().value());
+	}
+}
+
 /**
  * @brief Test behaviour of a proper push() call into an empty repository.
  * After the push, the index should contain valid records and appropriate
@@ -384,6 +476,232 @@ void JournalQueuingStrategyTest::testPushDiskFullOnIndexAppend()
 	CPPUNIT_ASSERT_EQUAL(0, index.getSize());
 }
 
+/**
+ * @brief Test that the bytes used by the strategy are tracked while pushing
+ * and garbage collecting and that it matches the real contents of the
+ * repository.
+ */
+void JournalQueuingStrategyTest::testBytesUsedAllTracked()
+{
+	TestableJournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+	strategy.setBytesLimit(700);
+
+	File dangling(Path(testingPath(), "b2d37030ae3d28d6fde6db21b43362ae54a35299"));
+	writeFile(dangling, raw_b2d3703);
+
+	const auto onDisk = [&]() -> size_t {
+		size_t bytes = 0;
+		DirectoryIterator it(testingFile());
+		const DirectoryIterator end;
+
+		for (; it != end; ++it)
+			bytes += it->getSize();
+
+		return bytes;
+	};
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+	CPPUNIT_ASSERT_EQUAL(onDisk(), strategy.bytesUsedAll());
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.push(data_3a8f509));
+	CPPUNIT_ASSERT_EQUAL(onDisk(), strategy.bytesUsedAll());
+
+	// over limit, the dangling buffer is collected
+	CPPUNIT_ASSERT_NO_THROW(strategy.push(data_6fef851));
+	CPPUNIT_ASSERT_FILE_NOT_EXISTS(dangling);
+	CPPUNIT_ASSERT_EQUAL(onDisk(), strategy.bytesUsedAll());
+}
+
+/**
+ * @brief Test push() of data in the binary format. The created buffer starts
+ * with the binary header and consists of fixed-width records (22 B + 10 B per
+ * value). The data must be read back unchanged after restart.
+ */
+void JournalQueuingStrategyTest::testPushBinary()
+{
+	File index(Path(testingPath(), "index"));
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(testingFile().path());
+		strategy.setBufferFormat("binary");
+
+		CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+		CPPUNIT_ASSERT_NO_THROW(strategy.push(data_b2d3703));
+	}
+
+	Journal journal(index);
+	CPPUNIT_ASSERT_NO_THROW(journal.load());
+	CPPUNIT_ASSERT_EQUAL(1, journal.records().size());
+
+	File buffer(Path(testingPath(), journal.records().front().key));
+	CPPUNIT_ASSERT_FILE_EXISTS(buffer);
+	CPPUNIT_ASSERT_EQUAL(8 + 3 * 22 + 6 * 10, buffer.getSize());
+
+	FileInputStream fin(buffer.path());
+	char magic[5];
+	fin.read(magic, sizeof(magic));
+	CPPUNIT_ASSERT_EQUAL(string("\0JQS\1", 5), string(magic, sizeof(magic)));
+
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+
+	vector<SensorData> data;
+	CPPUNIT_ASSERT_EQUAL(3, strategy.peek(data, 4));
+	CPPUNIT_ASSERT(data[0] == data_b2d3703[0]);
+	CPPUNIT_ASSERT(data[1] == data_b2d3703[1]);
+	CPPUNIT_ASSERT(data[2] == data_b2d3703[2]);
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.pop(3));
+	CPPUNIT_ASSERT(strategy.empty());
+}
+
+/**
+ * @brief Test that buffers written in the text format are still read when
+ * the binary format is configured and both formats can be mixed in a single
+ * repository.
+ */
+void JournalQueuingStrategyTest::testReadMixedFormats()
+{
+	File data0(Path(testingPath(), "b2d37030ae3d28d6fde6db21b43362ae54a35299"));
+	writeFile(data0, raw_b2d3703);
+
+	File index(Path(testingPath(), "index"));
+	writeFile(index,
+		"D29C989A\tb2d37030ae3d28d6fde6db21b43362ae54a35299\t0\n");
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(testingFile().path());
+		strategy.setBufferFormat("binary");
+
+		CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+		CPPUNIT_ASSERT_NO_THROW(strategy.push(data_6fef851));
+	}
+
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+	strategy.setBufferFormat("binary");
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+
+	vector<SensorData> data;
+	CPPUNIT_ASSERT_EQUAL(5, strategy.peek(data, 5));
+	CPPUNIT_ASSERT(data[0] == data_b2d3703[0]);
+	CPPUNIT_ASSERT(data[1] == data_b2d3703[1]);
+	CPPUNIT_ASSERT(data[2] == data_b2d3703[2]);
+	CPPUNIT_ASSERT(data[3] == data_6fef851[0]);
+	CPPUNIT_ASSERT(data[4] == data_6fef851[1]);
+
+	CPPUNIT_ASSERT_FILE_TEXTUAL_EQUALS(raw_b2d3703, data0);
+}
+
+/**
+ * @brief Test push() of data with compression enabled. The buffer starts
+ * with the header marking deflated text records. The data must be read
+ * back unchanged after restart and the offset of a partial pop (pointing
+ * into the inflated records) must be respected.
+ */
+void JournalQueuingStrategyTest::testPushCompressed()
+{
+	File index(Path(testingPath(), "index"));
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(testingFile().path());
+		strategy.setBufferFormat("text");
+		strategy.setCompression("deflate");
+
+		CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+		CPPUNIT_ASSERT_NO_THROW(strategy.push(data_b2d3703));
+	}
+
+	Journal journal(index);
+	CPPUNIT_ASSERT_NO_THROW(journal.load());
+	CPPUNIT_ASSERT_EQUAL(1, journal.records().size());
+
+	File buffer(Path(testingPath(), journal.records().front().key));
+	CPPUNIT_ASSERT_FILE_EXISTS(buffer);
+
+	FileInputStream fin(buffer.path());
+	char header[6];
+	fin.read(header, sizeof(header));
+	CPPUNIT_ASSERT_EQUAL(string("\0JQS\1\3", 6), string(header, sizeof(header)));
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(testingFile().path());
+		CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+
+		vector<SensorData> data;
+		CPPUNIT_ASSERT_EQUAL(1, strategy.peek(data, 1));
+		CPPUNIT_ASSERT(data[0] == data_b2d3703[0]);
+		CPPUNIT_ASSERT_NO_THROW(strategy.pop(1));
+	}
+
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+
+	vector<SensorData> data;
+	CPPUNIT_ASSERT_EQUAL(2, strategy.peek(data, 4));
+	CPPUNIT_ASSERT(data[0] == data_b2d3703[1]);
+	CPPUNIT_ASSERT(data[1] == data_b2d3703[2]);
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.pop(2));
+	CPPUNIT_ASSERT(strategy.empty());
+}
+
+/**
+ * @brief Test that buffers of both formats are verified and read by
+ * the stream reader the same way as by the default one. The file is
+ * read again on each peek() and the offsets of pop() are respected.
+ */
+void JournalQueuingStrategyTest::testStreamReader()
+{
+	File data0(Path(testingPath(), "b2d37030ae3d28d6fde6db21b43362ae54a35299"));
+	writeFile(data0, raw_b2d3703);
+
+	File index(Path(testingPath(), "index"));
+	writeFile(index,
+		"D29C989A\tb2d37030ae3d28d6fde6db21b43362ae54a35299\t0\n");
+
+	{
+		JournalQueuingStrategy strategy;
+		strategy.setRootDir(testingFile().path());
+		strategy.setBufferFormat("binary");
+		strategy.setBufferReader("stream");
+
+		CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+		CPPUNIT_ASSERT_NO_THROW(strategy.push(data_6fef851));
+	}
+
+	JournalQueuingStrategy strategy;
+	strategy.setRootDir(testingFile().path());
+	strategy.setBufferReader("stream");
+	CPPUNIT_ASSERT_NO_THROW(strategy.setup());
+
+	vector<SensorData> data;
+	CPPUNIT_ASSERT_EQUAL(2, strategy.peek(data, 2));
+	CPPUNIT_ASSERT(data[0] == data_b2d3703[0]);
+	CPPUNIT_ASSERT(data[1] == data_b2d3703[1]);
+	CPPUNIT_ASSERT_NO_THROW(strategy.pop(2));
+
+	data.clear();
+	CPPUNIT_ASSERT_EQUAL(3, strategy.peek(data, 5));
+	CPPUNIT_ASSERT(data[0] == data_b2d3703[2]);
+	CPPUNIT_ASSERT(data[1] == data_6fef851[0]);
+	CPPUNIT_ASSERT(data[2] == data_6fef851[1]);
+
+	CPPUNIT_ASSERT_NO_THROW(strategy.pop(3));
+	CPPUNIT_ASSERT(strategy.empty());
+
+	CPPUNIT_ASSERT_THROW(
+		strategy.setBufferReader("unknown"),
+		InvalidArgumentException);
+}
+
 /**
  * @brief Test situation when there is the data.tmp file in the repository while
  * pushing the exactly same data. We should not fail as we count that only
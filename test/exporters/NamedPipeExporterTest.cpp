@@ -0,0 +1,278 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Clock.h>
+#include <Poco/Exception.h>
+#include <Poco/Path.h>
+#include <Poco/Timespan.h>
+
+#include "cppunit/BetterAssert.h"
+#include "cppunit/FileTestFixture.h"
+#include "exporters/NamedPipeExporter.h"
+#include "model/SensorData.h"
+#include "util/PosixSignal.h"
+#include "util/SensorDataFormatter.h"
+
+using namespace Poco;
+using namespace std;
+
+namespace BeeeOn {
+
+class NamedPipeExporterTest : public FileTestFixture {
+	CPPUNIT_TEST_SUITE(NamedPipeExporterTest);
+	CPPUNIT_TEST(testNoReaderDrops);
+	CPPUNIT_TEST(testKeepOpenAcrossShips);
+	CPPUNIT_TEST(testReaderGone);
+	CPPUNIT_TEST(testBackpressureFail);
+	CPPUNIT_TEST(testBackpressureDrop);
+	CPPUNIT_TEST(testBackpressureBlock);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void setUp();
+	void testNoReaderDrops();
+	void testKeepOpenAcrossShips();
+	void testReaderGone();
+	void testBackpressureFail();
+	void testBackpressureDrop();
+	void testBackpressureBlock();
+
+protected:
+	string pipePath() const;
+	int openReader();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NamedPipeExporterTest);
+
+static const size_t LINE_SIZE = 1000;
+
+/**
+ * Formats each SensorData as a line of exactly LINE_SIZE bytes
+ * (including the newline) to make the pipe content predictable.
+ */
+class FixedLineFormatter : public SensorDataFormatter {
+public:
+	string format(const SensorData &data) override
+	{
+		string line = data.deviceID().toString();
+		line.resize(LINE_SIZE - 1, '.');
+		return line;
+	}
+};
+
+static vector<SensorData> generate(size_t count)
+{
+	vector<SensorData> data;
+
+	for (size_t i = 0; i < count; ++i) {
+		SensorData one;
+		one.setDeviceID(DeviceID(0xa300000000000000 | i));
+		data.push_back(one);
+	}
+
+	return data;
+}
+
+static string readAll(int fd)
+{
+	string result;
+	char buffer[4096];
+
+	for (;;) {
+		const ssize_t ret = ::read(fd, buffer, sizeof(buffer));
+		if (ret <= 0)
+			break;
+
+		result.append(buffer, ret);
+	}
+
+	return result;
+}
+
+void NamedPipeExporterTest::setUp()
+{
+	FileTestFixture::setUpAsDirectory();
+	PosixSignal::ignore("SIGPIPE");
+}
+
+string NamedPipeExporterTest::pipePath() const
+{
+	return Path(testingPath(), "exporter").toString();
+}
+
+int NamedPipeExporterTest::openReader()
+{
+	const int fd = ::open(pipePath().c_str(), O_RDONLY | O_NONBLOCK);
+	CPPUNIT_ASSERT(fd >= 0);
+	return fd;
+}
+
+/**
+ * @brief Test that the named pipe is created on the first ship and
+ * data are dropped (reported as shipped) while there is no reader.
+ */
+void NamedPipeExporterTest::testNoReaderDrops()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	struct stat st;
+	CPPUNIT_ASSERT_EQUAL(0, ::stat(pipePath().c_str(), &st));
+	CPPUNIT_ASSERT(S_ISFIFO(st.st_mode));
+
+	CPPUNIT_ASSERT_EQUAL(5, exporter.shipBatch(generate(5)));
+}
+
+/**
+ * @brief Test that the pipe is kept open between ships, thus the reader
+ * never sees the end of file, and a batch is written completely.
+ */
+void NamedPipeExporterTest::testKeepOpenAcrossShips()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	const int reader = openReader();
+
+	CPPUNIT_ASSERT_EQUAL(3, exporter.shipBatch(generate(3)));
+	CPPUNIT_ASSERT_EQUAL(3 * LINE_SIZE, readAll(reader).size());
+
+	char c;
+	CPPUNIT_ASSERT_EQUAL(-1, ::read(reader, &c, 1));
+	CPPUNIT_ASSERT_EQUAL(EAGAIN, errno);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+	CPPUNIT_ASSERT_EQUAL(LINE_SIZE, readAll(reader).size());
+
+	::close(reader);
+}
+
+/**
+ * @brief Test that the exporter survives disconnection of the reader
+ * (EPIPE), drops data while there is no reader and reaches a new reader.
+ */
+void NamedPipeExporterTest::testReaderGone()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	int reader = openReader();
+	CPPUNIT_ASSERT_EQUAL(2, exporter.shipBatch(generate(2)));
+	::close(reader);
+
+	CPPUNIT_ASSERT_EQUAL(2, exporter.shipBatch(generate(2)));
+
+	reader = openReader();
+	CPPUNIT_ASSERT_EQUAL(2, exporter.shipBatch(generate(2)));
+	CPPUNIT_ASSERT_EQUAL(2 * LINE_SIZE, readAll(reader).size());
+	::close(reader);
+}
+
+/**
+ * @brief Test that when the pipe is full, only the written prefix is
+ * reported as shipped and a partially written line is completed before
+ * any other data.
+ */
+void NamedPipeExporterTest::testBackpressureFail()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+	exporter.setBackpressure("fail");
+
+	CPPUNIT_ASSERT_THROW(exporter.setBackpressure("unknown"), InvalidArgumentException);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	const int reader = openReader();
+
+	// much more than a default pipe capacity
+	const size_t shipped = exporter.shipBatch(generate(200));
+	CPPUNIT_ASSERT(shipped > 0);
+	CPPUNIT_ASSERT(shipped < 200);
+
+	string content = readAll(reader);
+	CPPUNIT_ASSERT(content.size() <= shipped * LINE_SIZE);
+
+	CPPUNIT_ASSERT_EQUAL(1, exporter.shipBatch(generate(1)));
+	content += readAll(reader);
+
+	CPPUNIT_ASSERT_EQUAL((shipped + 1) * LINE_SIZE, content.size());
+
+	for (size_t i = 0; i < shipped + 1; ++i) {
+		const size_t end = (i + 1) * LINE_SIZE - 1;
+		CPPUNIT_ASSERT_EQUAL('\n', content[end]);
+		CPPUNIT_ASSERT_EQUAL('0', content[i * LINE_SIZE]);
+	}
+
+	::close(reader);
+}
+
+/**
+ * @brief Test that data that do not fit into the pipe are dropped
+ * with the drop policy.
+ */
+void NamedPipeExporterTest::testBackpressureDrop()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+	exporter.setBackpressure("drop");
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	const int reader = openReader();
+
+	CPPUNIT_ASSERT_EQUAL(200, exporter.shipBatch(generate(200)));
+	CPPUNIT_ASSERT(readAll(reader).size() < 200 * LINE_SIZE);
+
+	::close(reader);
+}
+
+/**
+ * @brief Test that the block policy waits for the reader up to
+ * the configured timeout and then reports the rest as not shipped.
+ */
+void NamedPipeExporterTest::testBackpressureBlock()
+{
+	FixedLineFormatter formatter;
+	NamedPipeExporter exporter;
+	exporter.setFilePath(pipePath());
+	exporter.setFormatter(&formatter);
+	exporter.setBackpressure("block");
+	exporter.setBlockTimeout(20 * Timespan::MILLISECONDS);
+
+	CPPUNIT_ASSERT(exporter.ship(generate(1).front()));
+
+	const int reader = openReader();
+
+	const Clock started;
+	const size_t shipped = exporter.shipBatch(generate(200));
+
+	CPPUNIT_ASSERT(started.elapsed() >= 20 * Timespan::MILLISECONDS);
+	CPPUNIT_ASSERT(shipped > 0);
+	CPPUNIT_ASSERT(shipped < 200);
+
+	::close(reader);
+}
+
+}
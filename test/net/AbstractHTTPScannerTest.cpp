@@ -0,0 +1,222 @@
+#include <string>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Clock.h>
+#include <Poco/Thread.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Net/StreamSocket.h>
+
+#include "cppunit/BetterAssert.h"
+#include "net/AbstractHTTPScanner.h"
+
+using namespace Poco;
+using namespace Poco::Net;
+using namespace std;
+
+namespace BeeeOn {
+
+class AbstractHTTPScannerTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(AbstractHTTPScannerTest);
+	CPPUNIT_TEST(testSweepFindsListening);
+	CPPUNIT_TEST(testSweepSkipsClosed);
+	CPPUNIT_TEST(testStopDuringSweep);
+	CPPUNIT_TEST(testProbeVerifiesHosts);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void testSweepFindsListening();
+	void testSweepSkipsClosed();
+	void testStopDuringSweep();
+	void testProbeVerifiesHosts();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(AbstractHTTPScannerTest);
+
+/**
+ * Range 127.0.0.0/30, only 127.0.0.1 is listening in the tests,
+ * the other loopback addresses refuse connections.
+ */
+static const IPAddress LOOPBACK_NETWORK("127.0.0.0");
+static const IPAddress LOOPBACK_MASK("255.255.255.252");
+
+class TestableHTTPScanner : public AbstractHTTPScanner {
+public:
+	TestableHTTPScanner(uint16_t port):
+		AbstractHTTPScanner("/info", port, IPAddress("255.255.255.0"))
+	{
+		setPingTimeout(1 * Timespan::SECONDS);
+		setHTTPTimeout(1 * Timespan::SECONDS);
+		setMaxInFlightProbes(4);
+		setVerifyThreads(2);
+	}
+
+	using AbstractHTTPScanner::probeAddressRange;
+	using AbstractHTTPScanner::sweepAddressRange;
+
+protected:
+	void prepareRequest(HTTPRequest &request) override
+	{
+		request.setMethod(HTTPRequest::HTTP_GET);
+		request.setURI(path());
+	}
+
+	bool isValidResponse(const string &response) override
+	{
+		return response == "beeeon";
+	}
+};
+
+class InfoHandler : public HTTPRequestHandler {
+public:
+	void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override
+	{
+		const string body = request.getURI() == "/info" ? "beeeon" : "other";
+
+		response.setContentLength(body.size());
+		response.send() << body;
+	}
+};
+
+class InfoHandlerFactory : public HTTPRequestHandlerFactory {
+public:
+	HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override
+	{
+		return new InfoHandler;
+	}
+};
+
+/**
+ * @brief Test the sweep reports the address where a loopback server
+ * is listening and nothing else of the range.
+ */
+void AbstractHTTPScannerTest::testSweepFindsListening()
+{
+	ServerSocket server(SocketAddress("127.0.0.1", 0));
+	const uint16_t port = server.address().port();
+
+	TestableHTTPScanner scanner(port);
+	StopControl control;
+	StopControl::Run run(control);
+
+	const auto hosts = scanner.sweepAddressRange(
+		run, IPAddressRange(LOOPBACK_NETWORK, LOOPBACK_MASK));
+
+	CPPUNIT_ASSERT_EQUAL(1, hosts.size());
+	CPPUNIT_ASSERT_EQUAL(
+		SocketAddress("127.0.0.1", port).toString(),
+		hosts.front().toString());
+}
+
+/**
+ * @brief Test the sweep skips a closed port quickly without waiting
+ * for the ping timeout.
+ */
+void AbstractHTTPScannerTest::testSweepSkipsClosed()
+{
+	uint16_t port;
+
+	{
+		ServerSocket server(SocketAddress("127.0.0.1", 0));
+		port = server.address().port();
+	}
+
+	TestableHTTPScanner scanner(port);
+	scanner.setPingTimeout(10 * Timespan::SECONDS);
+	StopControl control;
+	StopControl::Run run(control);
+
+	const Clock started;
+	const auto hosts = scanner.sweepAddressRange(
+		run, IPAddressRange(LOOPBACK_NETWORK, LOOPBACK_MASK));
+
+	CPPUNIT_ASSERT(hosts.empty());
+	CPPUNIT_ASSERT(started.elapsed() < 5 * Timespan::SECONDS);
+}
+
+/**
+ * @brief Test stop requested while the sweep waits for pending connects
+ * makes the sweep return promptly instead of waiting for the ping timeout.
+ * The connects are kept pending by a listening socket whose backlog is
+ * full and that never accepts.
+ */
+void AbstractHTTPScannerTest::testStopDuringSweep()
+{
+	ServerSocket server(SocketAddress("127.0.0.1", 0), 1);
+	const uint16_t port = server.address().port();
+
+	vector<StreamSocket> backlog(4);
+	for (auto &socket : backlog)
+		socket.connectNB(server.address());
+
+	Thread::sleep(100);
+
+	TestableHTTPScanner scanner(port);
+	scanner.setPingTimeout(30 * Timespan::SECONDS);
+	StopControl control;
+	StopControl::Run run(control);
+
+	Thread stopper;
+	stopper.startFunc([&]() {
+		Thread::sleep(200);
+		control.requestStop();
+	});
+
+	const Clock started;
+	scanner.sweepAddressRange(
+		run, IPAddressRange(LOOPBACK_NETWORK, LOOPBACK_MASK));
+
+	stopper.join();
+
+	CPPUNIT_ASSERT(started.elapsed() < 5 * Timespan::SECONDS);
+
+	for (auto &socket : backlog)
+		socket.close();
+}
+
+/**
+ * @brief Test the concurrent sweep followed by the HTTP verification
+ * reports only the host with a valid response.
+ */
+void AbstractHTTPScannerTest::testProbeVerifiesHosts()
+{
+	ServerSocket socket(SocketAddress("127.0.0.1", 0));
+	const uint16_t port = socket.address().port();
+
+	HTTPServer server(new InfoHandlerFactory, socket, new HTTPServerParams);
+	server.start();
+
+	StopControl control;
+	StopControl::Run run(control);
+	vector<SocketAddress> devices;
+
+	TestableHTTPScanner scanner(port);
+	scanner.probeAddressRange(
+		run, IPAddressRange(LOOPBACK_NETWORK, LOOPBACK_MASK), devices, 1024);
+
+	CPPUNIT_ASSERT_EQUAL(1, devices.size());
+	CPPUNIT_ASSERT_EQUAL(
+		SocketAddress("127.0.0.1", port).toString(),
+		devices.front().toString());
+
+	TestableHTTPScanner other(port);
+	other.setPath("/other");
+	devices.clear();
+
+	other.probeAddressRange(
+		run, IPAddressRange(LOOPBACK_NETWORK, LOOPBACK_MASK), devices, 1024);
+
+	CPPUNIT_ASSERT(devices.empty());
+
+	server.stop();
+}
+
+}
@@ -0,0 +1,347 @@
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/AtomicCounter.h>
+#include <Poco/Exception.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/SocketAddress.h>
+#include <Poco/Net/StreamSocket.h>
+
+#include "cppunit/BetterAssert.h"
+#include "net/HTTPConnectionPool.h"
+
+using namespace Poco;
+using namespace Poco::Net;
+using namespace std;
+
+namespace BeeeOn {
+
+class HTTPConnectionPoolTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(HTTPConnectionPoolTest);
+	CPPUNIT_TEST(testReuse);
+	CPPUNIT_TEST(testIdleExpiry);
+	CPPUNIT_TEST(testNoRetryOfSentPost);
+	CPPUNIT_TEST(testRetryIdempotentOnClose);
+	CPPUNIT_TEST(testNoRetryOnTimeout);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void setUp();
+	void tearDown();
+	void testReuse();
+	void testIdleExpiry();
+	void testNoRetryOfSentPost();
+	void testRetryIdempotentOnClose();
+	void testNoRetryOnTimeout();
+
+protected:
+	HTTPEntireResponse get(HTTPConnectionPool &pool, const string &path);
+
+private:
+	SharedPtr<HTTPServer> m_server;
+	uint16_t m_port;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HTTPConnectionPoolTest);
+
+/**
+ * Responds with the requested URI as a body.
+ */
+class EchoURIHandler : public HTTPRequestHandler {
+public:
+	void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override
+	{
+		response.setContentLength(request.getURI().size());
+		response.send() << request.getURI();
+	}
+};
+
+class EchoURIHandlerFactory : public HTTPRequestHandlerFactory {
+public:
+	HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override
+	{
+		return new EchoURIHandler;
+	}
+};
+
+/**
+ * Raw HTTP server answering only the first request of each connection.
+ * Any following request on the same connection is read and then
+ * the connection is closed without response (optionally after
+ * a delay).
+ */
+class FirstOnlyServer : public Runnable {
+public:
+	FirstOnlyServer(long stallMs = 0):
+		m_socket(SocketAddress("127.0.0.1", 0)),
+		m_stallMs(stallMs),
+		m_stop(false)
+	{
+	}
+
+	uint16_t port() const
+	{
+		return m_socket.address().port();
+	}
+
+	int requests() const
+	{
+		return m_requests.value();
+	}
+
+	void stop()
+	{
+		m_stop = true;
+	}
+
+	void run() override
+	{
+		while (!m_stop) {
+			if (!m_socket.poll(10 * Timespan::MILLISECONDS, Socket::SELECT_READ))
+				continue;
+
+			StreamSocket client = m_socket.acceptConnection();
+			client.setReceiveTimeout(1 * Timespan::SECONDS);
+
+			try {
+				serve(client);
+			}
+			catch (const Exception &) {
+			}
+
+			client.close();
+		}
+	}
+
+protected:
+	void serve(StreamSocket &client)
+	{
+		static const string RESPONSE =
+			"HTTP/1.1 200 OK\r\n"
+			"Content-Length: 2\r\n"
+			"Connection: Keep-Alive\r\n"
+			"\r\n"
+			"OK";
+
+		for (int i = 0; !m_stop; ++i) {
+			if (!readRequest(client))
+				return;
+
+			++m_requests;
+
+			if (i == 0) {
+				client.sendBytes(RESPONSE.data(), RESPONSE.size());
+				continue;
+			}
+
+			if (m_stallMs > 0)
+				Thread::sleep(m_stallMs);
+
+			return;
+		}
+	}
+
+	bool readRequest(StreamSocket &client)
+	{
+		string input;
+		char buffer[1024];
+		size_t end = string::npos;
+
+		while ((end = input.find("\r\n\r\n")) == string::npos) {
+			const int n = client.receiveBytes(buffer, sizeof(buffer));
+			if (n <= 0)
+				return false;
+
+			input.append(buffer, n);
+		}
+
+		size_t length = 0;
+		const size_t header = input.find("Content-Length: ");
+		if (header != string::npos && header < end)
+			length = stoul(input.substr(header + 16));
+
+		while (input.size() < end + 4 + length) {
+			const int n = client.receiveBytes(buffer, sizeof(buffer));
+			if (n <= 0)
+				return false;
+
+			input.append(buffer, n);
+		}
+
+		return true;
+	}
+
+private:
+	ServerSocket m_socket;
+	long m_stallMs;
+	AtomicCounter m_requests;
+	volatile bool m_stop;
+};
+
+void HTTPConnectionPoolTest::setUp()
+{
+	ServerSocket socket(SocketAddress("127.0.0.1", 0));
+	m_port = socket.address().port();
+
+	HTTPServerParams::Ptr params = new HTTPServerParams;
+	params->setKeepAlive(true);
+
+	m_server = new HTTPServer(new EchoURIHandlerFactory, socket, params);
+	m_server->start();
+}
+
+void HTTPConnectionPoolTest::tearDown()
+{
+	m_server->stop();
+}
+
+HTTPEntireResponse HTTPConnectionPoolTest::get(
+		HTTPConnectionPool &pool,
+		const string &path)
+{
+	HTTPRequest request(HTTPRequest::HTTP_GET, path);
+	return pool.makeRequest(request, "127.0.0.1", m_port, "", 5 * Timespan::SECONDS);
+}
+
+/**
+ * @brief Test that consecutive requests to the same endpoint
+ * share a single persistent session.
+ */
+void HTTPConnectionPoolTest::testReuse()
+{
+	HTTPConnectionPool pool;
+
+	CPPUNIT_ASSERT_EQUAL("/first", get(pool, "/first").getBody());
+	CPPUNIT_ASSERT_EQUAL(1, pool.opened());
+	CPPUNIT_ASSERT_EQUAL(0, pool.reused());
+	CPPUNIT_ASSERT_EQUAL(1, pool.idle());
+
+	CPPUNIT_ASSERT_EQUAL("/second", get(pool, "/second").getBody());
+	CPPUNIT_ASSERT_EQUAL("/third", get(pool, "/third").getBody());
+	CPPUNIT_ASSERT_EQUAL(1, pool.opened());
+	CPPUNIT_ASSERT_EQUAL(2, pool.reused());
+	CPPUNIT_ASSERT_EQUAL(1, pool.idle());
+
+	pool.closeIdle();
+	CPPUNIT_ASSERT_EQUAL(0, pool.idle());
+
+	CPPUNIT_ASSERT_EQUAL("/fourth", get(pool, "/fourth").getBody());
+	CPPUNIT_ASSERT_EQUAL(2, pool.opened());
+}
+
+/**
+ * @brief Test that a session idle for longer than idleTimeout
+ * is not reused.
+ */
+void HTTPConnectionPoolTest::testIdleExpiry()
+{
+	HTTPConnectionPool pool;
+	pool.setIdleTimeout(50 * Timespan::MILLISECONDS);
+
+	CPPUNIT_ASSERT_EQUAL("/first", get(pool, "/first").getBody());
+	CPPUNIT_ASSERT_EQUAL(1, pool.opened());
+
+	Thread::sleep(100);
+
+	CPPUNIT_ASSERT_EQUAL("/second", get(pool, "/second").getBody());
+	CPPUNIT_ASSERT_EQUAL(2, pool.opened());
+	CPPUNIT_ASSERT_EQUAL(0, pool.reused());
+}
+
+/**
+ * @brief Test that a non-idempotent request is not repeated when a reused
+ * session is closed by the server after the request has been sent.
+ * The server would otherwise execute the request twice.
+ */
+void HTTPConnectionPoolTest::testNoRetryOfSentPost()
+{
+	FirstOnlyServer server;
+	Thread thread;
+	thread.start(server);
+
+	HTTPConnectionPool pool;
+
+	HTTPRequest first(HTTPRequest::HTTP_GET, "/first");
+	CPPUNIT_ASSERT_EQUAL("OK", pool.makeRequest(
+		first, "127.0.0.1", server.port(), "", 5 * Timespan::SECONDS).getBody());
+
+	HTTPRequest second(HTTPRequest::HTTP_POST, "/second");
+	CPPUNIT_ASSERT_THROW(pool.makeRequest(
+		second, "127.0.0.1", server.port(), "{}", 5 * Timespan::SECONDS),
+		Exception);
+
+	CPPUNIT_ASSERT_EQUAL(2, server.requests());
+	CPPUNIT_ASSERT_EQUAL(1, pool.reused());
+	CPPUNIT_ASSERT_EQUAL(0, pool.retried());
+	CPPUNIT_ASSERT_EQUAL(1, pool.opened());
+
+	server.stop();
+	thread.join();
+}
+
+/**
+ * @brief Test that an idempotent request is repeated via a new session
+ * when a reused session is closed before any response byte arrives.
+ */
+void HTTPConnectionPoolTest::testRetryIdempotentOnClose()
+{
+	FirstOnlyServer server;
+	Thread thread;
+	thread.start(server);
+
+	HTTPConnectionPool pool;
+
+	HTTPRequest first(HTTPRequest::HTTP_GET, "/first");
+	CPPUNIT_ASSERT_EQUAL("OK", pool.makeRequest(
+		first, "127.0.0.1", server.port(), "", 5 * Timespan::SECONDS).getBody());
+
+	HTTPRequest second(HTTPRequest::HTTP_GET, "/second");
+	CPPUNIT_ASSERT_EQUAL("OK", pool.makeRequest(
+		second, "127.0.0.1", server.port(), "", 5 * Timespan::SECONDS).getBody());
+
+	CPPUNIT_ASSERT_EQUAL(3, server.requests());
+	CPPUNIT_ASSERT_EQUAL(1, pool.retried());
+	CPPUNIT_ASSERT_EQUAL(2, pool.opened());
+
+	server.stop();
+	thread.join();
+}
+
+/**
+ * @brief Test that a request on a reused session timing out while waiting
+ * for the response is never repeated.
+ */
+void HTTPConnectionPoolTest::testNoRetryOnTimeout()
+{
+	FirstOnlyServer server(500);
+	Thread thread;
+	thread.start(server);
+
+	HTTPConnectionPool pool;
+
+	HTTPRequest first(HTTPRequest::HTTP_GET, "/first");
+	CPPUNIT_ASSERT_EQUAL("OK", pool.makeRequest(
+		first, "127.0.0.1", server.port(), "", 5 * Timespan::SECONDS).getBody());
+
+	HTTPRequest second(HTTPRequest::HTTP_GET, "/second");
+	CPPUNIT_ASSERT_THROW(pool.makeRequest(
+		second, "127.0.0.1", server.port(), "", 100 * Timespan::MILLISECONDS),
+		TimeoutException);
+
+	CPPUNIT_ASSERT_EQUAL(2, server.requests());
+	CPPUNIT_ASSERT_EQUAL(0, pool.retried());
+
+	server.stop();
+	thread.join();
+}
+
+}
@@ -1,4 +1,5 @@
 #include <queue>
+#include <string>
 
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -23,6 +24,7 @@ public:
 	using AbstractGWSConnector::outputValid;
 	using AbstractGWSConnector::peekOutput;
 	using AbstractGWSConnector::popOutput;
+	using AbstractGWSConnector::outputSize;
 };
 
 class AbstractGWSConnectorTest : public CppUnit::TestFixture {
@@ -32,6 +34,8 @@ class AbstractGWSConnectorTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testSendMixedPriorities);
 	CPPUNIT_TEST(testQueuePrioritiesSimple);
 	CPPUNIT_TEST(testQueuePriorities);
+	CPPUNIT_TEST(testQueueChargedBySize);
+	CPPUNIT_TEST(testPeekDeepOutput);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -41,6 +45,8 @@ public:
 	void testSendMixedPriorities();
 	void testQueuePrioritiesSimple();
 	void testQueuePriorities();
+	void testQueueChargedBySize();
+	void testPeekDeepOutput();
 
 private:
 	TestableAbstractGWSConnector::Ptr m_connector;
@@ -88,7 +94,7 @@ void AbstractGWSConnectorTest::testSendHighPriority()
 	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 
 	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
+	m_connector->updateOutputs(0, 100);
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 
 	m_connector->send(highPriorityMessage());
@@ -98,11 +104,11 @@ void AbstractGWSConnectorTest::testSendHighPriority()
 	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 
 	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
+	m_connector->updateOutputs(0, 100);
 	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 
 	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
+	m_connector->updateOutputs(0, 100);
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 }
 
@@ -117,7 +123,7 @@ void AbstractGWSConnectorTest::testSendLowPriority()
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
+	m_connector->updateOutputs(3, 100);
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 
 	m_connector->send(lowPriorityMessage());
@@ -127,11 +133,11 @@ void AbstractGWSConnectorTest::testSendLowPriority()
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
+	m_connector->updateOutputs(3, 100);
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
+	m_connector->updateOutputs(3, 100);
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 }
 
@@ -150,7 +156,7 @@ void AbstractGWSConnectorTest::testSendMixedPriorities()
 	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 
 	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
+	m_connector->updateOutputs(0, 100);
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->send(midPriorityMessage());
@@ -158,18 +164,19 @@ void AbstractGWSConnectorTest::testSendMixedPriorities()
 	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
 
 	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
+	m_connector->updateOutputs(1, 100);
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
+	m_connector->updateOutputs(3, 100);
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 }
 
 /**
- * @brief If all queues are equivalently filled and has same histories
- * then the higher-priority wins approach is used. The queues are poped
- * in order 0, 1, 3 (queue 2 is unused).
+ * @brief If all queues hold a single message and have their full deficit,
+ * each newly activated queue is served before the active queues of a lower
+ * priority. The queues are popped in order 0, 1, 3 (queue 2 is unused).
+ * Weights (and initial deficits) are 4096, 3072, 2048 and 1024 bytes.
  */
 void AbstractGWSConnectorTest::testQueuePrioritiesSimple()
 {
@@ -179,107 +186,117 @@ void AbstractGWSConnectorTest::testQueuePrioritiesSimple()
 	m_connector->send(midPriorityMessage());
 	m_connector->send(highPriorityMessage());
 
-	// 0/1 0/1 0/0 0/1
+	// active: 0 (4096), 1 (3072), 3 (1024)
 	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 
 	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
-	// 1/0 0/1 0/0 0/1
+	m_connector->updateOutputs(0, 100);
+	// queue 0 is empty (deficit 3996), active: 1 (3072), 3 (1024)
 	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
 
 	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
-	// 1/0 1/0 0/0 0/1
+	m_connector->updateOutputs(1, 100);
+	// queue 1 is empty (deficit 2972), active: 3 (1024)
 	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
-	// 1/0 1/0 0/0 1/0
+	m_connector->updateOutputs(3, 100);
+	// queue 3 is empty (deficit 924), no active queue
 	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 }
 
 /**
- * @brief If a batch of messages arrives and all queues have the same initial
- * history, we can see that the higher-priority queues are preferred over the
- * lower-priority ones. However, as the queue history is updated, the higher-priority
- * queues are sometimes skipped in favor of the closest lower-priority one.
+ * @brief Pop the given count of messages from the selected outputs
+ * while charging each one by the given size.
+ * @returns sequence of the selected outputs
  */
-void AbstractGWSConnectorTest::testQueuePriorities()
+static string schedule(
+		TestableAbstractGWSConnector::Ptr connector,
+		size_t count,
+		size_t size)
 {
-	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
+	string sequence;
 
-	m_connector->send(lowPriorityMessage());
-	m_connector->send(lowPriorityMessage());
-	m_connector->send(lowPriorityMessage());
-	m_connector->send(lowPriorityMessage());
-	m_connector->send(midPriorityMessage());
-	m_connector->send(midPriorityMessage());
-	m_connector->send(midPriorityMessage());
-	m_connector->send(highPriorityMessage());
-	m_connector->send(highPriorityMessage());
+	for (size_t n = 0; n < count; ++n) {
+		const size_t i = connector->selectOutput();
+		if (!connector->outputValid(i))
+			break;
 
-	// 0/2 0/3 0/0 0/4 - queue 0 wins
-	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
+		connector->popOutput(i);
+		connector->updateOutputs(i, size);
+		sequence += to_string(i);
+	}
 
-	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
-	// 1/1 0/3 0/0 0/4 - queue 1 wins over queue 0 because of history
-	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
+	return sequence;
+}
 
-	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
-	// 1/1 1/2 0/0 0/4 - queue 0 wins over queue 1
-	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
+/**
+ * @brief When all queues are backlogged, each of them sends bytes
+ * proportional to its weight per round. The queue 2 is unused.
+ */
+void AbstractGWSConnectorTest::testQueuePriorities()
+{
+	m_connector->setOutputsWeights({"300", "200", "100", "100"});
+	m_connector->setupQueues();
 
-	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
-	// 2/0 1/2 0/0 0/4 - queue 3 wins over queue 1 because of history
-	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
+	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
 
-	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
-	// 2/0 1/2 0/0 1/3 - queue 1 wins
-	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
+	for (size_t i = 0; i < 10; ++i) {
+		m_connector->send(lowPriorityMessage());
+		m_connector->send(midPriorityMessage());
+		m_connector->send(highPriorityMessage());
+	}
 
-	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
-	// 2/0 2/1 0/0 1/3 - queue 3 wins over queue 1 because of history
-	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
+	// 3 * 100 B from queue 0, 2 * 100 B from queue 1, 1 * 100 B from queue 3
+	CPPUNIT_ASSERT_EQUAL(string("000113000113"), schedule(m_connector, 12, 100));
+}
 
-	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
-	// 2/0 2/1 0/0 2/2 - queue 1 wins
-	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
+/**
+ * @brief A message bigger than the weight of its queue is charged fully,
+ * the queue must wait until the other queues are served accordingly.
+ */
+void AbstractGWSConnectorTest::testQueueChargedBySize()
+{
+	m_connector->setOutputsWeights({"300", "200", "100", "100"});
+	m_connector->setupQueues();
 
-	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
-	// 2/0 3/0 0/0 2/2 - no competition anymore, but...
-	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
+	for (size_t i = 0; i < 3; ++i) {
+		m_connector->send(lowPriorityMessage());
+		m_connector->send(highPriorityMessage());
+	}
 
-	m_connector->send(midPriorityMessage());
-	m_connector->send(highPriorityMessage());
-	// 2/1 3/1 0/0 2/2 - queue 0 wins
-	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
+	// 300 - 1000 = -700 B
+	CPPUNIT_ASSERT_EQUAL(string("0"), schedule(m_connector, 1, 1000));
+	// 3 refills are needed to get to 200 B, the queue 3 is served meanwhile
+	CPPUNIT_ASSERT_EQUAL(string("330"), schedule(m_connector, 3, 100));
+}
 
-	m_connector->popOutput(0);
-	m_connector->updateOutputs(0);
-	// 3/0 3/1 0/0 2/2 - queue 3 wins over queue 1 because of history
-	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
+/**
+ * @brief Messages deeper in a queue can be inspected (e.g. to coalesce
+ * them) without modifying the queue.
+ */
+void AbstractGWSConnectorTest::testPeekDeepOutput()
+{
+	const GWMessage::Ptr first = lowPriorityMessage();
+	const GWMessage::Ptr second = lowPriorityMessage();
 
-	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
-	// 3/0 3/1 0/0 3/1 - queue 1 wins
-	CPPUNIT_ASSERT_EQUAL(1, m_connector->selectOutput());
+	m_connector->send(first);
+	m_connector->send(highPriorityMessage());
+	m_connector->send(second);
 
-	m_connector->popOutput(1);
-	m_connector->updateOutputs(1);
-	// 3/0 4/0 0/0 3/1 - no competition anymore
-	CPPUNIT_ASSERT_EQUAL(3, m_connector->selectOutput());
+	CPPUNIT_ASSERT_EQUAL(1, m_connector->outputSize(0));
+	CPPUNIT_ASSERT_EQUAL(2, m_connector->outputSize(3));
+
+	CPPUNIT_ASSERT(m_connector->peekOutput(3, 0) == first);
+	CPPUNIT_ASSERT(m_connector->peekOutput(3, 1) == second);
+	CPPUNIT_ASSERT(m_connector->peekOutput(3) == first);
 
 	m_connector->popOutput(3);
-	m_connector->updateOutputs(3);
-	// 3/0 4/0 0/0 4/0
-	CPPUNIT_ASSERT(!m_connector->outputValid(m_connector->selectOutput()));
+	m_connector->popOutput(3);
+	m_connector->updateOutputs(3, 200);
+
+	CPPUNIT_ASSERT_EQUAL(0, m_connector->outputSize(3));
+	CPPUNIT_ASSERT_EQUAL(0, m_connector->selectOutput());
 }
 
 }
@@ -0,0 +1,431 @@
+#include <deque>
+#include <sstream>
+#include <string>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Buffer.h>
+#include <Poco/Condition.h>
+#include <Poco/Exception.h>
+#include <Poco/InflatingStream.h>
+#include <Poco/Mutex.h>
+#include <Poco/StreamCopier.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/WebSocket.h>
+
+#include "cppunit/BetterAssert.h"
+#include "gwmessage/GWResponse.h"
+#include "gwmessage/GWSensorDataExport.h"
+#include "model/SensorData.h"
+#include "server/GWSConnectorImpl.h"
+#include "server/GWSFixedPriorityAssigner.h"
+#include "util/NonAsyncExecutor.h"
+
+using namespace Poco;
+using namespace Poco::Net;
+using namespace std;
+
+namespace BeeeOn {
+
+class GWSConnectorImplTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(GWSConnectorImplTest);
+	CPPUNIT_TEST(testEnvelopeNotOffered);
+	CPPUNIT_TEST(testEnvelopeRejected);
+	CPPUNIT_TEST(testEnvelopeCoalesce);
+	CPPUNIT_TEST(testCoalesceMaxMessageSize);
+	CPPUNIT_TEST(testDeflateThreshold);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void setUp();
+	void tearDown();
+
+	void testEnvelopeNotOffered();
+	void testEnvelopeRejected();
+	void testEnvelopeCoalesce();
+	void testCoalesceMaxMessageSize();
+	void testDeflateThreshold();
+
+private:
+	SharedPtr<HTTPServer> m_server;
+	uint16_t m_port;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(GWSConnectorImplTest);
+
+static const string ENVELOPE_PROTOCOL = "beeeon-gws-envelope";
+
+class TestableGWSConnectorImpl : public GWSConnectorImpl {
+public:
+	using GWSConnectorImpl::connect;
+	using GWSConnectorImpl::performOutput;
+};
+
+/**
+ * Frames received by the testing WebSocket server and its settings.
+ */
+class ReceivedFrames {
+public:
+	struct Frame {
+		int opcode;
+		string payload;
+	};
+
+	ReceivedFrames():
+		m_accept(false)
+	{
+	}
+
+	void setAccept(bool accept)
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		m_accept = accept;
+	}
+
+	bool accept() const
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		return m_accept;
+	}
+
+	void setOffered(const string &protocol)
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		m_offered = protocol;
+	}
+
+	string offered() const
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		return m_offered;
+	}
+
+	void push(int opcode, const string &payload)
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		m_frames.push_back({opcode, payload});
+		m_pushed.broadcast();
+	}
+
+	Frame pop()
+	{
+		FastMutex::ScopedLock guard(m_lock);
+
+		while (m_frames.empty())
+			m_pushed.wait(m_lock, 5000);
+
+		const Frame frame = m_frames.front();
+		m_frames.pop_front();
+		return frame;
+	}
+
+private:
+	bool m_accept;
+	string m_offered;
+	deque<Frame> m_frames;
+	mutable FastMutex m_lock;
+	Condition m_pushed;
+};
+
+static ReceivedFrames received;
+
+/**
+ * Accept the WebSocket (and the envelope if configured) and collect
+ * all received data frames until the connection is closed.
+ */
+class CollectingWebSocketHandler : public HTTPRequestHandler {
+public:
+	void handleRequest(HTTPServerRequest &request, HTTPServerResponse &response) override
+	{
+		const string offered = request.get("Sec-WebSocket-Protocol", "");
+		received.setOffered(offered);
+
+		if (received.accept() && offered == ENVELOPE_PROTOCOL)
+			response.set("Sec-WebSocket-Protocol", ENVELOPE_PROTOCOL);
+
+		WebSocket socket(request, response);
+		socket.setReceiveTimeout(5 * Timespan::SECONDS);
+
+		Buffer<char> buffer(64 * 1024);
+
+		try {
+			while (true) {
+				int flags;
+				const int n = socket.receiveFrame(buffer.begin(), buffer.size(), flags);
+				const int opcode = flags & WebSocket::FRAME_OP_BITMASK;
+
+				if (n <= 0 || opcode == WebSocket::FRAME_OP_CLOSE)
+					break;
+
+				received.push(opcode, string(buffer.begin(), n));
+			}
+		}
+		catch (const Exception &) {
+		}
+	}
+};
+
+class CollectingWebSocketHandlerFactory : public HTTPRequestHandlerFactory {
+public:
+	HTTPRequestHandler *createRequestHandler(const HTTPServerRequest &) override
+	{
+		return new CollectingWebSocketHandler;
+	}
+};
+
+void GWSConnectorImplTest::setUp()
+{
+	received.setAccept(false);
+	received.setOffered("");
+
+	ServerSocket socket(SocketAddress("127.0.0.1", 0));
+	m_port = socket.address().port();
+
+	m_server = new HTTPServer(
+		new CollectingWebSocketHandlerFactory,
+		socket,
+		new HTTPServerParams);
+	m_server->start();
+}
+
+void GWSConnectorImplTest::tearDown()
+{
+	m_server->stopAll(true);
+	m_server = nullptr;
+}
+
+static SharedPtr<TestableGWSConnectorImpl> createConnector(uint16_t port)
+{
+	SharedPtr<TestableGWSConnectorImpl> connector = new TestableGWSConnectorImpl;
+	connector->setHost("127.0.0.1");
+	connector->setPort(port);
+	connector->setPriorityAssigner(new GWSFixedPriorityAssigner);
+	connector->setOutputsCount(4);
+	connector->setEventsExecutor(new NonAsyncExecutor);
+	connector->setupQueues();
+
+	return connector;
+}
+
+static GWMessage::Ptr response()
+{
+	GWResponse::Ptr message = new GWResponse;
+	message->setID(GlobalID::random());
+	message->setStatus(GWResponse::Status::SUCCESS);
+	return message;
+}
+
+static string inflate(const string &payload)
+{
+	istringstream in(payload);
+	InflatingInputStream inflate(in, InflatingStreamBuf::STREAM_ZLIB);
+
+	string result;
+	StreamCopier::copyToString(inflate, result);
+	return result;
+}
+
+/**
+ * @brief Test that the envelope is not offered when neither coalescing
+ * nor compression is configured and each message is sent as a plain
+ * text frame.
+ */
+void GWSConnectorImplTest::testEnvelopeNotOffered()
+{
+	received.setAccept(true);
+
+	auto connector = createConnector(m_port);
+	auto socket = connector->connect("127.0.0.1", m_port);
+
+	const auto first = response();
+	const auto second = response();
+	connector->send(first);
+	connector->send(second);
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(!connector->performOutput(*socket));
+
+	CPPUNIT_ASSERT(received.offered().empty());
+
+	const auto frame0 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_TEXT, frame0.opcode);
+	CPPUNIT_ASSERT_EQUAL(first->toString(), frame0.payload);
+
+	const auto frame1 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_TEXT, frame1.opcode);
+	CPPUNIT_ASSERT_EQUAL(second->toString(), frame1.payload);
+
+	socket->shutdown();
+}
+
+/**
+ * @brief Test that when the server does not accept the offered envelope,
+ * messages are not coalesced.
+ */
+void GWSConnectorImplTest::testEnvelopeRejected()
+{
+	received.setAccept(false);
+
+	auto connector = createConnector(m_port);
+	connector->setMaxRecords(10);
+	auto socket = connector->connect("127.0.0.1", m_port);
+
+	const auto first = response();
+	const auto second = response();
+	connector->send(first);
+	connector->send(second);
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+
+	CPPUNIT_ASSERT_EQUAL(ENVELOPE_PROTOCOL, received.offered());
+
+	const auto frame0 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_TEXT, frame0.opcode);
+	CPPUNIT_ASSERT_EQUAL(first->toString(), frame0.payload);
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+
+	const auto frame1 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(second->toString(), frame1.payload);
+
+	socket->shutdown();
+}
+
+/**
+ * @brief Test that when the server accepts the envelope, messages
+ * of the same queue are coalesced into a single JSON array.
+ */
+void GWSConnectorImplTest::testEnvelopeCoalesce()
+{
+	received.setAccept(true);
+
+	auto connector = createConnector(m_port);
+	connector->setMaxRecords(10);
+	auto socket = connector->connect("127.0.0.1", m_port);
+
+	const auto first = response();
+	const auto second = response();
+	const auto third = response();
+	connector->send(first);
+	connector->send(second);
+	connector->send(third);
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(!connector->performOutput(*socket));
+
+	CPPUNIT_ASSERT_EQUAL(ENVELOPE_PROTOCOL, received.offered());
+
+	const auto frame = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_TEXT, frame.opcode);
+	CPPUNIT_ASSERT_EQUAL(
+		"[" + first->toString()
+		+ "," + second->toString()
+		+ "," + third->toString() + "]",
+		frame.payload);
+
+	socket->shutdown();
+}
+
+/**
+ * @brief Test that only as many messages are coalesced as fit into
+ * the maxMessageSize (including the array delimiters). A single message
+ * exceeding the maxMessageSize is still sent as its own frame.
+ */
+void GWSConnectorImplTest::testCoalesceMaxMessageSize()
+{
+	received.setAccept(true);
+
+	const size_t size = response()->toString().size();
+
+	auto connector = createConnector(m_port);
+	connector->setMaxRecords(10);
+	connector->setMaxMessageSize(2 * size + 3);
+	auto socket = connector->connect("127.0.0.1", m_port);
+
+	for (int i = 0; i < 5; ++i)
+		connector->send(response());
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(!connector->performOutput(*socket));
+
+	const auto frame0 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(2 * size + 3, frame0.payload.size());
+
+	const auto frame1 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(2 * size + 3, frame1.payload.size());
+
+	const auto frame2 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(size, frame2.payload.size());
+
+	connector->setMaxMessageSize(size - 1);
+
+	connector->send(response());
+	connector->send(response());
+
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+	CPPUNIT_ASSERT(!connector->performOutput(*socket));
+
+	CPPUNIT_ASSERT_EQUAL(size, received.pop().payload.size());
+	CPPUNIT_ASSERT_EQUAL(size, received.pop().payload.size());
+
+	socket->shutdown();
+}
+
+/**
+ * @brief Test that small frames are sent as text even if the compression
+ * is enabled and frames above the threshold are sent deflated as binary.
+ */
+void GWSConnectorImplTest::testDeflateThreshold()
+{
+	received.setAccept(true);
+
+	auto connector = createConnector(m_port);
+	connector->setCompression("deflate");
+	connector->setMaxMessageSize(64 * 1024);
+	auto socket = connector->connect("127.0.0.1", m_port);
+
+	const auto small = response();
+	CPPUNIT_ASSERT(small->toString().size() < 128);
+
+	vector<SensorData> data;
+	for (int i = 0; i < 20; ++i) {
+		data.push_back({
+			DeviceID(DevicePrefix::PREFIX_VIRTUAL_DEVICE, i),
+			Timestamp(0),
+			{SensorValue(ModuleID(0), 20.5)}
+		});
+	}
+
+	GWSensorDataExport::Ptr large = new GWSensorDataExport;
+	large->setID(GlobalID::random());
+	large->setData(data);
+	CPPUNIT_ASSERT(large->toString().size() >= 128);
+
+	connector->send(small);
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+
+	const auto frame0 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_TEXT, frame0.opcode);
+	CPPUNIT_ASSERT_EQUAL(small->toString(), frame0.payload);
+
+	connector->send(large);
+	CPPUNIT_ASSERT(connector->performOutput(*socket));
+
+	const auto frame1 = received.pop();
+	CPPUNIT_ASSERT_EQUAL(WebSocket::FRAME_OP_BINARY, frame1.opcode);
+	CPPUNIT_ASSERT(frame1.payload.size() < large->toString().size());
+	CPPUNIT_ASSERT_EQUAL(large->toString(), inflate(frame1.payload));
+
+	socket->shutdown();
+}
+
+}
@@ -24,6 +24,11 @@ class GWSQueuingExporterTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testShipAndWaitBatched);
 	CPPUNIT_TEST(testShipNoConfirm);
 	CPPUNIT_TEST(testSendFails);
+	CPPUNIT_TEST(testWindowOutOfOrder);
+	CPPUNIT_TEST(testAdaptiveBatchSize);
+	CPPUNIT_TEST(testAdaptiveRespectsMessageSize);
+	CPPUNIT_TEST(testAdaptiveDecreaseOncePerWindow);
+	CPPUNIT_TEST(testAdaptivePruneUnconfirmed);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -32,6 +37,11 @@ public:
 	void testShipAndWaitBatched();
 	void testShipNoConfirm();
 	void testSendFails();
+	void testWindowOutOfOrder();
+	void testAdaptiveBatchSize();
+	void testAdaptiveRespectsMessageSize();
+	void testAdaptiveDecreaseOncePerWindow();
+	void testAdaptivePruneUnconfirmed();
 
 protected:
 	void clearConnector();
@@ -45,6 +55,17 @@ private:
 
 CPPUNIT_TEST_SUITE_REGISTRATION(GWSQueuingExporterTest);
 
+class TestableGWSQueuingExporter : public GWSQueuingExporter {
+public:
+	typedef SharedPtr<TestableGWSQueuingExporter> Ptr;
+
+	using GWSQueuingExporter::ackConfirmed;
+	using GWSQueuingExporter::exportBatch;
+	using GWSQueuingExporter::inFlight;
+	using GWSQueuingExporter::adaptBatchSize;
+	using GWSQueuingExporter::updateBytesPerData;
+};
+
 class SensorDataConfirmer : public GWSListener {
 public:
 	typedef Poco::SharedPtr<SensorDataConfirmer> Ptr;
@@ -75,6 +96,12 @@ public:
 		return m_exports;
 	}
 
+	size_t exportsCount()
+	{
+		FastMutex::ScopedLock guard(m_lock);
+		return m_exports.size();
+	}
+
 	vector<SensorData> confirmExport()
 	{
 		FastMutex::ScopedLock guard(m_lock);
@@ -88,6 +115,19 @@ public:
 		return request->data();
 	}
 
+	vector<SensorData> confirmLastExport()
+	{
+		FastMutex::ScopedLock guard(m_lock);
+
+		CPPUNIT_ASSERT(!m_exports.empty());
+		GWSensorDataExport::Ptr request = m_exports.back();
+		m_connector.receive(request->confirm());
+
+		m_exports.pop_back();
+
+		return request->data();
+	}
+
 private:
 	MockGWSConnector &m_connector;
 	list<GWSensorDataExport::Ptr> m_exports;
@@ -293,4 +333,249 @@ void GWSQueuingExporterTest::testSendFails()
 	CPPUNIT_ASSERT_EQUAL(1, m_queuingStrategy->size());
 }
 
+/**
+ * @brief Ship 3 sensor data entries and expect them to be exported
+ * one-by-one without waiting for confirmation as the window allows
+ * 3 in-flight requests. Confirm them out of order and expect that
+ * nothing remains to be stored.
+ */
+void GWSQueuingExporterTest::testWindowOutOfOrder()
+{
+	SensorDataConfirmer::Ptr confirmer = new SensorDataConfirmer(*m_connector);
+
+	m_connector->addListener(confirmer);
+	m_exporter->setActiveCount(1);
+	m_exporter->setWindowSize(3);
+	m_exporter->setAcquireTimeout(10 * Timespan::MILLISECONDS);
+
+	for (const auto &one : vector<SensorData>(begin(DATA), begin(DATA) + 4))
+		CPPUNIT_ASSERT(m_exporter->ship(one));
+
+	Thread thread;
+	thread.start(*m_exporter);
+
+	for (int i = 0; i < 100 && confirmer->exportsCount() < 3; ++i)
+		Thread::sleep(10);
+
+	// the 4th one must wait until the window moves
+	Thread::sleep(50);
+	CPPUNIT_ASSERT_EQUAL(3, confirmer->exportsCount());
+
+	const auto result2 = confirmer->confirmLastExport();
+	CPPUNIT_ASSERT_EQUAL(1, result2.size());
+	CPPUNIT_ASSERT(result2[0] == DATA[2]);
+
+	for (int i = 0; i < 100 && confirmer->exportsCount() < 3; ++i)
+		Thread::sleep(10);
+
+	CPPUNIT_ASSERT_EQUAL(3, confirmer->exportsCount());
+
+	const auto result3 = confirmer->confirmLastExport();
+	CPPUNIT_ASSERT_EQUAL(1, result3.size());
+	CPPUNIT_ASSERT(result3[0] == DATA[3]);
+
+	const auto result0 = confirmer->confirmExport();
+	CPPUNIT_ASSERT(result0[0] == DATA[0]);
+
+	const auto result1 = confirmer->confirmExport();
+	CPPUNIT_ASSERT(result1[0] == DATA[1]);
+
+	m_exporter->stop();
+	thread.join();
+
+	confirmer = nullptr; // ensure save occurs
+	clearConnector();
+	CPPUNIT_ASSERT(m_queuingStrategy->empty());
+}
+
+/**
+ * @brief Test that in the adaptive mode the batch size is incremented
+ * after a full batch is confirmed on time, halved when a confirmation
+ * is late and limited by the maxMessageSize and maxActiveCount.
+ */
+void GWSQueuingExporterTest::testAdaptiveBatchSize()
+{
+	TestableGWSQueuingExporter exporter;
+	exporter.setActiveCount(8);
+	exporter.setMaxActiveCount(10);
+	exporter.setLatencyTarget(1 * Timespan::SECONDS);
+
+	CPPUNIT_ASSERT_EQUAL(8, exporter.batchSize());
+
+	exporter.setBatchMode("adaptive");
+	CPPUNIT_ASSERT_EQUAL(8, exporter.batchSize());
+
+	// full batch confirmed on time
+	exporter.adaptBatchSize(8, 8, 100 * Timespan::MILLISECONDS, 1);
+	CPPUNIT_ASSERT_EQUAL(9, exporter.batchSize());
+
+	// not a full batch, no reason to grow
+	exporter.adaptBatchSize(3, 9, 100 * Timespan::MILLISECONDS, 2);
+	CPPUNIT_ASSERT_EQUAL(9, exporter.batchSize());
+
+	exporter.adaptBatchSize(9, 9, 100 * Timespan::MILLISECONDS, 3);
+	exporter.adaptBatchSize(10, 10, 100 * Timespan::MILLISECONDS, 4);
+	CPPUNIT_ASSERT_EQUAL(10, exporter.batchSize());
+
+	// confirmed too late
+	exporter.adaptBatchSize(10, 10, 2 * Timespan::SECONDS, 5);
+	CPPUNIT_ASSERT_EQUAL(5, exporter.batchSize());
+
+	// 4 * 100 B fit into maxMessageSize
+	exporter.setMaxMessageSize(450);
+	exporter.updateBytesPerData(500, 5);
+	CPPUNIT_ASSERT_EQUAL(4, exporter.batchSize());
+
+	exporter.setBatchMode("fixed");
+	CPPUNIT_ASSERT_EQUAL(8, exporter.batchSize());
+}
+
+/**
+ * @brief Ship 6 sensor data entries while only 2 of them fit into
+ * the maxMessageSize and expect that no export exceeds it and all data
+ * are delivered.
+ */
+void GWSQueuingExporterTest::testAdaptiveRespectsMessageSize()
+{
+	SensorDataConfirmer::Ptr confirmer = new SensorDataConfirmer(*m_connector);
+
+	GWSensorDataExport::Ptr sample = new GWSensorDataExport;
+	sample->setID(GlobalID::random());
+	sample->setData({DATA[0], DATA[1]});
+	const size_t maxMessageSize = sample->toString().size();
+
+	m_connector->addListener(confirmer);
+	m_exporter->setBatchMode("adaptive");
+	m_exporter->setActiveCount(6);
+	m_exporter->setMaxMessageSize(maxMessageSize);
+	m_exporter->setAcquireTimeout(10 * Timespan::MILLISECONDS);
+
+	for (const auto &one : DATA)
+		CPPUNIT_ASSERT(m_exporter->ship(one));
+
+	Thread thread;
+	thread.start(*m_exporter);
+
+	size_t delivered = 0;
+
+	while (delivered < DATA.size()) {
+		CPPUNIT_ASSERT_NO_THROW(confirmer->exportEvent().wait(1000));
+
+		while (confirmer->exportsCount() > 0) {
+			const GWSensorDataExport::Ptr request = confirmer->exports().front();
+			CPPUNIT_ASSERT(request->toString().size() <= maxMessageSize);
+
+			const auto result = confirmer->confirmExport();
+			CPPUNIT_ASSERT(!result.empty());
+
+			for (const auto &one : result)
+				CPPUNIT_ASSERT(one == DATA[delivered++]);
+		}
+	}
+
+	m_exporter->stop();
+	thread.join();
+
+	confirmer = nullptr; // ensure save occurs
+	clearConnector();
+	CPPUNIT_ASSERT(m_queuingStrategy->empty());
+}
+
+/**
+ * @brief Export 3 batches, confirm all of them too late and expect
+ * that the batch size is halved only once because all of them belong
+ * to the same window. A late batch exported after the decrease halves
+ * the batch size again.
+ */
+void GWSQueuingExporterTest::testAdaptiveDecreaseOncePerWindow()
+{
+	SensorDataConfirmer::Ptr confirmer = new SensorDataConfirmer(*m_connector);
+	TestableGWSQueuingExporter::Ptr exporter = new TestableGWSQueuingExporter;
+
+	exporter->setConnector(m_connector);
+	exporter->setStrategy(m_queuingStrategy);
+	exporter->setBatchMode("adaptive");
+	exporter->setActiveCount(8);
+	exporter->setLatencyTarget(10 * Timespan::MILLISECONDS);
+	exporter->setAcquireTimeout(0);
+
+	m_connector->addListener(confirmer);
+	m_connector->addListener(exporter);
+
+	for (int i = 0; i < 5; ++i) {
+		for (const auto &one : DATA)
+			CPPUNIT_ASSERT(exporter->ship(one));
+	}
+
+	CPPUNIT_ASSERT(exporter->exportBatch());
+	CPPUNIT_ASSERT(exporter->exportBatch());
+	CPPUNIT_ASSERT(exporter->exportBatch());
+	CPPUNIT_ASSERT_EQUAL(3, confirmer->exportsCount());
+
+	Thread::sleep(50);
+
+	confirmer->confirmExport();
+	confirmer->confirmExport();
+	confirmer->confirmExport();
+	exporter->ackConfirmed();
+
+	CPPUNIT_ASSERT_EQUAL(4, exporter->batchSize());
+
+	CPPUNIT_ASSERT(exporter->exportBatch());
+	Thread::sleep(50);
+
+	confirmer->confirmExport();
+	exporter->ackConfirmed();
+
+	CPPUNIT_ASSERT_EQUAL(2, exporter->batchSize());
+
+	m_connector->clearListeners();
+}
+
+/**
+ * @brief Export a batch that is never confirmed in time and expect it is
+ * not tracked anymore and considered as confirmed too late. Its late
+ * confirmation still acknowledges its data but does not affect the batch
+ * size.
+ */
+void GWSQueuingExporterTest::testAdaptivePruneUnconfirmed()
+{
+	SensorDataConfirmer::Ptr confirmer = new SensorDataConfirmer(*m_connector);
+	TestableGWSQueuingExporter::Ptr exporter = new TestableGWSQueuingExporter;
+
+	exporter->setConnector(m_connector);
+	exporter->setStrategy(m_queuingStrategy);
+	exporter->setBatchMode("adaptive");
+	exporter->setActiveCount(8);
+	exporter->setLatencyTarget(10 * Timespan::MILLISECONDS);
+	exporter->setAcquireTimeout(0);
+
+	m_connector->addListener(confirmer);
+	m_connector->addListener(exporter);
+
+	for (const auto &one : DATA)
+		CPPUNIT_ASSERT(exporter->ship(one));
+
+	CPPUNIT_ASSERT(exporter->exportBatch());
+	CPPUNIT_ASSERT_EQUAL(1, exporter->inFlight());
+
+	exporter->ackConfirmed();
+	CPPUNIT_ASSERT_EQUAL(8, exporter->batchSize());
+
+	// longer than 8 times the latencyTarget
+	Thread::sleep(150);
+
+	exporter->ackConfirmed();
+	CPPUNIT_ASSERT_EQUAL(4, exporter->batchSize());
+	CPPUNIT_ASSERT_EQUAL(1, exporter->inFlight());
+
+	confirmer->confirmExport();
+	exporter->ackConfirmed();
+
+	CPPUNIT_ASSERT_EQUAL(4, exporter->batchSize());
+	CPPUNIT_ASSERT_EQUAL(0, exporter->inFlight());
+
+	m_connector->clearListeners();
+}
+
 }
@@ -35,6 +35,8 @@ class GWSResenderTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testResendAcceptFailure);
 	CPPUNIT_TEST(testResendSuccessFailureBug);
 	CPPUNIT_TEST(testResendFailureSuccessBug);
+	CPPUNIT_TEST(testAdaptiveResendTimeout);
+	CPPUNIT_TEST(testPacedFlushAfterReconnect);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -49,6 +51,8 @@ public:
 	void testResendAcceptFailure();
 	void testResendSuccessFailureBug();
 	void testResendFailureSuccessBug();
+	void testAdaptiveResendTimeout();
+	void testPacedFlushAfterReconnect();
 
 private:
 	NonAsyncExecutor::Ptr m_executor;
@@ -448,4 +452,107 @@ void GWSResenderTest::testResendFailureSuccessBug()
 	CPPUNIT_ASSERT_EQUAL(GWResponse::Status::FAILED, tmp1->status());
 }
 
+/**
+ * @brief Test that in the adaptive mode the resend timeout follows
+ * the measured RTT (bounded by minResendTimeout) and that it is doubled
+ * for each resend of the same message.
+ */
+void GWSResenderTest::testAdaptiveResendTimeout()
+{
+	SentWatcher::Ptr watcher = new SentWatcher;
+	m_connector->addListener(watcher);
+
+	m_resender->setAdaptive(true);
+	m_resender->setMinResendTimeout(1 * Timespan::SECONDS);
+
+	GWNewDeviceRequest::Ptr first = new GWNewDeviceRequest;
+	first->setID(GlobalID::parse("0d3bd6a1-9a67-4b8e-8f43-1ad1a5d40e6a"));
+	first->setDeviceID(0xa300000000000001);
+
+	const string type = first->type().toString();
+	CPPUNIT_ASSERT_EQUAL(30 * Timespan::SECONDS,
+		m_resender->resendTimeoutOf(type).totalMicroseconds());
+
+	m_resender->onTrySend(first);
+	m_resender->onSent(first);
+
+	GWResponse::Ptr response = first->derive();
+	response->setStatus(GWResponse::Status::SUCCESS);
+	m_resender->onResponse(response);
+
+	// RTT is almost zero, thus the minimum applies
+	CPPUNIT_ASSERT_EQUAL(1 * Timespan::SECONDS,
+		m_resender->resendTimeoutOf(type).totalMicroseconds());
+
+	GWNewDeviceRequest::Ptr second = new GWNewDeviceRequest;
+	second->setID(GlobalID::parse("6a2f5b8e-3c1d-4d7a-9b0e-5f4c3a2b1d0e"));
+	second->setDeviceID(0xa300000000000002);
+
+	m_resender->onTrySend(second);
+	m_resender->onSent(second);
+
+	const Clock sent;
+	auto it = m_resender->resendOrGet(sent + 500 * Timespan::MILLISECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT(watcher->sent().empty());
+
+	it = m_resender->resendOrGet(sent + 2 * Timespan::SECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT_EQUAL(1, watcher->sent().size());
+
+	// backoff: the second resend is scheduled after 2 seconds
+	const Clock resent;
+	it = m_resender->resendOrGet(resent + 1500 * Timespan::MILLISECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT_EQUAL(1, watcher->sent().size());
+
+	it = m_resender->resendOrGet(resent + 3 * Timespan::SECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT_EQUAL(2, watcher->sent().size());
+}
+
+/**
+ * @brief Test that messages that became due while being disconnected
+ * are resent one by one with the flushInterval between them after
+ * reconnecting.
+ */
+void GWSResenderTest::testPacedFlushAfterReconnect()
+{
+	SentWatcher::Ptr watcher = new SentWatcher;
+	m_connector->addListener(watcher);
+
+	m_resender->setFlushInterval(100 * Timespan::MILLISECONDS);
+
+	GWSensorDataExport::Ptr first = new GWSensorDataExport;
+	first->setID(GlobalID::parse("1b0e6c55-2f7d-4b8f-a0b4-3c2d1e0f9a8b"));
+
+	GWSensorDataExport::Ptr second = new GWSensorDataExport;
+	second->setID(GlobalID::parse("7c9d8e1f-0a2b-4c3d-8e5f-6a7b8c9d0e1f"));
+
+	m_resender->onTrySend(first);
+	m_resender->onSent(first);
+	m_resender->onTrySend(second);
+	m_resender->onSent(second);
+
+	m_resender->onDisconnected({"localhost", 8012});
+	m_resender->onConnected({"localhost", 8012});
+
+	const Clock now;
+	auto it = m_resender->resendOrGet(now + 40 * Timespan::SECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT_EQUAL(1, watcher->sent().size());
+	CPPUNIT_ASSERT(watcher->sent().front() == first->id());
+
+	// the second one is overdue but paced
+	it = m_resender->resendOrGet(now + 40 * Timespan::SECONDS);
+	CPPUNIT_ASSERT(it != end(m_resender->waiting()));
+	CPPUNIT_ASSERT(it->second->id() == second->id());
+	CPPUNIT_ASSERT_EQUAL(1, watcher->sent().size());
+
+	it = m_resender->resendOrGet(now + 40 * Timespan::SECONDS
+			+ 100 * Timespan::MILLISECONDS);
+	CPPUNIT_ASSERT_EQUAL(2, watcher->sent().size());
+	CPPUNIT_ASSERT(watcher->sent().back() == second->id());
+}
+
 }
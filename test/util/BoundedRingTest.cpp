@@ -0,0 +1,162 @@
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/AtomicCounter.h>
+#include <Poco/Exception.h>
+#include <Poco/SharedPtr.h>
+#include <Poco/Thread.h>
+
+#include "cppunit/BetterAssert.h"
+#include "util/BoundedRing.h"
+
+using namespace Poco;
+using namespace std;
+
+namespace BeeeOn {
+
+class BoundedRingTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(BoundedRingTest);
+	CPPUNIT_TEST(testPushPop);
+	CPPUNIT_TEST(testDrain);
+	CPPUNIT_TEST(testConcurrentProducers);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void testPushPop();
+	void testDrain();
+	void testConcurrentProducers();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BoundedRingTest);
+
+/**
+ * @brief Test that push() fails on a full ring, pop() fails on an empty ring
+ * and the items are popped in the FIFO order even when wrapping around.
+ */
+void BoundedRingTest::testPushPop()
+{
+	CPPUNIT_ASSERT_THROW(BoundedRing<int>(0), InvalidArgumentException);
+
+	BoundedRing<int> ring(3);
+	int item;
+
+	CPPUNIT_ASSERT(ring.empty());
+	CPPUNIT_ASSERT(!ring.pop(item));
+
+	CPPUNIT_ASSERT(ring.push(1));
+	CPPUNIT_ASSERT(ring.push(2));
+	CPPUNIT_ASSERT(ring.push(3));
+	CPPUNIT_ASSERT(!ring.push(4));
+	CPPUNIT_ASSERT_EQUAL(3, ring.size());
+
+	CPPUNIT_ASSERT(ring.pop(item));
+	CPPUNIT_ASSERT_EQUAL(1, item);
+
+	CPPUNIT_ASSERT(ring.push(4));
+
+	for (int i = 2; i <= 4; ++i) {
+		CPPUNIT_ASSERT(ring.pop(item));
+		CPPUNIT_ASSERT_EQUAL(i, item);
+	}
+
+	CPPUNIT_ASSERT(ring.empty());
+	CPPUNIT_ASSERT(!ring.pop(item));
+}
+
+/**
+ * @brief Test that drain() removes up to the given count of the oldest
+ * items at once and appends them to the given container.
+ */
+void BoundedRingTest::testDrain()
+{
+	BoundedRing<int> ring(4);
+	deque<int> items;
+
+	CPPUNIT_ASSERT_EQUAL(0, ring.drain(items, 10));
+
+	for (int i = 0; i < 4; ++i)
+		CPPUNIT_ASSERT(ring.push(i));
+
+	CPPUNIT_ASSERT_EQUAL(3, ring.drain(items, 3));
+	CPPUNIT_ASSERT_EQUAL(3, items.size());
+	CPPUNIT_ASSERT_EQUAL(0, items[0]);
+	CPPUNIT_ASSERT_EQUAL(2, items[2]);
+
+	CPPUNIT_ASSERT(ring.push(4));
+	CPPUNIT_ASSERT(ring.push(5));
+
+	CPPUNIT_ASSERT_EQUAL(3, ring.drain(items, 10));
+	CPPUNIT_ASSERT_EQUAL(6, items.size());
+
+	for (int i = 0; i < 6; ++i)
+		CPPUNIT_ASSERT_EQUAL(i, items[i]);
+
+	CPPUNIT_ASSERT(ring.empty());
+}
+
+/**
+ * @brief Test multiple producers with drop-oldest semantics against a single
+ * draining consumer. No item can be lost or duplicated and items of each
+ * producer must be consumed in their order.
+ */
+void BoundedRingTest::testConcurrentProducers()
+{
+	static const int PRODUCERS = 4;
+	static const int ITEMS = 20000;
+
+	BoundedRing<int> ring(16);
+	AtomicCounter dropped;
+	AtomicCounter finished;
+
+	vector<SharedPtr<Thread>> threads;
+
+	auto produce = [&](int id) {
+		for (int i = 0; i < ITEMS; ++i) {
+			const int item = id * ITEMS + i;
+
+			while (!ring.push(item)) {
+				int oldest;
+				if (ring.pop(oldest))
+					++dropped;
+			}
+		}
+
+		++finished;
+	};
+
+	vector<function<void()>> producers;
+	for (int id = 0; id < PRODUCERS; ++id)
+		producers.emplace_back([&, id]() {produce(id);});
+
+	for (auto &producer : producers) {
+		SharedPtr<Thread> thread = new Thread;
+		thread->startFunc(producer);
+		threads.emplace_back(thread);
+	}
+
+	vector<int> last(PRODUCERS, -1);
+	size_t consumed = 0;
+	vector<int> batch;
+
+	while (finished < PRODUCERS || !ring.empty()) {
+		batch.clear();
+		ring.drain(batch, 8);
+
+		for (const auto item : batch) {
+			const int id = item / ITEMS;
+			CPPUNIT_ASSERT(item % ITEMS > last[id]);
+			last[id] = item % ITEMS;
+		}
+
+		consumed += batch.size();
+	}
+
+	for (auto thread : threads)
+		thread->join();
+
+	CPPUNIT_ASSERT_EQUAL(PRODUCERS * ITEMS, consumed + dropped);
+}
+
+}
@@ -18,12 +18,14 @@ class JSONSensorDataFormatterTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST(testFormatNaN);
 	CPPUNIT_TEST(testFormatINFINITY);
 	CPPUNIT_TEST(testFormatNoValues);
+	CPPUNIT_TEST(testFormatToAppends);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void testFormat();
 	void testFormatNaN();
 	void testFormatINFINITY();
 	void testFormatNoValues();
+	void testFormatToAppends();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(JSONSensorDataFormatterTest);
@@ -94,4 +96,29 @@ void JSONSensorDataFormatterTest::testFormatNoValues()
 	CPPUNIT_ASSERT_EQUAL(str, expected);
 }
 
+/**
+ * @brief Test that formatTo() appends to the given buffer and produces
+ * the same output as format(), also for IDs using all 64 bits.
+ */
+void JSONSensorDataFormatterTest::testFormatToAppends()
+{
+	SensorData data;
+	data.setDeviceID(DeviceID(0xa3fedcba98765432));
+	data.setTimestamp(Timestamp(1500000000123456));
+	data.insertValue(SensorValue(ModuleID(65535), -12.3456));
+	data.insertValue(SensorValue(ModuleID(0), 0));
+
+	JSONSensorDataFormatter formatter;
+	string buffer = "prefix:";
+	formatter.formatTo(data, buffer);
+
+	const string expected = "prefix:"
+		R"({"device_id":")" + data.deviceID().toString()
+		+ R"(","timestamp":1500000000123456)"
+		+ R"(,"data":[{"module_id":65535,"value":-12.346},{"module_id":0,"value":0.000}]})";
+
+	CPPUNIT_ASSERT_EQUAL(expected, buffer);
+	CPPUNIT_ASSERT_EQUAL(expected.substr(7), formatter.format(data));
+}
+
 }
@@ -28,6 +28,7 @@ class JournalTest : public FileTestFixture {
 	CPPUNIT_TEST(testAppendWithRewrite);
 	CPPUNIT_TEST(testEatMyself);
 	CPPUNIT_TEST(testCheckConsistent);
+	CPPUNIT_TEST(testLookup);
 	CPPUNIT_TEST_SUITE_END();
 public:
 	void setUp();
@@ -44,6 +45,7 @@ public:
 	void testAppendWithRewrite();
 	void testEatMyself();
 	void testCheckConsistent();
+	void testLookup();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(JournalTest);
@@ -522,4 +524,44 @@ void JournalTest::testCheckConsistent()
 	CPPUNIT_ASSERT_NO_THROW(journal.checkConsistent(input));
 }
 
+/**
+ * @brief Test lookups of the most recent values including the records
+ * waiting for flush and the current state of records after a drop.
+ */
+void JournalTest::testLookup()
+{
+	Journal journal(testingPath());
+	journal.load();
+
+	CPPUNIT_ASSERT_EQUAL(2.5, journal.currentDuplicatesFactor());
+
+	CPPUNIT_ASSERT_EQUAL("354", journal["a"].value());
+	CPPUNIT_ASSERT(journal["b"].isNull());
+	CPPUNIT_ASSERT_EQUAL("0", journal["c"].value());
+	CPPUNIT_ASSERT_EQUAL("56", journal["d"].value());
+	CPPUNIT_ASSERT(journal["e"].isNull());
+
+	journal.append("b", "1", false);
+	journal.append("a", "2", false);
+
+	CPPUNIT_ASSERT_EQUAL("1", journal["b"].value());
+	CPPUNIT_ASSERT_EQUAL("2", journal["a"].value());
+	CPPUNIT_ASSERT_EQUAL(2.5, journal.currentDuplicatesFactor());
+
+	journal.drop("d", false);
+	CPPUNIT_ASSERT(journal["d"].isNull());
+
+	const list<Journal::Record> expected = {
+		{"a", "2"},
+		{"c", "0"},
+		{"b", "1"},
+	};
+
+	CPPUNIT_ASSERT(expected == journal.records());
+
+	journal.flush();
+	CPPUNIT_ASSERT(expected == journal.records());
+	CPPUNIT_ASSERT_NO_THROW(journal.checkConsistent());
+}
+
 }
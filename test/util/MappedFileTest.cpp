@@ -0,0 +1,93 @@
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+
+#include "cppunit/BetterAssert.h"
+#include "cppunit/FileTestFixture.h"
+#include "util/MappedFile.h"
+
+using namespace Poco;
+using namespace std;
+
+namespace BeeeOn {
+
+class MappedFileTest : public FileTestFixture {
+	CPPUNIT_TEST_SUITE(MappedFileTest);
+	CPPUNIT_TEST(testMapContents);
+	CPPUNIT_TEST(testMapEmpty);
+	CPPUNIT_TEST(testMapMissing);
+	CPPUNIT_TEST(testMapDirectory);
+	CPPUNIT_TEST_SUITE_END();
+public:
+	void setUp();
+	void testMapContents();
+	void testMapEmpty();
+	void testMapMissing();
+	void testMapDirectory();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MappedFileTest);
+
+void MappedFileTest::setUp()
+{
+	setUpAsDirectory();
+}
+
+/**
+ * @brief Test the mapping exposes the whole contents of the file
+ * as it was when mapped.
+ */
+void MappedFileTest::testMapContents()
+{
+	File file(Path(testingPath(), "data"));
+	writeFile(file, string("some\ncontents\0with zero", 23));
+
+	MappedFile mapped(file.path());
+
+	CPPUNIT_ASSERT_EQUAL(23, mapped.size());
+	CPPUNIT_ASSERT(mapped.data() != nullptr);
+	CPPUNIT_ASSERT_EQUAL(
+		string("some\ncontents\0with zero", 23),
+		string(mapped.data(), mapped.size()));
+}
+
+/**
+ * @brief Test an empty file can be mapped and it has no data.
+ */
+void MappedFileTest::testMapEmpty()
+{
+	File file(Path(testingPath(), "empty"));
+	writeFile(file, "");
+
+	MappedFile mapped(file.path());
+
+	CPPUNIT_ASSERT_EQUAL(0, mapped.size());
+	CPPUNIT_ASSERT(mapped.data() == nullptr);
+}
+
+/**
+ * @brief Test mapping of a missing file fails by FileNotFoundException
+ * to be distinguishable from other I/O errors.
+ */
+void MappedFileTest::testMapMissing()
+{
+	CPPUNIT_ASSERT_THROW(
+		MappedFile(Path(testingPath(), "missing")),
+		FileNotFoundException);
+}
+
+/**
+ * @brief Test mapping of a directory fails by ReadFileException.
+ */
+void MappedFileTest::testMapDirectory()
+{
+	File dir(Path(testingPath(), "dir"));
+	dir.createDirectories();
+
+	CPPUNIT_ASSERT_THROW(
+		MappedFile(dir.path()),
+		ReadFileException);
+}
+
+}
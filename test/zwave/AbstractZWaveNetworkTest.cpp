@@ -17,10 +17,18 @@ namespace BeeeOn {
 class AbstractZWaveNetworkTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE(AbstractZWaveNetworkTest);
 	CPPUNIT_TEST(testPollTimeout);
+	CPPUNIT_TEST(testUnboundedQueue);
+	CPPUNIT_TEST(testFullQueueReplacesValue);
+	CPPUNIT_TEST(testFullQueueDropsOldestValue);
+	CPPUNIT_TEST(testFullQueueKeepsLifecycle);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
 	void testPollTimeout();
+	void testUnboundedQueue();
+	void testFullQueueReplacesValue();
+	void testFullQueueDropsOldestValue();
+	void testFullQueueKeepsLifecycle();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(AbstractZWaveNetworkTest);
@@ -51,8 +59,35 @@ public:
 	{
 		throw NotImplementedException(__func__);
 	}
+
+	void fireValue(uint8_t node, uint8_t cc, const string &value)
+	{
+		const ZWaveNode::Value v(
+			ZWaveNode::Identity(0x1234, node),
+			ZWaveNode::CommandClass(cc, 0, 0),
+			value);
+
+		notifyEvent(PollEvent::createValue(v));
+	}
+
+	void fireNewNode(uint8_t node)
+	{
+		notifyEvent(PollEvent::createNewNode(ZWaveNode(ZWaveNode::Identity(0x1234, node))));
+	}
 };
 
+static void assertValue(
+		const PollEvent &e,
+		uint8_t node,
+		uint8_t cc,
+		const string &value)
+{
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_VALUE, e.type());
+	CPPUNIT_ASSERT_EQUAL(node, e.value().node().node);
+	CPPUNIT_ASSERT_EQUAL(cc, e.value().commandClass().id());
+	CPPUNIT_ASSERT_EQUAL(value, e.value().value());
+}
+
 void AbstractZWaveNetworkTest::testPollTimeout()
 {
 	TestableAbstractZWaveNetwork network;
@@ -64,4 +99,107 @@ void AbstractZWaveNetworkTest::testPollTimeout()
 	CPPUNIT_ASSERT(started.elapsed() >= 10 * Timespan::MILLISECONDS);
 }
 
+/**
+ * @brief Test that without capacity no event is ever dropped
+ * and the high-water mark is tracked.
+ */
+void AbstractZWaveNetworkTest::testUnboundedQueue()
+{
+	TestableAbstractZWaveNetwork network;
+
+	for (int i = 0; i < 10; ++i)
+		network.fireValue(2, 0x31, to_string(i));
+
+	const auto stats = network.eventsQueueStats();
+	CPPUNIT_ASSERT_EQUAL(10, stats.depth);
+	CPPUNIT_ASSERT_EQUAL(10, stats.highWaterMark);
+	CPPUNIT_ASSERT_EQUAL(0, stats.replaced);
+	CPPUNIT_ASSERT_EQUAL(0, stats.dropped);
+
+	for (int i = 0; i < 10; ++i)
+		assertValue(network.pollEvent(0), 2, 0x31, to_string(i));
+
+	CPPUNIT_ASSERT_EQUAL(0, network.eventsQueueStats().depth);
+	CPPUNIT_ASSERT_EQUAL(10, network.eventsQueueStats().highWaterMark);
+}
+
+/**
+ * @brief Test that a value of the same node and command class
+ * replaces the queued one in place when the queue is full.
+ */
+void AbstractZWaveNetworkTest::testFullQueueReplacesValue()
+{
+	TestableAbstractZWaveNetwork network;
+	network.setEventsQueueCapacity(3);
+
+	CPPUNIT_ASSERT_THROW(network.setEventsQueueCapacity(-1), InvalidArgumentException);
+
+	network.fireValue(2, 0x31, "1");
+	network.fireValue(2, 0x25, "0");
+	network.fireValue(3, 0x31, "5");
+	network.fireValue(2, 0x31, "2");
+	network.fireValue(2, 0x31, "3");
+
+	const auto stats = network.eventsQueueStats();
+	CPPUNIT_ASSERT_EQUAL(3, stats.depth);
+	CPPUNIT_ASSERT_EQUAL(3, stats.highWaterMark);
+	CPPUNIT_ASSERT_EQUAL(2, stats.replaced);
+	CPPUNIT_ASSERT_EQUAL(0, stats.dropped);
+
+	assertValue(network.pollEvent(0), 2, 0x31, "3");
+	assertValue(network.pollEvent(0), 2, 0x25, "0");
+	assertValue(network.pollEvent(0), 3, 0x31, "5");
+	CPPUNIT_ASSERT(network.pollEvent(0).isNone());
+}
+
+/**
+ * @brief Test that the oldest value is dropped when the queue is full
+ * and there is no value of the same node and command class.
+ */
+void AbstractZWaveNetworkTest::testFullQueueDropsOldestValue()
+{
+	TestableAbstractZWaveNetwork network;
+	network.setEventsQueueCapacity(2);
+
+	network.fireNewNode(2);
+	network.fireValue(2, 0x31, "1");
+	network.fireValue(2, 0x25, "0");
+
+	const auto stats = network.eventsQueueStats();
+	CPPUNIT_ASSERT_EQUAL(2, stats.depth);
+	CPPUNIT_ASSERT_EQUAL(0, stats.replaced);
+	CPPUNIT_ASSERT_EQUAL(1, stats.dropped);
+
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_NEW_NODE, network.pollEvent(0).type());
+	assertValue(network.pollEvent(0), 2, 0x25, "0");
+	CPPUNIT_ASSERT(network.pollEvent(0).isNone());
+}
+
+/**
+ * @brief Test that life-cycle events are enqueued beyond the capacity
+ * while values that do not fit are dropped.
+ */
+void AbstractZWaveNetworkTest::testFullQueueKeepsLifecycle()
+{
+	TestableAbstractZWaveNetwork network;
+	network.setEventsQueueCapacity(2);
+
+	network.fireNewNode(2);
+	network.startInclusion();
+	network.fireNewNode(3);
+	network.cancelInclusion();
+	network.fireValue(3, 0x31, "1");
+
+	const auto stats = network.eventsQueueStats();
+	CPPUNIT_ASSERT_EQUAL(4, stats.depth);
+	CPPUNIT_ASSERT_EQUAL(4, stats.highWaterMark);
+	CPPUNIT_ASSERT_EQUAL(1, stats.dropped);
+
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_NEW_NODE, network.pollEvent(0).type());
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_INCLUSION_START, network.pollEvent(0).type());
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_NEW_NODE, network.pollEvent(0).type());
+	CPPUNIT_ASSERT_EQUAL(PollEvent::EVENT_INCLUSION_DONE, network.pollEvent(0).type());
+	CPPUNIT_ASSERT(network.pollEvent(0).isNone());
+}
+
 }
@@ -0,0 +1,303 @@
+#include <vector>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <Poco/Event.h>
+#include <Poco/Exception.h>
+#include <Poco/Thread.h>
+
+#include "cppunit/BetterAssert.h"
+#include "core/Distributor.h"
+#include "core/MetricsRegistry.h"
+#include "model/SensorData.h"
+#include "zwave/AbstractZWaveNetwork.h"
+#include "zwave/ZWaveDeviceManager.h"
+
+using namespace std;
+using namespace Poco;
+
+namespace BeeeOn {
+
+class ZWaveDeviceManagerTest : public CppUnit::TestFixture {
+	CPPUNIT_TEST_SUITE(ZWaveDeviceManagerTest);
+	CPPUNIT_TEST(testCoalesceSettings);
+	CPPUNIT_TEST(testCoalesceWindow);
+	CPPUNIT_TEST(testCoalesceSameModule);
+	CPPUNIT_TEST(testCoalesceMaxDelay);
+	CPPUNIT_TEST(testCoalesceFlushOnStop);
+	CPPUNIT_TEST(testCoalescingMetrics);
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testCoalesceSettings();
+	void testCoalesceWindow();
+	void testCoalesceSameModule();
+	void testCoalesceMaxDelay();
+	void testCoalesceFlushOnStop();
+	void testCoalescingMetrics();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ZWaveDeviceManagerTest);
+
+static const DeviceID DEVICE0(DevicePrefix::PREFIX_ZWAVE, 1);
+static const DeviceID DEVICE1(DevicePrefix::PREFIX_ZWAVE, 2);
+
+class CollectingDistributor : public Distributor {
+public:
+	typedef SharedPtr<CollectingDistributor> Ptr;
+
+	void exportData(const SensorData &data) override
+	{
+		m_data.emplace_back(data);
+	}
+
+	const vector<SensorData> &data() const
+	{
+		return m_data;
+	}
+
+private:
+	vector<SensorData> m_data;
+};
+
+class PollingZWaveNetwork : public AbstractZWaveNetwork {
+public:
+	PollEvent pollEvent(const Timespan &timeout) override
+	{
+		m_polled.set();
+		return AbstractZWaveNetwork::pollEvent(timeout);
+	}
+
+	void startInclusion() override
+	{
+		throw NotImplementedException(__func__);
+	}
+
+	void cancelInclusion() override
+	{
+		throw NotImplementedException(__func__);
+	}
+
+	void startRemoveNode() override
+	{
+		throw NotImplementedException(__func__);
+	}
+
+	void cancelRemoveNode() override
+	{
+		throw NotImplementedException(__func__);
+	}
+
+	void postValue(const ZWaveNode::Value &) override
+	{
+		throw NotImplementedException(__func__);
+	}
+
+	void waitPolled()
+	{
+		m_polled.wait(10000);
+	}
+
+private:
+	Poco::Event m_polled;
+};
+
+class TestableZWaveDeviceManager : public ZWaveDeviceManager {
+public:
+	using ZWaveDeviceManager::coalesce;
+	using ZWaveDeviceManager::flushCoalesced;
+	using ZWaveDeviceManager::shipCoalesced;
+};
+
+static size_t countValues(const SensorData &data)
+{
+	size_t count = 0;
+
+	for (auto it = data.begin(); it != data.end(); ++it)
+		count += 1;
+
+	return count;
+}
+
+/**
+ * @brief Test validation of the coalescing settings and that each
+ * shipped SensorData is counted.
+ */
+void ZWaveDeviceManagerTest::testCoalesceSettings()
+{
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+
+	CPPUNIT_ASSERT_NO_THROW(manager.setCoalesceWindow(0));
+	CPPUNIT_ASSERT_THROW(
+		manager.setCoalesceWindow(-1 * Timespan::MILLISECONDS),
+		InvalidArgumentException);
+	CPPUNIT_ASSERT_THROW(
+		manager.setCoalesceMaxDelay(0),
+		InvalidArgumentException);
+
+	manager.shipCoalesced({DEVICE0, Timestamp{}, {SensorValue(ModuleID(0), 1)}});
+	manager.shipCoalesced({DEVICE0, Timestamp{}, {SensorValue(ModuleID(1), 2)}});
+
+	CPPUNIT_ASSERT_EQUAL(2, distributor->data().size());
+	CPPUNIT_ASSERT_EQUAL(2, manager.coalescingStats().shipped);
+}
+
+/**
+ * @brief Test that values of a device received within the window are
+ * shipped as a single SensorData once the window expires. Values of
+ * different devices are never merged together.
+ */
+void ZWaveDeviceManagerTest::testCoalesceWindow()
+{
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+	manager.setPollTimeout(30 * Timespan::SECONDS);
+	manager.setCoalesceWindow(100 * Timespan::MILLISECONDS);
+	manager.setCoalesceMaxDelay(10 * Timespan::SECONDS);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 10));
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(1), 11));
+	manager.coalesce(DEVICE1, SensorValue(ModuleID(0), 20));
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(2), 12));
+
+	const Timespan timeout = manager.flushCoalesced();
+	CPPUNIT_ASSERT(distributor->data().empty());
+	CPPUNIT_ASSERT(timeout <= 100 * Timespan::MILLISECONDS);
+
+	Thread::sleep(150);
+
+	CPPUNIT_ASSERT_EQUAL(
+		30 * Timespan::SECONDS,
+		manager.flushCoalesced().totalMicroseconds());
+	CPPUNIT_ASSERT_EQUAL(2, distributor->data().size());
+
+	const SensorData &data0 = distributor->data()[0];
+	CPPUNIT_ASSERT_EQUAL(DEVICE0.toString(), data0.deviceID().toString());
+	CPPUNIT_ASSERT_EQUAL(3, countValues(data0));
+
+	const SensorData &data1 = distributor->data()[1];
+	CPPUNIT_ASSERT_EQUAL(DEVICE1.toString(), data1.deviceID().toString());
+	CPPUNIT_ASSERT_EQUAL(1, countValues(data1));
+}
+
+/**
+ * @brief Test that a second value of an already pending module causes
+ * the pending data to be shipped and the new value starts a new data.
+ */
+void ZWaveDeviceManagerTest::testCoalesceSameModule()
+{
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+	manager.setCoalesceWindow(10 * Timespan::SECONDS);
+	manager.setCoalesceMaxDelay(10 * Timespan::SECONDS);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 10));
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(1), 11));
+	CPPUNIT_ASSERT(distributor->data().empty());
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 15));
+	CPPUNIT_ASSERT_EQUAL(1, distributor->data().size());
+	CPPUNIT_ASSERT_EQUAL(2, countValues(distributor->data()[0]));
+	CPPUNIT_ASSERT_EQUAL(10.0, distributor->data()[0].begin()->value());
+
+	manager.flushCoalesced(true);
+	CPPUNIT_ASSERT_EQUAL(2, distributor->data().size());
+	CPPUNIT_ASSERT_EQUAL(1, countValues(distributor->data()[1]));
+	CPPUNIT_ASSERT_EQUAL(15.0, distributor->data()[1].begin()->value());
+}
+
+/**
+ * @brief Test that values arriving continuously (each restarting
+ * the window) are shipped at latest after coalesceMaxDelay since
+ * the first of them.
+ */
+void ZWaveDeviceManagerTest::testCoalesceMaxDelay()
+{
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+	manager.setCoalesceWindow(1 * Timespan::SECONDS);
+	manager.setCoalesceMaxDelay(200 * Timespan::MILLISECONDS);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 10));
+	Thread::sleep(100);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(1), 11));
+	const Timespan timeout = manager.flushCoalesced();
+	CPPUNIT_ASSERT(distributor->data().empty());
+	CPPUNIT_ASSERT(timeout <= 100 * Timespan::MILLISECONDS);
+
+	Thread::sleep(150);
+
+	manager.flushCoalesced();
+	CPPUNIT_ASSERT_EQUAL(1, distributor->data().size());
+	CPPUNIT_ASSERT_EQUAL(2, countValues(distributor->data()[0]));
+}
+
+/**
+ * @brief Test that data still pending when the manager stops are
+ * shipped before its run() returns.
+ */
+void ZWaveDeviceManagerTest::testCoalesceFlushOnStop()
+{
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+	SharedPtr<PollingZWaveNetwork> network = new PollingZWaveNetwork;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+	manager.setNetwork(network);
+	manager.setCoalesceWindow(10 * Timespan::SECONDS);
+	manager.setCoalesceMaxDelay(10 * Timespan::SECONDS);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 10));
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(1), 11));
+
+	Thread thread;
+	thread.startFunc([&]() {
+		manager.run();
+	});
+
+	network->waitPolled();
+	CPPUNIT_ASSERT(distributor->data().empty());
+
+	manager.stop();
+	CPPUNIT_ASSERT_NO_THROW(thread.join(10000));
+
+	CPPUNIT_ASSERT_EQUAL(1, distributor->data().size());
+	CPPUNIT_ASSERT_EQUAL(2, countValues(distributor->data()[0]));
+}
+
+/**
+ * @brief Test that the counts of received values and shipped data
+ * are exported via MetricsRegistry.
+ */
+void ZWaveDeviceManagerTest::testCoalescingMetrics()
+{
+	MetricsRegistry::Ptr registry = new MetricsRegistry;
+	CollectingDistributor::Ptr distributor = new CollectingDistributor;
+
+	TestableZWaveDeviceManager manager;
+	manager.setDistributor(distributor);
+	manager.setMetricsRegistry(registry);
+	manager.setCoalesceWindow(10 * Timespan::SECONDS);
+
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(0), 10));
+	manager.coalesce(DEVICE0, SensorValue(ModuleID(1), 11));
+	manager.flushCoalesced(true);
+
+	CPPUNIT_ASSERT_EQUAL(2, registry->counter(
+		"beeeon_zwave_values_total", "")->value());
+	CPPUNIT_ASSERT_EQUAL(1, registry->counter(
+		"beeeon_zwave_shipped_total", "")->value());
+	CPPUNIT_ASSERT_EQUAL(2.0, manager.coalescingStats().mergeRatio());
+}
+
+}